@@ -18,13 +18,12 @@
 
 #import "MXKAttachmentsViewController.h"
 
-#import <WebKit/WebKit.h>
-
 @import MatrixSDK.MXMediaManager;
 
 #import "MXKMediaCollectionViewCell.h"
 
 #import "MXKPieChartView.h"
+#import "MXKAnimatedImageView.h"
 
 #import "MXKConstants.h"
 
@@ -655,7 +654,7 @@
                 
                 cell.customView.hidden = NO;
                 
-                // Animated gif is displayed in webview
+                // Animated gif is displayed in an animated image view
                 CGFloat minSize = (cell.frame.size.width < cell.frame.size.height) ? cell.frame.size.width : cell.frame.size.height;
                 CGFloat width, height;
                 if (attachment.contentInfo[@"w"] && attachment.contentInfo[@"h"])
@@ -689,7 +688,7 @@
                     height = minSize;
                 }
                 
-                WKWebView *animatedGifViewer = [[WKWebView alloc] initWithFrame:CGRectMake(0, 0, width, height)];
+                MXKAnimatedImageView *animatedGifViewer = [[MXKAnimatedImageView alloc] initWithFrame:CGRectMake(0, 0, width, height)];
                 animatedGifViewer.center = cell.customView.center;
                 animatedGifViewer.opaque = NO;
                 animatedGifViewer.backgroundColor = cell.customView.backgroundColor;
@@ -738,7 +737,7 @@
                     
                 }];
                 
-                void (^onDownloaded)(NSData *) = ^(NSData *data){
+                void (^onDownloaded)(void) = ^{
                     if (cell.notificationObserver)
                     {
                         [[NSNotificationCenter defaultCenter] removeObserver:cell.notificationObserver];
@@ -747,8 +746,6 @@
                     
                     if (animatedGifViewer.superview)
                     {
-                        [animatedGifViewer loadData:data MIMEType:@"image/gif" characterEncodingName:@"UTF-8" baseURL:[NSURL URLWithString:@"http://"]];
-                        
                         [pieChartView removeFromSuperview];
                         [previewImage removeFromSuperview];
                     }
@@ -767,8 +764,8 @@
                 };
                 
                 
-                [attachment getAttachmentData:^(NSData *data) {
-                    onDownloaded(data);
+                [animatedGifViewer setAnimatedImageWithAttachment:attachment success:^{
+                    onDownloaded();
                 } failure:^(NSError *error) {
                     onFailure(error);
                 }];
@@ -17,6 +17,7 @@
 #import "MXKContactListViewController.h"
 
 #import "MXKSectionedContacts.h"
+#import "MXKContactSearchIndex.h"
 
 #import "NSBundle+MatrixKit.h"
 #import "UIScrollView+MatrixKit.h"
@@ -43,6 +44,10 @@
     BOOL             searchBarShouldEndEditing;
     BOOL             ignoreSearchRequest;
     NSString* latestSearchedPattern;
+    // The local contacts are searched with the contact manager index, restricted to this screenshot
+    NSSet<NSString*> *localContactIDs;
+    // The search index of the matrix contacts screenshot, built on the first search
+    MXKContactSearchIndex *matrixContactsSearchIndex;
     
     NSArray* collationTitles;
     
@@ -199,6 +204,7 @@
     if (force || !localContactsArray)
     {
         localContactsArray = sharedManager.localContacts;
+        localContactIDs = nil;
         sectionedLocalContacts = [sharedManager getSectionedContacts:localContactsArray];
     }
 }
@@ -212,6 +218,7 @@
     if (force || !matrixContactsArray)
     {
         matrixContactsArray = sharedManager.matrixContacts;
+        matrixContactsSearchIndex = nil;
         sectionedMatrixContacts = [sharedManager getSectionedContacts:matrixContactsArray];
     }
 }
@@ -454,6 +461,9 @@
 
 - (void)onContactsRefresh:(NSNotification *)notif
 {
+    // The contacts may have been updated in place (display name, matrix ids...), the search index is outdated
+    matrixContactsSearchIndex = nil;
+    
     if ([notif.name isEqualToString:kMXKContactManagerDidUpdateMatrixContactsNotification])
     {
         [self updateSectionedMatrixContacts:YES];
@@ -590,14 +600,32 @@
         // Update filtered list
         if (searchText.length && contacts.count)
         {
-            filteredContacts = [[NSMutableArray alloc] init];
-            
             NSArray* patterns = [self patternsFromText:searchText];
-            for(MXKContact* contact in contacts)
+            
+            if (displayMatrixUsers)
             {
-                if ([contact matchedWithPatterns:patterns])
+                if (!matrixContactsSearchIndex)
+                {
+                    matrixContactsSearchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+                }
+                
+                filteredContacts = [[matrixContactsSearchIndex contactsMatchingPatterns:patterns] mutableCopy];
+            }
+            else
+            {
+                // The contact manager maintains the local contacts index, ignore the contacts which are not displayed yet
+                if (!localContactIDs)
+                {
+                    localContactIDs = [NSSet setWithArray:[contacts valueForKey:@"contactID"]];
+                }
+                
+                filteredContacts = [NSMutableArray array];
+                for (MXKContact *contact in [[MXKContactManager sharedManager].localContactsSearchIndex contactsMatchingPatterns:patterns])
                 {
-                    [filteredContacts addObject:contact];
+                    if ([localContactIDs containsObject:contact.contactID])
+                    {
+                        [filteredContacts addObject:contact];
+                    }
                 }
             }
         }
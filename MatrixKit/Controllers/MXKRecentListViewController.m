@@ -56,6 +56,11 @@
      The restart the event connnection
      */
     BOOL restartConnection;
+    
+    /**
+     The change set to apply at the next table refresh, if any.
+     */
+    MXKDataSourceChangeSet *pendingRecentsChangeSet;
 }
 
 @end
@@ -351,8 +356,34 @@
 
 - (void)refreshRecentsTable
 {
-    // For now, do a simple full reload
-    [self.recentsTableView reloadData];
+    MXKDataSourceChangeSet *changeSet = pendingRecentsChangeSet;
+    pendingRecentsChangeSet = nil;
+    
+    if (changeSet && _recentsTableView.dataSource == dataSource && _recentsTableView.numberOfSections == 1
+        && [dataSource numberOfSectionsInTableView:_recentsTableView] == 1
+        && [changeSet isValidForNumberOfRows:[_recentsTableView numberOfRowsInSection:0]
+                             newNumberOfRows:[dataSource tableView:_recentsTableView numberOfRowsInSection:0]])
+    {
+        if (changeSet.isEmpty)
+        {
+            return;
+        }
+        
+        // Only the impacted rows are updated
+        [_recentsTableView beginUpdates];
+        [changeSet applyToTableView:_recentsTableView withRowAnimation:UITableViewRowAnimationNone];
+        [_recentsTableView endUpdates];
+        
+        // A moved row displays the new data of its room
+        if (changeSet.movedIndexPaths.count)
+        {
+            [_recentsTableView reloadRowsAtIndexPaths:changeSet.movedIndexPaths.allValues withRowAnimation:UITableViewRowAnimationNone];
+        }
+    }
+    else
+    {
+        [self.recentsTableView reloadData];
+    }
 }
 
 - (void)hideSearchBar:(BOOL)hidden
@@ -415,9 +446,21 @@
     return MXKRecentTableViewCell.defaultReuseIdentifier;
 }
 
+- (void)dataSource:(MXKDataSource *)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet *)changeSet
+{
+    // Keep the change set for the next table refresh, and go through the legacy callback
+    // so that inherited classes which override it are still notified.
+    pendingRecentsChangeSet = changeSet;
+    
+    [self dataSource:dataSource didCellChange:nil];
+    
+    // The change set is obsolete if it has not been consumed
+    pendingRecentsChangeSet = nil;
+}
+
 - (void)dataSource:(MXKDataSource *)dataSource didCellChange:(id)changes
 {
-    // For now, do a simple full reload
+    // Apply the pending change set if any, do a full reload otherwise
     [self refreshRecentsTable];
 }
 
@@ -77,6 +77,18 @@
      */
     BOOL isPaginationInProgress;
     
+    /**
+     The changes reported by the room data source that have not been applied yet to the bubbles table.
+     */
+    MXKDataSourceChangeSet *pendingBubblesChangeSet;
+    
+    /**
+     YES when some changes reported by the room data source have been ignored (application in background,
+     pagination in progress...). The rows of the bubbles table do not match the data source anymore,
+     the next refresh must fully reload the table.
+     */
+    BOOL bubblesTableNeedsFullReload;
+    
     /**
      The back pagination spinner view.
      */
@@ -421,8 +433,9 @@
         }
         
         // Force full table refresh to take into account cell width change.
+        // The cell data cache is kept: the bubble heights are cached by width.
         self.bubbleTableViewDisplayInTransition = YES;
-        [self reloadBubblesTable:YES invalidateBubblesCellDataCache:YES];
+        [self reloadBubblesTable:YES invalidateBubblesCellDataCache:NO];
         self.bubbleTableViewDisplayInTransition = NO;
         
         self->shouldScrollToBottomOnTableRefresh = NO;
@@ -551,6 +564,10 @@
     [self dismissTemporarySubViews];
     
     _bubblesTableView.dataSource = nil;
+    if (@available(iOS 10.0, *))
+    {
+        _bubblesTableView.prefetchDataSource = nil;
+    }
     _bubblesTableView.delegate = nil;
     _bubblesTableView = nil;
     
@@ -606,6 +623,10 @@
     // Set up table delegates
     _bubblesTableView.delegate = self;
     _bubblesTableView.dataSource = roomDataSource; // Note: data source may be nil here, it will be set during [displayRoom:] call.
+    if (@available(iOS 10.0, *))
+    {
+        _bubblesTableView.prefetchDataSource = roomDataSource;
+    }
     
     // Set up default classes to use for cells
     [_bubblesTableView registerClass:MXKRoomIncomingTextMsgBubbleCell.class forCellReuseIdentifier:MXKRoomIncomingTextMsgBubbleCell.defaultReuseIdentifier];
@@ -707,6 +728,10 @@
             
             // Set up table data source
             _bubblesTableView.dataSource = roomDataSource;
+            if (@available(iOS 10.0, *))
+            {
+                _bubblesTableView.prefetchDataSource = roomDataSource;
+            }
         }
         
         // When ready, do the initial back pagination
@@ -1024,6 +1049,10 @@
     
     
     _bubblesTableView.dataSource = nil;
+    if (@available(iOS 10.0, *))
+    {
+        _bubblesTableView.prefetchDataSource = nil;
+    }
     _bubblesTableView.delegate = nil;
     
     if (self.hasRoomDataSourceOwnership)
@@ -2296,6 +2325,9 @@
     if (invalidateBubblesCellDataCache)
     {
         [self.roomDataSource invalidateBubblesCellDataCache];
+        
+        // All the rows must be refreshed
+        pendingBubblesChangeSet = nil;
     }
     
     // When scroll to bottom is not active, check whether we should keep the current event displayed at the bottom of the table
@@ -2303,7 +2335,7 @@
     {
         // Update content offset after refresh in order to keep visible the current event displayed at the bottom
         
-        [_bubblesTableView reloadData];
+        [self reloadBubblesTableData];
         
         // Retrieve the new cell index of the event displayed previously at the bottom of table
         NSInteger rowIndex = [roomDataSource indexOfCellDataWithEventId:currentEventIdAtTableBottom];
@@ -2402,8 +2434,8 @@
     }
     else
     {
-        // Do a full reload
-        [_bubblesTableView reloadData];
+        // Apply the pending changes, or do a full reload
+        [self reloadBubblesTableData];
     }
     
     if (shouldScrollToBottom)
@@ -2414,6 +2446,57 @@
     return shouldScrollToBottom;
 }
 
+/**
+ Refresh the bubbles table rows.
+ 
+ The changes reported by the room data source are applied with batch updates when they are consistent
+ with the rows currently displayed by the table. The table is fully reloaded otherwise.
+ */
+- (void)reloadBubblesTableData
+{
+    MXKDataSourceChangeSet *changeSet = pendingBubblesChangeSet;
+    pendingBubblesChangeSet = nil;
+    
+    if (bubblesTableNeedsFullReload)
+    {
+        // The table has missed some changes, the change set cannot be applied on top of its rows
+        bubblesTableNeedsFullReload = NO;
+        changeSet = nil;
+    }
+    
+    if (changeSet && _bubblesTableView.dataSource && _bubblesTableView.numberOfSections == 1
+        && [changeSet isValidForNumberOfRows:[_bubblesTableView numberOfRowsInSection:0]
+                             newNumberOfRows:[_bubblesTableView.dataSource tableView:_bubblesTableView numberOfRowsInSection:0]])
+    {
+        if (changeSet.isEmpty)
+        {
+            return;
+        }
+        
+        // Only the impacted rows are dequeued and measured again
+        [UIView performWithoutAnimation:^{
+            
+            if (@available(iOS 11.0, *))
+            {
+                [self->_bubblesTableView performBatchUpdates:^{
+                    [changeSet applyToTableView:self->_bubblesTableView withRowAnimation:UITableViewRowAnimationNone];
+                } completion:nil];
+            }
+            else
+            {
+                [self->_bubblesTableView beginUpdates];
+                [changeSet applyToTableView:self->_bubblesTableView withRowAnimation:UITableViewRowAnimationNone];
+                [self->_bubblesTableView endUpdates];
+            }
+            
+        }];
+    }
+    else
+    {
+        [_bubblesTableView reloadData];
+    }
+}
+
 - (void)updateCurrentEventIdAtTableBottom:(BOOL)acknowledge
 {
     // Update the identifier of the event displayed at the bottom of the table, except if a rotation or other size transition is in progress.
@@ -2603,18 +2686,32 @@
     return nil;
 }
 
+- (void)dataSource:(MXKDataSource *)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet *)changeSet
+{
+    // Keep the change set for the next table refresh, and go through the legacy callback
+    // so that inherited classes which override it are still notified.
+    pendingBubblesChangeSet = changeSet;
+    
+    [self dataSource:dataSource didCellChange:nil];
+    
+    // The change set is obsolete if it has not been consumed
+    pendingBubblesChangeSet = nil;
+}
+
 - (void)dataSource:(MXKDataSource *)dataSource didCellChange:(id)changes
 {
     UIApplication *sharedApplication = [UIApplication performSelector:@selector(sharedApplication)];
     if (sharedApplication && sharedApplication.applicationState != UIApplicationStateActive)
     {
         // Do nothing at the UI level if the application do a sync in background
+        bubblesTableNeedsFullReload = YES;
         return;
     }
 
     if (isPaginationInProgress)
     {
         // Ignore these changes, the table will be full updated at the end of pagination.
+        bubblesTableNeedsFullReload = YES;
         return;
     }
     
@@ -80,6 +80,7 @@
 #import "MXKRoomBubbleCellDataWithAppendingMode.h"
 
 #import "MXKAttachment.h"
+#import "MXKAttachmentDecryptor.h"
 
 #import "MXKRecentTableViewCell.h"
 #import "MXKInterleavedRecentTableViewCell.h"
@@ -116,6 +117,7 @@
 #import "MXKMediaCollectionViewCell.h"
 #import "MXKPieChartView.h"
 #import "MXKPieChartHUD.h"
+#import "MXKAnimatedImageView.h"
 
 #import "MXKRoomTitleView.h"
 #import "MXKRoomTitleViewWithTopic.h"
@@ -787,6 +787,9 @@ static MXKAccountOnCertificateChange _onCertificateChangeBlock;
     // Apply the event types filter to display only the wanted event types.
     eventFormatter.eventTypesFilterForMessages = [MXKAppSettings standardAppSettings].eventsFilterForMessages;
 
+    // Render the last message previews only when they are displayed, if requested.
+    eventFormatter.renderLastMessageOnDemand = [MXKAppSettings standardAppSettings].renderRoomSummaryLastMessageOnDemand;
+
     mxSession.roomSummaryUpdateDelegate = eventFormatter;
 
     // Observe UIApplicationSignificantTimeChangeNotification to refresh to MXRoomSummaries if date/time are shown.
@@ -1569,6 +1572,12 @@ static MXKAccountOnCertificateChange _onCertificateChangeBlock;
 
                 NSLog(@"[MXKAccount] %@: The session is ready. Matrix SDK session has been started in %0.fms.", self->mxCredentials.userId, [[NSDate date] timeIntervalSinceDate:self->openSessionStartDate] * 1000);
 
+                if ([self.mxSession.roomSummaryUpdateDelegate isKindOfClass:MXKEventFormatter.class])
+                {
+                    MXKEventFormatter *eventFormatter = (MXKEventFormatter*)self.mxSession.roomSummaryUpdateDelegate;
+                    NSLog(@"[MXKAccount] %@: Last message previews: %tu rendered, %tu deferred", self->mxCredentials.userId, eventFormatter.renderedLastMessagesCount, eventFormatter.deferredLastMessagesCount);
+                }
+
                 [self setUserPresence:MXPresenceOnline andStatusMessage:nil completion:nil];
 
             } failure:^(NSError *error) {
@@ -1722,6 +1731,12 @@ static MXKAccountOnCertificateChange _onCertificateChangeBlock;
         
         for (MXRoomSummary *summary in mxSession.roomsSummaries)
         {
+            if ([summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] boolValue])
+            {
+                // The date will be computed with the preview
+                continue;
+            }
+            
             summary.lastMessageOthers[@"lastEventDate"] = [eventFormatter dateStringFromEvent:summary.lastMessageEvent withTime:YES];
             [mxSession.store storeSummaryForRoom:summary.roomId summary:summary];
         }
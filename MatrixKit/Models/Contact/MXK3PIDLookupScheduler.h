@@ -0,0 +1,116 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default maximum number of 3PIDs sent in a single lookup request.
+ */
+#define MXK3PIDLOOKUPSCHEDULER_DEFAULT_CHUNK_SIZE 500
+
+/**
+ The default maximum number of lookup requests in flight.
+ */
+#define MXK3PIDLOOKUPSCHEDULER_DEFAULT_MAX_CONCURRENT_LOOKUPS 2
+
+/**
+ The default duration during which a lookup result is considered as fresh (24 hours).
+ */
+#define MXK3PIDLOOKUPSCHEDULER_DEFAULT_FRESHNESS_TTL (24 * 3600)
+
+/**
+ Block used to look up a set of third-party identifiers (see `MXKContactManagerDiscoverUsersBoundTo3PIDs`).
+
+ @param threepids the list of 3rd party ids: [[<(MX3PIDMedium)media1>, <(NSString*)address1>], ...].
+ @param success a block object called when the operation succeeds. It provides the array of the discovered users:
+ [[<(MX3PIDMedium)media>, <(NSString*)address>, <(NSString*)userId>], ...].
+ @param failure a block object called when the operation fails.
+ */
+typedef void(^MXK3PIDLookupBlock)(NSArray<NSArray<NSString *> *> *threepids,
+                                  void (^success)(NSArray<NSArray<NSString *> *> *),
+                                  void (^failure)(NSError *));
+
+/**
+ `MXK3PIDLookupScheduler` schedules the lookup of a large set of 3PIDs.
+
+ The 3PIDs are deduplicated, the ones which have been looked up recently are skipped, and the remaining
+ ones are split in bounded-size chunks which are looked up with a limited concurrency. The result of each
+ chunk is reported as soon as it is available, so that it can be merged incrementally.
+
+ The scheduler is not thread safe: it must be used on the queue provided at init, on which all its
+ callbacks are called.
+ */
+@interface MXK3PIDLookupScheduler : NSObject
+
+/**
+ Create a scheduler.
+
+ @param queue the queue on which the scheduler is used.
+ @param lookupBlock the block used to look up each chunk.
+ @return the newly created instance.
+ */
+- (instancetype)initWithQueue:(dispatch_queue_t)queue lookupBlock:(MXK3PIDLookupBlock)lookupBlock;
+
+/**
+ The maximum number of 3PIDs per lookup request.
+ Default is MXK3PIDLOOKUPSCHEDULER_DEFAULT_CHUNK_SIZE.
+ */
+@property (nonatomic) NSUInteger chunkSize;
+
+/**
+ The maximum number of lookup requests in flight.
+ Default is MXK3PIDLOOKUPSCHEDULER_DEFAULT_MAX_CONCURRENT_LOOKUPS.
+ */
+@property (nonatomic) NSUInteger maxConcurrentLookups;
+
+/**
+ The duration during which a lookup result is considered as fresh. The 3PIDs looked up more recently
+ are skipped. Set 0 to look up all the 3PIDs.
+ Default is MXK3PIDLOOKUPSCHEDULER_DEFAULT_FRESHNESS_TTL.
+ */
+@property (nonatomic) NSTimeInterval freshnessTTL;
+
+/**
+ Tell whether a lookup is in progress.
+ */
+@property (nonatomic, readonly) BOOL isLookingUp;
+
+/**
+ Look up a set of 3PIDs. A pending lookup is cancelled.
+
+ @param threepids the 3PIDs: [[<(MX3PIDMedium)media>, <(NSString*)address>], ...]. Duplicates are ignored.
+ @param lastLookupDates the date of the last lookup of the 3PIDs by address, as timestamps (in seconds since 1970).
+ @param onChunk a block called each time a chunk has been looked up successfully, with the addresses of the chunk
+                and the matrix ids found for them by address. The addresses without matrix id are not bound anymore.
+ @param completion a block called once all the chunks have been looked up. `success` is NO if at least one chunk failed.
+ @return the number of 3PIDs which will be looked up.
+ */
+- (NSUInteger)lookup3PIDs:(NSArray<NSArray<NSString *> *> *)threepids
+          lastLookupDates:(nullable NSDictionary<NSString*, NSNumber*> *)lastLookupDates
+                  onChunk:(void (^)(NSArray<NSString*> *addresses, NSDictionary<NSString*, NSString*> *matrixIDByAddress))onChunk
+               completion:(nullable void (^)(BOOL success))completion;
+
+/**
+ Cancel the pending lookup. The results of the requests in flight are ignored.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,248 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXK3PIDLookupScheduler.h"
+
+@import MatrixSDK;
+
+@interface MXK3PIDLookupScheduler ()
+{
+    dispatch_queue_t queue;
+    MXK3PIDLookupBlock lookupBlock;
+    
+    /**
+     Incremented on each new lookup and on cancellation, to ignore the results of the obsolete requests.
+     */
+    NSUInteger generation;
+    
+    /**
+     The chunks which have not been sent yet.
+     */
+    NSMutableArray<NSArray<NSArray<NSString*>*>*> *pendingChunks;
+    
+    /**
+     The number of requests in flight.
+     */
+    NSUInteger inFlightCount;
+    
+    /**
+     The number of chunks which failed during the current lookup.
+     */
+    NSUInteger failedChunkCount;
+    
+    void (^chunkBlock)(NSArray<NSString*> *, NSDictionary<NSString*, NSString*> *);
+    void (^completionBlock)(BOOL);
+}
+
+@end
+
+@implementation MXK3PIDLookupScheduler
+
+- (instancetype)initWithQueue:(dispatch_queue_t)theQueue lookupBlock:(MXK3PIDLookupBlock)theLookupBlock
+{
+    self = [super init];
+    if (self)
+    {
+        queue = theQueue;
+        lookupBlock = theLookupBlock;
+        pendingChunks = [NSMutableArray array];
+        
+        _chunkSize = MXK3PIDLOOKUPSCHEDULER_DEFAULT_CHUNK_SIZE;
+        _maxConcurrentLookups = MXK3PIDLOOKUPSCHEDULER_DEFAULT_MAX_CONCURRENT_LOOKUPS;
+        _freshnessTTL = MXK3PIDLOOKUPSCHEDULER_DEFAULT_FRESHNESS_TTL;
+    }
+    return self;
+}
+
+- (BOOL)isLookingUp
+{
+    return (pendingChunks.count || inFlightCount);
+}
+
+- (NSUInteger)lookup3PIDs:(NSArray<NSArray<NSString *> *> *)threepids
+          lastLookupDates:(NSDictionary<NSString*, NSNumber*> *)lastLookupDates
+                  onChunk:(void (^)(NSArray<NSString*> *, NSDictionary<NSString*, NSString*> *))onChunk
+               completion:(void (^)(BOOL))completion
+{
+    [self cancel];
+    
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+    
+    // Deduplicate the 3PIDs and skip the ones which are still fresh
+    NSMutableSet<NSString*> *addresses = [NSMutableSet setWithCapacity:threepids.count];
+    NSMutableArray<NSArray<NSString*>*> *lookup3pids = [NSMutableArray arrayWithCapacity:threepids.count];
+    
+    for (NSArray<NSString*> *threepid in threepids)
+    {
+        if (threepid.count < 2 || [addresses containsObject:threepid[1]])
+        {
+            continue;
+        }
+        [addresses addObject:threepid[1]];
+        
+        NSNumber *lastLookupDate = lastLookupDates[threepid[1]];
+        if (lastLookupDate && now - lastLookupDate.doubleValue < _freshnessTTL)
+        {
+            continue;
+        }
+        
+        [lookup3pids addObject:threepid];
+    }
+    
+    // Split them in chunks
+    NSUInteger chunkSize = MAX(_chunkSize, 1);
+    for (NSUInteger index = 0; index < lookup3pids.count; index += chunkSize)
+    {
+        NSRange range = NSMakeRange(index, MIN(chunkSize, lookup3pids.count - index));
+        [pendingChunks addObject:[lookup3pids subarrayWithRange:range]];
+    }
+    
+    NSLog(@"[MXK3PIDLookupScheduler] lookup3PIDs: %tu 3PIDs to look up in %tu chunks (%tu fresh 3PIDs skipped)", lookup3pids.count, pendingChunks.count, addresses.count - lookup3pids.count);
+    
+    if (pendingChunks.count)
+    {
+        chunkBlock = onChunk;
+        completionBlock = completion;
+        
+        [self sendPendingChunks];
+    }
+    else if (completion)
+    {
+        completion(YES);
+    }
+    
+    return lookup3pids.count;
+}
+
+- (void)cancel
+{
+    generation++;
+    
+    [pendingChunks removeAllObjects];
+    inFlightCount = 0;
+    failedChunkCount = 0;
+    
+    chunkBlock = nil;
+    completionBlock = nil;
+}
+
+#pragma mark - Private methods
+
+- (void)sendPendingChunks
+{
+    while (pendingChunks.count && inFlightCount < MAX(_maxConcurrentLookups, 1))
+    {
+        NSArray<NSArray<NSString*>*> *chunk = pendingChunks.firstObject;
+        [pendingChunks removeObjectAtIndex:0];
+        inFlightCount++;
+        
+        [self lookupChunk:chunk];
+    }
+}
+
+- (void)lookupChunk:(NSArray<NSArray<NSString*>*>*)chunk
+{
+    NSUInteger chunkGeneration = generation;
+    dispatch_queue_t callbackQueue = queue;
+    
+    MXWeakify(self);
+    
+    lookupBlock(chunk, ^(NSArray<NSArray<NSString *> *> *discoveredUsers) {
+        
+        dispatch_async(callbackQueue, ^{
+            
+            MXStrongifyAndReturnIfNil(self);
+            if (chunkGeneration != self->generation)
+            {
+                return;
+            }
+            
+            NSMutableArray<NSString*> *addresses = [NSMutableArray arrayWithCapacity:chunk.count];
+            for (NSArray<NSString*> *threepid in chunk)
+            {
+                [addresses addObject:threepid[1]];
+            }
+            
+            NSMutableDictionary<NSString*, NSString*> *matrixIDByAddress = [NSMutableDictionary dictionaryWithCapacity:discoveredUsers.count];
+            for (NSArray *discoveredUser in discoveredUsers)
+            {
+                // Sanity check
+                if (discoveredUser.count == 3)
+                {
+                    id address = discoveredUser[1];
+                    id userId = discoveredUser[2];
+                    
+                    if ([address isKindOfClass:[NSString class]] && [userId isKindOfClass:[NSString class]])
+                    {
+                        matrixIDByAddress[address] = userId;
+                    }
+                }
+            }
+            
+            self->inFlightCount--;
+            
+            if (self->chunkBlock)
+            {
+                self->chunkBlock(addresses, matrixIDByAddress);
+            }
+            
+            [self didCompleteChunk];
+        });
+        
+    }, ^(NSError *error) {
+        
+        dispatch_async(callbackQueue, ^{
+            
+            MXStrongifyAndReturnIfNil(self);
+            if (chunkGeneration != self->generation)
+            {
+                return;
+            }
+            
+            NSLog(@"[MXK3PIDLookupScheduler] lookupChunk: failed to look up %tu 3PIDs. Error: %@", chunk.count, error);
+            
+            self->inFlightCount--;
+            self->failedChunkCount++;
+            
+            [self didCompleteChunk];
+        });
+    });
+}
+
+- (void)didCompleteChunk
+{
+    if (pendingChunks.count)
+    {
+        [self sendPendingChunks];
+    }
+    else if (!inFlightCount)
+    {
+        void (^completion)(BOOL) = completionBlock;
+        BOOL success = (failedChunkCount == 0);
+        
+        chunkBlock = nil;
+        completionBlock = nil;
+        failedChunkCount = 0;
+        
+        if (completion)
+        {
+            completion(success);
+        }
+    }
+}
+
+@end
@@ -98,6 +98,12 @@ extern NSString *const kMXKContactDefaultContactPrefixId;
  */
 + (NSString*)contactID:(ABRecordRef)record;
 
+/**
+ A hash of the data of a native phonebook record used by a local contact: its name, emails,
+ phone numbers and thumbnail revision. A change of the fingerprint means the contact must be rebuilt.
+ */
++ (uint64_t)fingerprintOfABRecord:(ABRecordRef)record;
+
 /**
  Create a local contact from a device contact
  
@@ -20,6 +20,7 @@
 
 #import "MXKEmail.h"
 #import "MXKPhoneNumber.h"
+#import "MXKLocalContactsDiffer.h"
 
 NSString *const kMXKContactThumbnailUpdateNotification = @"kMXKContactThumbnailUpdateNotification";
 
@@ -45,6 +46,42 @@ NSString *const kMXKContactDefaultContactPrefixId = @"Default_";
     return [NSString stringWithFormat:@"%@%d", kMXKContactLocalContactPrefixId, ABRecordGetRecordID(record)];
 }
 
++ (uint64_t)fingerprintOfABRecord:(ABRecordRef)record
+{
+    NSMutableArray<NSString*> *fields = [NSMutableArray array];
+    
+    NSString *compositeName = CFBridgingRelease(ABRecordCopyCompositeName(record));
+    [fields addObject:compositeName ?: @""];
+    
+    for (NSNumber *property in @[@(kABPersonPhoneProperty), @(kABPersonEmailProperty)])
+    {
+        ABMultiValueRef multi = ABRecordCopyValue(record, property.intValue);
+        CFIndex count = multi ? ABMultiValueGetCount(multi) : 0;
+        for (CFIndex i = 0; i < count; i++)
+        {
+            NSString *value = CFBridgingRelease(ABMultiValueCopyValueAtIndex(multi, i));
+            NSString *label = CFBridgingRelease(ABMultiValueCopyLabelAtIndex(multi, i));
+            [fields addObject:[NSString stringWithFormat:@"%@:%@", label ?: @"", value ?: @""]];
+        }
+        if (multi)
+        {
+            CFRelease(multi);
+        }
+        
+        // Separate the phone numbers from the emails
+        [fields addObject:@""];
+    }
+    
+    // The thumbnail revision: any picture change updates the record modification date
+    if (ABPersonHasImageData(record))
+    {
+        NSDate *modificationDate = CFBridgingRelease(ABRecordCopyValue(record, kABPersonModificationDateProperty));
+        [fields addObject:[NSString stringWithFormat:@"%f", modificationDate.timeIntervalSinceReferenceDate]];
+    }
+    
+    return [MXKLocalContactsDiffer fingerprintOfFields:fields];
+}
+
 - (id)init
 {
     self = [super init];
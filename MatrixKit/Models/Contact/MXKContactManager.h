@@ -22,6 +22,8 @@
 
 #import "MXKSectionedContacts.h"
 #import "MXKContact.h"
+#import "MXK3PIDLookupScheduler.h"
+#import "MXKContactSearchIndex.h"
 
 /**
  Posted when the matrix contact list is loaded or updated.
@@ -107,6 +109,13 @@ typedef void(^MXKContactManagerDiscoverUsersBoundTo3PIDs)(NSArray<NSArray<NSStri
                                                           void (^ _Nonnull failure)(NSError *_Nonnull));
 @property (nonatomic, nullable) MXKContactManagerDiscoverUsersBoundTo3PIDs discoverUsersBoundTo3PIDsBlock;
 
+/**
+ The scheduler used to look up the 3PIDs of all the local contacts.
+ The 3PIDs looked up recently are skipped (see its `freshnessTTL`), the others are looked up by chunks
+ and the matrix ids are updated chunk by chunk.
+ */
+@property (nonatomic, readonly, nonnull) MXK3PIDLookupScheduler *lookup3PIDsScheduler;
+
 /**
  Define if the room member must have their dedicated contact even if they are not define in the device contacts book.
  The default value is MXKContactManagerMXRoomSourceDirectChats;
@@ -128,6 +137,13 @@ typedef void(^MXKContactManagerDiscoverUsersBoundTo3PIDs)(NSArray<NSArray<NSStri
  */
 @property (nonatomic, readonly, nullable) NSArray *localContacts;
 
+/**
+ The search index of the local contacts. It is updated incrementally when the local contacts are refreshed.
+ Use it to filter the local contacts with `contactsMatchingPatterns:` or `contactsWithPrefix:` rather than
+ testing each contact.
+ */
+@property (nonatomic, readonly, nonnull) MXKContactSearchIndex *localContactsSearchIndex;
+
 /**
  The current list of the local contacts who have contact methods which can be used to invite them or to discover matrix users.
  */
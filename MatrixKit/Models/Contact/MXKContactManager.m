@@ -19,6 +19,11 @@
 #import "MXKContactManager.h"
 
 #import "MXKContact.h"
+#import "MXKLocalContactsDiffer.h"
+#import "MXK3PIDLookupScheduler.h"
+#import "MXKContactSearchIndex.h"
+#import "MXKContactsCacheStore.h"
+#import "MXKContactsCacheDictionary.h"
 
 #import "MXKAppSettings.h"
 #import "MXKTools.h"
@@ -26,6 +31,7 @@
 #import <MatrixSDK/MXAes.h>
 #import <MatrixSDK/MXRestClient.h>
 #import <MatrixSDK/MXKeyProvider.h>
+#import <libkern/OSByteOrder.h>
 
 NSString *const kMXKContactManagerDidUpdateMatrixContactsNotification = @"kMXKContactManagerDidUpdateMatrixContactsNotification";
 
@@ -59,21 +65,32 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
     BOOL isLocalContactListRefreshing;
     dispatch_queue_t processingQueue;
     NSDate *lastSyncDate;
-    // Local contacts by contact Id
+    // Local contacts by contact Id. The cached ones are decoded on demand
     NSMutableDictionary* localContactByContactID;
+    // The fingerprints of the local contacts by contact Id (see [MXKContact fingerprintOfABRecord:])
+    NSDictionary<NSString*, NSNumber*> *localContactFingerprints;
     NSMutableArray* localContactsWithMethods;
     NSMutableArray* splitLocalContacts;
     
     // Matrix id linked to 3PID.
     NSMutableDictionary<NSString*, NSString*> *matrixIDBy3PID;
+    // The date of the last lookup of each 3PID (timestamp in seconds), used to skip the fresh ones.
+    NSMutableDictionary<NSString*, NSNumber*> *lookupDateBy3PID;
     
     /**
      Matrix contacts handling
      */
-    // Matrix contacts by contact Id
-    NSMutableDictionary* matrixContactByContactID;
+    // Matrix contacts by contact Id, decoded from the cache on demand
+    MXKContactsCacheDictionary* matrixContactByContactID;
     // Matrix contacts by matrix id
     NSMutableDictionary* matrixContactByMatrixID;
+    
+    /**
+     File caches
+     */
+    // The opened cache stores by file name, and the key used to open them
+    NSMutableDictionary<NSString*, MXKContactsCacheStore*> *cacheStores;
+    NSData *cacheStoresKey;
 }
 
 @end
@@ -102,6 +119,7 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
         NSString *label = [NSString stringWithFormat:@"MatrixKit.%@.Contacts", [[NSBundle mainBundle] objectForInfoDictionaryKey:@"CFBundleName"]];
         
         [self deleteOldFiles];
+        cacheStores = [NSMutableDictionary dictionary];
         
         processingQueue = dispatch_queue_create([label UTF8String], DISPATCH_QUEUE_SERIAL);
         
@@ -111,6 +129,24 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
         
         self.contactManagerMXRoomSource = MXKContactManagerMXRoomSourceDirectChats;
         
+        _localContactsSearchIndex = [[MXKContactSearchIndex alloc] init];
+        
+        MXWeakify(self);
+        _lookup3PIDsScheduler = [[MXK3PIDLookupScheduler alloc] initWithQueue:processingQueue lookupBlock:^(NSArray<NSArray<NSString *> *> *threepids, void (^success)(NSArray<NSArray<NSString *> *> *), void (^failure)(NSError *)) {
+            MXStrongifyAndReturnIfNil(self);
+            
+            if (self.discoverUsersBoundTo3PIDsBlock)
+            {
+                self.discoverUsersBoundTo3PIDsBlock(threepids, success, failure);
+            }
+            else
+            {
+                [self.identityService lookup3pids:threepids
+                                          success:success
+                                          failure:failure];
+            }
+        }];
+        
         // Observe related settings change
         [[MXKAppSettings standardAppSettings]  addObserver:self forKeyPath:@"syncLocalContacts" options:0 context:nil];
         [[MXKAppSettings standardAppSettings]  addObserver:self forKeyPath:@"phonebookCountryCode" options:0 context:nil];
@@ -125,6 +161,7 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 -(void)dealloc
 {
     matrixIDBy3PID = nil;
+    lookupDateBy3PID = nil;
 
     localContactByContactID = nil;
     localContactsWithMethods = nil;
@@ -527,6 +564,8 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
             
             // Local contacts list is empty if the access is denied.
             self->localContactByContactID = nil;
+            [self.localContactsSearchIndex removeAllContacts];
+            self->localContactFingerprints = nil;
             self->localContactsWithMethods = nil;
             self->splitLocalContacts = nil;
             [self cacheLocalContacts];
@@ -550,6 +589,7 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
             {
                 // The user changed his mind and disabled the local contact sync, remove the cached data.
                 self->matrixIDBy3PID = nil;
+                self->lookupDateBy3PID = nil;
                 [self cacheMatrixIDsDict];
                 
                 // Reload the local contacts from the system
@@ -583,9 +623,15 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
                     }
                 }
 
-                BOOL didContactBookChange = NO;
-
-                NSMutableArray* deletedContactIDs = [NSMutableArray arrayWithArray:[self->localContactByContactID allKeys]];
+                // Compare the contacts book with the fingerprints of the cached contacts.
+                // The cached contacts without fingerprint (cached by a previous version) are fingerprinted when they change.
+                NSMutableDictionary<NSString*, NSNumber*> *previousFingerprints = [NSMutableDictionary dictionaryWithCapacity:self->localContactByContactID.count];
+                for (NSString *contactID in self->localContactByContactID)
+                {
+                    previousFingerprints[contactID] = self->localContactFingerprints[contactID] ?: @(0);
+                }
+                MXKLocalContactsDiffer *differ = [[MXKLocalContactsDiffer alloc] initWithPreviousFingerprints:previousFingerprints];
+                NSMutableArray<MXKContact*> *updatedContacts = [NSMutableArray array];
 
                 // can list local contacts?
                 if (ABAddressBookGetAuthorizationStatus() == kABAuthorizationStatusAuthorized)
@@ -607,17 +653,14 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 
                             NSString* contactID = [MXKContact contactID:contactRecord];
 
-                            // the contact still exists
-                            [deletedContactIDs removeObject:contactID];
-
                             if (self->lastSyncDate)
                             {
                                 // ignore unchanged contacts since the previous sync
                                 CFDateRef lastModifDate = ABRecordCopyValue(contactRecord, kABPersonModificationDateProperty);
                                 if (lastModifDate)
                                 {
-                                    if (kCFCompareGreaterThan != CFDateCompare(lastModifDate, (__bridge CFDateRef)self->lastSyncDate, nil))
-
+                                    if (kCFCompareGreaterThan != CFDateCompare(lastModifDate, (__bridge CFDateRef)self->lastSyncDate, nil)
+                                        && [differ keepContactID:contactID])
                                     {
                                         CFRelease(lastModifDate);
                                         continue;
@@ -626,7 +669,11 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
                                 }
                             }
 
-                            didContactBookChange = YES;
+                            // ignore the modified contacts whose displayed data did not change
+                            if (![differ addContactID:contactID fingerprint:[MXKContact fingerprintOfABRecord:contactRecord]])
+                            {
+                                continue;
+                            }
 
                             MXKContact* contact = [[MXKContact alloc] initLocalContactWithABRecord:contactRecord];
 
@@ -637,6 +684,7 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 
                             // update the local contacts list
                             [self->localContactByContactID setValue:contact forKey:contactID];
+                            [updatedContacts addObject:contact];
                         }
 
                         CFRelease(people);
@@ -649,23 +697,71 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
                 }
 
                 // some contacts have been deleted
-                for (NSString* contactID in deletedContactIDs)
+                [self->localContactByContactID removeObjectsForKeys:differ.removedContactIDs];
+                
+                // Update the search index
+                if (isColdStart)
+                {
+                    [self.localContactsSearchIndex removeAllContacts];
+                    for (MXKContact *contact in self->localContactByContactID.allValues)
+                    {
+                        [self.localContactsSearchIndex addContact:contact];
+                    }
+                }
+                else
                 {
-                    didContactBookChange = YES;
-                    [self->localContactByContactID removeObjectForKey:contactID];
+                    for (MXKContact *contact in updatedContacts)
+                    {
+                        [self.localContactsSearchIndex addContact:contact];
+                    }
+                    for (NSString *contactID in differ.removedContactIDs)
+                    {
+                        [self.localContactsSearchIndex removeContactWithContactID:contactID];
+                    }
                 }
 
+                BOOL didContactBookChange = differ.hasChanges;
+                NSDictionary<NSString*, NSNumber*> *fingerprints = differ.fingerprints;
+                if (isColdStart && fingerprints.count != self->localContactByContactID.count)
+                {
+                    // The contacts whose cached record was corrupted have been dropped when they were decoded.
+                    // Forget their fingerprints so that the next refresh rebuilds them.
+                    NSMutableDictionary<NSString*, NSNumber*> *validFingerprints = [fingerprints mutableCopy];
+                    for (NSString *contactID in fingerprints)
+                    {
+                        if (!self->localContactByContactID[contactID])
+                        {
+                            [validFingerprints removeObjectForKey:contactID];
+                        }
+                    }
+                    fingerprints = validFingerprints;
+                }
+                self->localContactFingerprints = fingerprints;
+
+                NSLog(@"[MXKContactManager] refreshLocalContacts : %tu added, %tu changed, %tu removed contacts", differ.addedContactIDs.count, differ.changedContactIDs.count, differ.removedContactIDs.count);
+
                 // something has been modified in the local contact book
                 if (didContactBookChange)
                 {
-                    [self cacheLocalContacts];
+                    [self cacheLocalContacts:updatedContacts removedContactIDs:differ.removedContactIDs];
                 }
                 
                 self->lastSyncDate = [NSDate date];
                 [self cacheContactBookInfo];
                 
                 // Update loaded contacts with the known dict 3PID -> matrix ID
-                [self updateAllLocalContactsMatrixIDs];
+                if (isColdStart)
+                {
+                    [self updateAllLocalContactsMatrixIDs];
+                }
+                else if ([MXKAppSettings standardAppSettings].syncLocalContacts)
+                {
+                    // Only the rebuilt contacts miss their matrix ids
+                    for (MXKContact *contact in updatedContacts)
+                    {
+                        [self updateLocalContactMatrixIDs:contact];
+                    }
+                }
                 
                 dispatch_async(dispatch_get_main_queue(), ^{
                     
@@ -813,19 +909,29 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
         
         NSArray* contactsSnapshot = [self->localContactByContactID allValues];
         
-        // Retrieve all 3PIDs
-        NSMutableArray* threepids = [[NSMutableArray alloc] init];
+        // Retrieve all 3PIDs, and the contacts which own them
         NSMutableArray* lookup3pidsArray = [[NSMutableArray alloc] init];
+        NSMutableDictionary<NSString*, NSMutableArray<MXKContact*>*> *contactsBy3PID = [[NSMutableDictionary alloc] init];
+        
+        void (^add3PID)(NSString*, NSString*, MXKContact*) = ^(NSString *medium, NSString *address, MXKContact *contact) {
+            NSMutableArray<MXKContact*> *contacts = contactsBy3PID[address];
+            if (!contacts)
+            {
+                // Not yet added
+                [lookup3pidsArray addObject:@[medium, address]];
+                contacts = [NSMutableArray arrayWithCapacity:1];
+                contactsBy3PID[address] = contacts;
+            }
+            [contacts addObject:contact];
+        };
         
         for (MXKContact* contact in contactsSnapshot)
         {
             for (MXKEmail* email in contact.emailAddresses)
             {
-                // Not yet added
-                if (email.emailAddress.length && [threepids indexOfObject:email.emailAddress] == NSNotFound)
+                if (email.emailAddress.length)
                 {
-                    [lookup3pidsArray addObject:@[kMX3PIDMediumEmail, email.emailAddress]];
-                    [threepids addObject:email.emailAddress];
+                    add3PID(kMX3PIDMediumEmail, email.emailAddress, contact);
                 }
             }
             
@@ -833,86 +939,94 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
             {
                 if (phone.msisdn)
                 {
-                    // Not yet added
-                    if ([threepids indexOfObject:phone.msisdn] == NSNotFound)
-                    {
-                        [lookup3pidsArray addObject:@[kMX3PIDMediumMSISDN, phone.msisdn]];
-                        [threepids addObject:phone.msisdn];
-                    }
+                    add3PID(kMX3PIDMediumMSISDN, phone.msisdn, contact);
                 }
             }
         }
         
         // Update 3PIDs mapping
-        if (lookup3pidsArray.count > 0)
+        if (lookup3pidsArray.count > 0 && (self.discoverUsersBoundTo3PIDsBlock || self.identityService))
         {
+            // Forget the 3PIDs which are not in the contacts book anymore
+            if (!self->matrixIDBy3PID)
+            {
+                self->matrixIDBy3PID = [[NSMutableDictionary alloc] init];
+            }
+            if (!self->lookupDateBy3PID)
+            {
+                self->lookupDateBy3PID = [[NSMutableDictionary alloc] init];
+            }
+            for (NSString *pid in self->lookupDateBy3PID.allKeys)
+            {
+                if (!contactsBy3PID[pid])
+                {
+                    [self->lookupDateBy3PID removeObjectForKey:pid];
+                }
+            }
+            for (NSString *pid in self->matrixIDBy3PID.allKeys)
+            {
+                if (!contactsBy3PID[pid])
+                {
+                    [self->matrixIDBy3PID removeObjectForKey:pid];
+                }
+            }
+            
             MXWeakify(self);
             
-            void (^success)(NSArray<NSArray<NSString *> *> *) = ^(NSArray<NSArray<NSString *> *> *discoveredUsers) {
+            [self.lookup3PIDsScheduler lookup3PIDs:lookup3pidsArray lastLookupDates:self->lookupDateBy3PID onChunk:^(NSArray<NSString *> *addresses, NSDictionary<NSString *,NSString *> *matrixIDByAddress) {
+                
                 MXStrongifyAndReturnIfNil(self);
                 
-                [threepids removeAllObjects];
-                NSMutableArray* userIds = [[NSMutableArray alloc] init];
+                // Merge the result of this chunk
+                NSNumber *lookupDate = @([NSDate date].timeIntervalSince1970);
+                NSMutableSet<MXKContact*> *updatedContacts = [NSMutableSet set];
                 
-                // Consider each discored user
-                for (NSArray *discoveredUser in discoveredUsers)
+                for (NSString *pid in addresses)
                 {
-                    // Sanity check
-                    if (discoveredUser.count == 3)
+                    NSString *matrixID = matrixIDByAddress[pid];
+                    NSString *currentMatrixID = self->matrixIDBy3PID[pid];
+                    
+                    if (matrixID != currentMatrixID && ![matrixID isEqualToString:currentMatrixID])
                     {
-                        id threepid = discoveredUser[1];
-                        id userId = discoveredUser[2];
-                        
-                        if ([threepid isKindOfClass:[NSString class]] && [userId isKindOfClass:[NSString class]])
-                        {
-                            [threepids addObject:threepid];
-                            [userIds addObject:userId];
-                        }
+                        self->matrixIDBy3PID[pid] = matrixID;
+                        [updatedContacts addObjectsFromArray:contactsBy3PID[pid]];
                     }
+                    
+                    self->lookupDateBy3PID[pid] = lookupDate;
                 }
                 
-                if (userIds.count)
+                if (updatedContacts.count && [MXKAppSettings standardAppSettings].syncLocalContacts)
                 {
-                    self->matrixIDBy3PID = [[NSMutableDictionary alloc] initWithObjects:userIds forKeys:threepids];
-                }
-                else
-                {
-                    self->matrixIDBy3PID = nil;
+                    for (MXKContact *contact in updatedContacts)
+                    {
+                        [self updateLocalContactMatrixIDs:contact];
+                    }
+                    
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        [[NSNotificationCenter defaultCenter] postNotificationName:kMXKContactManagerDidUpdateLocalContactMatrixIDsNotification object:nil userInfo:nil];
+                    });
                 }
                 
-                [self cacheMatrixIDsDict];
+            } completion:^(BOOL success) {
                 
-                [self updateAllLocalContactsMatrixIDs];
+                MXStrongifyAndReturnIfNil(self);
                 
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    [[NSNotificationCenter defaultCenter] postNotificationName:kMXKContactManagerDidUpdateLocalContactMatrixIDsNotification object:nil userInfo:nil];
-                });
-            };
-            
-            void (^failure)(NSError *) = ^(NSError *error) {
-                NSLog(@"[MXKContactManager] updateMatrixIDsForAllLocalContacts failed");
-            };
-            
-            if (self.discoverUsersBoundTo3PIDsBlock)
-            {
-                self.discoverUsersBoundTo3PIDsBlock(lookup3pidsArray, success, failure);
-            }
-            else if (self.identityService)
-            {
-                [self.identityService lookup3pids:lookup3pidsArray
-                                          success:success
-                                          failure:failure];
-            }
-            else
-            {
-                // No IS, no detection of Matrix users in local contacts
-                self->matrixIDBy3PID = nil;
+                if (!success)
+                {
+                    NSLog(@"[MXKContactManager] updateMatrixIDsForAllLocalContacts failed");
+                }
+                
+                // Store the merged results, even partial ones
                 [self cacheMatrixIDsDict];
-            }
+            }];
         }
         else
         {
+            // No 3PID or no IS, no detection of Matrix users in local contacts
+            [self.lookup3PIDsScheduler cancel];
+            
             self->matrixIDBy3PID = nil;
+            self->lookupDateBy3PID = nil;
             [self cacheMatrixIDsDict];
         }
     });
@@ -922,7 +1036,10 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 {
     dispatch_async(processingQueue, ^{
         
+        [self.lookup3PIDsScheduler cancel];
+        
         self->matrixIDBy3PID = nil;
+        self->lookupDateBy3PID = nil;
         [self cacheMatrixIDsDict];
 
         dispatch_async(dispatch_get_main_queue(), ^{
@@ -933,11 +1050,18 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 
 - (void)reset
 {
+    dispatch_async(processingQueue, ^{
+        [self.lookup3PIDsScheduler cancel];
+    });
+    
     matrixIDBy3PID = nil;
+    lookupDateBy3PID = nil;
     [self cacheMatrixIDsDict];
     
     isLocalContactListRefreshing = NO;
     localContactByContactID = nil;
+    [_localContactsSearchIndex removeAllContacts];
+    localContactFingerprints = nil;
     localContactsWithMethods = nil;
     splitLocalContacts = nil;
     [self cacheLocalContacts];
@@ -1255,24 +1379,24 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
             NSArray *sessions = self.mxSessions;
 
             NSMutableDictionary *matrixContactsByMatrixID = nil;
-            NSMutableDictionary *matrixContactsByContactID = nil;
+            MXKContactsCacheDictionary *matrixContactsByContactID = nil;
 
             if (shouldFetchLocalContacts)
             {
-                NSDictionary *cachedMatrixContacts = [self fetchCachedMatrixContacts];
+                MXKContactsCacheDictionary *cachedMatrixContacts = [self fetchCachedMatrixContacts];
 
                 if (!matrixContactsByContactID)
                 {
-                    matrixContactsByContactID = [NSMutableDictionary dictionary];
+                    matrixContactsByContactID = [[MXKContactsCacheDictionary alloc] init];
                 }
                 else
                 {
-                    matrixContactsByContactID = [cachedMatrixContacts mutableCopy];
+                    matrixContactsByContactID = cachedMatrixContacts;
                 }
             }
             else
             {
-                matrixContactsByContactID = [NSMutableDictionary dictionary];
+                matrixContactsByContactID = [[MXKContactsCacheDictionary alloc] init];
             }
 
             NSDictionary *matrixContacts = [self matrixContactsByMatrixIDFromMXSessions:sessions];
@@ -1338,6 +1462,7 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
                     {
                         contact.displayName = userDisplayName;
                         
+                        [matrixContactByContactID setNeedsWriteForContactID:contact.contactID];
                         [self cacheMatrixContacts];
                         isUpdated = YES;
                     }
@@ -1386,17 +1511,21 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
 
 - (void)updateLocalContactMatrixIDs:(MXKContact*) contact
 {
+    NSMutableArray<MXKPhoneNumber*> *phoneNumbers = [NSMutableArray array];
+    NSMutableArray<NSString*> *phoneNumberMatrixIDs = [NSMutableArray array];
+    NSMutableArray<MXKEmail*> *emails = [NSMutableArray array];
+    NSMutableArray<NSString*> *emailMatrixIDs = [NSMutableArray array];
+    BOOL didMatrixIDsChange = NO;
+    
     for (MXKPhoneNumber* phoneNumber in contact.phoneNumbers)
     {
         if (phoneNumber.msisdn)
         {
             NSString* matrixID = [matrixIDBy3PID objectForKey:phoneNumber.msisdn];
+            didMatrixIDsChange |= (matrixID != phoneNumber.matrixID && ![matrixID isEqualToString:phoneNumber.matrixID]);
             
-            dispatch_async(dispatch_get_main_queue(), ^{
-                
-                [phoneNumber setMatrixID:matrixID];
-                
-            });
+            [phoneNumbers addObject:phoneNumber];
+            [phoneNumberMatrixIDs addObject:(matrixID ?: (NSString*)[NSNull null])];
         }
     }
     
@@ -1405,14 +1534,43 @@ NSString *const MXKContactManagerDataType = @"org.matrix.kit.MXKContactManagerDa
         if (email.emailAddress.length > 0)
         {
             NSString *matrixID = [matrixIDBy3PID objectForKey:email.emailAddress];
+            didMatrixIDsChange |= (matrixID != email.matrixID && ![matrixID isEqualToString:email.matrixID]);
             
-            dispatch_async(dispatch_get_main_queue(), ^{
-                
-                [email setMatrixID:matrixID];
-                
-            });
+            [emails addObject:email];
+            [emailMatrixIDs addObject:(matrixID ?: (NSString*)[NSNull null])];
         }
     }
+    
+    if (!phoneNumbers.count && !emails.count)
+    {
+        return;
+    }
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        
+        // The matrix ids are read by the UI, set them on the main thread
+        for (NSUInteger index = 0; index < phoneNumbers.count; index++)
+        {
+            NSString *matrixID = phoneNumberMatrixIDs[index];
+            [phoneNumbers[index] setMatrixID:([matrixID isKindOfClass:NSString.class] ? matrixID : nil)];
+        }
+        for (NSUInteger index = 0; index < emails.count; index++)
+        {
+            NSString *matrixID = emailMatrixIDs[index];
+            [emails[index] setMatrixID:([matrixID isKindOfClass:NSString.class] ? matrixID : nil)];
+        }
+        
+        if (didMatrixIDsChange)
+        {
+            // The matrix ids are indexed: reindex the contact, unless it has been removed in the meantime
+            dispatch_async(self->processingQueue, ^{
+                if (self->localContactByContactID[contact.contactID] == contact)
+                {
+                    [self.localContactsSearchIndex addContact:contact];
+                }
+            });
+        }
+    });
 }
 
 - (void)updateAllLocalContactsMatrixIDs
@@ -1537,10 +1695,23 @@ static NSString *matrixIDsDictFileOld = @"matrixIDsDict";
 static NSString *localContactsFileOld = @"localContacts";
 static NSString *contactsBookInfoFileOld = @"contacts";
 
-static NSString *matrixContactsFile = @"matrixContactsV2";
-static NSString *matrixIDsDictFile = @"matrixIDsDictV2";
-static NSString *localContactsFile = @"localContactsV2";
-static NSString *contactsBookInfoFile = @"contactsV2";
+// NSKeyedArchiver archives, migrated to the cache stores
+static NSString *matrixContactsFileV2 = @"matrixContactsV2";
+static NSString *matrixIDsDictFileV2 = @"matrixIDsDictV2";
+static NSString *localContactsFileV2 = @"localContactsV2";
+static NSString *contactsBookInfoFileV2 = @"contactsV2";
+
+// MXKContactsCacheStore files
+static NSString *matrixContactsFile = @"matrixContactsV3";
+static NSString *matrixIDsDictFile = @"matrixIDsDictV3";
+static NSString *localContactsFile = @"localContactsV3";
+static NSString *contactsBookInfoFile = @"contactsV3";
+
+// Record key prefixes in the cache stores
+static NSString *matrixIDRecordPrefix = @"mxid:";
+static NSString *lookupDateRecordPrefix = @"date:";
+static NSString *fingerprintRecordPrefix = @"fingerprint:";
+static NSString *lastSyncDateRecordKey = @"lastSyncDate";
 
 - (NSString*)dataFilePathForComponent:(NSString*)component
 {
@@ -1549,311 +1720,391 @@ static NSString *contactsBookInfoFile = @"contactsV2";
     return [documentsDirectory stringByAppendingPathComponent:component];
 }
 
-- (void)cacheMatrixContacts
+- (MXKContactsCacheStore*)cacheStoreForFile:(NSString*)fileName
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:matrixContactsFile];
+    NSData *key;
+    @try
+    {
+        MXKeyData *keyData = [[MXKeyProvider sharedInstance] requestKeyForDataOfType:MXKContactManagerDataType isMandatory:NO expectedKeyType:kAes];
+        if (keyData && [keyData isKindOfClass:[MXAesKeyData class]])
+        {
+            key = ((MXAesKeyData *)keyData).key;
+        }
+    }
+    @catch (NSException *exception)
+    {
+        NSLog(@"[MXKContactManager] cacheStoreForFile: key not available for %@: %@", fileName, exception.reason);
+        return nil;
+    }
     
-    if (matrixContactByContactID && (matrixContactByContactID.count > 0))
+    @synchronized (cacheStores)
     {
-        // Switch on processing queue because matrixContactByContactID dictionary may be huge.
-        NSDictionary *matrixContactByContactIDCpy = [matrixContactByContactID copy];
+        // The stores must be reopened if the key changed
+        if (key != cacheStoresKey && ![key isEqualToData:cacheStoresKey])
+        {
+            [cacheStores removeAllObjects];
+            cacheStoresKey = key;
+        }
         
-        dispatch_async(processingQueue, ^{
-            
-            NSMutableData *theData = [NSMutableData data];
-            NSKeyedArchiver *encoder = [[NSKeyedArchiver alloc] initForWritingWithMutableData:theData];
-            
-            [encoder encodeObject:matrixContactByContactIDCpy forKey:@"matrixContactByContactID"];
-            
-            [encoder finishEncoding];
-            
-            [self encryptAndSaveData:theData toFile:matrixContactsFile];
-        });
+        MXKContactsCacheStore *store = cacheStores[fileName];
+        if (!store)
+        {
+            store = [[MXKContactsCacheStore alloc] initWithFilePath:[self dataFilePathForComponent:fileName] key:key];
+            cacheStores[fileName] = store;
+        }
+        return store;
     }
-    else
+}
+
+- (BOOL)saveRecords:(NSDictionary<NSString*, NSData*>*)records toCacheFile:(NSString*)fileName
+{
+    MXKContactsCacheStore *store = [self cacheStoreForFile:fileName];
+    if (store)
+    {
+        [store setRecords:records];
+        return [store synchronize];
+    }
+    else if (!records.count)
     {
         NSFileManager *fileManager = [[NSFileManager alloc] init];
-        [fileManager removeItemAtPath:dataFilePath error:nil];
+        [fileManager removeItemAtPath:[self dataFilePathForComponent:fileName] error:nil];
+        return YES;
     }
+    return NO;
 }
 
-- (NSDictionary*)fetchCachedMatrixContacts
+- (NSData*)recordWithUInt64:(uint64_t)value
 {
-    NSDate *startDate = [NSDate date];
-    
-    NSString *dataFilePath = [self dataFilePathForComponent:matrixContactsFile];
+    uint8_t bytes[sizeof(uint64_t)];
+    OSWriteLittleInt64(bytes, 0, value);
+    return [NSData dataWithBytes:bytes length:sizeof(bytes)];
+}
+
+- (uint64_t)uint64OfRecord:(NSData*)record
+{
+    return (record.length == sizeof(uint64_t)) ? OSReadLittleInt64(record.bytes, 0) : 0;
+}
+
+/**
+ Decode a NSKeyedArchiver archive of a previous version.
+ 
+ The archive is kept: the caller removes it with `removeLegacyCacheFile:` once the decoded objects
+ have been written to the cache store.
+ 
+ @param fileName the archive file name.
+ @param keys the keys of the archived objects.
+ @return the decoded objects by key. nil if there is no such archive or if it cannot be decoded.
+ */
+- (NSDictionary<NSString*, id>*)objectsOfLegacyCacheFile:(NSString*)fileName forKeys:(NSArray<NSString*>*)keys
+{
+    NSString *dataFilePath = [self dataFilePathForComponent:fileName];
     
     NSFileManager *fileManager = [[NSFileManager alloc] init];
     
-    __block NSDictionary *matrixContactByContactID = nil;
+    if (![fileManager fileExistsAtPath:dataFilePath])
+    {
+        return nil;
+    }
+    
+    NSMutableDictionary<NSString*, id> *objects;
     
-    if ([fileManager fileExistsAtPath:dataFilePath])
+    // the file content could be corrupted
+    @try
     {
-        @try
+        NSData* filecontent = [NSData dataWithContentsOfFile:dataFilePath options:(NSDataReadingMappedAlways | NSDataReadingUncached) error:nil];
+        
+        NSError *error = nil;
+        filecontent = [self decryptData:filecontent error:&error fileName:fileName];
+        
+        if (error)
         {
-            NSData* filecontent = [NSData dataWithContentsOfFile:dataFilePath options:(NSDataReadingMappedAlways | NSDataReadingUncached) error:nil];
+            NSLog(@"[MXKContactManager] objectsOfLegacyCacheFile: failed to decrypt %@: %@", fileName, error);
             
-            NSError *error = nil;
-            filecontent = [self decryptData:filecontent error:&error fileName:matrixContactsFile];
-
-            if (!error)
-            {
-                NSKeyedUnarchiver *decoder = [[NSKeyedUnarchiver alloc] initForReadingWithData:filecontent];
-                
-                id object = [decoder decodeObjectForKey:@"matrixContactByContactID"];
-                
-                if ([object isKindOfClass:[NSDictionary class]])
-                {
-                    matrixContactByContactID = object;
-                }
-                
-                [decoder finishDecoding];
-            }
-            else
-            {
-                NSLog(@"[MXKContactManager] fetchCachedMatrixContacts: failed to decrypt %@: %@", matrixContactsFile, error);
-            }
+            // Try again later
+            return nil;
         }
-        @catch (NSException *exception)
+        
+        NSKeyedUnarchiver *decoder = [[NSKeyedUnarchiver alloc] initForReadingWithData:filecontent];
+        
+        objects = [NSMutableDictionary dictionary];
+        for (NSString *key in keys)
         {
+            objects[key] = [decoder decodeObjectForKey:key];
         }
+        
+        [decoder finishDecoding];
+    }
+    @catch (NSException *exception)
+    {
+        NSLog(@"[MXKContactManager] objectsOfLegacyCacheFile: failed to decode %@: %@", fileName, exception.reason);
+        objects = nil;
     }
     
-    NSLog(@"[MXKContactManager] fetchCachedMatrixContacts : Loaded %tu contacts in %.0fms", matrixContactByContactID.count, [[NSDate date] timeIntervalSinceDate:startDate] * 1000);
-    
-    return matrixContactByContactID;
+    return objects;
 }
 
-- (void)cacheMatrixIDsDict
+/**
+ Remove a migrated NSKeyedArchiver archive.
+ 
+ @param fileName the archive file name.
+ @param migrated YES if its objects have been written to the cache store. The archive is kept otherwise,
+ so that the migration is retried later.
+ */
+- (void)removeLegacyCacheFile:(NSString*)fileName migrated:(BOOL)migrated
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:matrixIDsDictFile];
+    if (!migrated)
+    {
+        NSLog(@"[MXKContactManager] removeLegacyCacheFile: failed to migrate %@", fileName);
+        return;
+    }
+    
+    NSLog(@"[MXKContactManager] removeLegacyCacheFile: migrated %@", fileName);
     
-    if (matrixIDBy3PID.count)
+    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    [fileManager removeItemAtPath:[self dataFilePathForComponent:fileName] error:nil];
+}
+
+- (void)cacheMatrixContacts
+{
+    if (matrixContactByContactID && (matrixContactByContactID.count > 0))
     {
-        NSMutableData *theData = [NSMutableData data];
-        NSKeyedArchiver *encoder = [[NSKeyedArchiver alloc] initForWritingWithMutableData:theData];
-        
-        [encoder encodeObject:matrixIDBy3PID forKey:@"matrixIDsDict"];
-        [encoder finishEncoding];
+        // Switch on processing queue because matrixContactByContactID dictionary may be huge.
+        MXKContactsCacheDictionary *matrixContacts = matrixContactByContactID;
         
-        [self encryptAndSaveData:theData toFile:matrixIDsDictFile];
+        dispatch_async(processingQueue, ^{
+            
+            // Only the contacts changed since the previous write are archived
+            MXKContactsCacheStore *store = [self cacheStoreForFile:matrixContactsFile];
+            if (store)
+            {
+                [matrixContacts writeToCacheStore:store];
+            }
+        });
     }
     else
     {
-        NSFileManager *fileManager = [[NSFileManager alloc] init];
-        [fileManager removeItemAtPath:dataFilePath error:nil];
+        [self saveRecords:@{} toCacheFile:matrixContactsFile];
     }
 }
 
-- (void)loadCachedMatrixIDsDict
+- (MXKContactsCacheDictionary*)fetchCachedMatrixContacts
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:matrixIDsDictFile];
+    NSDate *startDate = [NSDate date];
     
-    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    MXKContactsCacheDictionary *matrixContactByContactID = nil;
     
-    if ([fileManager fileExistsAtPath:dataFilePath])
+    NSDictionary *legacyObjects = [self objectsOfLegacyCacheFile:matrixContactsFileV2 forKeys:@[@"matrixContactByContactID"]];
+    if (legacyObjects)
     {
-        // the file content could be corrupted
-        @try
+        id object = legacyObjects[@"matrixContactByContactID"];
+        if ([object isKindOfClass:[NSDictionary class]])
         {
-            NSData* filecontent = [NSData dataWithContentsOfFile:dataFilePath options:(NSDataReadingMappedAlways | NSDataReadingUncached) error:nil];
+            matrixContactByContactID = [[MXKContactsCacheDictionary alloc] init];
+            [matrixContactByContactID addEntriesFromDictionary:object];
             
-            NSError *error = nil;
-            filecontent = [self decryptData:filecontent error:&error fileName:matrixIDsDictFile];
-
-            if (!error)
-            {
-                NSKeyedUnarchiver *decoder = [[NSKeyedUnarchiver alloc] initForReadingWithData:filecontent];
-                
-                id object = [decoder decodeObjectForKey:@"matrixIDsDict"];
-                
-                if ([object isKindOfClass:[NSDictionary class]])
-                {
-                    matrixIDBy3PID = [object mutableCopy];
-                }
-                
-                [decoder finishDecoding];
-            }
-            else
-            {
-                NSLog(@"[MXKContactManager] loadCachedMatrixIDsDict: failed to decrypt %@: %@", matrixIDsDictFile, error);
-            }
+            MXKContactsCacheStore *store = [self cacheStoreForFile:matrixContactsFile];
+            [self removeLegacyCacheFile:matrixContactsFileV2 migrated:(store && [matrixContactByContactID writeToCacheStore:store])];
         }
-        @catch (NSException *exception)
+        else
         {
+            // Nothing to migrate
+            [self removeLegacyCacheFile:matrixContactsFileV2 migrated:YES];
         }
     }
-    
-    if (!matrixIDBy3PID)
+    else
     {
-        matrixIDBy3PID = [[NSMutableDictionary alloc] init];
+        MXKContactsCacheStore *store = [self cacheStoreForFile:matrixContactsFile];
+        if (store.count)
+        {
+            // The contacts are decoded when they are accessed
+            matrixContactByContactID = [[MXKContactsCacheDictionary alloc] initWithCacheStore:store];
+        }
     }
+    
+    NSLog(@"[MXKContactManager] fetchCachedMatrixContacts : Loaded %tu contacts in %.0fms", matrixContactByContactID.count, [[NSDate date] timeIntervalSinceDate:startDate] * 1000);
+    
+    return matrixContactByContactID;
 }
 
-- (void)cacheLocalContacts
+- (BOOL)cacheMatrixIDsDict
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:localContactsFile];
+    NSMutableDictionary<NSString*, NSData*> *records = [NSMutableDictionary dictionaryWithCapacity:(matrixIDBy3PID.count + lookupDateBy3PID.count)];
+    
+    [matrixIDBy3PID enumerateKeysAndObjectsUsingBlock:^(NSString *pid, NSString *matrixID, BOOL *stop) {
+        records[[matrixIDRecordPrefix stringByAppendingString:pid]] = [matrixID dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    [lookupDateBy3PID enumerateKeysAndObjectsUsingBlock:^(NSString *pid, NSNumber *lookupDate, BOOL *stop) {
+        records[[lookupDateRecordPrefix stringByAppendingString:pid]] = [self recordWithUInt64:(uint64_t)(lookupDate.doubleValue * 1000)];
+    }];
     
-    if (localContactByContactID && (localContactByContactID.count > 0))
+    return [self saveRecords:records toCacheFile:matrixIDsDictFile];
+}
+
+- (void)loadCachedMatrixIDsDict
+{
+    NSDictionary *legacyObjects = [self objectsOfLegacyCacheFile:matrixIDsDictFileV2 forKeys:@[@"matrixIDsDict", @"lookupDatesDict"]];
+    if (legacyObjects)
     {
-        NSMutableData *theData = [NSMutableData data];
-        NSKeyedArchiver *encoder = [[NSKeyedArchiver alloc] initForWritingWithMutableData:theData];
-        
-        [encoder encodeObject:localContactByContactID forKey:@"localContactByContactID"];
+        id object = legacyObjects[@"matrixIDsDict"];
+        if ([object isKindOfClass:[NSDictionary class]])
+        {
+            matrixIDBy3PID = [object mutableCopy];
+        }
         
-        [encoder finishEncoding];
+        object = legacyObjects[@"lookupDatesDict"];
+        if ([object isKindOfClass:[NSDictionary class]])
+        {
+            lookupDateBy3PID = [object mutableCopy];
+        }
         
-        [self encryptAndSaveData:theData toFile:localContactsFile];
+        [self removeLegacyCacheFile:matrixIDsDictFileV2 migrated:[self cacheMatrixIDsDict]];
     }
     else
     {
-        NSFileManager *fileManager = [[NSFileManager alloc] init];
-        [fileManager removeItemAtPath:dataFilePath error:nil];
-    }
-}
-
-- (void)loadCachedLocalContacts
-{
-    NSString *dataFilePath = [self dataFilePathForComponent:localContactsFile];
-    
-    NSFileManager *fileManager = [[NSFileManager alloc] init];
-    
-    if ([fileManager fileExistsAtPath:dataFilePath])
-    {
-        // the file content could be corrupted
-        @try
+        MXKContactsCacheStore *store = [self cacheStoreForFile:matrixIDsDictFile];
+        if (store.count)
         {
-            NSData* filecontent = [NSData dataWithContentsOfFile:dataFilePath options:(NSDataReadingMappedAlways | NSDataReadingUncached) error:nil];
+            matrixIDBy3PID = [NSMutableDictionary dictionary];
+            lookupDateBy3PID = [NSMutableDictionary dictionary];
             
-            NSError *error = nil;
-            filecontent = [self decryptData:filecontent error:&error fileName:localContactsFile];
-
-            if (!error)
+            for (NSString *key in store.allKeys)
             {
-                NSKeyedUnarchiver *decoder = [[NSKeyedUnarchiver alloc] initForReadingWithData:filecontent];
-                
-                id object = [decoder decodeObjectForKey:@"localContactByContactID"];
-                
-                if ([object isKindOfClass:[NSDictionary class]])
+                if ([key hasPrefix:matrixIDRecordPrefix])
                 {
-                    localContactByContactID = [object mutableCopy];
+                    NSString *matrixID = [[NSString alloc] initWithData:[store recordForKey:key] encoding:NSUTF8StringEncoding];
+                    if (matrixID)
+                    {
+                        matrixIDBy3PID[[key substringFromIndex:matrixIDRecordPrefix.length]] = matrixID;
+                    }
+                }
+                else if ([key hasPrefix:lookupDateRecordPrefix])
+                {
+                    uint64_t lookupDate = [self uint64OfRecord:[store recordForKey:key]];
+                    if (lookupDate)
+                    {
+                        lookupDateBy3PID[[key substringFromIndex:lookupDateRecordPrefix.length]] = @(lookupDate / 1000.0);
+                    }
                 }
-                
-                [decoder finishDecoding];
-            }
-            else
-            {
-                NSLog(@"[MXKContactManager] loadCachedLocalContacts: failed to decrypt %@: %@", localContactsFile, error);
             }
         }
-        @catch (NSException *exception)
-        {
-            lastSyncDate = nil;
-        }
     }
     
-    if (!localContactByContactID)
+    if (!matrixIDBy3PID)
     {
-        localContactByContactID = [[NSMutableDictionary alloc] init];
+        matrixIDBy3PID = [[NSMutableDictionary alloc] init];
     }
 }
 
-- (void)cacheContactBookInfo
+- (BOOL)cacheLocalContacts
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:contactsBookInfoFile];
+    NSMutableDictionary<NSString*, NSData*> *records = [NSMutableDictionary dictionaryWithCapacity:localContactByContactID.count];
     
-    if (lastSyncDate)
+    [localContactByContactID enumerateKeysAndObjectsUsingBlock:^(NSString *contactID, MXKContact *contact, BOOL *stop) {
+        records[contactID] = [MXKContactsCacheDictionary recordOfContact:contact];
+    }];
+    
+    return [self saveRecords:records toCacheFile:localContactsFile];
+}
+
+- (void)cacheLocalContacts:(NSArray<MXKContact*>*)updatedContacts removedContactIDs:(NSArray<NSString*>*)removedContactIDs
+{
+    MXKContactsCacheStore *store = [self cacheStoreForFile:localContactsFile];
+    if (!store)
     {
-        NSMutableData *theData = [NSMutableData data];
-        NSKeyedArchiver *encoder = [[NSKeyedArchiver alloc] initForWritingWithMutableData:theData];
-        
-        [encoder encodeObject:lastSyncDate forKey:@"lastSyncDate"];
-        
-        [encoder finishEncoding];
-        
-        [self encryptAndSaveData:theData toFile:contactsBookInfoFile];
+        return;
     }
-    else
+    
+    for (MXKContact *contact in updatedContacts)
     {
-        NSFileManager *fileManager = [[NSFileManager alloc] init];
-        [fileManager removeItemAtPath:dataFilePath error:nil];
+        [store setRecord:[MXKContactsCacheDictionary recordOfContact:contact] forKey:contact.contactID];
     }
+    for (NSString *contactID in removedContactIDs)
+    {
+        [store removeRecordForKey:contactID];
+    }
+    
+    [store synchronize];
 }
 
-- (void)loadCachedContactBookInfo
+- (void)loadCachedLocalContacts
 {
-    NSString *dataFilePath = [self dataFilePathForComponent:contactsBookInfoFile];
-    
-    NSFileManager *fileManager = [[NSFileManager alloc] init];
-    
-    if ([fileManager fileExistsAtPath:dataFilePath])
+    NSDictionary *legacyObjects = [self objectsOfLegacyCacheFile:localContactsFileV2 forKeys:@[@"localContactByContactID"]];
+    if (legacyObjects)
     {
-        // the file content could be corrupted
-        @try
+        id object = legacyObjects[@"localContactByContactID"];
+        if ([object isKindOfClass:[NSDictionary class]])
         {
-            NSData* filecontent = [NSData dataWithContentsOfFile:dataFilePath options:(NSDataReadingMappedAlways | NSDataReadingUncached) error:nil];
-            
-            NSError *error = nil;
-            filecontent = [self decryptData:filecontent error:&error fileName:contactsBookInfoFile];
-
-            if (!error)
-            {
-                NSKeyedUnarchiver *decoder = [[NSKeyedUnarchiver alloc] initForReadingWithData:filecontent];
-                
-                lastSyncDate = [decoder decodeObjectForKey:@"lastSyncDate"];
-                
-                [decoder finishDecoding];
-            }
-            else
-            {
-                lastSyncDate = nil;
-                NSLog(@"[MXKContactManager] loadCachedContactBookInfo: failed to decrypt %@: %@", contactsBookInfoFile, error);
-            }
+            localContactByContactID = [object mutableCopy];
+            [self removeLegacyCacheFile:localContactsFileV2 migrated:[self cacheLocalContacts]];
         }
-        @catch (NSException *exception)
+        else
         {
             lastSyncDate = nil;
+            [self removeLegacyCacheFile:localContactsFileV2 migrated:YES];
         }
     }
+    else
+    {
+        MXKContactsCacheStore *store = [self cacheStoreForFile:localContactsFile];
+        if (store.count)
+        {
+            // The contacts are decoded record by record from the mapped file, when they are accessed
+            localContactByContactID = [[MXKContactsCacheDictionary alloc] initWithCacheStore:store];
+        }
+    }
+    
+    if (!localContactByContactID)
+    {
+        localContactByContactID = [[NSMutableDictionary alloc] init];
+    }
 }
 
-- (BOOL)encryptAndSaveData:(NSData*)data toFile:(NSString*)fileName
+- (BOOL)cacheContactBookInfo
 {
-    NSError *error = nil;
-    NSData *cipher = [self encryptData:data error:&error fileName:fileName];
-
-    if (error == nil)
-    {
-        [cipher writeToFile:[self dataFilePathForComponent:fileName] atomically:YES];
-    }
-    else
+    NSMutableDictionary<NSString*, NSData*> *records = [NSMutableDictionary dictionary];
+    
+    if (lastSyncDate)
     {
-        NSLog(@"[MXKContactManager] encryptAndSaveData: failed to encrypt %@", fileName);
+        records[lastSyncDateRecordKey] = [self recordWithUInt64:(uint64_t)(lastSyncDate.timeIntervalSince1970 * 1000)];
+        
+        [localContactFingerprints enumerateKeysAndObjectsUsingBlock:^(NSString *contactID, NSNumber *fingerprint, BOOL *stop) {
+            records[[fingerprintRecordPrefix stringByAppendingString:contactID]] = [self recordWithUInt64:fingerprint.unsignedLongLongValue];
+        }];
     }
     
-    return error == nil;
+    return [self saveRecords:records toCacheFile:contactsBookInfoFile];
 }
 
-- (NSData*)encryptData:(NSData*)data error:(NSError**)error fileName:(NSString*)fileName
+- (void)loadCachedContactBookInfo
 {
-    @try
+    NSDictionary *legacyObjects = [self objectsOfLegacyCacheFile:contactsBookInfoFileV2 forKeys:@[@"lastSyncDate", @"localContactFingerprints"]];
+    if (legacyObjects)
     {
-        MXKeyData *keyData = (MXKeyData *) [[MXKeyProvider sharedInstance] requestKeyForDataOfType:MXKContactManagerDataType isMandatory:NO expectedKeyType:kAes];
-        if (keyData && [keyData isKindOfClass:[MXAesKeyData class]])
-        {
-            MXAesKeyData *aesKey = (MXAesKeyData *) keyData;
-            NSData *cipher = [MXAes encrypt:data aesKey:aesKey.key iv:aesKey.iv error:error];
-            NSLog(@"[MXKContactManager] encryptData: encrypted %lu Bytes for %@", cipher.length, fileName);
-            return cipher;
-        }
+        id object = legacyObjects[@"lastSyncDate"];
+        lastSyncDate = [object isKindOfClass:[NSDate class]] ? object : nil;
+        
+        object = legacyObjects[@"localContactFingerprints"];
+        localContactFingerprints = [object isKindOfClass:[NSDictionary class]] ? object : nil;
+        
+        [self removeLegacyCacheFile:contactsBookInfoFileV2 migrated:[self cacheContactBookInfo]];
     }
-    @catch (NSException *exception)
+    else
     {
-        *error = [NSError errorWithDomain:MXKContactManagerDomain code:MXContactManagerEncryptionDelegateNotReady userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"encryptData failed: %@", exception.reason]}];
+        MXKContactsCacheStore *store = [self cacheStoreForFile:contactsBookInfoFile];
+        
+        uint64_t lastSyncTimestamp = [self uint64OfRecord:[store recordForKey:lastSyncDateRecordKey]];
+        lastSyncDate = lastSyncTimestamp ? [NSDate dateWithTimeIntervalSince1970:(lastSyncTimestamp / 1000.0)] : nil;
+        
+        NSMutableDictionary<NSString*, NSNumber*> *fingerprints = [NSMutableDictionary dictionaryWithCapacity:store.count];
+        for (NSString *key in store.allKeys)
+        {
+            if ([key hasPrefix:fingerprintRecordPrefix])
+            {
+                fingerprints[[key substringFromIndex:fingerprintRecordPrefix.length]] = @([self uint64OfRecord:[store recordForKey:key]]);
+            }
+        }
+        localContactFingerprints = fingerprints.count ? fingerprints : nil;
     }
-    
-    NSLog(@"[MXKContactManager] encryptData: no key method provided for encryption of %@", fileName);
-    return data;
 }
 
 - (NSData*)decryptData:(NSData*)data error:(NSError**)error fileName:(NSString*)fileName
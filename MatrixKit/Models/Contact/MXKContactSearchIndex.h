@@ -0,0 +1,97 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "MXKContact.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKContactSearchIndex` indexes contacts to filter them without scanning all of them on each keystroke.
+
+ The display names, matrix ids, email addresses and phone numbers of the contacts are normalised (case
+ and diacritics folded) once, when the contacts are added. They are indexed by:
+ - their n-grams (up to trigrams), to answer `matchedWithPatterns:` queries: a pattern is looked up from the
+   postings of its trigrams, and the few candidates are checked against the normalised data.
+ - a prefix trie of their words, to answer `hasPrefix:` queries.
+
+ The index is updated incrementally, contact by contact. It is thread safe.
+ */
+@interface MXKContactSearchIndex : NSObject
+
+/**
+ Create an index of contacts.
+
+ @param contacts the contacts to index.
+ @return the newly created instance.
+ */
+- (instancetype)initWithContacts:(NSArray<MXKContact*>*)contacts;
+
+/**
+ Add a contact to the index, or update it if a contact with the same contact id is already indexed.
+
+ @param contact the contact.
+ */
+- (void)addContact:(MXKContact*)contact;
+
+/**
+ Remove a contact from the index.
+
+ @param contactID the contact id.
+ */
+- (void)removeContactWithContactID:(NSString*)contactID;
+
+/**
+ Remove all the contacts.
+ */
+- (void)removeAllContacts;
+
+/**
+ The number of indexed contacts.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ The indexed contacts which match with the patterns (see [MXKContact matchedWithPatterns:]). The matching
+ ignores the case and the diacritics.
+
+ @param patterns the patterns.
+ @return the matching contacts. All the contacts if there is no pattern.
+ */
+- (NSArray<MXKContact*>*)contactsMatchingPatterns:(NSArray<NSString*>*)patterns;
+
+/**
+ The indexed contacts which have a display name component, a matrix id, an email or a phone number starting
+ with the prefix (see [MXKContact hasPrefix:]). The matching ignores the case and the diacritics.
+
+ @param prefix a non empty string.
+ @return the matching contacts.
+ */
+- (NSArray<MXKContact*>*)contactsWithPrefix:(NSString*)prefix;
+
+/**
+ Normalise a string for the search: fold its case and its diacritics.
+
+ @param string the string.
+ @return the normalised string.
+ */
++ (NSString*)normalizedString:(NSString*)string;
+
+@end
+
+NS_ASSUME_NONNULL_END
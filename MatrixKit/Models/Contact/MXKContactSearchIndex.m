@@ -0,0 +1,646 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKContactSearchIndex.h"
+
+#import "MXKEmail.h"
+#import "MXKPhoneNumber.h"
+
+/**
+ The maximum length of the indexed n-grams.
+ */
+#define MXKCONTACTSEARCHINDEX_GRAM_LENGTH 3
+
+#pragma mark - MXKContactSearchIndexEntry
+
+/**
+ The normalised data of an indexed contact.
+ */
+@interface MXKContactSearchIndexEntry : NSObject
+
+@property (nonatomic) MXKContact *contact;
+@property (nonatomic) NSString *displayName;
+// The matrix ids without their homeserver name
+@property (nonatomic) NSArray<NSString*> *matrixIDNames;
+@property (nonatomic) NSArray<NSString*> *emails;
+
+// The n-grams of the display name, the emails and the phone numbers
+@property (nonatomic) NSSet<NSString*> *grams;
+// The n-grams of the matrix id names
+@property (nonatomic) NSSet<NSString*> *matrixIDGrams;
+// The words inserted in the prefix trie
+@property (nonatomic) NSSet<NSString*> *words;
+
+@end
+
+@implementation MXKContactSearchIndexEntry
+@end
+
+#pragma mark - MXKContactSearchIndexTrieNode
+
+@interface MXKContactSearchIndexTrieNode : NSObject
+
+@property (nonatomic) NSMutableDictionary<NSNumber*, MXKContactSearchIndexTrieNode*> *children;
+// The slots of the entries having a word which ends at this node
+@property (nonatomic) NSMutableIndexSet *slots;
+
+@end
+
+@implementation MXKContactSearchIndexTrieNode
+@end
+
+#pragma mark - MXKContactSearchIndex
+
+@interface MXKContactSearchIndex ()
+{
+    /**
+     The entries by slot. A removed entry leaves a NSNull which is reused by the next added contact.
+     */
+    NSMutableArray *entries;
+    NSMutableIndexSet *freeSlots;
+    NSMutableDictionary<NSString*, NSNumber*> *slotByContactID;
+    
+    /**
+     The slots of the entries by n-gram.
+     */
+    NSMutableDictionary<NSString*, NSMutableIndexSet*> *gramPostings;
+    NSMutableDictionary<NSString*, NSMutableIndexSet*> *matrixIDGramPostings;
+    
+    /**
+     The prefix trie of the words of the entries.
+     */
+    MXKContactSearchIndexTrieNode *trieRoot;
+}
+
+@end
+
+@implementation MXKContactSearchIndex
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        [self reset];
+    }
+    return self;
+}
+
+- (instancetype)initWithContacts:(NSArray<MXKContact*>*)contacts
+{
+    self = [self init];
+    if (self)
+    {
+        for (MXKContact *contact in contacts)
+        {
+            [self addContact:contact];
+        }
+    }
+    return self;
+}
+
++ (NSString*)normalizedString:(NSString*)string
+{
+    return [string stringByFoldingWithOptions:(NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch) locale:nil];
+}
+
+- (NSUInteger)count
+{
+    @synchronized (self)
+    {
+        return slotByContactID.count;
+    }
+}
+
+- (void)addContact:(MXKContact*)contact
+{
+    if (!contact.contactID)
+    {
+        return;
+    }
+    
+    // Normalise the contact data outside the lock
+    MXKContactSearchIndexEntry *entry = [self entryForContact:contact];
+    
+    @synchronized (self)
+    {
+        NSNumber *slotNumber = slotByContactID[contact.contactID];
+        if (slotNumber)
+        {
+            [self removeEntryAtSlot:slotNumber.unsignedIntegerValue];
+        }
+        
+        NSUInteger slot;
+        if (freeSlots.count)
+        {
+            slot = freeSlots.firstIndex;
+            [freeSlots removeIndex:slot];
+            entries[slot] = entry;
+        }
+        else
+        {
+            slot = entries.count;
+            [entries addObject:entry];
+        }
+        slotByContactID[contact.contactID] = @(slot);
+        
+        for (NSString *gram in entry.grams)
+        {
+            [self addSlot:slot toPostings:gramPostings ofGram:gram];
+        }
+        for (NSString *gram in entry.matrixIDGrams)
+        {
+            [self addSlot:slot toPostings:matrixIDGramPostings ofGram:gram];
+        }
+        for (NSString *word in entry.words)
+        {
+            [[self trieNodeForWord:word create:YES].slots addIndex:slot];
+        }
+    }
+}
+
+- (void)removeContactWithContactID:(NSString*)contactID
+{
+    @synchronized (self)
+    {
+        NSNumber *slotNumber = slotByContactID[contactID];
+        if (slotNumber)
+        {
+            [self removeEntryAtSlot:slotNumber.unsignedIntegerValue];
+        }
+    }
+}
+
+- (void)removeAllContacts
+{
+    @synchronized (self)
+    {
+        [self reset];
+    }
+}
+
+- (NSArray<MXKContact*>*)contactsMatchingPatterns:(NSArray<NSString*>*)patterns
+{
+    NSMutableArray<NSString*> *nonEmptyPatterns = [NSMutableArray arrayWithCapacity:patterns.count];
+    NSMutableArray<NSString*> *normalizedPatterns = [NSMutableArray arrayWithCapacity:patterns.count];
+    for (NSString *pattern in patterns)
+    {
+        if (pattern.length)
+        {
+            [nonEmptyPatterns addObject:pattern];
+            [normalizedPatterns addObject:[MXKContactSearchIndex normalizedString:pattern]];
+        }
+    }
+    
+    NSMutableArray<MXKContact*> *contacts = [NSMutableArray array];
+    
+    @synchronized (self)
+    {
+        if (!normalizedPatterns.count)
+        {
+            for (id entry in entries)
+            {
+                if (entry != [NSNull null])
+                {
+                    [contacts addObject:((MXKContactSearchIndexEntry*)entry).contact];
+                }
+            }
+            return contacts;
+        }
+        
+        // The display name, an email or a phone number must match all the patterns
+        NSMutableIndexSet *candidates;
+        for (NSString *pattern in normalizedPatterns)
+        {
+            NSMutableIndexSet *slots = [self slotsInPostings:gramPostings containingPattern:pattern];
+            
+            // A phone number pattern is matched without whitespace, and may be an international number (see [MXKPhoneNumber matchedWithPatterns:])
+            NSString *cleanPattern = [[pattern componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] componentsJoinedByString:@""];
+            if (cleanPattern.length && ![cleanPattern isEqualToString:pattern])
+            {
+                [slots addIndexes:[self slotsInPostings:gramPostings containingPattern:cleanPattern]];
+            }
+            
+            NSString *msisdnPattern = [self msisdnPatternFromPattern:cleanPattern];
+            if (msisdnPattern)
+            {
+                [slots addIndexes:[self slotsInPostings:gramPostings containingPattern:msisdnPattern]];
+            }
+            
+            candidates = candidates ? [self intersectionOfSlots:candidates withSlots:slots] : slots;
+            if (!candidates.count)
+            {
+                break;
+            }
+        }
+        
+        // A matrix id must match any pattern
+        for (NSString *pattern in normalizedPatterns)
+        {
+            [candidates addIndexes:[self slotsInPostings:matrixIDGramPostings containingPattern:pattern]];
+        }
+        
+        // Check the candidates
+        [candidates enumerateIndexesUsingBlock:^(NSUInteger slot, BOOL *stop) {
+            MXKContactSearchIndexEntry *entry = self->entries[slot];
+            if ([self entry:entry matchesPatterns:nonEmptyPatterns normalizedPatterns:normalizedPatterns])
+            {
+                [contacts addObject:entry.contact];
+            }
+        }];
+    }
+    
+    return contacts;
+}
+
+- (NSArray<MXKContact*>*)contactsWithPrefix:(NSString*)prefix
+{
+    if (!prefix.length)
+    {
+        return @[];
+    }
+    
+    NSString *normalizedPrefix = [MXKContactSearchIndex normalizedString:prefix];
+    
+    // Consider the prefix of a phone number without whitespace and without international prefix (see [MXKPhoneNumber hasPrefix:])
+    NSMutableSet<NSString*> *prefixes = [NSMutableSet setWithObject:normalizedPrefix];
+    NSString *cleanPrefix = [[normalizedPrefix componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] componentsJoinedByString:@""];
+    if (cleanPrefix.length)
+    {
+        [prefixes addObject:cleanPrefix];
+        
+        NSString *msisdnPrefix = [self msisdnPatternFromPattern:cleanPrefix];
+        if (msisdnPrefix)
+        {
+            [prefixes addObject:msisdnPrefix];
+        }
+    }
+    
+    NSMutableArray<MXKContact*> *contacts = [NSMutableArray array];
+    
+    @synchronized (self)
+    {
+        NSMutableIndexSet *slots = [NSMutableIndexSet indexSet];
+        for (NSString *aPrefix in prefixes)
+        {
+            MXKContactSearchIndexTrieNode *node = [self trieNodeForWord:aPrefix create:NO];
+            if (node)
+            {
+                [self collectSlotsOfTrieNode:node inSlots:slots];
+            }
+        }
+        
+        [slots enumerateIndexesUsingBlock:^(NSUInteger slot, BOOL *stop) {
+            [contacts addObject:((MXKContactSearchIndexEntry*)self->entries[slot]).contact];
+        }];
+    }
+    
+    return contacts;
+}
+
+#pragma mark - Private methods
+
+// Must be called under @synchronized(self)
+- (void)reset
+{
+    entries = [NSMutableArray array];
+    freeSlots = [NSMutableIndexSet indexSet];
+    slotByContactID = [NSMutableDictionary dictionary];
+    gramPostings = [NSMutableDictionary dictionary];
+    matrixIDGramPostings = [NSMutableDictionary dictionary];
+    trieRoot = [[MXKContactSearchIndexTrieNode alloc] init];
+    trieRoot.slots = [NSMutableIndexSet indexSet];
+}
+
+- (MXKContactSearchIndexEntry*)entryForContact:(MXKContact*)contact
+{
+    MXKContactSearchIndexEntry *entry = [[MXKContactSearchIndexEntry alloc] init];
+    entry.contact = contact;
+    
+    NSMutableSet<NSString*> *grams = [NSMutableSet set];
+    NSMutableSet<NSString*> *matrixIDGrams = [NSMutableSet set];
+    NSMutableSet<NSString*> *words = [NSMutableSet set];
+    
+    // Display name and its components
+    entry.displayName = contact.displayName.length ? [MXKContactSearchIndex normalizedString:contact.displayName] : @"";
+    if (entry.displayName.length)
+    {
+        [self addGramsOfString:entry.displayName toSet:grams];
+        [words addObject:entry.displayName];
+        
+        for (NSString *component in [entry.displayName componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]])
+        {
+            if (component.length)
+            {
+                [words addObject:component];
+            }
+        }
+    }
+    
+    // Matrix ids
+    NSMutableArray<NSString*> *matrixIDNames = [NSMutableArray array];
+    for (NSString *matrixID in contact.matrixIdentifiers)
+    {
+        NSString *normalizedMatrixID = [MXKContactSearchIndex normalizedString:matrixID];
+        
+        // Consider only the first part of the matrix id (ignore homeserver name)
+        NSRange range = [normalizedMatrixID rangeOfString:@":"];
+        if (range.location != NSNotFound)
+        {
+            NSString *matrixIDName = [normalizedMatrixID substringToIndex:range.location];
+            [matrixIDNames addObject:matrixIDName];
+            [self addGramsOfString:matrixIDName toSet:matrixIDGrams];
+        }
+        
+        [words addObject:normalizedMatrixID];
+        if ([normalizedMatrixID hasPrefix:@"@"])
+        {
+            // A prefix without "@" matches the matrix ids too
+            [words addObject:[normalizedMatrixID substringFromIndex:1]];
+        }
+    }
+    entry.matrixIDNames = matrixIDNames;
+    
+    // Emails
+    NSMutableArray<NSString*> *emails = [NSMutableArray array];
+    for (MXKEmail *email in contact.emailAddresses)
+    {
+        if (email.emailAddress.length)
+        {
+            NSString *normalizedEmail = [MXKContactSearchIndex normalizedString:email.emailAddress];
+            [emails addObject:normalizedEmail];
+            [self addGramsOfString:normalizedEmail toSet:grams];
+            [words addObject:normalizedEmail];
+        }
+    }
+    entry.emails = emails;
+    
+    // Phone numbers, in all their forms
+    for (MXKPhoneNumber *phoneNumber in contact.phoneNumbers)
+    {
+        for (NSString *number in @[phoneNumber.textNumber ?: @"", phoneNumber.cleanedPhonenumber ?: @"", phoneNumber.msisdn ?: @""])
+        {
+            if (number.length)
+            {
+                NSString *normalizedNumber = [MXKContactSearchIndex normalizedString:number];
+                [self addGramsOfString:normalizedNumber toSet:grams];
+                [words addObject:normalizedNumber];
+            }
+        }
+    }
+    
+    entry.grams = grams;
+    entry.matrixIDGrams = matrixIDGrams;
+    entry.words = words;
+    
+    return entry;
+}
+
+- (void)addGramsOfString:(NSString*)string toSet:(NSMutableSet<NSString*>*)grams
+{
+    NSUInteger length = string.length;
+    for (NSUInteger location = 0; location < length; location++)
+    {
+        for (NSUInteger gramLength = 1; gramLength <= MXKCONTACTSEARCHINDEX_GRAM_LENGTH && location + gramLength <= length; gramLength++)
+        {
+            [grams addObject:[string substringWithRange:NSMakeRange(location, gramLength)]];
+        }
+    }
+}
+
+// Must be called under @synchronized(self)
+- (void)removeEntryAtSlot:(NSUInteger)slot
+{
+    MXKContactSearchIndexEntry *entry = entries[slot];
+    
+    for (NSString *gram in entry.grams)
+    {
+        [self removeSlot:slot fromPostings:gramPostings ofGram:gram];
+    }
+    for (NSString *gram in entry.matrixIDGrams)
+    {
+        [self removeSlot:slot fromPostings:matrixIDGramPostings ofGram:gram];
+    }
+    for (NSString *word in entry.words)
+    {
+        [[self trieNodeForWord:word create:NO].slots removeIndex:slot];
+    }
+    
+    [slotByContactID removeObjectForKey:entry.contact.contactID];
+    entries[slot] = [NSNull null];
+    [freeSlots addIndex:slot];
+}
+
+// Must be called under @synchronized(self)
+- (void)addSlot:(NSUInteger)slot toPostings:(NSMutableDictionary<NSString*, NSMutableIndexSet*>*)postings ofGram:(NSString*)gram
+{
+    NSMutableIndexSet *slots = postings[gram];
+    if (!slots)
+    {
+        slots = [NSMutableIndexSet indexSet];
+        postings[gram] = slots;
+    }
+    [slots addIndex:slot];
+}
+
+// Must be called under @synchronized(self)
+- (void)removeSlot:(NSUInteger)slot fromPostings:(NSMutableDictionary<NSString*, NSMutableIndexSet*>*)postings ofGram:(NSString*)gram
+{
+    NSMutableIndexSet *slots = postings[gram];
+    [slots removeIndex:slot];
+    if (slots && !slots.count)
+    {
+        [postings removeObjectForKey:gram];
+    }
+}
+
+/**
+ The slots of the entries which may contain the pattern: the entries which contain the pattern if it is a n-gram,
+ or all its trigrams.
+ Must be called under @synchronized(self).
+ */
+- (NSMutableIndexSet*)slotsInPostings:(NSDictionary<NSString*, NSMutableIndexSet*>*)postings containingPattern:(NSString*)pattern
+{
+    NSUInteger length = pattern.length;
+    if (length <= MXKCONTACTSEARCHINDEX_GRAM_LENGTH)
+    {
+        return [postings[pattern] mutableCopy] ?: [NSMutableIndexSet indexSet];
+    }
+    
+    // Intersect the postings of the trigrams, from the shortest one
+    NSMutableArray<NSIndexSet*> *trigramPostings = [NSMutableArray arrayWithCapacity:length];
+    for (NSUInteger location = 0; location + MXKCONTACTSEARCHINDEX_GRAM_LENGTH <= length; location++)
+    {
+        NSIndexSet *slots = postings[[pattern substringWithRange:NSMakeRange(location, MXKCONTACTSEARCHINDEX_GRAM_LENGTH)]];
+        if (!slots)
+        {
+            return [NSMutableIndexSet indexSet];
+        }
+        [trigramPostings addObject:slots];
+    }
+    [trigramPostings sortUsingComparator:^NSComparisonResult(NSIndexSet *slots1, NSIndexSet *slots2) {
+        return (slots1.count < slots2.count) ? NSOrderedAscending : ((slots1.count > slots2.count) ? NSOrderedDescending : NSOrderedSame);
+    }];
+    
+    NSMutableIndexSet *candidates = [trigramPostings.firstObject mutableCopy];
+    for (NSUInteger index = 1; index < trigramPostings.count && candidates.count; index++)
+    {
+        candidates = [self intersectionOfSlots:candidates withSlots:trigramPostings[index]];
+    }
+    return candidates;
+}
+
+- (NSMutableIndexSet*)intersectionOfSlots:(NSIndexSet*)slots withSlots:(NSIndexSet*)otherSlots
+{
+    if (slots.count > otherSlots.count)
+    {
+        NSIndexSet *swap = slots;
+        slots = otherSlots;
+        otherSlots = swap;
+    }
+    
+    NSMutableIndexSet *intersection = [NSMutableIndexSet indexSet];
+    [slots enumerateIndexesUsingBlock:^(NSUInteger slot, BOOL *stop) {
+        if ([otherSlots containsIndex:slot])
+        {
+            [intersection addIndex:slot];
+        }
+    }];
+    return intersection;
+}
+
+/**
+ The pattern without its international prefix ("+" or "00"), nil if it has none.
+ */
+- (NSString*)msisdnPatternFromPattern:(NSString*)pattern
+{
+    NSString *msisdnPattern;
+    if ([pattern hasPrefix:@"+"])
+    {
+        msisdnPattern = [pattern substringFromIndex:1];
+    }
+    else if ([pattern hasPrefix:@"00"])
+    {
+        msisdnPattern = [pattern substringFromIndex:2];
+    }
+    return msisdnPattern.length ? msisdnPattern : nil;
+}
+
+/**
+ Check a candidate with the rules of [MXKContact matchedWithPatterns:], on the normalised data.
+ */
+- (BOOL)entry:(MXKContactSearchIndexEntry*)entry matchesPatterns:(NSArray<NSString*>*)patterns normalizedPatterns:(NSArray<NSString*>*)normalizedPatterns
+{
+    if ([self string:entry.displayName containsAllPatterns:normalizedPatterns])
+    {
+        return YES;
+    }
+    
+    for (NSString *matrixIDName in entry.matrixIDNames)
+    {
+        for (NSString *pattern in normalizedPatterns)
+        {
+            if ([matrixIDName containsString:pattern])
+            {
+                return YES;
+            }
+        }
+    }
+    
+    for (MXKPhoneNumber *phoneNumber in entry.contact.phoneNumbers)
+    {
+        if ([phoneNumber matchedWithPatterns:patterns])
+        {
+            return YES;
+        }
+    }
+    
+    for (NSString *email in entry.emails)
+    {
+        if ([self string:email containsAllPatterns:normalizedPatterns])
+        {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+- (BOOL)string:(NSString*)string containsAllPatterns:(NSArray<NSString*>*)patterns
+{
+    if (!string.length)
+    {
+        return NO;
+    }
+    
+    for (NSString *pattern in patterns)
+    {
+        if (![string containsString:pattern])
+        {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// Must be called under @synchronized(self)
+- (MXKContactSearchIndexTrieNode*)trieNodeForWord:(NSString*)word create:(BOOL)create
+{
+    MXKContactSearchIndexTrieNode *node = trieRoot;
+    
+    NSUInteger length = word.length;
+    for (NSUInteger index = 0; index < length && node; index++)
+    {
+        NSNumber *character = @([word characterAtIndex:index]);
+        MXKContactSearchIndexTrieNode *child = node.children[character];
+        
+        if (!child && create)
+        {
+            child = [[MXKContactSearchIndexTrieNode alloc] init];
+            child.slots = [NSMutableIndexSet indexSet];
+            
+            if (!node.children)
+            {
+                node.children = [NSMutableDictionary dictionary];
+            }
+            node.children[character] = child;
+        }
+        
+        node = child;
+    }
+    
+    return node;
+}
+
+// Must be called under @synchronized(self)
+- (void)collectSlotsOfTrieNode:(MXKContactSearchIndexTrieNode*)node inSlots:(NSMutableIndexSet*)slots
+{
+    NSMutableArray<MXKContactSearchIndexTrieNode*> *nodes = [NSMutableArray arrayWithObject:node];
+    while (nodes.count)
+    {
+        MXKContactSearchIndexTrieNode *aNode = nodes.lastObject;
+        [nodes removeLastObject];
+        
+        [slots addIndexes:aNode.slots];
+        if (aNode.children)
+        {
+            [nodes addObjectsFromArray:aNode.children.allValues];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,92 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "MXKContactsCacheStore.h"
+
+@class MXKContact;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKContactsCacheDictionary` is a mutable dictionary of contacts by contact id backed by a `MXKContactsCacheStore`.
+
+ The contacts of the store are decoded one by one, when they are first accessed. The keys whose contact has been
+ set, removed or marked as changed since the last write are tracked, so that only their records are written.
+
+ A dictionary is thread safe.
+ */
+@interface MXKContactsCacheDictionary : NSMutableDictionary<NSString*, MXKContact*>
+
+/**
+ Create a dictionary with the contacts of a cache store.
+
+ No record is read here: the record of a contact is decoded when the contact is first accessed.
+
+ @param cacheStore the store of the archived contacts by contact id. nil for an empty dictionary.
+ @return the newly created instance.
+ */
+- (instancetype)initWithCacheStore:(nullable MXKContactsCacheStore*)cacheStore NS_DESIGNATED_INITIALIZER;
+
+/**
+ The store the contacts are read from and written to.
+ */
+@property (nonatomic, readonly, nullable) MXKContactsCacheStore *cacheStore;
+
+/**
+ The number of contacts whose record has not been decoded yet.
+ */
+@property (nonatomic, readonly) NSUInteger undecodedContactsCount;
+
+/**
+ Mark a contact modified in place as changed, so that its record is written by the next write.
+
+ @param contactID the contact id.
+ */
+- (void)setNeedsWriteForContactID:(NSString*)contactID;
+
+/**
+ Write the changes to a cache store.
+
+ Only the changed records are written when the store is the one of the dictionary. Otherwise all the contacts
+ are written, the missing ones are removed, and the store becomes the one of the dictionary.
+
+ @param cacheStore the store.
+ @return YES on success.
+ */
+- (BOOL)writeToCacheStore:(MXKContactsCacheStore*)cacheStore;
+
+/**
+ Decode an archived contact.
+
+ @param record the archive.
+ @return the contact. nil if the record is corrupted.
+ */
++ (nullable MXKContact*)contactOfRecord:(NSData*)record;
+
+/**
+ Archive a contact.
+
+ @param contact the contact.
+ @return the archive.
+ */
++ (NSData*)recordOfContact:(MXKContact*)contact;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,308 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKContactsCacheDictionary.h"
+
+#import "MXKContact.h"
+
+@interface MXKContactsCacheDictionary ()
+{
+    /**
+     The decoded or set contacts by contact id.
+     */
+    NSMutableDictionary<NSString*, MXKContact*> *contacts;
+    
+    /**
+     The contact ids whose record is still to decode.
+     */
+    NSMutableSet<NSString*> *undecodedContactIDs;
+    
+    /**
+     The contact ids whose record must be written or removed by the next write.
+     */
+    NSMutableSet<NSString*> *dirtyContactIDs;
+}
+
+@end
+
+@implementation MXKContactsCacheDictionary
+
+- (instancetype)initWithCacheStore:(MXKContactsCacheStore*)cacheStore
+{
+    self = [super init];
+    if (self)
+    {
+        _cacheStore = cacheStore;
+        
+        contacts = [NSMutableDictionary dictionary];
+        undecodedContactIDs = cacheStore ? [NSMutableSet setWithArray:cacheStore.allKeys] : [NSMutableSet set];
+        dirtyContactIDs = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    return [self initWithCacheStore:nil];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)numItems
+{
+    return [self initWithCacheStore:nil];
+}
+
+- (instancetype)initWithObjects:(const id _Nonnull [_Nullable])objects forKeys:(const id<NSCopying> _Nonnull [_Nullable])keys count:(NSUInteger)count
+{
+    self = [self initWithCacheStore:nil];
+    if (self)
+    {
+        for (NSUInteger index = 0; index < count; index++)
+        {
+            [self setObject:objects[index] forKey:keys[index]];
+        }
+    }
+    return self;
+}
+
+- (instancetype)initWithCoder:(NSCoder *)coder
+{
+    // The dictionary is persisted in its cache store only
+    return [self initWithCacheStore:nil];
+}
+
+#pragma mark - NSDictionary primitives
+
+- (NSUInteger)count
+{
+    @synchronized(self)
+    {
+        return contacts.count + undecodedContactIDs.count;
+    }
+}
+
+- (MXKContact*)objectForKey:(id)key
+{
+    @synchronized(self)
+    {
+        MXKContact *contact = contacts[key];
+        if (!contact && [undecodedContactIDs containsObject:key])
+        {
+            [undecodedContactIDs removeObject:key];
+            
+            contact = [MXKContactsCacheDictionary contactOfRecord:[_cacheStore recordForKey:key]];
+            if (contact)
+            {
+                contacts[key] = contact;
+            }
+            else
+            {
+                NSLog(@"[MXKContactsCacheDictionary] objectForKey: corrupted record for %@", key);
+                
+                // Remove the record with the next write
+                [dirtyContactIDs addObject:key];
+            }
+        }
+        return contact;
+    }
+}
+
+- (NSEnumerator*)keyEnumerator
+{
+    @synchronized(self)
+    {
+        // Enumerate a snapshot of the keys
+        NSMutableArray<NSString*> *keys = [NSMutableArray arrayWithCapacity:(contacts.count + undecodedContactIDs.count)];
+        [keys addObjectsFromArray:contacts.allKeys];
+        [keys addObjectsFromArray:undecodedContactIDs.allObjects];
+        return keys.objectEnumerator;
+    }
+}
+
+- (NSArray<MXKContact*>*)allValues
+{
+    // Skip the contacts whose record is corrupted
+    NSMutableArray<MXKContact*> *allValues = [NSMutableArray arrayWithCapacity:self.count];
+    for (NSString *contactID in self.keyEnumerator)
+    {
+        MXKContact *contact = [self objectForKey:contactID];
+        if (contact)
+        {
+            [allValues addObject:contact];
+        }
+    }
+    return allValues;
+}
+
+- (void)enumerateKeysAndObjectsWithOptions:(NSEnumerationOptions)opts usingBlock:(void (NS_NOESCAPE ^)(NSString *key, MXKContact *obj, BOOL *stop))block
+{
+    BOOL stop = NO;
+    for (NSString *contactID in self.keyEnumerator)
+    {
+        MXKContact *contact = [self objectForKey:contactID];
+        if (contact)
+        {
+            block(contactID, contact, &stop);
+            if (stop)
+            {
+                break;
+            }
+        }
+    }
+}
+
+- (void)enumerateKeysAndObjectsUsingBlock:(void (NS_NOESCAPE ^)(NSString *key, MXKContact *obj, BOOL *stop))block
+{
+    [self enumerateKeysAndObjectsWithOptions:0 usingBlock:block];
+}
+
+#pragma mark - NSMutableDictionary primitives
+
+- (void)setObject:(MXKContact*)contact forKey:(id<NSCopying>)key
+{
+    NSString *contactID = (NSString*)key;
+    
+    @synchronized(self)
+    {
+        contacts[contactID] = contact;
+        [undecodedContactIDs removeObject:contactID];
+        [dirtyContactIDs addObject:contactID];
+    }
+}
+
+- (void)removeObjectForKey:(id)key
+{
+    @synchronized(self)
+    {
+        if (contacts[key] || [undecodedContactIDs containsObject:key])
+        {
+            [contacts removeObjectForKey:key];
+            [undecodedContactIDs removeObject:key];
+            [dirtyContactIDs addObject:key];
+        }
+    }
+}
+
+#pragma mark - Cache store
+
+- (NSUInteger)undecodedContactsCount
+{
+    @synchronized(self)
+    {
+        return undecodedContactIDs.count;
+    }
+}
+
+- (void)setNeedsWriteForContactID:(NSString*)contactID
+{
+    @synchronized(self)
+    {
+        [dirtyContactIDs addObject:contactID];
+    }
+}
+
+- (BOOL)writeToCacheStore:(MXKContactsCacheStore*)cacheStore
+{
+    NSMutableDictionary<NSString*, MXKContact*> *updatedContacts;
+    NSMutableArray<NSString*> *removedContactIDs;
+    BOOL rewritesAll;
+    
+    @synchronized(self)
+    {
+        rewritesAll = (cacheStore != _cacheStore);
+        if (rewritesAll)
+        {
+            // All the contacts are written in the new store
+            for (NSString *contactID in undecodedContactIDs.allObjects)
+            {
+                [self objectForKey:contactID];
+            }
+            updatedContacts = [contacts mutableCopy];
+            _cacheStore = cacheStore;
+        }
+        else
+        {
+            updatedContacts = [NSMutableDictionary dictionaryWithCapacity:dirtyContactIDs.count];
+            removedContactIDs = [NSMutableArray array];
+            for (NSString *contactID in dirtyContactIDs)
+            {
+                MXKContact *contact = contacts[contactID];
+                if (contact)
+                {
+                    updatedContacts[contactID] = contact;
+                }
+                else if (![undecodedContactIDs containsObject:contactID])
+                {
+                    [removedContactIDs addObject:contactID];
+                }
+            }
+        }
+        [dirtyContactIDs removeAllObjects];
+    }
+    
+    // Archive the contacts out of the lock
+    NSMutableDictionary<NSString*, NSData*> *records = [NSMutableDictionary dictionaryWithCapacity:updatedContacts.count];
+    [updatedContacts enumerateKeysAndObjectsUsingBlock:^(NSString *contactID, MXKContact *contact, BOOL *stop) {
+        records[contactID] = [MXKContactsCacheDictionary recordOfContact:contact];
+    }];
+    
+    if (rewritesAll)
+    {
+        [cacheStore setRecords:records];
+    }
+    else
+    {
+        [records enumerateKeysAndObjectsUsingBlock:^(NSString *contactID, NSData *record, BOOL *stop) {
+            [cacheStore setRecord:record forKey:contactID];
+        }];
+        for (NSString *contactID in removedContactIDs)
+        {
+            [cacheStore removeRecordForKey:contactID];
+        }
+    }
+    
+    return [cacheStore synchronize];
+}
+
+#pragma mark - Records
+
++ (MXKContact*)contactOfRecord:(NSData*)record
+{
+    if (!record)
+    {
+        return nil;
+    }
+    
+    MXKContact *contact;
+    
+    // the record could be corrupted
+    @try
+    {
+        contact = [NSKeyedUnarchiver unarchiveObjectWithData:record];
+    }
+    @catch (NSException *exception)
+    {
+    }
+    
+    return [contact isKindOfClass:[MXKContact class]] ? contact : nil;
+}
+
++ (NSData*)recordOfContact:(MXKContact*)contact
+{
+    return [NSKeyedArchiver archivedDataWithRootObject:contact];
+}
+
+@end
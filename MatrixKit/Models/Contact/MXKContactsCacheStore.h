@@ -0,0 +1,130 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default size of the blocks of a store file.
+ */
+#define MXKCONTACTSCACHESTORE_DEFAULT_BLOCK_SIZE 4096
+
+/**
+ `MXKContactsCacheStore` is a compact binary store of records (data by string key) used for the contacts caches.
+
+ The store file is a versioned header followed by a log of length-prefixed records ("put" and "delete" records).
+ The log is split in fixed-size blocks which are encrypted independently (AES-CTR with a random nonce per block
+ write) when a key is provided, so that the file can be memory-mapped and each record decrypted on demand.
+
+ Opening a store only reads the record headers to build the offset index of the records. Updates are appended
+ to the log, and the log is compacted when the obsolete records take more space than the live ones.
+
+ A store is thread safe.
+ */
+@interface MXKContactsCacheStore : NSObject
+
+/**
+ Open or create a store.
+
+ A store file created with another key (or without key) is discarded.
+
+ @param filePath the path of the store file.
+ @param key the AES key (16, 24 or 32 bytes) used to encrypt the file. nil to store it in plain text.
+ @return the newly created instance.
+ */
+- (instancetype)initWithFilePath:(NSString*)filePath key:(nullable NSData*)key;
+
+/**
+ The path of the store file.
+ */
+@property (nonatomic, readonly) NSString *filePath;
+
+/**
+ The size of the blocks used for the new store files. The block size of an existing file does not change.
+ Default is MXKCONTACTSCACHESTORE_DEFAULT_BLOCK_SIZE.
+ */
+@property (nonatomic) NSUInteger blockSize;
+
+/**
+ The keys of the records.
+ */
+@property (nonatomic, readonly) NSArray<NSString*> *allKeys;
+
+/**
+ The number of records.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ The size of the log, and the size of its live records.
+ */
+@property (nonatomic, readonly) uint64_t logSize;
+@property (nonatomic, readonly) uint64_t liveRecordsSize;
+
+/**
+ Read a record. Only the blocks containing it are decrypted.
+
+ @param key the record key.
+ @return the record. nil if there is no such record or if it is corrupted.
+ */
+- (nullable NSData*)recordForKey:(NSString*)key;
+
+/**
+ Set a record. Nothing is written if the record is unchanged.
+
+ @param record the record.
+ @param key the record key.
+ */
+- (void)setRecord:(NSData*)record forKey:(NSString*)key;
+
+/**
+ Remove a record.
+
+ @param key the record key.
+ */
+- (void)removeRecordForKey:(NSString*)key;
+
+/**
+ Replace all the records: only the changed records are written and the missing ones are removed.
+
+ @param records the records by key.
+ */
+- (void)setRecords:(NSDictionary<NSString*, NSData*>*)records;
+
+/**
+ Remove all the records and the store file.
+ */
+- (void)removeAllRecords;
+
+/**
+ Write the pending updates to the file, and compact the log if needed.
+
+ @return YES on success.
+ */
+- (BOOL)synchronize;
+
+/**
+ Rewrite the log with only the live records.
+
+ @return YES on success.
+ */
+- (BOOL)compact;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,809 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKContactsCacheStore.h"
+
+#import <CommonCrypto/CommonCrypto.h>
+#import <Security/Security.h>
+#import <libkern/OSByteOrder.h>
+
+/**
+ The store file format.
+
+ Header (MXKCONTACTSCACHESTORE_HEADER_SIZE bytes, plain text, little-endian):
+ - magic "MXKS" (4 bytes)
+ - format version (uint32)
+ - block size (uint32)
+ - flags (uint32): MXKCONTACTSCACHESTORE_FLAG_ENCRYPTED
+ - key check: the first 8 bytes of SHA-256("MXKContactsCacheStore" + key), zeros if not encrypted
+ - reserved (8 bytes)
+
+ Then the blocks, all of block size bytes but the last one:
+ - nonce (16 bytes): the AES-CTR initial counter of the block, zeros if not encrypted
+ - payload: a slice of the log
+
+ The log is a sequence of records:
+ - type (uint8): MXKCONTACTSCACHESTORE_RECORD_PUT or MXKCONTACTSCACHESTORE_RECORD_DELETE
+ - key length (uint32)
+ - value length (uint32)
+ - value hash (uint64): 64-bit FNV-1a of the value
+ - key (UTF-8)
+ - value
+ */
+#define MXKCONTACTSCACHESTORE_VERSION 1
+#define MXKCONTACTSCACHESTORE_HEADER_SIZE 32
+#define MXKCONTACTSCACHESTORE_FLAG_ENCRYPTED 0x1
+#define MXKCONTACTSCACHESTORE_NONCE_SIZE kCCBlockSizeAES128
+#define MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE 17
+#define MXKCONTACTSCACHESTORE_RECORD_PUT 1
+#define MXKCONTACTSCACHESTORE_RECORD_DELETE 2
+
+/**
+ The log is not compacted below this size.
+ */
+#define MXKCONTACTSCACHESTORE_MIN_COMPACTION_SIZE (64 * 1024)
+
+static const char MXKContactsCacheStoreMagic[4] = {'M', 'X', 'K', 'S'};
+
+static uint64_t MXKContactsCacheStoreHash(const uint8_t *bytes, NSUInteger length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (NSUInteger index = 0; index < length; index++)
+    {
+        hash ^= bytes[index];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#pragma mark - MXKContactsCacheStoreRecordInfo
+
+/**
+ The location of a live record in the log.
+ */
+@interface MXKContactsCacheStoreRecordInfo : NSObject
+
+@property (nonatomic) uint64_t offset;
+@property (nonatomic) uint32_t keyLength;
+@property (nonatomic) uint32_t valueLength;
+@property (nonatomic) uint64_t valueHash;
+
+@property (nonatomic, readonly) uint64_t recordLength;
+
+@end
+
+@implementation MXKContactsCacheStoreRecordInfo
+
+- (uint64_t)recordLength
+{
+    return MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE + _keyLength + _valueLength;
+}
+
+@end
+
+#pragma mark - MXKContactsCacheStore
+
+@interface MXKContactsCacheStore ()
+{
+    NSData *key;
+    
+    /**
+     The offset index of the live records by key.
+     */
+    NSMutableDictionary<NSString*, MXKContactsCacheStoreRecordInfo*> *recordInfos;
+    
+    /**
+     The block size of the current file, and the corresponding payload size.
+     */
+    NSUInteger fileBlockSize;
+    NSUInteger payloadSize;
+    
+    /**
+     The memory mapped file, and the last decrypted block payload.
+     */
+    NSData *fileData;
+    uint64_t cachedBlockIndex;
+    NSData *cachedBlockPayload;
+    
+    /**
+     The payload of the last block, in plain text. It is written to the file when it is full, or on synchronize.
+     */
+    NSMutableData *tailPayload;
+    uint64_t tailBlockIndex;
+    BOOL isTailDirty;
+    
+    NSFileHandle *fileHandle;
+}
+
+@end
+
+@implementation MXKContactsCacheStore
+
+- (instancetype)initWithFilePath:(NSString*)filePath key:(NSData*)theKey
+{
+    self = [super init];
+    if (self)
+    {
+        _filePath = filePath;
+        _blockSize = MXKCONTACTSCACHESTORE_DEFAULT_BLOCK_SIZE;
+        
+        if (theKey.length == kCCKeySizeAES128 || theKey.length == kCCKeySizeAES192 || theKey.length == kCCKeySizeAES256)
+        {
+            key = theKey;
+        }
+        else if (theKey)
+        {
+            NSLog(@"[MXKContactsCacheStore] initWithFilePath: Unsupported key size: %tu", theKey.length);
+        }
+        
+        [self open];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self closeFile];
+}
+
+- (void)setBlockSize:(NSUInteger)blockSize
+{
+    @synchronized (self)
+    {
+        if (blockSize <= MXKCONTACTSCACHESTORE_NONCE_SIZE + MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE)
+        {
+            return;
+        }
+        
+        _blockSize = blockSize;
+        
+        // The block size of an existing file cannot change
+        if (!_logSize && !fileHandle)
+        {
+            fileBlockSize = _blockSize;
+            payloadSize = fileBlockSize - MXKCONTACTSCACHESTORE_NONCE_SIZE;
+        }
+    }
+}
+
+- (NSArray<NSString*>*)allKeys
+{
+    @synchronized (self)
+    {
+        return recordInfos.allKeys;
+    }
+}
+
+- (NSUInteger)count
+{
+    @synchronized (self)
+    {
+        return recordInfos.count;
+    }
+}
+
+- (NSData*)recordForKey:(NSString*)recordKey
+{
+    @synchronized (self)
+    {
+        MXKContactsCacheStoreRecordInfo *info = recordInfos[recordKey];
+        if (!info)
+        {
+            return nil;
+        }
+        
+        NSData *record = [self readLogAtOffset:(info.offset + MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE + info.keyLength) length:info.valueLength];
+        if (!record || MXKContactsCacheStoreHash(record.bytes, record.length) != info.valueHash)
+        {
+            NSLog(@"[MXKContactsCacheStore] recordForKey: Corrupted record in %@", _filePath.lastPathComponent);
+            return nil;
+        }
+        
+        return record;
+    }
+}
+
+- (void)setRecord:(NSData*)record forKey:(NSString*)recordKey
+{
+    @synchronized (self)
+    {
+        uint64_t valueHash = MXKContactsCacheStoreHash(record.bytes, record.length);
+        
+        MXKContactsCacheStoreRecordInfo *info = recordInfos[recordKey];
+        if (info && info.valueHash == valueHash && info.valueLength == record.length)
+        {
+            // Unchanged
+            return;
+        }
+        
+        // The log is rolled back on failure: the previous record, if any, is still valid
+        MXKContactsCacheStoreRecordInfo *newInfo = [self appendRecordOfType:MXKCONTACTSCACHESTORE_RECORD_PUT key:recordKey value:record valueHash:valueHash];
+        if (newInfo)
+        {
+            if (info)
+            {
+                _liveRecordsSize -= info.recordLength;
+            }
+            recordInfos[recordKey] = newInfo;
+            _liveRecordsSize += newInfo.recordLength;
+        }
+    }
+}
+
+- (void)removeRecordForKey:(NSString*)recordKey
+{
+    @synchronized (self)
+    {
+        MXKContactsCacheStoreRecordInfo *info = recordInfos[recordKey];
+        if (info)
+        {
+            _liveRecordsSize -= info.recordLength;
+            [recordInfos removeObjectForKey:recordKey];
+            
+            [self appendRecordOfType:MXKCONTACTSCACHESTORE_RECORD_DELETE key:recordKey value:[NSData data] valueHash:0];
+        }
+    }
+}
+
+- (void)setRecords:(NSDictionary<NSString*, NSData*>*)records
+{
+    @synchronized (self)
+    {
+        for (NSString *recordKey in recordInfos.allKeys)
+        {
+            if (!records[recordKey])
+            {
+                [self removeRecordForKey:recordKey];
+            }
+        }
+        
+        [records enumerateKeysAndObjectsUsingBlock:^(NSString *recordKey, NSData *record, BOOL *stop) {
+            [self setRecord:record forKey:recordKey];
+        }];
+    }
+}
+
+- (void)removeAllRecords
+{
+    @synchronized (self)
+    {
+        [self closeFile];
+        [[NSFileManager defaultManager] removeItemAtPath:_filePath error:nil];
+        [self open];
+    }
+}
+
+- (BOOL)synchronize
+{
+    @synchronized (self)
+    {
+        if (!recordInfos.count)
+        {
+            // No need to keep a file
+            if (_logSize)
+            {
+                [self removeAllRecords];
+            }
+            return YES;
+        }
+        
+        if (isTailDirty)
+        {
+            if (tailPayload.length && ![self writeTailBlock])
+            {
+                return NO;
+            }
+            
+            if (![self openFileForWriting])
+            {
+                return NO;
+            }
+            
+            // Accessing a memory mapped page beyond the end of the truncated file would crash
+            [self releaseFileData];
+            
+            @try
+            {
+                // Drop the potential corrupted data beyond the log
+                [fileHandle truncateFileAtOffset:(MXKCONTACTSCACHESTORE_HEADER_SIZE + tailBlockIndex * fileBlockSize + (tailPayload.length ? MXKCONTACTSCACHESTORE_NONCE_SIZE + tailPayload.length : 0))];
+                [fileHandle synchronizeFile];
+            }
+            @catch (NSException *exception)
+            {
+                NSLog(@"[MXKContactsCacheStore] synchronize: Failed to write %@: %@", _filePath.lastPathComponent, exception.reason);
+                return NO;
+            }
+            
+            isTailDirty = NO;
+        }
+        
+        if (_logSize > MXKCONTACTSCACHESTORE_MIN_COMPACTION_SIZE && _logSize > 2 * _liveRecordsSize)
+        {
+            return [self compact];
+        }
+        
+        return YES;
+    }
+}
+
+- (BOOL)compact
+{
+    @synchronized (self)
+    {
+        NSDate *startDate = [NSDate date];
+        uint64_t logSize = _logSize;
+        
+        NSString *compactedFilePath = [_filePath stringByAppendingPathExtension:@"compacting"];
+        [[NSFileManager defaultManager] removeItemAtPath:compactedFilePath error:nil];
+        
+        MXKContactsCacheStore *compactedStore = [[MXKContactsCacheStore alloc] initWithFilePath:compactedFilePath key:key];
+        compactedStore.blockSize = _blockSize;
+        
+        for (NSString *recordKey in recordInfos)
+        {
+            NSData *record = [self recordForKey:recordKey];
+            if (record)
+            {
+                [compactedStore setRecord:record forKey:recordKey];
+            }
+        }
+        
+        BOOL success = [compactedStore synchronize];
+        [compactedStore closeFile];
+        
+        if (success)
+        {
+            [self closeFile];
+            
+            if (compactedStore.count)
+            {
+                success = (rename(compactedFilePath.fileSystemRepresentation, _filePath.fileSystemRepresentation) == 0);
+            }
+            else
+            {
+                [[NSFileManager defaultManager] removeItemAtPath:_filePath error:nil];
+            }
+            
+            [self open];
+        }
+        
+        [[NSFileManager defaultManager] removeItemAtPath:compactedFilePath error:nil];
+        
+        NSLog(@"[MXKContactsCacheStore] compact: %@ compacted from %llu to %llu bytes in %.0fms (success: %@)", _filePath.lastPathComponent, logSize, _logSize, [[NSDate date] timeIntervalSinceDate:startDate] * 1000, @(success));
+        
+        return success;
+    }
+}
+
+#pragma mark - Private methods
+
+/**
+ Load the offset index of the store file.
+ */
+- (void)open
+{
+    recordInfos = [NSMutableDictionary dictionary];
+    _logSize = 0;
+    _liveRecordsSize = 0;
+    
+    fileBlockSize = _blockSize;
+    payloadSize = fileBlockSize - MXKCONTACTSCACHESTORE_NONCE_SIZE;
+    fileData = nil;
+    cachedBlockPayload = nil;
+    tailPayload = [NSMutableData data];
+    tailBlockIndex = 0;
+    isTailDirty = NO;
+    
+    NSData *data = [NSData dataWithContentsOfFile:_filePath options:NSDataReadingMappedIfSafe error:nil];
+    if (!data)
+    {
+        return;
+    }
+    
+    if (![self checkHeaderOfData:data])
+    {
+        NSLog(@"[MXKContactsCacheStore] open: Discard %@ (unsupported format or key)", _filePath.lastPathComponent);
+        [[NSFileManager defaultManager] removeItemAtPath:_filePath error:nil];
+        return;
+    }
+    fileData = data;
+    
+    // Retrieve the log size from the file size
+    uint64_t blocksLength = data.length - MXKCONTACTSCACHESTORE_HEADER_SIZE;
+    uint64_t lastBlockLength = blocksLength % fileBlockSize;
+    _logSize = (blocksLength / fileBlockSize) * payloadSize + (lastBlockLength > MXKCONTACTSCACHESTORE_NONCE_SIZE ? lastBlockLength - MXKCONTACTSCACHESTORE_NONCE_SIZE : 0);
+    
+    // Read the record headers
+    tailBlockIndex = UINT64_MAX;
+    uint64_t offset = 0;
+    while (offset + MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE <= _logSize)
+    {
+        NSData *header = [self readLogAtOffset:offset length:MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE];
+        if (!header)
+        {
+            break;
+        }
+        
+        const uint8_t *bytes = header.bytes;
+        uint8_t type = bytes[0];
+        
+        MXKContactsCacheStoreRecordInfo *info = [[MXKContactsCacheStoreRecordInfo alloc] init];
+        info.offset = offset;
+        info.keyLength = OSReadLittleInt32(bytes, 1);
+        info.valueLength = OSReadLittleInt32(bytes, 5);
+        info.valueHash = OSReadLittleInt64(bytes, 9);
+        
+        if ((type != MXKCONTACTSCACHESTORE_RECORD_PUT && type != MXKCONTACTSCACHESTORE_RECORD_DELETE)
+            || !info.keyLength || offset + info.recordLength > _logSize)
+        {
+            break;
+        }
+        
+        NSData *keyData = [self readLogAtOffset:(offset + MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE) length:info.keyLength];
+        NSString *recordKey = keyData ? [[NSString alloc] initWithData:keyData encoding:NSUTF8StringEncoding] : nil;
+        if (!recordKey)
+        {
+            break;
+        }
+        
+        MXKContactsCacheStoreRecordInfo *previousInfo = recordInfos[recordKey];
+        if (previousInfo)
+        {
+            _liveRecordsSize -= previousInfo.recordLength;
+        }
+        
+        if (type == MXKCONTACTSCACHESTORE_RECORD_PUT)
+        {
+            recordInfos[recordKey] = info;
+            _liveRecordsSize += info.recordLength;
+        }
+        else
+        {
+            [recordInfos removeObjectForKey:recordKey];
+        }
+        
+        offset += info.recordLength;
+    }
+    
+    if (offset < _logSize)
+    {
+        // The end of the log has not been written completely
+        NSLog(@"[MXKContactsCacheStore] open: Truncate the log of %@ from %llu to %llu bytes", _filePath.lastPathComponent, _logSize, offset);
+        _logSize = offset;
+        isTailDirty = YES;
+    }
+    
+    // Prepare the next appends
+    tailBlockIndex = _logSize / payloadSize;
+    NSUInteger tailLength = _logSize % payloadSize;
+    if (tailLength)
+    {
+        NSData *payload = [self payloadOfBlockAtIndex:tailBlockIndex];
+        tailPayload = [[payload subdataWithRange:NSMakeRange(0, tailLength)] mutableCopy];
+    }
+}
+
+- (BOOL)checkHeaderOfData:(NSData*)data
+{
+    if (data.length < MXKCONTACTSCACHESTORE_HEADER_SIZE)
+    {
+        return NO;
+    }
+    
+    const uint8_t *bytes = data.bytes;
+    uint32_t flags = OSReadLittleInt32(bytes, 12);
+    
+    if (memcmp(bytes, MXKContactsCacheStoreMagic, sizeof(MXKContactsCacheStoreMagic))
+        || OSReadLittleInt32(bytes, 4) != MXKCONTACTSCACHESTORE_VERSION
+        || ((flags & MXKCONTACTSCACHESTORE_FLAG_ENCRYPTED) != 0) != (key != nil)
+        || OSReadLittleInt64(bytes, 16) != [self keyCheck])
+    {
+        return NO;
+    }
+    
+    NSUInteger blockSize = OSReadLittleInt32(bytes, 8);
+    if (blockSize <= MXKCONTACTSCACHESTORE_NONCE_SIZE + MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE)
+    {
+        return NO;
+    }
+    
+    fileBlockSize = blockSize;
+    payloadSize = fileBlockSize - MXKCONTACTSCACHESTORE_NONCE_SIZE;
+    
+    return YES;
+}
+
+- (uint64_t)keyCheck
+{
+    if (!key)
+    {
+        return 0;
+    }
+    
+    NSMutableData *data = [[@"MXKContactsCacheStore" dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    [data appendData:key];
+    
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+    
+    return OSReadLittleInt64(digest, 0);
+}
+
+- (BOOL)openFileForWriting
+{
+    if (fileHandle)
+    {
+        return YES;
+    }
+    
+    if (![[NSFileManager defaultManager] fileExistsAtPath:_filePath])
+    {
+        uint8_t header[MXKCONTACTSCACHESTORE_HEADER_SIZE] = {0};
+        memcpy(header, MXKContactsCacheStoreMagic, sizeof(MXKContactsCacheStoreMagic));
+        OSWriteLittleInt32(header, 4, MXKCONTACTSCACHESTORE_VERSION);
+        OSWriteLittleInt32(header, 8, (uint32_t)fileBlockSize);
+        OSWriteLittleInt32(header, 12, key ? MXKCONTACTSCACHESTORE_FLAG_ENCRYPTED : 0);
+        OSWriteLittleInt64(header, 16, [self keyCheck]);
+        
+        if (![[NSData dataWithBytes:header length:sizeof(header)] writeToFile:_filePath atomically:YES])
+        {
+            NSLog(@"[MXKContactsCacheStore] openFileForWriting: Failed to create %@", _filePath.lastPathComponent);
+            return NO;
+        }
+    }
+    
+    fileHandle = [NSFileHandle fileHandleForUpdatingAtPath:_filePath];
+    return (fileHandle != nil);
+}
+
+- (void)closeFile
+{
+    [fileHandle closeFile];
+    fileHandle = nil;
+    [self releaseFileData];
+}
+
+/**
+ Release the memory mapped file, and the block payload that may point into it.
+ */
+- (void)releaseFileData
+{
+    fileData = nil;
+    cachedBlockPayload = nil;
+}
+
+- (MXKContactsCacheStoreRecordInfo*)appendRecordOfType:(uint8_t)type key:(NSString*)recordKey value:(NSData*)value valueHash:(uint64_t)valueHash
+{
+    NSData *keyData = [recordKey dataUsingEncoding:NSUTF8StringEncoding];
+    
+    MXKContactsCacheStoreRecordInfo *info = [[MXKContactsCacheStoreRecordInfo alloc] init];
+    info.offset = _logSize;
+    info.keyLength = (uint32_t)keyData.length;
+    info.valueLength = (uint32_t)value.length;
+    info.valueHash = valueHash;
+    
+    uint8_t header[MXKCONTACTSCACHESTORE_RECORD_HEADER_SIZE];
+    header[0] = type;
+    OSWriteLittleInt32(header, 1, info.keyLength);
+    OSWriteLittleInt32(header, 5, info.valueLength);
+    OSWriteLittleInt64(header, 9, info.valueHash);
+    
+    // A full tail block is replaced by a new buffer: keep the current one to roll back a partial append
+    NSMutableData *previousTailPayload = tailPayload;
+    NSUInteger previousTailLength = tailPayload.length;
+    uint64_t previousTailBlockIndex = tailBlockIndex;
+    
+    if ([self appendBytes:header length:sizeof(header)]
+        && [self appendBytes:keyData.bytes length:keyData.length]
+        && [self appendBytes:value.bytes length:value.length])
+    {
+        return info;
+    }
+    
+    NSLog(@"[MXKContactsCacheStore] appendRecordOfType: Roll back the log of %@ to %llu bytes", _filePath.lastPathComponent, info.offset);
+    
+    previousTailPayload.length = previousTailLength;
+    tailPayload = previousTailPayload;
+    tailBlockIndex = previousTailBlockIndex;
+    _logSize = info.offset;
+    
+    // The blocks written beyond the log are dropped on synchronize
+    isTailDirty = YES;
+    [self releaseFileData];
+    
+    return nil;
+}
+
+- (BOOL)appendBytes:(const void*)bytes length:(NSUInteger)length
+{
+    const uint8_t *cursor = bytes;
+    
+    while (length)
+    {
+        NSUInteger chunkLength = MIN(payloadSize - tailPayload.length, length);
+        [tailPayload appendBytes:cursor length:chunkLength];
+        cursor += chunkLength;
+        length -= chunkLength;
+        _logSize += chunkLength;
+        isTailDirty = YES;
+        
+        if (tailPayload.length == payloadSize)
+        {
+            // The block is full, write it
+            if (![self writeTailBlock])
+            {
+                return NO;
+            }
+            
+            tailPayload = [NSMutableData data];
+            tailBlockIndex++;
+        }
+    }
+    
+    return YES;
+}
+
+- (BOOL)writeTailBlock
+{
+    if (![self openFileForWriting])
+    {
+        return NO;
+    }
+    
+    // Use a new nonce on each write of a block, even if it is rewritten
+    uint8_t nonce[MXKCONTACTSCACHESTORE_NONCE_SIZE] = {0};
+    NSData *payload = tailPayload;
+    
+    if (key)
+    {
+        if (SecRandomCopyBytes(kSecRandomDefault, sizeof(nonce), nonce) != errSecSuccess)
+        {
+            return NO;
+        }
+        
+        payload = [self cryptPayload:tailPayload.bytes length:tailPayload.length nonce:nonce];
+        if (!payload)
+        {
+            return NO;
+        }
+    }
+    
+    @try
+    {
+        [fileHandle seekToFileOffset:(MXKCONTACTSCACHESTORE_HEADER_SIZE + tailBlockIndex * fileBlockSize)];
+        [fileHandle writeData:[NSData dataWithBytes:nonce length:sizeof(nonce)]];
+        [fileHandle writeData:payload];
+    }
+    @catch (NSException *exception)
+    {
+        NSLog(@"[MXKContactsCacheStore] writeTailBlock: Failed to write %@: %@", _filePath.lastPathComponent, exception.reason);
+        return NO;
+    }
+    
+    // The memory mapped data is obsolete
+    fileData = nil;
+    if (cachedBlockIndex == tailBlockIndex)
+    {
+        cachedBlockPayload = nil;
+    }
+    
+    return YES;
+}
+
+/**
+ Encrypt or decrypt a block payload (AES-CTR is symmetric).
+ */
+- (NSData*)cryptPayload:(const void*)bytes length:(NSUInteger)length nonce:(const uint8_t*)nonce
+{
+    CCCryptorRef cryptor;
+    CCCryptorStatus status = CCCryptorCreateWithMode(kCCEncrypt, kCCModeCTR, kCCAlgorithmAES, ccNoPadding,
+                                                     nonce, key.bytes, key.length,
+                                                     nil, 0, 0, kCCModeOptionCTR_BE, &cryptor);
+    if (status != kCCSuccess)
+    {
+        NSLog(@"[MXKContactsCacheStore] cryptPayload: Failed to create the cryptor: %d", status);
+        return nil;
+    }
+    
+    NSMutableData *output = [NSMutableData dataWithLength:length];
+    size_t outputLength = 0;
+    status = CCCryptorUpdate(cryptor, bytes, length, output.mutableBytes, length, &outputLength);
+    CCCryptorRelease(cryptor);
+    
+    if (status != kCCSuccess || outputLength != length)
+    {
+        NSLog(@"[MXKContactsCacheStore] cryptPayload: Failed: %d", status);
+        return nil;
+    }
+    
+    return output;
+}
+
+/**
+ The plain text payload of a block of the file.
+ */
+- (NSData*)payloadOfBlockAtIndex:(uint64_t)blockIndex
+{
+    if (cachedBlockPayload && cachedBlockIndex == blockIndex)
+    {
+        return cachedBlockPayload;
+    }
+    
+    if (!fileData)
+    {
+        fileData = [NSData dataWithContentsOfFile:_filePath options:NSDataReadingMappedIfSafe error:nil];
+    }
+    
+    uint64_t blockOffset = MXKCONTACTSCACHESTORE_HEADER_SIZE + blockIndex * fileBlockSize;
+    if (blockOffset + MXKCONTACTSCACHESTORE_NONCE_SIZE >= fileData.length)
+    {
+        return nil;
+    }
+    
+    NSUInteger length = (NSUInteger)MIN(payloadSize, fileData.length - blockOffset - MXKCONTACTSCACHESTORE_NONCE_SIZE);
+    const uint8_t *nonce = (const uint8_t*)fileData.bytes + blockOffset;
+    
+    NSData *payload;
+    if (key)
+    {
+        payload = [self cryptPayload:(nonce + MXKCONTACTSCACHESTORE_NONCE_SIZE) length:length nonce:nonce];
+    }
+    else
+    {
+        payload = [fileData subdataWithRange:NSMakeRange((NSUInteger)blockOffset + MXKCONTACTSCACHESTORE_NONCE_SIZE, length)];
+    }
+    
+    cachedBlockIndex = blockIndex;
+    cachedBlockPayload = payload;
+    
+    return payload;
+}
+
+/**
+ Read a slice of the log. Only the blocks containing it are decrypted.
+ */
+- (NSData*)readLogAtOffset:(uint64_t)offset length:(NSUInteger)length
+{
+    if (offset + length > _logSize)
+    {
+        return nil;
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithCapacity:length];
+    
+    while (length)
+    {
+        uint64_t blockIndex = offset / payloadSize;
+        NSUInteger offsetInBlock = offset % payloadSize;
+        NSUInteger chunkLength = MIN(payloadSize - offsetInBlock, length);
+        
+        // The last block may not be written yet
+        NSData *payload = (blockIndex == tailBlockIndex) ? tailPayload : [self payloadOfBlockAtIndex:blockIndex];
+        if (!payload || offsetInBlock + chunkLength > payload.length)
+        {
+            return nil;
+        }
+        
+        [data appendBytes:((const uint8_t*)payload.bytes + offsetInBlock) length:chunkLength];
+        offset += chunkLength;
+        length -= chunkLength;
+    }
+    
+    return data;
+}
+
+@end
@@ -0,0 +1,84 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKLocalContactsDiffer` computes the changes of the local contacts book since the previous refresh.
+
+ Each contact is identified by its contact id and described by a fingerprint (see
+ [MXKContact fingerprintOfABRecord:]). The contacts of the current contacts book are passed one by one,
+ they are compared to the fingerprints of the previous refresh with hashed lookups, so that a refresh
+ is linear in the number of contacts.
+ */
+@interface MXKLocalContactsDiffer : NSObject
+
+/**
+ Create a differ.
+
+ @param previousFingerprints the fingerprints by contact id of the previous refresh (nil if none).
+ @return the newly created instance.
+ */
+- (instancetype)initWithPreviousFingerprints:(nullable NSDictionary<NSString*, NSNumber*>*)previousFingerprints;
+
+/**
+ Pass a contact of the current contacts book.
+
+ @param contactID the contact id.
+ @param fingerprint the fingerprint of the contact.
+ @return YES if the contact has been added or changed since the previous refresh.
+ */
+- (BOOL)addContactID:(NSString*)contactID fingerprint:(uint64_t)fingerprint;
+
+/**
+ Pass a contact known to be unchanged, without computing its fingerprint.
+
+ @param contactID the contact id.
+ @return NO if the contact has no previous fingerprint: it must be passed with `addContactID:fingerprint:`.
+ */
+- (BOOL)keepContactID:(NSString*)contactID;
+
+/**
+ The changes, once all the contacts have been passed.
+ */
+@property (nonatomic, readonly) NSArray<NSString*> *addedContactIDs;
+@property (nonatomic, readonly) NSArray<NSString*> *changedContactIDs;
+@property (nonatomic, readonly) NSArray<NSString*> *removedContactIDs;
+
+/**
+ Tell whether there is any change.
+ */
+@property (nonatomic, readonly) BOOL hasChanges;
+
+/**
+ The fingerprints of the current contacts book by contact id, to pass to the next refresh.
+ */
+@property (nonatomic, readonly) NSDictionary<NSString*, NSNumber*> *fingerprints;
+
+/**
+ Hash a list of strings (64-bit FNV-1a over their UTF-8 representations).
+
+ @param fields the strings to hash.
+ @return the fingerprint.
+ */
++ (uint64_t)fingerprintOfFields:(NSArray<NSString*>*)fields;
+
+@end
+
+NS_ASSUME_NONNULL_END
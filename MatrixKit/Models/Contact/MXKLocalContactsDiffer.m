@@ -0,0 +1,132 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKLocalContactsDiffer.h"
+
+static const uint64_t kFNVOffsetBasis = 0xcbf29ce484222325ULL;
+static const uint64_t kFNVPrime = 0x100000001b3ULL;
+
+@interface MXKLocalContactsDiffer ()
+{
+    /**
+     The previous fingerprints of the contacts which have not been passed yet.
+     */
+    NSMutableDictionary<NSString*, NSNumber*> *remainingFingerprints;
+    
+    NSMutableDictionary<NSString*, NSNumber*> *fingerprints;
+    NSMutableArray<NSString*> *addedContactIDs;
+    NSMutableArray<NSString*> *changedContactIDs;
+}
+@end
+
+@implementation MXKLocalContactsDiffer
+
+- (instancetype)initWithPreviousFingerprints:(NSDictionary<NSString*, NSNumber*>*)previousFingerprints
+{
+    self = [super init];
+    if (self)
+    {
+        remainingFingerprints = previousFingerprints ? [previousFingerprints mutableCopy] : [NSMutableDictionary dictionary];
+        fingerprints = [NSMutableDictionary dictionaryWithCapacity:previousFingerprints.count];
+        addedContactIDs = [NSMutableArray array];
+        changedContactIDs = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)addContactID:(NSString*)contactID fingerprint:(uint64_t)fingerprint
+{
+    NSNumber *fingerprintValue = @(fingerprint);
+    fingerprints[contactID] = fingerprintValue;
+    
+    NSNumber *previousFingerprint = remainingFingerprints[contactID];
+    if (!previousFingerprint)
+    {
+        [addedContactIDs addObject:contactID];
+        return YES;
+    }
+    
+    [remainingFingerprints removeObjectForKey:contactID];
+    if (![previousFingerprint isEqualToNumber:fingerprintValue])
+    {
+        [changedContactIDs addObject:contactID];
+        return YES;
+    }
+    return NO;
+}
+
+- (BOOL)keepContactID:(NSString*)contactID
+{
+    NSNumber *previousFingerprint = remainingFingerprints[contactID];
+    if (!previousFingerprint)
+    {
+        return NO;
+    }
+    
+    fingerprints[contactID] = previousFingerprint;
+    [remainingFingerprints removeObjectForKey:contactID];
+    return YES;
+}
+
+- (NSArray<NSString*>*)addedContactIDs
+{
+    return addedContactIDs;
+}
+
+- (NSArray<NSString*>*)changedContactIDs
+{
+    return changedContactIDs;
+}
+
+- (NSArray<NSString*>*)removedContactIDs
+{
+    // The previous contacts which have not been passed
+    return remainingFingerprints.allKeys;
+}
+
+- (BOOL)hasChanges
+{
+    return addedContactIDs.count || changedContactIDs.count || remainingFingerprints.count;
+}
+
+- (NSDictionary<NSString*, NSNumber*>*)fingerprints
+{
+    return fingerprints;
+}
+
++ (uint64_t)fingerprintOfFields:(NSArray<NSString*>*)fields
+{
+    uint64_t hash = kFNVOffsetBasis;
+    
+    for (NSString *field in fields)
+    {
+        const char *bytes = field.UTF8String;
+        for (const char *c = bytes; c && *c; c++)
+        {
+            hash ^= (uint8_t)*c;
+            hash *= kFNVPrime;
+        }
+        
+        // Separate the fields so that ("ab", "c") and ("a", "bc") differ
+        hash ^= 0x1F;
+        hash *= kFNVPrime;
+    }
+    
+    return hash;
+}
+
+@end
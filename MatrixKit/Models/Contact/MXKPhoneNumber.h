@@ -41,9 +41,19 @@
 /**
  The default ISO 3166-1 country code used to parse the text number,
  and create the nbPhoneNumber instance.
+ 
+ Only the numbers which are not in international format are parsed again when it changes.
  */
 @property (nonatomic) NSString *defaultCountryCode;
 
+/**
+ The parsed forms of the number: its E.164 format, the ISO 3166-1 code of its region, and
+ whether it is a valid number. They are cached with the number when it is archived.
+ */
+@property (nonatomic, readonly) NSString *e164;
+@property (nonatomic, readonly) NSString *regionCode;
+@property (nonatomic, readonly) BOOL isValidNumber;
+
 /**
  The Mobile Station International Subscriber Directory Number.
  Available when the nbPhoneNumber is not nil.
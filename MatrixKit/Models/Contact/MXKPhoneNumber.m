@@ -19,9 +19,44 @@
 
 @import libPhoneNumber_iOS;
 
+/**
+ The maximum number of parsing results kept in the process-wide memo.
+ */
+#define MXKPHONENUMBER_PARSE_RESULTS_COUNT_LIMIT 20000
+
+/**
+ The result of the parsing of a cleaned phone number with a default region.
+ */
+@interface MXKPhoneNumberParseResult : NSObject
+
+/**
+ The parsed number, shared by all the phone numbers with the same parsing.
+ NBPhoneNumber is mutable: it must be copied before being handed out.
+ */
+@property (nonatomic) NBPhoneNumber *nbPhoneNumber;
+@property (nonatomic) NSString *e164;
+@property (nonatomic) NSString *regionCode;
+@property (nonatomic) BOOL isValid;
+
+@end
+
+@implementation MXKPhoneNumberParseResult
+@end
+
+@interface MXKPhoneNumber ()
+{
+    // Tell whether the parsed forms correspond to the current default country code
+    BOOL isParsed;
+    
+    // The nbPhoneNumber instance is copied on demand from the parsing memo
+    BOOL needsNBPhoneNumber;
+}
+
+@end
+
 @implementation MXKPhoneNumber
 
-@synthesize msisdn;
+@synthesize msisdn, nbPhoneNumber = _nbPhoneNumber, e164 = _e164, regionCode = _regionCode, isValidNumber = _isValidNumber;
 
 - (id)initWithTextNumber:(NSString*)textNumber type:(NSString*)type contactID:(NSString*)contactID matrixID:(NSString*)matrixID
 {
@@ -35,12 +70,69 @@
         _defaultCountryCode = nil;
         msisdn = nil;
         
-        _nbPhoneNumber = [[NBPhoneNumberUtil sharedInstance] parse:_cleanedPhonenumber defaultRegion:nil error:nil];
+        // The number is parsed on demand, usually once its default country code is set
+        isParsed = NO;
     }
     
     return self;
 }
 
++ (BOOL)isParsingDependentOnDefaultRegion:(NSString*)cleanedPhoneNumber
+{
+    // A number in international format is parsed without the default region
+    return ![cleanedPhoneNumber hasPrefix:@"+"];
+}
+
++ (MXKPhoneNumberParseResult*)parseResultOfPhoneNumber:(NSString*)cleanedPhoneNumber defaultRegion:(NSString*)defaultRegion
+{
+    static NSCache<NSString*, MXKPhoneNumberParseResult*> *parseResults;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        parseResults = [[NSCache alloc] init];
+        parseResults.countLimit = MXKPHONENUMBER_PARSE_RESULTS_COUNT_LIMIT;
+    });
+    
+    // Identical numbers are parsed once
+    NSString *regionKey = [MXKPhoneNumber isParsingDependentOnDefaultRegion:cleanedPhoneNumber] ? (defaultRegion ?: @"") : @"+";
+    NSString *key = [NSString stringWithFormat:@"%@|%@", regionKey, cleanedPhoneNumber ?: @""];
+    
+    MXKPhoneNumberParseResult *result = [parseResults objectForKey:key];
+    if (!result)
+    {
+        NBPhoneNumberUtil *phoneNumberUtil = [NBPhoneNumberUtil sharedInstance];
+        
+        result = [[MXKPhoneNumberParseResult alloc] init];
+        result.nbPhoneNumber = cleanedPhoneNumber.length ? [phoneNumberUtil parse:cleanedPhoneNumber defaultRegion:defaultRegion error:nil] : nil;
+        if (result.nbPhoneNumber)
+        {
+            result.e164 = [phoneNumberUtil format:result.nbPhoneNumber numberFormat:NBEPhoneNumberFormatE164 error:nil];
+            result.regionCode = [phoneNumberUtil getRegionCodeForNumber:result.nbPhoneNumber];
+            result.isValid = [phoneNumberUtil isValidNumber:result.nbPhoneNumber];
+        }
+        
+        [parseResults setObject:result forKey:key];
+    }
+    
+    return result;
+}
+
+- (void)parseIfNeeded
+{
+    if (!isParsed)
+    {
+        MXKPhoneNumberParseResult *result = [MXKPhoneNumber parseResultOfPhoneNumber:_cleanedPhonenumber defaultRegion:_defaultCountryCode];
+        
+        _nbPhoneNumber = nil;
+        _e164 = result.e164;
+        _regionCode = result.regionCode;
+        _isValidNumber = result.isValid;
+        msisdn = nil;
+        
+        needsNBPhoneNumber = (result.nbPhoneNumber != nil);
+        isParsed = YES;
+    }
+}
+
 // remove the unuseful characters in a phonenumber
 + (NSString*)cleanPhonenumber:(NSString*)phoneNumber
 {
@@ -156,25 +248,62 @@
 {
     if (![defaultCountryCode isEqualToString:_defaultCountryCode])
     {
-        _nbPhoneNumber = [[NBPhoneNumberUtil sharedInstance] parse:_cleanedPhonenumber defaultRegion:defaultCountryCode error:nil];
-        
         _defaultCountryCode = defaultCountryCode;
-        msisdn = nil;
+        
+        // Parse again only the numbers which depend on the default region
+        if ([MXKPhoneNumber isParsingDependentOnDefaultRegion:_cleanedPhonenumber])
+        {
+            isParsed = NO;
+            msisdn = nil;
+        }
     }
 }
 
+- (NBPhoneNumber*)nbPhoneNumber
+{
+    [self parseIfNeeded];
+    
+    if (needsNBPhoneNumber)
+    {
+        // Do not share the mutable instance of the memo with the callers
+        _nbPhoneNumber = [[MXKPhoneNumber parseResultOfPhoneNumber:_cleanedPhonenumber defaultRegion:_defaultCountryCode].nbPhoneNumber copy];
+        needsNBPhoneNumber = NO;
+    }
+    
+    return _nbPhoneNumber;
+}
+
+- (NSString*)e164
+{
+    [self parseIfNeeded];
+    return _e164;
+}
+
+- (NSString*)regionCode
+{
+    [self parseIfNeeded];
+    return _regionCode;
+}
+
+- (BOOL)isValidNumber
+{
+    [self parseIfNeeded];
+    return _isValidNumber;
+}
+
 - (NSString*)msisdn
 {
-    if (!msisdn && _nbPhoneNumber)
+    [self parseIfNeeded];
+    
+    if (!msisdn && _e164)
     {
-        NSString *e164 = [[NBPhoneNumberUtil sharedInstance] format:_nbPhoneNumber numberFormat:NBEPhoneNumberFormatE164 error:nil];
-        if ([e164 hasPrefix:@"+"])
+        if ([_e164 hasPrefix:@"+"])
         {
-            msisdn = [e164 substringFromIndex:1];
+            msisdn = [_e164 substringFromIndex:1];
         }
-        else if ([e164 hasPrefix:@"00"])
+        else if ([_e164 hasPrefix:@"00"])
         {
-            msisdn = [e164 substringFromIndex:2];
+            msisdn = [_e164 substringFromIndex:2];
         }
     }
     return msisdn;
@@ -192,9 +321,18 @@
         _textNumber = [coder decodeObjectForKey:@"textNumber"];
         _cleanedPhonenumber = [coder decodeObjectForKey:@"cleanedPhonenumber"];
         _defaultCountryCode = [coder decodeObjectForKey:@"countryCode"];
-        
-        _nbPhoneNumber = [[NBPhoneNumberUtil sharedInstance] parse:_cleanedPhonenumber defaultRegion:_defaultCountryCode error:nil];
         msisdn = nil;
+        
+        // Restore the parsed forms of the number with its default country code, if they have been cached
+        if ([coder containsValueForKey:@"isValidNumber"])
+        {
+            _e164 = [coder decodeObjectForKey:@"e164"];
+            _regionCode = [coder decodeObjectForKey:@"regionCode"];
+            _isValidNumber = [coder decodeBoolForKey:@"isValidNumber"];
+            
+            needsNBPhoneNumber = (_e164 != nil);
+            isParsed = YES;
+        }
     }
     
     return self;
@@ -208,6 +346,12 @@
     [coder encodeObject:_textNumber forKey:@"textNumber"];
     [coder encodeObject:_cleanedPhonenumber forKey:@"cleanedPhonenumber"];
     [coder encodeObject:_defaultCountryCode forKey:@"countryCode"];
+    
+    // Cache the parsed forms of the number for its default country code
+    [self parseIfNeeded];
+    [coder encodeObject:_e164 forKey:@"e164"];
+    [coder encodeObject:_regionCode forKey:@"regionCode"];
+    [coder encodeBool:_isValidNumber forKey:@"isValidNumber"];
 }
 
 @end
@@ -106,6 +106,13 @@
  */
 @property (nonatomic) BOOL hideUndecryptableEvents;
 
+/**
+ Indicate to render the previews of the last messages of the room summaries only when they are displayed
+ (see `MXKEventFormatter.renderLastMessageOnDemand`). This value is applied to the sessions opened afterwards.
+ Default is `NO`.
+ */
+@property (nonatomic) BOOL renderRoomSummaryLastMessageOnDemand;
+
 #pragma mark - Room members
 
 /**
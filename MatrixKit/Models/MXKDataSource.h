@@ -18,6 +18,7 @@
 
 #import <MatrixSDK/MatrixSDK.h>
 #import "MXKCellRendering.h"
+#import "MXKDataSourceChangeSet.h"
 
 /**
  List data source states.
@@ -126,6 +127,18 @@ typedef enum : NSUInteger {
  */
 - (Class)cellDataClassForCellIdentifier:(NSString *)identifier;
 
+#pragma mark - Changes notification
+
+/**
+ Notify the delegate about a set of changes.
+
+ The delegate receives `[MXKDataSourceDelegate dataSource:didCellChangeWithChangeSet:]` when it implements it,
+ `[MXKDataSourceDelegate dataSource:didCellChange:]` with nil changes otherwise.
+
+ @param changeSet the changes, nil if the whole data must be reloaded.
+ */
+- (void)notifyDelegateWithChangeSet:(MXKDataSourceChangeSet*)changeSet;
+
 #pragma mark - Pending HTTP requests 
 
 /**
@@ -169,6 +182,16 @@ typedef enum : NSUInteger {
 
 @optional
 
+/**
+ Tells the delegate that some cell data/views have been changed, with the details of the changes.
+ 
+ When this method is not implemented, `dataSource:didCellChange:` is called instead.
+
+ @param dataSource the involved data source.
+ @param changeSet the inserted, deleted, moved and updated cells.
+ */
+- (void)dataSource:(MXKDataSource*)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet*)changeSet;
+
 /**
  Tells the delegate that data source state changed
  
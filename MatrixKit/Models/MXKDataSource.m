@@ -136,6 +136,19 @@
 }
 
 
+#pragma mark - Changes notification
+- (void)notifyDelegateWithChangeSet:(MXKDataSourceChangeSet*)changeSet
+{
+    if (changeSet && [_delegate respondsToSelector:@selector(dataSource:didCellChangeWithChangeSet:)])
+    {
+        [_delegate dataSource:self didCellChangeWithChangeSet:changeSet];
+    }
+    else
+    {
+        [_delegate dataSource:self didCellChange:nil];
+    }
+}
+
 #pragma mark - Pending HTTP requests
 /**
  Cancel all registered requests.
@@ -0,0 +1,87 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKDataSourceChangeSet` describes the changes applied to the cells of a data source.
+
+ The index paths follow the UITableView batch updates convention:
+ - deleted and updated index paths, and the sources of moves, refer to the cells before the changes.
+ - inserted index paths, and the destinations of moves, refer to the cells after the changes.
+ */
+@interface MXKDataSourceChangeSet : NSObject
+
+/**
+ The index paths of the inserted cells.
+ */
+@property (nonatomic, readonly) NSArray<NSIndexPath*> *insertedIndexPaths;
+
+/**
+ The index paths of the deleted cells.
+ */
+@property (nonatomic, readonly) NSArray<NSIndexPath*> *deletedIndexPaths;
+
+/**
+ The index paths of the cells whose content changed.
+ */
+@property (nonatomic, readonly) NSArray<NSIndexPath*> *updatedIndexPaths;
+
+/**
+ The moved cells: the new index path by previous index path.
+ */
+@property (nonatomic, readonly) NSDictionary<NSIndexPath*, NSIndexPath*> *movedIndexPaths;
+
+/**
+ YES when the change set contains no change.
+ */
+@property (nonatomic, readonly) BOOL isEmpty;
+
+/**
+ The difference between the number of cells after and before the changes.
+ */
+@property (nonatomic, readonly) NSInteger cellCountDelta;
+
+- (void)addInsertedIndexPath:(NSIndexPath*)indexPath;
+- (void)addDeletedIndexPath:(NSIndexPath*)indexPath;
+- (void)addUpdatedIndexPath:(NSIndexPath*)indexPath;
+- (void)addMoveFromIndexPath:(NSIndexPath*)fromIndexPath toIndexPath:(NSIndexPath*)toIndexPath;
+
+/**
+ Check whether the change set can be applied with batch updates to a table view
+ which currently displays `numberOfRows` rows in a single section and which will display `newNumberOfRows` rows.
+
+ @param numberOfRows the number of rows before the changes.
+ @param newNumberOfRows the number of rows after the changes.
+ @return YES if the change set is consistent with these numbers.
+ */
+- (BOOL)isValidForNumberOfRows:(NSInteger)numberOfRows newNumberOfRows:(NSInteger)newNumberOfRows;
+
+/**
+ Apply the change set to a table view.
+
+ This method must be called inside a batch updates block of the table view.
+
+ @param tableView the table view.
+ @param animation the rows animation.
+ */
+- (void)applyToTableView:(UITableView*)tableView withRowAnimation:(UITableViewRowAnimation)animation;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,158 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKDataSourceChangeSet.h"
+
+@interface MXKDataSourceChangeSet ()
+{
+    NSMutableOrderedSet<NSIndexPath*> *insertedIndexPaths;
+    NSMutableOrderedSet<NSIndexPath*> *deletedIndexPaths;
+    NSMutableOrderedSet<NSIndexPath*> *updatedIndexPaths;
+    NSMutableDictionary<NSIndexPath*, NSIndexPath*> *movedIndexPaths;
+}
+
+@end
+
+@implementation MXKDataSourceChangeSet
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        insertedIndexPaths = [NSMutableOrderedSet orderedSet];
+        deletedIndexPaths = [NSMutableOrderedSet orderedSet];
+        updatedIndexPaths = [NSMutableOrderedSet orderedSet];
+        movedIndexPaths = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSArray<NSIndexPath *> *)insertedIndexPaths
+{
+    return insertedIndexPaths.array;
+}
+
+- (NSArray<NSIndexPath *> *)deletedIndexPaths
+{
+    return deletedIndexPaths.array;
+}
+
+- (NSArray<NSIndexPath *> *)updatedIndexPaths
+{
+    return updatedIndexPaths.array;
+}
+
+- (NSDictionary<NSIndexPath *,NSIndexPath *> *)movedIndexPaths
+{
+    return movedIndexPaths;
+}
+
+- (BOOL)isEmpty
+{
+    return !insertedIndexPaths.count && !deletedIndexPaths.count && !updatedIndexPaths.count && !movedIndexPaths.count;
+}
+
+- (NSInteger)cellCountDelta
+{
+    return (NSInteger)insertedIndexPaths.count - (NSInteger)deletedIndexPaths.count;
+}
+
+- (void)addInsertedIndexPath:(NSIndexPath *)indexPath
+{
+    [insertedIndexPaths addObject:indexPath];
+}
+
+- (void)addDeletedIndexPath:(NSIndexPath *)indexPath
+{
+    // A deleted cell cannot be updated
+    [updatedIndexPaths removeObject:indexPath];
+    [deletedIndexPaths addObject:indexPath];
+}
+
+- (void)addUpdatedIndexPath:(NSIndexPath *)indexPath
+{
+    if (![deletedIndexPaths containsObject:indexPath] && !movedIndexPaths[indexPath])
+    {
+        [updatedIndexPaths addObject:indexPath];
+    }
+}
+
+- (void)addMoveFromIndexPath:(NSIndexPath *)fromIndexPath toIndexPath:(NSIndexPath *)toIndexPath
+{
+    // UITableView does not support the reload of a moved row
+    [updatedIndexPaths removeObject:fromIndexPath];
+    movedIndexPaths[fromIndexPath] = toIndexPath;
+}
+
+- (BOOL)isValidForNumberOfRows:(NSInteger)numberOfRows newNumberOfRows:(NSInteger)newNumberOfRows
+{
+    if (numberOfRows + self.cellCountDelta != newNumberOfRows)
+    {
+        return NO;
+    }
+
+    for (NSOrderedSet<NSIndexPath*> *indexPaths in @[deletedIndexPaths, updatedIndexPaths, [NSOrderedSet orderedSetWithArray:movedIndexPaths.allKeys]])
+    {
+        for (NSIndexPath *indexPath in indexPaths)
+        {
+            if (indexPath.section != 0 || indexPath.row >= numberOfRows)
+            {
+                return NO;
+            }
+        }
+    }
+
+    for (NSOrderedSet<NSIndexPath*> *indexPaths in @[insertedIndexPaths, [NSOrderedSet orderedSetWithArray:movedIndexPaths.allValues]])
+    {
+        for (NSIndexPath *indexPath in indexPaths)
+        {
+            if (indexPath.section != 0 || indexPath.row >= newNumberOfRows)
+            {
+                return NO;
+            }
+        }
+    }
+
+    return YES;
+}
+
+- (void)applyToTableView:(UITableView *)tableView withRowAnimation:(UITableViewRowAnimation)animation
+{
+    if (deletedIndexPaths.count)
+    {
+        [tableView deleteRowsAtIndexPaths:deletedIndexPaths.array withRowAnimation:animation];
+    }
+    if (insertedIndexPaths.count)
+    {
+        [tableView insertRowsAtIndexPaths:insertedIndexPaths.array withRowAnimation:animation];
+    }
+    if (updatedIndexPaths.count)
+    {
+        [tableView reloadRowsAtIndexPaths:updatedIndexPaths.array withRowAnimation:animation];
+    }
+    for (NSIndexPath *fromIndexPath in movedIndexPaths)
+    {
+        [tableView moveRowAtIndexPath:fromIndexPath toIndexPath:movedIndexPaths[fromIndexPath]];
+    }
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<MXKDataSourceChangeSet: %p> inserted: %tu - deleted: %tu - updated: %tu - moved: %tu", self, insertedIndexPaths.count, deletedIndexPaths.count, updatedIndexPaths.count, movedIndexPaths.count];
+}
+
+@end
@@ -18,6 +18,8 @@
 #import <Foundation/Foundation.h>
 #import <MatrixSDK/MatrixSDK.h>
 
+#import "MXKAttachmentDecryptor.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 extern NSString * const kMXKAttachmentErrorDomain;
@@ -152,6 +154,12 @@ typedef enum : NSUInteger {
  */
 - (void)decryptToTempFile:(void (^_Nullable)(NSString *_Nullable))onSuccess failure:(void (^_Nullable)(NSError * _Nullable error))onFailure;
 
+/**
+ Same as [self decryptToTempFile:failure:] with a block called after each decrypted chunk.
+ The attachment is decrypted chunk by chunk: it is never entirely loaded in memory.
+ */
+- (void)decryptToTempFile:(void (^_Nullable)(NSString *_Nullable))onSuccess progress:(nullable MXKAttachmentDecryptorProgress)onProgress failure:(void (^_Nullable)(NSError * _Nullable error))onFailure;
+
 /**
  Gets the thumbnails for this attachment, downloading it or loading it from disk cache
  if necessary
@@ -22,6 +22,7 @@
 @import MobileCoreServices;
 
 #import "MXKTools.h"
+#import "MXKAttachmentDecryptor.h"
 
 // The size of thumbnail we request from the server
 // Note that this is smaller than the ones we upload: when sending, one size
@@ -289,16 +290,15 @@ NSString *const kMXKAttachmentErrorDomain = @"kMXKAttachmentErrorDomain";
         
         void (^decryptAndCache)(void) = ^{
             MXStrongifyAndReturnIfNil(self);
-            NSInputStream *instream = [[NSInputStream alloc] initWithFileAtPath:self.thumbnailCachePath];
-            NSOutputStream *outstream = [[NSOutputStream alloc] initToMemory];
-            NSError *err = [MXEncryptedAttachments decryptAttachment:self->thumbnailFile inputStream:instream outputStream:outstream];
-            if (err) {
+            NSError *err;
+            NSData *data = [self decryptedDataOfFile:self->thumbnailFile atPath:self.thumbnailCachePath error:&err];
+            if (!data) {
                 NSLog(@"Error decrypting attachment! %@", err.userInfo);
                 if (onFailure) onFailure(self, err);
                 return;
             }
             
-            UIImage *img = [UIImage imageWithData:[outstream propertyForKey:NSStreamDataWrittenToMemoryStreamKey]];
+            UIImage *img = [UIImage imageWithData:data];
             // Save this image to in-memory cache.
             [MXMediaManager cacheImage:img withCachePath:self.thumbnailCachePath];
             onSuccess(self, img);
@@ -396,15 +396,15 @@ NSString *const kMXKAttachmentErrorDomain = @"kMXKAttachmentErrorDomain";
         if (self.isEncrypted)
         {
             // decrypt the encrypted file
-            NSInputStream *instream = [[NSInputStream alloc] initWithFileAtPath:self.cacheFilePath];
-            NSOutputStream *outstream = [[NSOutputStream alloc] initToMemory];
-            NSError *err = [MXEncryptedAttachments decryptAttachment:self->contentFile inputStream:instream outputStream:outstream];
-            if (err)
+            NSError *err;
+            NSData *data = [self decryptedDataOfFile:self->contentFile atPath:self.cacheFilePath error:&err];
+            if (!data)
             {
                 NSLog(@"Error decrypting attachment! %@", err.userInfo);
+                if (onFailure) onFailure(err);
                 return;
             }
-            onSuccess([outstream propertyForKey:NSStreamDataWrittenToMemoryStreamKey]);
+            onSuccess(data);
         }
         else
         {
@@ -414,6 +414,11 @@ NSString *const kMXKAttachmentErrorDomain = @"kMXKAttachmentErrorDomain";
 }
 
 - (void)decryptToTempFile:(void (^)(NSString *))onSuccess failure:(void (^)(NSError *error))onFailure
+{
+    [self decryptToTempFile:onSuccess progress:nil failure:onFailure];
+}
+
+- (void)decryptToTempFile:(void (^)(NSString *))onSuccess progress:(MXKAttachmentDecryptorProgress)onProgress failure:(void (^)(NSError *error))onFailure
 {
     MXWeakify(self);
     [self prepare:^{
@@ -425,11 +430,11 @@ NSString *const kMXKAttachmentErrorDomain = @"kMXKAttachmentErrorDomain";
             return;
         }
         
-        NSInputStream *inStream = [NSInputStream inputStreamWithFileAtPath:self.cacheFilePath];
-        NSOutputStream *outStream = [NSOutputStream outputStreamToFileAtPath:tempPath append:NO];
-        
-        NSError *err = [MXEncryptedAttachments decryptAttachment:self->contentFile inputStream:inStream outputStream:outStream];
-        if (err) {
+        // Decrypt chunk by chunk: the attachment is never entirely loaded in memory
+        MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:self->contentFile];
+        NSError *err;
+        if (![decryptor decryptFileAtPath:self.cacheFilePath toFileAtPath:tempPath progress:onProgress error:&err])
+        {
             if (onFailure) onFailure(err);
             return;
         }
@@ -437,6 +442,21 @@ NSString *const kMXKAttachmentErrorDomain = @"kMXKAttachmentErrorDomain";
     } failure:onFailure];
 }
 
+- (NSData *)decryptedDataOfFile:(MXEncryptedContentFile *)encryptedContentFile atPath:(NSString *)path error:(NSError **)error
+{
+    // Decrypt directly into a buffer sized for the whole attachment (CTR does not change the length)
+    unsigned long long fileSize = [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileSize];
+    NSMutableData *data = [NSMutableData dataWithCapacity:(NSUInteger)fileSize];
+    
+    MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:encryptedContentFile];
+    BOOL success = [decryptor decryptFileAtPath:path toConsumer:^BOOL(const void *bytes, NSUInteger length) {
+        [data appendBytes:bytes length:length];
+        return YES;
+    } progress:nil error:error];
+    
+    return success ? data : nil;
+}
+
 - (NSString *)getTempFile
 {
     // create a file with an appropriate extension because iOS detects based on file extension
@@ -0,0 +1,100 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import <MatrixSDK/MatrixSDK.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default maximum size of the chunks read from an encrypted attachment: 64 KB.
+ */
+#define MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE (64 * 1024)
+
+/**
+ Block called with each decrypted chunk.
+ The bytes are only valid during the call.
+ Return NO to stop the decryption, for example when the chunk cannot be stored.
+ */
+typedef BOOL (^MXKAttachmentDecryptorConsumer)(const void *bytes, NSUInteger length);
+
+/**
+ Block called after each decrypted chunk.
+ `totalBytesCount` is the size of the encrypted file.
+ */
+typedef void (^MXKAttachmentDecryptorProgress)(int64_t decryptedBytesCount, int64_t totalBytesCount);
+
+/**
+ `MXKAttachmentDecryptor` decrypts an encrypted attachment chunk by chunk.
+
+ The decryption itself, including the check of the hash, is done by `[MXEncryptedAttachments decryptAttachment:inputStream:outputStream:]`.
+ The decryptor only streams the encrypted file to it, and delivers the plaintext chunks to a consumer
+ instead of accumulating them: the memory used does not depend on the size of the attachment.
+ */
+@interface MXKAttachmentDecryptor : NSObject
+
+/**
+ The maximum size of the chunks read from the encrypted file.
+ Default is MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE.
+ */
+@property (nonatomic) NSUInteger bufferSize;
+
+/**
+ Create a decryptor for an encrypted content.
+
+ @param contentFile the information on the encrypted content (key, iv and hashes).
+ @return the newly created instance.
+ */
+- (instancetype)initWithContentFile:(MXEncryptedContentFile*)contentFile;
+
+/**
+ Decrypt an encrypted file into another file.
+
+ The decryption stops at the first write error. The destination file is removed if the decryption fails,
+ in particular when the hash does not match.
+
+ @param inputPath the path of the encrypted file.
+ @param outputPath the path of the decrypted file. An existing file is replaced.
+ @param progress a block called after each chunk (optional).
+ @param error the error on failure.
+ @return YES on success.
+ */
+- (BOOL)decryptFileAtPath:(NSString*)inputPath
+             toFileAtPath:(NSString*)outputPath
+                 progress:(nullable MXKAttachmentDecryptorProgress)progress
+                    error:(NSError**)error;
+
+/**
+ Decrypt an encrypted file chunk by chunk.
+
+ The consumer receives the plaintext before the hash of the whole ciphertext is known: it must discard
+ what it received if this method fails.
+
+ @param inputPath the path of the encrypted file.
+ @param consumer the block called with each decrypted chunk.
+ @param progress a block called after each chunk (optional).
+ @param error the error on failure.
+ @return YES on success.
+ */
+- (BOOL)decryptFileAtPath:(NSString*)inputPath
+               toConsumer:(MXKAttachmentDecryptorConsumer)consumer
+                 progress:(nullable MXKAttachmentDecryptorProgress)progress
+                    error:(NSError**)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
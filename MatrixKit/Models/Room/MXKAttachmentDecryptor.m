@@ -0,0 +1,317 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKAttachmentDecryptor.h"
+
+#import "MXKAttachment.h"
+
+@interface MXKAttachmentDecryptor ()
+{
+    MXEncryptedContentFile *contentFile;
+}
+
++ (NSError*)errorWithReason:(NSString*)reason;
+
+@end
+
+#pragma mark - MXKAttachmentDecryptorStream
+
+/**
+ The streams given to `MXEncryptedAttachments`.
+
+ The input stream reads the encrypted file by chunks of a bounded size. The output stream hands each
+ decrypted chunk to the consumer, and never holds more than one chunk. Once the consumer or the bounds
+ reject a chunk, both streams fail, so that the decryption stops reading the encrypted file.
+ */
+@interface MXKAttachmentDecryptorInputStream : NSInputStream
+{
+@public
+    NSInputStream *fileInputStream;
+    NSUInteger maxChunkLength;
+    NSError *abortError;
+}
+@end
+
+@interface MXKAttachmentDecryptorOutputStream : NSOutputStream
+{
+@public
+    MXKAttachmentDecryptorInputStream *inputStream;
+    MXKAttachmentDecryptorConsumer consumer;
+    MXKAttachmentDecryptorProgress progress;
+    int64_t writtenBytesCount;
+    int64_t totalBytesCount;
+    NSStreamStatus status;
+}
+@end
+
+@implementation MXKAttachmentDecryptorInputStream
+
+- (void)open
+{
+    [fileInputStream open];
+}
+
+- (void)close
+{
+    [fileInputStream close];
+}
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)len
+{
+    if (abortError)
+    {
+        return -1;
+    }
+    return [fileInputStream read:buffer maxLength:MIN(len, maxChunkLength)];
+}
+
+- (BOOL)getBuffer:(uint8_t **)buffer length:(NSUInteger *)len
+{
+    return NO;
+}
+
+- (BOOL)hasBytesAvailable
+{
+    return !abortError && fileInputStream.hasBytesAvailable;
+}
+
+- (NSStreamStatus)streamStatus
+{
+    return abortError ? NSStreamStatusError : fileInputStream.streamStatus;
+}
+
+- (NSError *)streamError
+{
+    return abortError ?: fileInputStream.streamError;
+}
+
+- (id<NSStreamDelegate>)delegate
+{
+    return nil;
+}
+
+- (void)setDelegate:(id<NSStreamDelegate>)delegate
+{
+}
+
+- (id)propertyForKey:(NSStreamPropertyKey)key
+{
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSStreamPropertyKey)key
+{
+    return NO;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)aRunLoop forMode:(NSRunLoopMode)mode
+{
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)aRunLoop forMode:(NSRunLoopMode)mode
+{
+}
+
+@end
+
+@implementation MXKAttachmentDecryptorOutputStream
+
+- (void)open
+{
+    status = NSStreamStatusOpen;
+}
+
+- (void)close
+{
+    status = NSStreamStatusClosed;
+}
+
+- (NSInteger)write:(const uint8_t *)buffer maxLength:(NSUInteger)len
+{
+    if (inputStream->abortError)
+    {
+        return -1;
+    }
+    
+    // AES-CTR does not change the length: more plaintext than ciphertext is a failure
+    if (writtenBytesCount + (int64_t)len > totalBytesCount)
+    {
+        inputStream->abortError = [MXKAttachmentDecryptor errorWithReason:@"invalid_attachment_length"];
+        return -1;
+    }
+    
+    if (!consumer(buffer, len))
+    {
+        inputStream->abortError = [MXKAttachmentDecryptor errorWithReason:@"error_writing_file"];
+        return -1;
+    }
+    
+    writtenBytesCount += len;
+    if (progress)
+    {
+        progress(writtenBytesCount, totalBytesCount);
+    }
+    
+    return len;
+}
+
+- (BOOL)hasSpaceAvailable
+{
+    return !inputStream->abortError;
+}
+
+- (NSStreamStatus)streamStatus
+{
+    return inputStream->abortError ? NSStreamStatusError : status;
+}
+
+- (NSError *)streamError
+{
+    return inputStream->abortError;
+}
+
+- (id<NSStreamDelegate>)delegate
+{
+    return nil;
+}
+
+- (void)setDelegate:(id<NSStreamDelegate>)delegate
+{
+}
+
+- (id)propertyForKey:(NSStreamPropertyKey)key
+{
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSStreamPropertyKey)key
+{
+    return NO;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)aRunLoop forMode:(NSRunLoopMode)mode
+{
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)aRunLoop forMode:(NSRunLoopMode)mode
+{
+}
+
+@end
+
+#pragma mark - MXKAttachmentDecryptor
+
+@implementation MXKAttachmentDecryptor
+
+- (instancetype)initWithContentFile:(MXEncryptedContentFile*)theContentFile
+{
+    self = [super init];
+    if (self)
+    {
+        contentFile = theContentFile;
+        _bufferSize = MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE;
+    }
+    return self;
+}
+
+- (BOOL)decryptFileAtPath:(NSString*)inputPath
+             toFileAtPath:(NSString*)outputPath
+                 progress:(MXKAttachmentDecryptorProgress)progress
+                    error:(NSError**)error
+{
+    NSOutputStream *outputStream = [NSOutputStream outputStreamToFileAtPath:outputPath append:NO];
+    [outputStream open];
+    
+    __block NSError *writeError;
+    BOOL success = [self decryptFileAtPath:inputPath toConsumer:^BOOL(const void *bytes, NSUInteger length) {
+        
+        // An output stream may write less than requested
+        const uint8_t *cursor = bytes;
+        while (length)
+        {
+            NSInteger written = [outputStream write:cursor maxLength:length];
+            if (written <= 0)
+            {
+                // Stop the decryption at the first write error
+                writeError = outputStream.streamError;
+                return NO;
+            }
+            cursor += written;
+            length -= written;
+        }
+        return YES;
+        
+    } progress:progress error:error];
+    
+    [outputStream close];
+    
+    if (!success)
+    {
+        if (writeError && error)
+        {
+            *error = writeError;
+        }
+        [[NSFileManager defaultManager] removeItemAtPath:outputPath error:nil];
+    }
+    
+    return success;
+}
+
+- (BOOL)decryptFileAtPath:(NSString*)inputPath
+               toConsumer:(MXKAttachmentDecryptorConsumer)consumer
+                 progress:(MXKAttachmentDecryptorProgress)progress
+                    error:(NSError**)error
+{
+    MXKAttachmentDecryptorInputStream *inputStream = [[MXKAttachmentDecryptorInputStream alloc] init];
+    inputStream->fileInputStream = [NSInputStream inputStreamWithFileAtPath:inputPath];
+    inputStream->maxChunkLength = MAX(_bufferSize, 1);
+    
+    MXKAttachmentDecryptorOutputStream *outputStream = [[MXKAttachmentDecryptorOutputStream alloc] init];
+    outputStream->inputStream = inputStream;
+    outputStream->consumer = consumer;
+    outputStream->progress = progress;
+    outputStream->totalBytesCount = [[[NSFileManager defaultManager] attributesOfItemAtPath:inputPath error:nil] fileSize];
+    
+    NSError *decryptionError = [MXEncryptedAttachments decryptAttachment:contentFile inputStream:inputStream outputStream:outputStream];
+    
+    // Report first the reason why the decryption was stopped, if any
+    if (inputStream->abortError)
+    {
+        decryptionError = inputStream->abortError;
+    }
+    
+    if (decryptionError)
+    {
+        NSLog(@"[MXKAttachmentDecryptor] Error decrypting attachment: %@", decryptionError);
+        if (error)
+        {
+            *error = decryptionError;
+        }
+        return NO;
+    }
+    
+    return YES;
+}
+
+#pragma mark - Private methods
+
++ (NSError*)errorWithReason:(NSString*)reason
+{
+    return [NSError errorWithDomain:kMXKAttachmentErrorDomain code:0 userInfo:@{@"err": reason}];
+}
+
+@end
@@ -19,6 +19,7 @@
 #import "MXKRoomBubbleCellDataStoring.h"
 
 #import "MXKRoomBubbleComponent.h"
+#import "MXKRoomBubbleHeightCache.h"
 
 #define MXKROOMBUBBLECELLDATA_TEXTVIEW_DEFAULT_VERTICAL_INSET 8
 
@@ -94,6 +95,13 @@
  */
 @property (nonatomic) CGSize contentSize;
 
+/**
+ The heights computed for this bubble, by cell view class and maximum width.
+ The cache is cleared each time the content of the bubble changes, and each time one of its layout flags
+ (pagination header, sender information, collapsing state and collapsable neighbours) changes.
+ */
+@property (nonatomic, readonly) MXKRoomBubbleHeightCache *heightCache;
+
 /**
  Set of flags indicating fixes that need to be applied at display time.
  */
@@ -125,7 +133,7 @@
 
 /**
  Return the content size of a text view initialized with the provided attributed text.
- CAUTION: This method runs only on main thread.
+ This method can be called from any thread.
  
  @param attributedText the attributed text to measure
  @param removeVerticalInset tell whether the computation should remove vertical inset in text container.
@@ -133,6 +141,17 @@
  */
 - (CGSize)textContentSize:(NSAttributedString*)attributedText removeVerticalInset:(BOOL)removeVerticalInset;
 
+/**
+ Return the content size of a text view with the provided width, initialized with the provided attributed text.
+ This method does not depend on any cell data, it can be called from any thread.
+ 
+ @param attributedText the attributed text to measure
+ @param maxTextViewWidth the maximum width of the text view
+ @param removeVerticalInset tell whether the computation should remove vertical inset in text container.
+ @return the computed size content
+ */
++ (CGSize)textContentSize:(NSAttributedString*)attributedText withMaxTextViewWidth:(CGFloat)maxTextViewWidth removeVerticalInset:(BOOL)removeVerticalInset;
+
 /**
  Get bubble component index from event id.
 
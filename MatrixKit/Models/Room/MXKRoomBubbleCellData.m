@@ -25,6 +25,7 @@
 #import "MXKRoomBubbleCellData.h"
 
 #import "MXKTools.h"
+#import "MXKTextMeasurementEngine.h"
 
 @implementation MXKRoomBubbleCellData
 @synthesize senderId, roomId, senderDisplayName, senderAvatarUrl, senderAvatarPlaceholder, isEncryptedRoom, isPaginationFirstBubble, shouldHideSenderInformation, date, isIncoming, isAttachmentWithThumbnail, isAttachmentWithIcon, attachment, senderFlair;
@@ -33,6 +34,16 @@
 @synthesize tag;
 @synthesize collapsable, collapsed, collapsedAttributedTextMessage, prevCollapsableCellData, nextCollapsableCellData, collapseState;
 
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        _heightCache = [[MXKRoomBubbleHeightCache alloc] init];
+    }
+    return self;
+}
+
 #pragma mark - MXKRoomBubbleCellDataStoring
 
 - (instancetype)initWithEvent:(MXEvent *)event andRoomState:(MXRoomState *)roomState andRoomDataSource:(MXKRoomDataSource *)roomDataSource2
@@ -41,7 +52,7 @@
     if (self)
     {
         roomDataSource = roomDataSource2;
-
+        
         // Initialize read receipts
         self.readReceipts = [NSMutableDictionary dictionary];
         
@@ -357,8 +368,61 @@
     self.attributedTextMessage = nil;
 }
 
+- (void)setIsPaginationFirstBubble:(BOOL)inIsPaginationFirstBubble
+{
+    if (isPaginationFirstBubble != inIsPaginationFirstBubble)
+    {
+        // The pagination header impacts the cell height
+        [_heightCache removeAllHeights];
+    }
+    isPaginationFirstBubble = inIsPaginationFirstBubble;
+}
+
+- (void)setCollapsed:(BOOL)inCollapsed
+{
+    if (collapsed != inCollapsed)
+    {
+        // A collapsed cell displays only the header of its series
+        [_heightCache removeAllHeights];
+    }
+    collapsed = inCollapsed;
+}
+
+- (void)setCollapsedAttributedTextMessage:(NSAttributedString *)inCollapsedAttributedTextMessage
+{
+    if (collapsedAttributedTextMessage != inCollapsedAttributedTextMessage)
+    {
+        [_heightCache removeAllHeights];
+    }
+    collapsedAttributedTextMessage = inCollapsedAttributedTextMessage;
+}
+
+- (void)setPrevCollapsableCellData:(id<MXKRoomBubbleCellDataStoring>)inPrevCollapsableCellData
+{
+    if (prevCollapsableCellData != inPrevCollapsableCellData)
+    {
+        // The head of a collapsed series is not rendered as the other cells of the series
+        [_heightCache removeAllHeights];
+    }
+    prevCollapsableCellData = inPrevCollapsableCellData;
+}
+
+- (void)setNextCollapsableCellData:(id<MXKRoomBubbleCellDataStoring>)inNextCollapsableCellData
+{
+    if (nextCollapsableCellData != inNextCollapsableCellData)
+    {
+        [_heightCache removeAllHeights];
+    }
+    nextCollapsableCellData = inNextCollapsableCellData;
+}
+
 - (void)setShouldHideSenderInformation:(BOOL)inShouldHideSenderInformation
 {
+    if (shouldHideSenderInformation != inShouldHideSenderInformation)
+    {
+        // The sender information impacts the cell height
+        [_heightCache removeAllHeights];
+    }
     shouldHideSenderInformation = inShouldHideSenderInformation;
     
     if (!shouldHideSenderInformation)
@@ -445,45 +509,25 @@
 // Return the raw height of the provided text by removing any margin
 - (CGFloat)rawTextHeight: (NSAttributedString*)attributedText
 {
-    __block CGSize textSize;
-    if ([NSThread currentThread] != [NSThread mainThread])
-    {
-        dispatch_sync(dispatch_get_main_queue(), ^{
-            textSize = [self textContentSize:attributedText removeVerticalInset:YES];
-        });
-    }
-    else
-    {
-        textSize = [self textContentSize:attributedText removeVerticalInset:YES];
-    }
-    
+    CGSize textSize = [self textContentSize:attributedText removeVerticalInset:YES];
     return textSize.height;
 }
 
 - (CGSize)textContentSize:(NSAttributedString*)attributedText removeVerticalInset:(BOOL)removeVerticalInset
 {
-    static UITextView* measurementTextView = nil;
-    static UITextView* measurementTextViewWithoutInset = nil;
-    
+    return [MXKRoomBubbleCellData textContentSize:attributedText withMaxTextViewWidth:_maxTextViewWidth removeVerticalInset:removeVerticalInset];
+}
+
++ (CGSize)textContentSize:(NSAttributedString*)attributedText withMaxTextViewWidth:(CGFloat)maxTextViewWidth removeVerticalInset:(BOOL)removeVerticalInset
+{
     if (attributedText.length)
     {
-        if (!measurementTextView)
-        {
-            measurementTextView = [[UITextView alloc] init];
-            
-            measurementTextViewWithoutInset = [[UITextView alloc] init];
-            // Remove the container inset: this operation impacts only the vertical margin.
-            // Note: consider textContainer.lineFragmentPadding to remove horizontal margin
-            measurementTextViewWithoutInset.textContainerInset = UIEdgeInsetsZero;
-        }
-        
-        // Select the right text view for measurement
-        UITextView *selectedTextView = (removeVerticalInset ? measurementTextViewWithoutInset : measurementTextView);
+        // Measure the text with TextKit: this can be done on any thread, without blocking the main one.
+        // Removing the container inset impacts only the vertical margin.
+        // Note: consider the line fragment padding to remove horizontal margin
+        UIEdgeInsets textContainerInset = (removeVerticalInset ? UIEdgeInsetsZero : kMXKTextMeasurementEngineTextViewTextContainerInset);
         
-        selectedTextView.frame = CGRectMake(0, 0, _maxTextViewWidth, MAXFLOAT);
-        selectedTextView.attributedText = attributedText;
-            
-        CGSize size = [selectedTextView sizeThatFits:selectedTextView.frame.size];
+        CGSize size = [MXKTextMeasurementEngine sizeOfAttributedText:attributedText withMaximumWidth:maxTextViewWidth textContainerInset:textContainerInset];
 
         // Manage the case where a string attribute has a single paragraph with a left indent
         // In this case, [UITextViex sizeThatFits] ignores the indent and return the width
@@ -539,6 +583,7 @@
     
     // Reset content size
     _contentSize = CGSizeZero;
+    [_heightCache removeAllHeights];
 }
 
 - (NSAttributedString*)attributedTextMessage
@@ -699,16 +744,7 @@
         if (attachment == nil)
         {
             // Here the bubble is a text message
-            if ([NSThread currentThread] != [NSThread mainThread])
-            {
-                dispatch_sync(dispatch_get_main_queue(), ^{
-                    self->_contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
-                });
-            }
-            else
-            {
-                _contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
-            }
+            _contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
         }
         else if (self.isAttachmentWithThumbnail)
         {
@@ -761,16 +797,7 @@
         {
             // Presently we displayed only the file name for attached file (no icon yet)
             // Return suitable content size of a text view to display the file name (available in text message). 
-            if ([NSThread currentThread] != [NSThread mainThread])
-            {
-                dispatch_sync(dispatch_get_main_queue(), ^{
-                    self->_contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
-                });
-            }
-            else
-            {
-                _contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
-            }
+            _contentSize = [self textContentSize:self.attributedTextMessage removeVerticalInset:NO];
         }
         else
         {
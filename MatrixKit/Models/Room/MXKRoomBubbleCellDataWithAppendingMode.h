@@ -38,7 +38,7 @@
 /**
  The maximum number of components in each bubble. Default is 10.
  We limit the number of components to reduce the computation time required during bubble handling.
- Indeed some process like [prepareBubbleComponentsPosition] is time consuming.
+ Note: [prepareBubbleComponentsPosition] lays out the bubble text once, its cost is linear in the number of components.
  */
 @property (nonatomic) NSUInteger maxComponentCount;
 
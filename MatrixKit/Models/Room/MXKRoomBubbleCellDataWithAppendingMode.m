@@ -16,6 +16,8 @@
 
 #import "MXKRoomBubbleCellDataWithAppendingMode.h"
 
+#import "MXKTextMeasurementEngine.h"
+
 static NSAttributedString *messageSeparator = nil;
 
 @implementation MXKRoomBubbleCellDataWithAppendingMode
@@ -165,43 +167,32 @@ static NSAttributedString *messageSeparator = nil;
         // Check whether the position of other components need to be refreshed
         if (!self.attachment && shouldUpdateComponentsPosition && bubbleComponents.count > 1)
         {
-            // Init attributed string with the first text component not nil.
+            // Build the whole text once, and keep the location of each text component in it.
             MXKRoomBubbleComponent *component = bubbleComponents.firstObject;
             CGFloat positionY = component.position.y;
             NSMutableAttributedString *attributedString;
-            NSUInteger index = 0;
+            NSMutableArray<MXKRoomBubbleComponent*> *locatedComponents = [NSMutableArray arrayWithCapacity:bubbleComponents.count];
+            NSMutableArray<NSNumber*> *componentLocations = [NSMutableArray arrayWithCapacity:bubbleComponents.count];
             
-            for (; index < bubbleComponents.count; index++)
+            for (component in bubbleComponents)
             {
-                component = [bubbleComponents objectAtIndex:index];
-                
-                component.position = CGPointMake(0, positionY);
-                
-                if (component.attributedTextMessage)
+                if (!attributedString)
                 {
-                    attributedString = [[NSMutableAttributedString alloc] initWithAttributedString:component.attributedTextMessage];
-                    [attributedString appendAttributedString:[MXKRoomBubbleCellDataWithAppendingMode messageSeparator]];
-                    break;
+                    // Apply the position of the first component until the first text component.
+                    component.position = CGPointMake(0, positionY);
+                    
+                    if (component.attributedTextMessage)
+                    {
+                        attributedString = [[NSMutableAttributedString alloc] initWithAttributedString:component.attributedTextMessage];
+                        [attributedString appendAttributedString:[MXKRoomBubbleCellDataWithAppendingMode messageSeparator]];
+                    }
                 }
-            }
-            
-            for (index++; index < bubbleComponents.count; index++)
-            {
-                // Append the next text component
-                component = [bubbleComponents objectAtIndex:index];
-                
-                if (component.attributedTextMessage)
+                else if (component.attributedTextMessage)
                 {
-                    [attributedString appendAttributedString:component.attributedTextMessage];
-                    
-                    // Compute the height of the resulting string
-                    CGFloat cumulatedHeight = [self rawTextHeight:attributedString];
-                    
-                    // Deduce the position of the beginning of this component
-                    CGFloat positionY = MXKROOMBUBBLECELLDATA_TEXTVIEW_DEFAULT_VERTICAL_INSET + (cumulatedHeight - [self rawTextHeight:component.attributedTextMessage]);
-                    
-                    component.position = CGPointMake(0, positionY);
+                    [locatedComponents addObject:component];
+                    [componentLocations addObject:@(attributedString.length)];
                     
+                    [attributedString appendAttributedString:component.attributedTextMessage];
                     [attributedString appendAttributedString:[MXKRoomBubbleCellDataWithAppendingMode messageSeparator]];
                 }
                 else
@@ -210,6 +201,19 @@ static NSAttributedString *messageSeparator = nil;
                     component.position = CGPointMake(0, positionY);
                 }
             }
+            
+            if (locatedComponents.count)
+            {
+                // Lay out the text once: the beginning of each component is the origin of its first line fragment.
+                NSArray<NSNumber*> *origins = [MXKTextMeasurementEngine lineFragmentOriginsOfCharactersAtIndexes:componentLocations
+                                                                                                  inAttributedText:attributedString
+                                                                                                  withMaximumWidth:self.maxTextViewWidth
+                                                                                                textContainerInset:UIEdgeInsetsZero];
+                
+                [locatedComponents enumerateObjectsUsingBlock:^(MXKRoomBubbleComponent *locatedComponent, NSUInteger index, BOOL *stop) {
+                    locatedComponent.position = CGPointMake(0, MXKROOMBUBBLECELLDATA_TEXTVIEW_DEFAULT_VERTICAL_INSET + origins[index].doubleValue);
+                }];
+            }
         }
     }
     
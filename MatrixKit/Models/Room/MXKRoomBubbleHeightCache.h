@@ -0,0 +1,78 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKRoomBubbleHeightCache` stores the heights computed for a bubble cell data.
+
+ A height is cached for a (cell view class, maximum width, preferred content size category) key,
+ so that a table refresh or a size transition back to a previous width does not measure the bubble again.
+ The owner must call `removeAllHeights` each time the content of the bubble changes.
+ */
+@interface MXKRoomBubbleHeightCache : NSObject
+
+/**
+ Get a cached height.
+
+ @param height the cached height, if any.
+ @param cellViewClass the class of the cell rendering the bubble.
+ @param maxWidth the maximum width of the cell.
+ @param contentSizeCategory the preferred content size category used to compute the height.
+ @return YES on a cache hit.
+ */
+- (BOOL)getHeight:(CGFloat*)height forCellViewClass:(Class)cellViewClass withMaximumWidth:(CGFloat)maxWidth contentSizeCategory:(NSString*)contentSizeCategory;
+
+/**
+ Store a height.
+
+ @param height the height to cache.
+ @param cellViewClass the class of the cell rendering the bubble.
+ @param maxWidth the maximum width of the cell.
+ @param contentSizeCategory the preferred content size category used to compute the height.
+ */
+- (void)setHeight:(CGFloat)height forCellViewClass:(Class)cellViewClass withMaximumWidth:(CGFloat)maxWidth contentSizeCategory:(NSString*)contentSizeCategory;
+
+/**
+ Remove all the cached heights.
+ */
+- (void)removeAllHeights;
+
+#pragma mark - Statistics
+
+/**
+ The number of cache hits and misses since the last reset, for all the caches.
+ */
++ (NSUInteger)hitCount;
++ (NSUInteger)missCount;
+
+/**
+ Reset the hit and miss counters.
+ */
++ (void)resetCounters;
+
+/**
+ The preferred content size category of the application.
+
+ The value is read on the main thread. The last read value is returned on the other threads.
+ */
++ (NSString*)preferredContentSizeCategory;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,139 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKRoomBubbleHeightCache.h"
+
+static NSUInteger hitCount = 0;
+static NSUInteger missCount = 0;
+static NSString *lastPreferredContentSizeCategory = nil;
+
+@interface MXKRoomBubbleHeightCache ()
+{
+    NSMutableDictionary<NSString*, NSNumber*> *heights;
+}
+
+@end
+
+@implementation MXKRoomBubbleHeightCache
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        heights = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (BOOL)getHeight:(CGFloat*)height forCellViewClass:(Class)cellViewClass withMaximumWidth:(CGFloat)maxWidth contentSizeCategory:(NSString*)contentSizeCategory
+{
+    NSNumber *cachedHeight;
+    @synchronized(self)
+    {
+        cachedHeight = heights[[MXKRoomBubbleHeightCache keyForCellViewClass:cellViewClass withMaximumWidth:maxWidth contentSizeCategory:contentSizeCategory]];
+    }
+
+    @synchronized([MXKRoomBubbleHeightCache class])
+    {
+        if (cachedHeight)
+        {
+            hitCount++;
+        }
+        else
+        {
+            missCount++;
+        }
+    }
+
+    if (cachedHeight && height)
+    {
+        *height = cachedHeight.doubleValue;
+    }
+    return (cachedHeight != nil);
+}
+
+- (void)setHeight:(CGFloat)height forCellViewClass:(Class)cellViewClass withMaximumWidth:(CGFloat)maxWidth contentSizeCategory:(NSString*)contentSizeCategory
+{
+    @synchronized(self)
+    {
+        heights[[MXKRoomBubbleHeightCache keyForCellViewClass:cellViewClass withMaximumWidth:maxWidth contentSizeCategory:contentSizeCategory]] = @(height);
+    }
+}
+
+- (void)removeAllHeights
+{
+    @synchronized(self)
+    {
+        [heights removeAllObjects];
+    }
+}
+
+#pragma mark - Statistics
+
++ (NSUInteger)hitCount
+{
+    @synchronized(self)
+    {
+        return hitCount;
+    }
+}
+
++ (NSUInteger)missCount
+{
+    @synchronized(self)
+    {
+        return missCount;
+    }
+}
+
++ (void)resetCounters
+{
+    @synchronized(self)
+    {
+        hitCount = 0;
+        missCount = 0;
+    }
+}
+
++ (NSString*)preferredContentSizeCategory
+{
+    if ([NSThread isMainThread])
+    {
+        // Note: [UIApplication sharedApplication] is not available in app extensions
+        UIApplication *sharedApplication = [UIApplication performSelector:@selector(sharedApplication)];
+        NSString *contentSizeCategory = sharedApplication.preferredContentSizeCategory;
+
+        @synchronized(self)
+        {
+            lastPreferredContentSizeCategory = contentSizeCategory;
+        }
+    }
+
+    @synchronized(self)
+    {
+        return lastPreferredContentSizeCategory ?: UIContentSizeCategoryLarge;
+    }
+}
+
+#pragma mark - Private methods
+
++ (NSString*)keyForCellViewClass:(Class)cellViewClass withMaximumWidth:(CGFloat)maxWidth contentSizeCategory:(NSString*)contentSizeCategory
+{
+    return [NSString stringWithFormat:@"%@|%.2f|%@", NSStringFromClass(cellViewClass), maxWidth, contentSizeCategory];
+}
+
+@end
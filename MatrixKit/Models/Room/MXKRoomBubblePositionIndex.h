@@ -0,0 +1,79 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKRoomBubblePositionIndex` maintains the position of each cell data in an ordered list of bubbles.
+
+ Positions are stored as sequence numbers relative to the first bubble, so that prepending
+ (back pagination) and appending (live events) a bubble are constant-time operations.
+ An insertion or a removal in the middle of the list renumbers the bubbles between it and
+ the nearest end of the list: it costs O(min(i, n - i)) for the position i in a list of n bubbles.
+
+ The index does not retain the list it describes: the owner must report every change
+ applied to the list. Cell data are compared by pointer.
+ */
+@interface MXKRoomBubblePositionIndex : NSObject <NSCopying>
+
+/**
+ Create an index describing the provided list of cell data.
+
+ @param cellDatas the current list of cell data.
+ @return the newly created instance.
+ */
+- (instancetype)initWithCellDatas:(nullable NSArray *)cellDatas;
+
+/**
+ The number of indexed cell data.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Get the position of a cell data.
+
+ @param cellData the cell data.
+ @return its position in the list, or NSNotFound.
+ */
+- (NSUInteger)indexOfCellData:(id)cellData;
+
+/**
+ Report the insertion of a cell data in the list.
+
+ @param cellData the inserted cell data.
+ @param index its position in the list.
+ */
+- (void)insertCellData:(id)cellData atIndex:(NSUInteger)index;
+
+/**
+ Report the removal of a cell data from the list.
+
+ @param cellData the removed cell data.
+ */
+- (void)removeCellData:(id)cellData;
+
+/**
+ Rebuild the whole index from the provided list.
+
+ @param cellDatas the current list of cell data.
+ */
+- (void)resetWithCellDatas:(nullable NSArray *)cellDatas;
+
+@end
+
+NS_ASSUME_NONNULL_END
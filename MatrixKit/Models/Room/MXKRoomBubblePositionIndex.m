@@ -0,0 +1,158 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKRoomBubblePositionIndex.h"
+
+@interface MXKRoomBubblePositionIndex ()
+{
+    /**
+     The sequence number of each cell data.
+     */
+    NSMapTable<id, NSNumber*> *sequences;
+
+    /**
+     The indexed cell data, in the list order.
+     */
+    NSMutableArray *orderedCellDatas;
+
+    /**
+     The sequence number of the first cell data of the list.
+     */
+    NSInteger firstSequence;
+}
+
+@end
+
+@implementation MXKRoomBubblePositionIndex
+
+- (instancetype)init
+{
+    return [self initWithCellDatas:nil];
+}
+
+- (instancetype)initWithCellDatas:(NSArray *)cellDatas
+{
+    self = [super init];
+    if (self)
+    {
+        [self resetWithCellDatas:cellDatas];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    MXKRoomBubblePositionIndex *positionIndex = [[MXKRoomBubblePositionIndex allocWithZone:zone] init];
+    positionIndex->sequences = [sequences copy];
+    positionIndex->orderedCellDatas = [orderedCellDatas mutableCopy];
+    positionIndex->firstSequence = firstSequence;
+    positionIndex->_count = _count;
+    return positionIndex;
+}
+
+- (NSUInteger)indexOfCellData:(id)cellData
+{
+    NSNumber *sequence = cellData ? [sequences objectForKey:cellData] : nil;
+    if (sequence)
+    {
+        return sequence.integerValue - firstSequence;
+    }
+    return NSNotFound;
+}
+
+- (void)insertCellData:(id)cellData atIndex:(NSUInteger)index
+{
+    if ([sequences objectForKey:cellData])
+    {
+        [self removeCellData:cellData];
+    }
+
+    if (index > _count)
+    {
+        index = _count;
+    }
+
+    [orderedCellDatas insertObject:cellData atIndex:index];
+    _count++;
+
+    // Make room for the new cell data on the shorter side of the list
+    if (index < _count - 1 - index)
+    {
+        firstSequence--;
+        [self updateSequencesInRange:NSMakeRange(0, index)];
+    }
+    else
+    {
+        [self updateSequencesInRange:NSMakeRange(index + 1, _count - 1 - index)];
+    }
+
+    [sequences setObject:@(firstSequence + index) forKey:cellData];
+}
+
+- (void)removeCellData:(id)cellData
+{
+    NSNumber *sequence = [sequences objectForKey:cellData];
+    if (!sequence)
+    {
+        return;
+    }
+
+    NSUInteger index = sequence.integerValue - firstSequence;
+    [sequences removeObjectForKey:cellData];
+    [orderedCellDatas removeObjectAtIndex:index];
+    _count--;
+
+    // Fill the gap from the shorter side of the list
+    if (index < _count - index)
+    {
+        firstSequence++;
+        [self updateSequencesInRange:NSMakeRange(0, index)];
+    }
+    else
+    {
+        [self updateSequencesInRange:NSMakeRange(index, _count - index)];
+    }
+}
+
+- (void)resetWithCellDatas:(NSArray *)cellDatas
+{
+    sequences = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality)
+                                      valueOptions:NSPointerFunctionsStrongMemory];
+    orderedCellDatas = [NSMutableArray arrayWithCapacity:cellDatas.count];
+    firstSequence = 0;
+    _count = 0;
+
+    for (id cellData in cellDatas)
+    {
+        if (![sequences objectForKey:cellData])
+        {
+            [sequences setObject:@(_count++) forKey:cellData];
+            [orderedCellDatas addObject:cellData];
+        }
+    }
+}
+
+#pragma mark - Private methods
+
+- (void)updateSequencesInRange:(NSRange)range
+{
+    for (NSUInteger index = range.location; index < NSMaxRange(range); index++)
+    {
+        [sequences setObject:@(firstSequence + (NSInteger)index) forKey:orderedCellDatas[index]];
+    }
+}
+
+@end
@@ -33,6 +33,11 @@
  */
 #define MXKROOMDATASOURCE_PAGINATION_LIMIT_AROUND_INITIAL_EVENT 30
 
+/**
+ Define the number of bubbles measured in advance.
+ */
+#define MXKROOMDATASOURCE_PREWARMING_BUBBLES_COUNT 20
+
 /**
  List the supported pagination of the rendered room bubble cells
  */
@@ -85,7 +90,7 @@ extern NSString *const kMXKRoomDataSourceTimelineErrorErrorKey;
 /**
  The data source for `MXKRoomViewController`.
  */
-@interface MXKRoomDataSource : MXKDataSource <UITableViewDataSource>
+@interface MXKRoomDataSource : MXKDataSource <UITableViewDataSource, UITableViewDataSourcePrefetching>
 {
 @protected
 
@@ -227,6 +232,13 @@ extern NSString *const kMXKRoomDataSourceTimelineErrorErrorKey;
  */
 @property (nonatomic) NSUInteger paginationLimitAroundInitialEvent;
 
+/**
+ The maximum number of bubbles whose text is measured in advance on a background queue,
+ ahead of the scroll position (see `UITableViewDataSourcePrefetching`) and after a back pagination.
+ 0 disables the prewarming. The default value is 20.
+ */
+@property (nonatomic) NSUInteger bubblesPrewarmingCount;
+
 /**
  Tell whether only the message events with an url key in their content must be handled. NO by default.
  Note: The stickers are not retained by this filter.
@@ -356,6 +368,9 @@ extern NSString *const kMXKRoomDataSourceTimelineErrorErrorKey;
 
 /**
  Get height of the cell at the given index.
+ 
+ The heights of `MXKRoomBubbleCellData` instances are cached by cell view class, maximum width and
+ preferred content size category (see `MXKRoomBubbleHeightCache`).
 
  @param index the index of the cell in the array.
  @param maxWidth the maximum available width.
@@ -570,7 +585,8 @@ extern NSString *const kMXKRoomDataSourceTimelineErrorErrorKey;
 /**
  This method is called for each read receipt event received in forward mode.
  
- By default, it tells the delegate that some cell data/views have been changed.
+ By default, it moves the read receipts of the senders and tells the delegate which cell data/views have been changed
+ (see `[MXKDataSourceDelegate dataSource:didCellChangeWithChangeSet:]`).
  You may override this method to handle the receipt event according to the application needs.
  
  You should not call this method directly.
@@ -583,6 +599,8 @@ extern NSString *const kMXKRoomDataSourceTimelineErrorErrorKey;
 
 /**
  Update read receipts for an event in a bubble cell data.
+ 
+ Read receipts must be updated through this method to keep the per-user read receipts index up to date.
 
  @param cellData The cell data to update.
  @param readReceipts The new read receipts.
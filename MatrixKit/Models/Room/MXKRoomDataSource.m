@@ -22,6 +22,8 @@
 @import MatrixSDK;
 
 #import "MXKQueuedEvent.h"
+#import "MXKRoomBubblePositionIndex.h"
+#import "MXKRoomReadReceiptsIndex.h"
 #import "MXKRoomBubbleTableViewCell.h"
 
 #import "MXKRoomBubbleCellData.h"
@@ -44,6 +46,34 @@ NSString *const kMXKRoomDataSourceFailToLoadTimelinePosition = @"kMXKRoomDataSou
 NSString *const kMXKRoomDataSourceTimelineError = @"kMXKRoomDataSourceTimelineError";
 NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTimelineErrorErrorKey";
 
+#pragma mark - MXKRoomDataSourcePrewarmingTask
+
+/**
+ The measurement of the text of a bubble, prepared on the main thread and done on the prewarming queue.
+ The text of the bubble is formatted and measured on the prewarming queue, under the lock of the bubble.
+ */
+@interface MXKRoomDataSourcePrewarmingTask : NSObject
+{
+@public
+    MXKRoomBubbleCellData *cellData;
+    
+    // The text of the bubble which has been measured
+    NSAttributedString *attributedTextMessage;
+    
+    // The cell view class and the maximum cell width the measurement is done for
+    NSString *key;
+    CGFloat maxTextViewWidth;
+    
+    // The result
+    CGSize contentSize;
+}
+@end
+
+@implementation MXKRoomDataSourcePrewarmingTask
+@end
+
+#pragma mark - MXKRoomDataSource
+
 @interface MXKRoomDataSource ()
 {
     /**
@@ -97,6 +127,56 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
      */
     NSMutableDictionary *eventIdToBubbleMap;
     
+    /**
+     Position of each bubble in `bubbles`.
+     */
+    MXKRoomBubblePositionIndex *bubblesPositionIndex;
+    
+    /**
+     Location of the displayed read receipt of each user.
+     */
+    MXKRoomReadReceiptsIndex *readReceiptsIndex;
+    
+    /**
+     The existing cell data updated during the current processing on the processing queue.
+     They are reported to the delegate as updated rows.
+     */
+    NSHashTable<id<MXKRoomBubbleCellDataStoring>> *updatedCellDatas;
+    
+    /**
+     The measurements waiting to be done on the prewarming queue, in processing order.
+     */
+    NSMutableArray<MXKRoomDataSourcePrewarmingTask*> *prewarmingTasks;
+    
+    /**
+     Tell whether a prewarming is in progress on the prewarming queue.
+     */
+    BOOL isPrewarming;
+    
+    /**
+     The last prefetched row and the scrolling direction it revealed.
+     */
+    NSInteger lastPrefetchedRow;
+    BOOL isPrefetchingBackwards;
+    
+    /**
+     The text view width applied by each cell view class for a maximum cell width, as observed
+     when the cell heights are computed. The keys are built by `prewarmingKeyForCellViewClass:withMaximumWidth:`.
+     This is only accessed on the main thread.
+     */
+    NSMutableDictionary<NSString*, NSNumber*> *prewarmingMaxTextViewWidths;
+    
+    /**
+     The last maximum cell width used to compute a cell height.
+     */
+    CGFloat prewarmingMaxWidth;
+    
+    /**
+     The measurements done on the prewarming queue, by bubble then by key.
+     They are published on the main thread, and consumed when the height of the bubble is computed.
+     */
+    NSMapTable<MXKRoomBubbleCellData*, NSMutableDictionary<NSString*, MXKRoomDataSourcePrewarmingTask*>*> *prewarmedTasks;
+    
     /**
      Typing notifications listener.
      */
@@ -117,6 +197,11 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
      */
     NSMutableArray *bubblesSnapshot;
     
+    /**
+     Position of each bubble in `bubblesSnapshot`.
+     */
+    MXKRoomBubblePositionIndex *bubblesSnapshotPositionIndex;
+    
     /**
      The room being peeked, if any.
      */
@@ -274,6 +359,12 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         bubbles = [NSMutableArray array];
         eventsToProcess = [NSMutableArray array];
         eventIdToBubbleMap = [NSMutableDictionary dictionary];
+        bubblesPositionIndex = [[MXKRoomBubblePositionIndex alloc] init];
+        readReceiptsIndex = [[MXKRoomReadReceiptsIndex alloc] init];
+        prewarmingTasks = [NSMutableArray array];
+        prewarmingMaxTextViewWidths = [NSMutableDictionary dictionary];
+        prewarmedTasks = [NSMapTable weakToStrongObjectsMapTable];
+        lastPrefetchedRow = NSNotFound;
         
         externalRelatedGroups = [NSMutableDictionary dictionary];
         
@@ -287,6 +378,8 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         
         // Set default MXEvent -> NSString formatter
         self.eventFormatter = [[MXKEventFormatter alloc] initWithMatrixSession:self.mxSession];
+        // This formatter renders only with its own properties: its renderings can be cached
+        self.eventFormatter.renderCacheCapacity = MXKEVENTFORMATTER_DEFAULT_RENDER_CACHE_CAPACITY;
         // Apply here the event types filter to display only the wanted event types.
         self.eventFormatter.eventTypesFilterForMessages = [MXKAppSettings standardAppSettings].eventsFilterForMessages;
         
@@ -305,6 +398,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         
         _maxBackgroundCachedBubblesCount = MXKROOMDATASOURCE_CACHED_BUBBLES_COUNT_THRESHOLD;
         _paginationLimitAroundInitialEvent = MXKROOMDATASOURCE_PAGINATION_LIMIT_AROUND_INITIAL_EVENT;
+        _bubblesPrewarmingCount = MXKROOMDATASOURCE_PREWARMING_BUBBLES_COUNT;
 
         // Observe UIApplicationSignificantTimeChangeNotification to refresh bubbles if date/time are shown.
         // UIApplicationSignificantTimeChangeNotification is posted if DST is updated, carrier time is updated
@@ -415,6 +509,9 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
 {
     [externalRelatedGroups removeAllObjects];
     
+    [self cancelBubblesPrewarming];
+    [prewarmedTasks removeAllObjects];
+    
     if (roomDidFlushDataNotificationObserver)
     {
         [[NSNotificationCenter defaultCenter] removeObserver:roomDidFlushDataNotificationObserver];
@@ -471,12 +568,16 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     {
         eventsToProcessSnapshot = nil;
         bubblesSnapshot = nil;
+        bubblesSnapshotPositionIndex = nil;
         
         @synchronized(bubbles)
         {
             [bubbles removeAllObjects];
+            [bubblesPositionIndex resetWithCellDatas:nil];
         }
         
+        [readReceiptsIndex removeAllReadReceipts];
+        
         @synchronized(eventIdToBubbleMap)
         {
             [eventIdToBubbleMap removeAllObjects];
@@ -514,6 +615,9 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
 {
     NSLog(@"[MXKRoomDataSource] Destroy %p - room id: %@", self, _roomId);
     
+    [self cancelBubblesPrewarming];
+    [prewarmedTasks removeAllObjects];
+    
     [self unregisterScanManagerNotifications];
     [self unregisterReactionsChangeListener];
     [self unregisterEventEditsListener];
@@ -548,6 +652,8 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     
     eventsToProcess = nil;
     bubbles = nil;
+    bubblesPositionIndex = nil;
+    readReceiptsIndex = nil;
     eventIdToBubbleMap = nil;
 
     [_timeline destroy];
@@ -890,9 +996,10 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                     }
 
                     // Check whether the bubble should be removed
+                    MXKDataSourceChangeSet *changeSet;
                     if (shouldRemoveBubbleData)
                     {
-                        [self removeCellData:bubbleData];
+                        changeSet = [self removeCellData:bubbleData];
                     }
 
                     if (hasChanged)
@@ -900,9 +1007,14 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                         // Update the delegate on main thread
                         dispatch_async(dispatch_get_main_queue(), ^{
 
-                            if (self.delegate)
+                            if (changeSet)
                             {
-                                [self.delegate dataSource:self didCellChange:nil];
+                                // The neighbour bubbles may have been merged or updated
+                                [self notifyDelegateWithChangeSet:changeSet];
+                            }
+                            else
+                            {
+                                [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
                             }
 
                         });
@@ -1107,7 +1219,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     {
         @synchronized(bubbles)
         {
-            index = [bubbles indexOfObject:bubbleData];
+            index = [self indexOfCellData:bubbleData inCellDatas:bubbles withPositionIndex:bubblesPositionIndex];
         }
     }
     
@@ -1121,9 +1233,43 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     // Sanity check
     if (bubbleData && self.delegate)
     {
-        // Compute here height of bubble cell
         Class<MXKCellRendering> cellViewClass = [self.delegate cellViewClassForCellData:bubbleData];
-        return [cellViewClass heightForCellData:bubbleData withMaximumWidth:maxWidth];
+        
+        // Check whether the height has already been computed for this width
+        MXKRoomBubbleHeightCache *heightCache;
+        NSString *contentSizeCategory;
+        if ([bubbleData isKindOfClass:MXKRoomBubbleCellData.class])
+        {
+            heightCache = ((MXKRoomBubbleCellData*)bubbleData).heightCache;
+            contentSizeCategory = [MXKRoomBubbleHeightCache preferredContentSizeCategory];
+            
+            CGFloat height;
+            if ([heightCache getHeight:&height forCellViewClass:cellViewClass withMaximumWidth:maxWidth contentSizeCategory:contentSizeCategory])
+            {
+                return height;
+            }
+        }
+        
+        NSString *prewarmingKey;
+        if (heightCache)
+        {
+            // Use the text size measured in advance, if any
+            prewarmingKey = [self prewarmingKeyForCellViewClass:cellViewClass withMaximumWidth:maxWidth];
+            [self applyPrewarmedTaskToCellData:(MXKRoomBubbleCellData*)bubbleData forKey:prewarmingKey];
+        }
+        
+        // Compute here height of bubble cell
+        CGFloat height = [cellViewClass heightForCellData:bubbleData withMaximumWidth:maxWidth];
+        [heightCache setHeight:height forCellViewClass:cellViewClass withMaximumWidth:maxWidth contentSizeCategory:contentSizeCategory];
+        
+        if (prewarmingKey && !((MXKRoomBubbleCellData*)bubbleData).attachment)
+        {
+            // Measure the next prewarmed text bubbles of this cell view class with the width applied by the cell
+            prewarmingMaxTextViewWidths[prewarmingKey] = @(((MXKRoomBubbleCellData*)bubbleData).maxTextViewWidth);
+            prewarmingMaxWidth = maxWidth;
+        }
+        
+        return height;
     }
     
     return 0;
@@ -1204,6 +1350,12 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         // Once done, process retrieved events
         [self processQueuedEvents:^(NSUInteger addedHistoryCellNb, NSUInteger addedLiveCellNb) {
             
+            if (direction == MXTimelineDirectionBackwards)
+            {
+                // Prepare the bubbles the user is about to scroll to
+                [self prewarmBubblesAddedByBackPagination:addedHistoryCellNb];
+            }
+            
             if (success)
             {
                 NSUInteger addedCellNb = (direction == MXTimelineDirectionBackwards) ? addedHistoryCellNb : addedLiveCellNb;
@@ -1749,18 +1901,23 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         }
         
         // If there is no more events in the bubble, remove it
+        MXKDataSourceChangeSet *changeSet;
         if (0 == remainingEvents)
         {
-            [self removeCellData:bubbleData];
+            changeSet = [self removeCellData:bubbleData];
         }
 
         // Remove the event from the outgoing messages storage
         [_room removeOutgoingMessage:eventId];
     
         // Update the delegate
-        if (self.delegate)
+        if (changeSet)
+        {
+            [self notifyDelegateWithChangeSet:changeSet];
+        }
+        else
         {
-            [self.delegate dataSource:self didCellChange:nil];
+            [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
         }
     }
 }
@@ -1772,52 +1929,29 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     dispatch_async(MXKRoomDataSource.processingQueue, ^{
         MXStrongifyAndReturnIfNil(self);
 
+        // Collect the cell data impacted by this receipt event
+        self->updatedCellDatas = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+
         // Remove the previous displayed read receipt for each user who sent a
         // new read receipt.
-        // To implement it, we need to find the sender id of each new read receipt
-        // among the read receipts array of all events in all bubbles.
+        // The read receipts index tells where the current receipt of each user is displayed.
         NSArray *readReceiptSenders = receiptEvent.readReceiptSenders;
-
-        @synchronized(self->bubbles)
+        for (NSString *senderId in readReceiptSenders)
         {
-            for (MXKRoomBubbleCellData *cellData in self->bubbles)
+            NSString *eventId;
+            MXKRoomBubbleCellData *cellData = [self->readReceiptsIndex cellDataWithReadReceiptOfUser:senderId eventId:&eventId];
+            if (cellData && eventId)
             {
-                NSMutableDictionary<NSString* /* eventId */, NSArray<MXReceiptData*> *> *updatedCellDataReadReceipts = [NSMutableDictionary dictionary];
-
-                for (NSString *eventId in cellData.readReceipts)
+                NSMutableArray<MXReceiptData*> *readReceipts = [NSMutableArray array];
+                for (MXReceiptData *receiptData in cellData.readReceipts[eventId])
                 {
-                    for (MXReceiptData *receiptData in cellData.readReceipts[eventId])
+                    if (![receiptData.userId isEqualToString:senderId])
                     {
-                        for (NSString *senderId in readReceiptSenders)
-                        {
-                            if ([receiptData.userId isEqualToString:senderId])
-                            {
-                                if (!updatedCellDataReadReceipts[eventId])
-                                {
-                                    updatedCellDataReadReceipts[eventId] = cellData.readReceipts[eventId];
-                                }
-
-                                NSPredicate *predicate = [NSPredicate predicateWithFormat:@"userId!=%@", receiptData.userId];
-                                updatedCellDataReadReceipts[eventId] = [updatedCellDataReadReceipts[eventId] filteredArrayUsingPredicate:predicate];
-                                break;
-                            }
-                        }
-
+                        [readReceipts addObject:receiptData];
                     }
                 }
 
-                // Flush found changed to the cell data
-                for (NSString *eventId in updatedCellDataReadReceipts)
-                {
-                    if (updatedCellDataReadReceipts[eventId].count)
-                    {
-                        [self updateCellData:cellData withReadReceipts:updatedCellDataReadReceipts[eventId] forEventId:eventId];
-                    }
-                    else
-                    {
-                        [self updateCellData:cellData withReadReceipts:nil forEventId:eventId];
-                    }
-                }
+                [self updateCellData:cellData withReadReceipts:(readReceipts.count ? readReceipts : nil) forEventId:eventId];
             }
         }
 
@@ -1835,18 +1969,24 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
             }
         }
 
+        NSArray<id<MXKRoomBubbleCellDataStoring>> *updatedCellDatas = self->updatedCellDatas.allObjects;
+        self->updatedCellDatas = nil;
+
         dispatch_async(dispatch_get_main_queue(), ^{
-            if (self.delegate)
-            {
-                [self.delegate dataSource:self didCellChange:nil];
-            }
+            // Report only the rows whose read receipts changed
+            [self notifyDelegateWithUpdatedCellDatas:updatedCellDatas];
         });
     });
 }
 
 - (void)updateCellData:(MXKRoomBubbleCellData*)cellData withReadReceipts:(NSArray<MXReceiptData*>*)readReceipts forEventId:(NSString*)eventId
 {
+    NSArray<MXReceiptData*> *previousReadReceipts = cellData.readReceipts[eventId];
     cellData.readReceipts[eventId] = readReceipts;
+
+    [readReceiptsIndex cellData:cellData didUpdateReadReceipts:readReceipts previousReadReceipts:previousReadReceipts forEventId:eventId];
+    [cellData.heightCache removeAllHeights];
+    [updatedCellDatas addObject:cellData];
 }
 
 - (void)handleUnsentMessages
@@ -1878,18 +2018,17 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
 {
     if (bubbleData.collapsed != collapsed)
     {
+        NSMutableArray<id<MXKRoomBubbleCellDataStoring>> *seriesCellDatas = [NSMutableArray array];
         id<MXKRoomBubbleCellDataStoring> nextBubbleData = bubbleData;
         do
         {
             nextBubbleData.collapsed = collapsed;
+            [seriesCellDatas addObject:nextBubbleData];
         }
         while ((nextBubbleData = nextBubbleData.nextCollapsableCellData));
 
-        if (self.delegate)
-        {
-            // Reload all the table
-            [self.delegate dataSource:self didCellChange:nil];
-        }
+        // Only the cells of the series change
+        [self notifyDelegateWithUpdatedCellDatas:seriesCellDatas];
     }
 }
 
@@ -1943,21 +2082,34 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     }
     
     // If there is no more events in the bubble, remove it
+    MXKDataSourceChangeSet *changeSet;
     if (0 == remainingEvents)
     {
-        [self removeCellData:bubbleData];
+        changeSet = [self removeCellData:bubbleData];
     }
 
     // Update the delegate
-    if (self.delegate)
+    if (changeSet)
     {
-        [self.delegate dataSource:self didCellChange:nil];
+        [self notifyDelegateWithChangeSet:changeSet];
+    }
+    else
+    {
+        [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
     }
 }
 
-- (NSArray<NSIndexPath *> *)removeCellData:(id<MXKRoomBubbleCellDataStoring>)cellData
+/**
+ Remove a cell data from the bubbles.
+
+ The adjacent bubbles may merge, and their sender and pagination flags are updated.
+
+ @param cellData the cell data to remove.
+ @return the changes of the bubbles, with the rows numbered as before the removal.
+ */
+- (MXKDataSourceChangeSet*)removeCellData:(id<MXKRoomBubbleCellDataStoring>)cellData
 {
-    NSMutableArray *deletedRows = [NSMutableArray array];
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
     
     // Remove potential occurrences in bubble map
     @synchronized (eventIdToBubbleMap)
@@ -1977,11 +2129,12 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     // Check whether the adjacent bubbles can merge together
     @synchronized(bubbles)
     {
-        NSUInteger index = [bubbles indexOfObject:cellData];
+        NSUInteger index = [self indexOfCellData:cellData inCellDatas:bubbles withPositionIndex:bubblesPositionIndex];
         if (index != NSNotFound)
         {
             [bubbles removeObjectAtIndex:index];
-            [deletedRows addObject:[NSIndexPath indexPathForRow:index inSection:0]];
+            [bubblesPositionIndex removeCellData:cellData];
+            [changeSet addDeletedIndexPath:[NSIndexPath indexPathForRow:index inSection:0]];
             
             if (bubbles.count)
             {
@@ -1997,6 +2150,9 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                     // Keep visible the sender information by default,
                     // except if the bubble has no display (composed only by ignored events).
                     firstCellData.shouldHideSenderInformation = firstCellData.hasNoDisplay;
+                    
+                    [self removeCachedHeightsOfCellData:firstCellData];
+                    [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:(index + 1) inSection:0]];
                 }
                 else if (index < bubbles.count)
                 {
@@ -2011,7 +2167,12 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                         if ([cellData1 mergeWithBubbleCellData:cellData2])
                         {
                             [bubbles removeObjectAtIndex:index];
-                            [deletedRows addObject:[NSIndexPath indexPathForRow:(index + 1) inSection:0]];
+                            [bubblesPositionIndex removeCellData:cellData2];
+                            [changeSet addDeletedIndexPath:[NSIndexPath indexPathForRow:(index + 1) inSection:0]];
+                            
+                            // The previous bubble displays the merged content
+                            [self removeCachedHeightsOfCellData:cellData1];
+                            [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:(index - 1) inSection:0]];
                             
                             cellData2 = nil;
                         }
@@ -2046,6 +2207,9 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                             // Check whether the neighbor bubbles have been sent by the same user.
                             cellData2.shouldHideSenderInformation = [cellData2 hasSameSenderAsBubbleCellData:cellData1];
                         }
+                        
+                        [self removeCachedHeightsOfCellData:cellData2];
+                        [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:(index + 1) inSection:0]];
                     }
 
                 }
@@ -2053,7 +2217,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         }
     }
     
-    return deletedRows;
+    return changeSet;
 }
 
 - (void)didMXRoomInitialSynced:(NSNotification *)notif
@@ -2114,10 +2278,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         }
         
         // Inform the delegate
-        if (self.delegate)
-        {
-            [self.delegate dataSource:self didCellChange:nil];
-        }
+        [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
     }
 }
 
@@ -2176,13 +2337,16 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
             {
                 [bubbleData updateEvent:event.eventId withEvent:event];
             }
+            
+            // Update the delegate
+            [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
         }
         else
         {
             @synchronized (bubbleData)
             {
                 BOOL eventIsFirstInBubble = NO;
-                NSInteger bubbleDataIndex =  [bubbles indexOfObject:bubbleData];
+                NSInteger bubbleDataIndex = [self indexOfCellData:bubbleData inCellDatas:bubbles withPositionIndex:bubblesPositionIndex];
 
                 // We need to create a dedicated cell for the event attachment.
                 // From the current bubble, remove the updated event and all events after.
@@ -2196,6 +2360,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                     @synchronized (eventsToProcessSnapshot)
                     {
                         [bubbles removeObjectAtIndex:bubbleDataIndex];
+                        [bubblesPositionIndex removeCellData:bubbleData];
                         bubbleDataIndex--;
                     }
                 }
@@ -2229,6 +2394,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                     @synchronized (eventsToProcessSnapshot)
                     {
                         [bubbles insertObject:newBubbleData atIndex:bubbleDataIndex + 1];
+                        [bubblesPositionIndex insertCellData:newBubbleData atIndex:bubbleDataIndex + 1];
                     }
                 }
 
@@ -2264,15 +2430,13 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                     @synchronized (eventsToProcessSnapshot)
                     {
                         [bubbles insertObject:newBubbleData atIndex:bubbleDataIndex + 2];
+                        [bubblesPositionIndex insertCellData:newBubbleData atIndex:bubbleDataIndex + 2];
                     }
                 }
             }
-        }
-
-        // Update the delegate
-        if (self.delegate)
-        {
-            [self.delegate dataSource:self didCellChange:nil];
+            
+            // Update the delegate: reload all the table
+            [self notifyDelegateWithChangeSet:nil];
         }
     }
 }
@@ -2514,6 +2678,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         NSUInteger serverSyncEventCount = 0;
         NSUInteger addedHistoryCellCount = 0;
         NSUInteger addedLiveCellCount = 0;
+        NSArray<id<MXKRoomBubbleCellDataStoring>> *updatedCellDatas;
 
         // Lock on `eventsToProcessSnapshot` to suspend reload or destroy during the process.
         @synchronized(self->eventsToProcessSnapshot)
@@ -2527,7 +2692,11 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                 @synchronized(self->bubbles)
                 {
                     self->bubblesSnapshot = [self->bubbles mutableCopy];
+                    self->bubblesSnapshotPositionIndex = [self->bubblesPositionIndex copy];
                 }
+                
+                // Collect the existing bubbles updated by this processing
+                self->updatedCellDatas = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
 
                 NSMutableSet<id<MXKRoomBubbleCellDataStoring>> *collapsingCellDataSeriess = [NSMutableSet set];
 
@@ -2568,6 +2737,11 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                 updatedBubbleDataHadNoDisplay = bubbleData.hasNoDisplay;
                                 eventManaged = [bubbleData addEvent:queuedEvent.event andRoomState:queuedEvent.state];
                             }
+                            
+                            if (eventManaged)
+                            {
+                                [self->updatedCellDatas addObject:bubbleData];
+                            }
                         }
 
                         if (NO == eventManaged)
@@ -2598,6 +2772,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                             bubbleData.collapsed = self->collapsableSeriesAtStart.collapsed;
 
                                             // Release data of the previous header
+                                            [self->updatedCellDatas addObject:self->collapsableSeriesAtStart];
                                             self->collapsableSeriesAtStart.collapseState = nil;
                                             self->collapsableSeriesAtStart.collapsedAttributedTextMessage = nil;
                                             [collapsingCellDataSeriess removeObject:self->collapsableSeriesAtStart];
@@ -2692,6 +2867,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                         {
                                             NSString *bubbleDateString = [self.eventFormatter dateStringFromDate:bubbleData.date withTime:NO];
                                             previousFirstBubbleDataWithDate.isPaginationFirstBubble = (bubbleDateString && ![firstBubbleDateString isEqualToString:bubbleDateString]);
+                                            [self->updatedCellDatas addObject:previousFirstBubbleDataWithDate];
                                         }
                                     }
                                 }
@@ -2713,11 +2889,13 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                     {
                                         // Check whether the current first bubble has been sent by the same user.
                                         previousFirstBubbleData.shouldHideSenderInformation |= [previousFirstBubbleData hasSameSenderAsBubbleCellData:bubbleData];
+                                        [self->updatedCellDatas addObject:previousFirstBubbleData];
                                     }
                                 }
 
                                 // Insert the new bubble data in first position
                                 [self->bubblesSnapshot insertObject:bubbleData atIndex:0];
+                                [self->bubblesSnapshotPositionIndex insertCellData:bubbleData atIndex:0];
                                 
                                 addedHistoryCellCount++;
                             }
@@ -2771,6 +2949,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
 
                                 // Insert the new bubble in last position
                                 [self->bubblesSnapshot addObject:bubbleData];
+                                [self->bubblesSnapshotPositionIndex insertCellData:bubbleData atIndex:self->bubblesSnapshotPositionIndex.count];
                                 
                                 addedLiveCellCount++;
                             }
@@ -2810,6 +2989,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                         {
                                             NSString *bubbleDateString = [self.eventFormatter dateStringFromDate:bubbleData.date withTime:NO];
                                             nextBubbleDataWithDate.isPaginationFirstBubble = (bubbleDateString && ![firstNextBubbleDateString isEqualToString:bubbleDateString]);
+                                            [self->updatedCellDatas addObject:nextBubbleDataWithDate];
                                         }
                                     }
                                 }
@@ -2830,6 +3010,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                                     {
                                         // Check whether the current first bubble has been sent by the same user.
                                         nextBubbleData.shouldHideSenderInformation |= [nextBubbleData hasSameSenderAsBubbleCellData:bubbleData];
+                                        [self->updatedCellDatas addObject:nextBubbleData];
                                     }
                                 }
                             }
@@ -2956,6 +3137,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
 
                     // Build the summary string for the series
                     bubbleData.collapsedAttributedTextMessage = [self.eventFormatter attributedStringFromEvents:events withRoomState:bubbleData.collapseState error:nil];
+                    [self->updatedCellDatas addObject:bubbleData];
 
                     // Release collapseState objects, even the one of collapsableSeriesAtStart.
                     // We do not need to keep its state because if an collapsable event comes before collapsableSeriesAtStart,
@@ -2967,6 +3149,9 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                 }
             }
             self->eventsToProcessSnapshot = nil;
+            
+            updatedCellDatas = self->updatedCellDatas.allObjects;
+            self->updatedCellDatas = nil;
         }
         
         // Check whether some events have been processed
@@ -2989,12 +3174,41 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                         }
                     }
                     
+                    // Describe the changes: new bubbles are inserted at the top (back pagination)
+                    // and at the bottom (live events), some existing bubbles have been updated.
+                    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+                    @synchronized(self->bubbles)
+                    {
+                        for (id<MXKRoomBubbleCellDataStoring> cellData in updatedCellDatas)
+                        {
+                            [self removeCachedHeightsOfCellData:cellData];
+                            
+                            NSUInteger index = [self indexOfCellData:cellData inCellDatas:self->bubbles withPositionIndex:self->bubblesPositionIndex];
+                            if (index != NSNotFound)
+                            {
+                                [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:index inSection:0]];
+                            }
+                        }
+                    }
+                    
+                    NSUInteger bubblesCount = self->bubblesSnapshot.count;
+                    for (NSUInteger row = 0; row < addedHistoryCellCount; row++)
+                    {
+                        [changeSet addInsertedIndexPath:[NSIndexPath indexPathForRow:row inSection:0]];
+                    }
+                    for (NSUInteger row = bubblesCount - addedLiveCellCount; row < bubblesCount; row++)
+                    {
+                        [changeSet addInsertedIndexPath:[NSIndexPath indexPathForRow:row inSection:0]];
+                    }
+                    
                     self->bubbles = self->bubblesSnapshot;
+                    self->bubblesPositionIndex = self->bubblesSnapshotPositionIndex;
                     self->bubblesSnapshot = nil;
+                    self->bubblesSnapshotPositionIndex = nil;
                     
                     if (self.delegate)
                     {
-                        [self.delegate dataSource:self didCellChange:nil];
+                        [self notifyDelegateWithChangeSet:changeSet];
                     }
                     else
                     {
@@ -3039,7 +3253,17 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
         NSArray<MXReceiptData*> *readReceipts = [self.room getEventReceipts:eventId sorted:YES];
         if (readReceipts.count)
         {
-            NSInteger cellDataIndex = [cellDatas indexOfObject:cellData];
+            MXKRoomBubblePositionIndex *positionIndex;
+            if (cellDatas == bubblesSnapshot)
+            {
+                positionIndex = bubblesSnapshotPositionIndex;
+            }
+            else if (cellDatas == bubbles)
+            {
+                positionIndex = bubblesPositionIndex;
+            }
+
+            NSInteger cellDataIndex = [self indexOfCellData:cellData inCellDatas:cellDatas withPositionIndex:positionIndex];
             if (cellDataIndex != NSNotFound)
             {
                 [self addReadReceipts:readReceipts forEvent:eventId inCellDatas:cellDatas atCellDataIndex:cellDataIndex];
@@ -3048,6 +3272,92 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     }
 }
 
+/**
+ Get the position of a cell data in a list of cell datas.
+
+ The position index is used when it is consistent with the list. It is rebuilt otherwise
+ (subclasses may update `bubbles` without reporting it).
+
+ @param cellData the cell data.
+ @param cellDatas the list of cell datas.
+ @param positionIndex the position index of `cellDatas` if any.
+ @return the position of the cell data, or NSNotFound.
+ */
+- (NSUInteger)indexOfCellData:(id<MXKRoomBubbleCellDataStoring>)cellData inCellDatas:(NSArray<id<MXKRoomBubbleCellDataStoring>>*)cellDatas withPositionIndex:(MXKRoomBubblePositionIndex*)positionIndex
+{
+    if (!cellData)
+    {
+        return NSNotFound;
+    }
+    
+    if (positionIndex)
+    {
+        NSUInteger index = [positionIndex indexOfCellData:cellData];
+        if (index < cellDatas.count && cellDatas[index] == cellData)
+        {
+            return index;
+        }
+        else if (index == NSNotFound && positionIndex.count == cellDatas.count)
+        {
+            return NSNotFound;
+        }
+        
+        NSLog(@"[MXKRoomDataSource] indexOfCellData: Rebuild the out of sync position index");
+        [positionIndex resetWithCellDatas:cellDatas];
+        return [positionIndex indexOfCellData:cellData];
+    }
+    
+    return [cellDatas indexOfObject:cellData];
+}
+
+/**
+ Remove the heights computed for a cell data whose content changed.
+
+ @param cellData the updated cell data.
+ */
+- (void)removeCachedHeightsOfCellData:(id<MXKRoomBubbleCellDataStoring>)cellData
+{
+    if ([cellData isKindOfClass:MXKRoomBubbleCellData.class])
+    {
+        [((MXKRoomBubbleCellData*)cellData).heightCache removeAllHeights];
+    }
+}
+
+/**
+ Tell the delegate that some cell data have been updated in place.
+
+ Must be called on the main thread.
+
+ @param cellDatas the updated cell data.
+ */
+- (void)notifyDelegateWithUpdatedCellDatas:(NSArray<id<MXKRoomBubbleCellDataStoring>>*)cellDatas
+{
+    for (id<MXKRoomBubbleCellDataStoring> cellData in cellDatas)
+    {
+        [self removeCachedHeightsOfCellData:cellData];
+    }
+    
+    if (!self.delegate)
+    {
+        return;
+    }
+    
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    @synchronized(bubbles)
+    {
+        for (id<MXKRoomBubbleCellDataStoring> cellData in cellDatas)
+        {
+            NSUInteger index = [self indexOfCellData:cellData inCellDatas:bubbles withPositionIndex:bubblesPositionIndex];
+            if (index != NSNotFound)
+            {
+                [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:index inSection:0]];
+            }
+        }
+    }
+    
+    [self notifyDelegateWithChangeSet:changeSet];
+}
+
 - (void)addReadReceipts:(NSArray<MXReceiptData*> *)readReceipts forEvent:(NSString*)eventId inCellDatas:(NSArray<id<MXKRoomBubbleCellDataStoring>>*)cellDatas atCellDataIndex:(NSInteger)cellDataIndex
 {
     id<MXKRoomBubbleCellDataStoring> cellData = cellDatas[cellDataIndex];
@@ -3229,6 +3539,294 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     return cell;
 }
 
+#pragma mark - UITableViewDataSourcePrefetching
+
+- (void)tableView:(UITableView *)tableView prefetchRowsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths
+{
+    if (!_bubblesPrewarmingCount || !indexPaths.count)
+    {
+        return;
+    }
+    
+    NSArray<NSIndexPath*> *sortedIndexPaths = [indexPaths sortedArrayUsingSelector:@selector(compare:)];
+    NSInteger firstRow = sortedIndexPaths.firstObject.row;
+    NSInteger lastRow = sortedIndexPaths.lastObject.row;
+    
+    // Detect the scrolling direction. The pending work is useless when the user reverses it.
+    if (lastPrefetchedRow != NSNotFound)
+    {
+        BOOL backwards = (lastRow < lastPrefetchedRow);
+        if (backwards != isPrefetchingBackwards)
+        {
+            isPrefetchingBackwards = backwards;
+            [self cancelBubblesPrewarming];
+        }
+    }
+    lastPrefetchedRow = isPrefetchingBackwards ? firstRow : lastRow;
+    
+    // Prepare first the rows which are the closest to the visible ones
+    NSEnumerator<NSIndexPath*> *enumerator = isPrefetchingBackwards ? sortedIndexPaths.reverseObjectEnumerator : sortedIndexPaths.objectEnumerator;
+    
+    NSMutableArray<id<MXKRoomBubbleCellDataStoring>> *cellDatas = [NSMutableArray arrayWithCapacity:_bubblesPrewarmingCount];
+    for (NSIndexPath *indexPath in enumerator)
+    {
+        id<MXKRoomBubbleCellDataStoring> cellData = [self cellDataAtIndex:indexPath.row];
+        if (cellData)
+        {
+            [cellDatas addObject:cellData];
+        }
+        
+        if (cellDatas.count >= _bubblesPrewarmingCount)
+        {
+            break;
+        }
+    }
+    
+    [self prewarmCellDatas:cellDatas];
+}
+
+- (void)tableView:(UITableView *)tableView cancelPrefetchingForRowsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths
+{
+    NSHashTable *cellDatas = [NSHashTable weakObjectsHashTable];
+    for (NSIndexPath *indexPath in indexPaths)
+    {
+        id<MXKRoomBubbleCellDataStoring> cellData = [self cellDataAtIndex:indexPath.row];
+        if (cellData)
+        {
+            [cellDatas addObject:cellData];
+        }
+    }
+    
+    @synchronized(prewarmingTasks)
+    {
+        NSIndexSet *cancelledTasks = [prewarmingTasks indexesOfObjectsPassingTest:^BOOL(MXKRoomDataSourcePrewarmingTask *task, NSUInteger index, BOOL *stop) {
+            return [cellDatas containsObject:task->cellData];
+        }];
+        [prewarmingTasks removeObjectsAtIndexes:cancelledTasks];
+    }
+}
+
+#pragma mark - Bubbles prewarming
+
++ (dispatch_queue_t)prewarmingQueue
+{
+    static dispatch_queue_t prewarmingQueue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        prewarmingQueue = dispatch_queue_create("MXKRoomDataSource.prewarming", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    });
+    
+    return prewarmingQueue;
+}
+
+/**
+ Prewarm the bubbles inserted at the top of the list by a back pagination.
+ 
+ @param addedCellNumber the number of inserted bubbles.
+ */
+- (void)prewarmBubblesAddedByBackPagination:(NSUInteger)addedCellNumber
+{
+    if (!_bubblesPrewarmingCount || !addedCellNumber)
+    {
+        return;
+    }
+    
+    // The user is scrolling up to the new bubbles, prepare first the closest ones
+    NSMutableArray<id<MXKRoomBubbleCellDataStoring>> *cellDatas = [NSMutableArray arrayWithCapacity:_bubblesPrewarmingCount];
+    @synchronized(bubbles)
+    {
+        NSInteger index = MIN(addedCellNumber, bubbles.count);
+        while (index-- > 0 && cellDatas.count < _bubblesPrewarmingCount)
+        {
+            [cellDatas addObject:bubbles[index]];
+        }
+    }
+    
+    [self prewarmCellDatas:cellDatas];
+}
+
+/**
+ Measure the texts of some bubbles on the prewarming queue.
+ 
+ This method must be called on the main thread: the texts to measure are read from the bubbles here.
+ Only the text bubbles of cell view classes already measured with the current maximum width are prewarmed.
+ 
+ @param cellDatas the bubbles to prepare, in processing order.
+ */
+- (void)prewarmCellDatas:(NSArray<id<MXKRoomBubbleCellDataStoring>>*)cellDatas
+{
+    if (!cellDatas.count || !self.delegate)
+    {
+        return;
+    }
+    
+    NSMutableArray<MXKRoomDataSourcePrewarmingTask*> *tasks = [NSMutableArray arrayWithCapacity:cellDatas.count];
+    for (id<MXKRoomBubbleCellDataStoring> cellData in cellDatas)
+    {
+        MXKRoomDataSourcePrewarmingTask *task = [self prewarmingTaskForCellData:cellData];
+        if (task)
+        {
+            [tasks addObject:task];
+        }
+    }
+    
+    if (!tasks.count)
+    {
+        return;
+    }
+    
+    @synchronized(prewarmingTasks)
+    {
+        [prewarmingTasks addObjectsFromArray:tasks];
+        
+        if (isPrewarming)
+        {
+            // The running prewarming will handle them
+            return;
+        }
+        isPrewarming = YES;
+    }
+    
+    MXWeakify(self);
+    dispatch_async(MXKRoomDataSource.prewarmingQueue, ^{
+        
+        MXStrongifyAndReturnIfNil(self);
+        
+        while (YES)
+        {
+            MXKRoomDataSourcePrewarmingTask *task;
+            @synchronized(self->prewarmingTasks)
+            {
+                task = self->prewarmingTasks.firstObject;
+                if (!task)
+                {
+                    self->isPrewarming = NO;
+                    break;
+                }
+                [self->prewarmingTasks removeObjectAtIndex:0];
+            }
+            
+            // Format the text here, off the main thread
+            NSAttributedString *measuredText;
+            @synchronized (task->cellData)
+            {
+                task->attributedTextMessage = task->cellData.attributedTextMessage;
+                measuredText = [task->attributedTextMessage copy];
+            }
+            if (!measuredText.length)
+            {
+                continue;
+            }
+            
+            // Measure the text as the cell will do
+            task->contentSize = [MXKRoomBubbleCellData textContentSize:measuredText withMaxTextViewWidth:task->maxTextViewWidth removeVerticalInset:NO];
+            
+            // Publish the result on the main thread
+            dispatch_async(dispatch_get_main_queue(), ^{
+                
+                NSMutableDictionary<NSString*, MXKRoomDataSourcePrewarmingTask*> *tasksByKey = [self->prewarmedTasks objectForKey:task->cellData];
+                if (!tasksByKey)
+                {
+                    tasksByKey = [NSMutableDictionary dictionary];
+                    [self->prewarmedTasks setObject:tasksByKey forKey:task->cellData];
+                }
+                tasksByKey[task->key] = task;
+            });
+        }
+    });
+}
+
+/**
+ Prepare the measurement of the text of a bubble.
+ 
+ @param cellData the bubble to prepare.
+ @return the task to run on the prewarming queue, nil if the bubble cannot be or does not need to be prewarmed.
+ */
+- (MXKRoomDataSourcePrewarmingTask*)prewarmingTaskForCellData:(id<MXKRoomBubbleCellDataStoring>)cellData
+{
+    if (![cellData isKindOfClass:MXKRoomBubbleCellData.class])
+    {
+        return nil;
+    }
+    
+    MXKRoomBubbleCellData *roomBubbleCellData = (MXKRoomBubbleCellData*)cellData;
+    if (roomBubbleCellData.attachment)
+    {
+        return nil;
+    }
+    
+    // The measurement must be the one the bubble would do
+    if ([roomBubbleCellData methodForSelector:@selector(contentSize)] != [MXKRoomBubbleCellData instanceMethodForSelector:@selector(contentSize)]
+        || [roomBubbleCellData methodForSelector:@selector(textContentSize:removeVerticalInset:)] != [MXKRoomBubbleCellData instanceMethodForSelector:@selector(textContentSize:removeVerticalInset:)])
+    {
+        return nil;
+    }
+    
+    // Use the text view width applied by its cell view class
+    Class<MXKCellRendering> cellViewClass = [self.delegate cellViewClassForCellData:roomBubbleCellData];
+    NSString *key = [self prewarmingKeyForCellViewClass:cellViewClass withMaximumWidth:prewarmingMaxWidth];
+    NSNumber *maxTextViewWidth = prewarmingMaxTextViewWidths[key];
+    if (!maxTextViewWidth || [[prewarmedTasks objectForKey:roomBubbleCellData] objectForKey:key])
+    {
+        return nil;
+    }
+    
+    // The text is formatted on the prewarming queue
+    MXKRoomDataSourcePrewarmingTask *task = [[MXKRoomDataSourcePrewarmingTask alloc] init];
+    task->cellData = roomBubbleCellData;
+    task->key = key;
+    task->maxTextViewWidth = maxTextViewWidth.doubleValue;
+    return task;
+}
+
+/**
+ Apply to a bubble the text size measured in advance for a cell view class and a maximum width.
+ 
+ The measurement is used only if the text of the bubble has not changed since. It is consumed in any case.
+ 
+ @param cellData the bubble.
+ @param key the cell view class and maximum width key.
+ */
+- (void)applyPrewarmedTaskToCellData:(MXKRoomBubbleCellData*)cellData forKey:(NSString*)key
+{
+    NSMutableDictionary<NSString*, MXKRoomDataSourcePrewarmingTask*> *tasksByKey = [prewarmedTasks objectForKey:cellData];
+    MXKRoomDataSourcePrewarmingTask *task = tasksByKey[key];
+    if (!task)
+    {
+        return;
+    }
+    
+    [tasksByKey removeObjectForKey:key];
+    if (!tasksByKey.count)
+    {
+        [prewarmedTasks removeObjectForKey:cellData];
+    }
+    
+    if (!cellData.attachment && cellData.attributedTextMessage == task->attributedTextMessage)
+    {
+        // The cell keeps this content size if it applies the same text view width
+        cellData.maxTextViewWidth = task->maxTextViewWidth;
+        cellData.contentSize = task->contentSize;
+    }
+}
+
+// The key of the measurements done for a cell view class and a maximum cell width
+- (NSString*)prewarmingKeyForCellViewClass:(Class<MXKCellRendering>)cellViewClass withMaximumWidth:(CGFloat)maxWidth
+{
+    return [NSString stringWithFormat:@"%@|%.2f", NSStringFromClass(cellViewClass), maxWidth];
+}
+
+/**
+ Cancel the pending prewarming work.
+ */
+- (void)cancelBubblesPrewarming
+{
+    @synchronized(prewarmingTasks)
+    {
+        [prewarmingTasks removeAllObjects];
+    }
+}
+
 #pragma mark - Groups
 
 - (MXGroup *)groupWithGroupId:(NSString*)groupId
@@ -3289,7 +3887,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
     reactionsChangeListener = [self.mxSession.aggregations listenToReactionCountUpdateInRoom:self.roomId block:^(NSDictionary<NSString *,MXReactionCountChange *> * _Nonnull changes) {
         MXStrongifyAndReturnIfNil(self);
 
-        BOOL updated = NO;
+        NSMutableArray<id<MXKRoomBubbleCellDataStoring>> *updatedBubbleDatas = [NSMutableArray array];
         for (NSString *eventId in changes)
         {
             id<MXKRoomBubbleCellDataStoring> bubbleData = [self cellDataOfEventWithEventId:eventId];
@@ -3297,13 +3895,13 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
             {
                 // TODO: Be smarted and use changes[eventId]
                 [self updateCellDataReactions:bubbleData forEventId:eventId];
-                updated = YES;
+                [updatedBubbleDatas addObject:bubbleData];
             }
         }
 
-        if (updated)
+        if (updatedBubbleDatas.count)
         {
-            [self.delegate dataSource:self didCellChange:nil];
+            [self notifyDelegateWithUpdatedCellDatas:updatedBubbleDatas];
         }
     }];
 }
@@ -3456,10 +4054,7 @@ NSString *const kMXKRoomDataSourceTimelineErrorErrorKey = @"kMXKRoomDataSourceTi
                 // Update the delegate on main thread
                 dispatch_async(dispatch_get_main_queue(), ^{
 
-                    if (self.delegate)
-                    {
-                        [self.delegate dataSource:self didCellChange:nil];
-                    }
+                    [self notifyDelegateWithUpdatedCellDatas:@[bubbleData]];
 
                 });
             }
@@ -0,0 +1,60 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import <MatrixSDK/MatrixSDK.h>
+
+@class MXKRoomBubbleCellData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKRoomReadReceiptsIndex` records, for each user, the cell data and the event
+ under which the user's read receipt is currently displayed.
+
+ It lets a room data source move a read receipt without scanning all bubbles.
+ The index is fed by `[MXKRoomDataSource updateCellData:withReadReceipts:forEventId:]`.
+ */
+@interface MXKRoomReadReceiptsIndex : NSObject
+
+/**
+ Report a change of the read receipts displayed for an event.
+
+ @param cellData the cell data hosting the event.
+ @param readReceipts the new read receipts of the event (nil if none).
+ @param previousReadReceipts the read receipts displayed before the change (nil if none).
+ @param eventId the id of the event.
+ */
+- (void)cellData:(MXKRoomBubbleCellData*)cellData didUpdateReadReceipts:(nullable NSArray<MXReceiptData*>*)readReceipts previousReadReceipts:(nullable NSArray<MXReceiptData*>*)previousReadReceipts forEventId:(NSString*)eventId;
+
+/**
+ Get the cell data that currently displays the read receipt of a user.
+
+ @param userId the user id.
+ @param eventId the id of the event the read receipt is attached to in the cell data.
+ @return the cell data, nil if no read receipt is displayed for this user.
+ */
+- (nullable MXKRoomBubbleCellData*)cellDataWithReadReceiptOfUser:(NSString*)userId eventId:(NSString * _Nullable * _Nullable)eventId;
+
+/**
+ Forget all read receipts.
+ */
+- (void)removeAllReadReceipts;
+
+@end
+
+NS_ASSUME_NONNULL_END
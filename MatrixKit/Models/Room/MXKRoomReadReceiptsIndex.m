@@ -0,0 +1,102 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKRoomReadReceiptsIndex.h"
+
+#import "MXKRoomBubbleCellData.h"
+
+@interface MXKRoomReadReceiptsIndex ()
+{
+    /**
+     The event id under which the read receipt of each user is displayed.
+     */
+    NSMutableDictionary<NSString* /* userId */, NSString* /* eventId */> *eventIdByUserId;
+
+    /**
+     The cell data which displays the read receipt of each user.
+     */
+    NSMapTable<NSString* /* userId */, MXKRoomBubbleCellData*> *cellDataByUserId;
+}
+
+@end
+
+@implementation MXKRoomReadReceiptsIndex
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        eventIdByUserId = [NSMutableDictionary dictionary];
+        cellDataByUserId = [NSMapTable strongToWeakObjectsMapTable];
+    }
+    return self;
+}
+
+- (void)cellData:(MXKRoomBubbleCellData*)cellData didUpdateReadReceipts:(NSArray<MXReceiptData*>*)readReceipts previousReadReceipts:(NSArray<MXReceiptData*>*)previousReadReceipts forEventId:(NSString*)eventId
+{
+    @synchronized(self)
+    {
+        for (MXReceiptData *receiptData in previousReadReceipts)
+        {
+            // Forget the user only if the index still points to this location
+            if ([cellDataByUserId objectForKey:receiptData.userId] == cellData
+                && [eventIdByUserId[receiptData.userId] isEqualToString:eventId])
+            {
+                [cellDataByUserId removeObjectForKey:receiptData.userId];
+                [eventIdByUserId removeObjectForKey:receiptData.userId];
+            }
+        }
+
+        for (MXReceiptData *receiptData in readReceipts)
+        {
+            if (receiptData.userId)
+            {
+                [cellDataByUserId setObject:cellData forKey:receiptData.userId];
+                eventIdByUserId[receiptData.userId] = eventId;
+            }
+        }
+    }
+}
+
+- (MXKRoomBubbleCellData*)cellDataWithReadReceiptOfUser:(NSString*)userId eventId:(NSString**)eventId
+{
+    @synchronized(self)
+    {
+        MXKRoomBubbleCellData *cellData = [cellDataByUserId objectForKey:userId];
+        if (!cellData)
+        {
+            // The cell data has been released
+            [eventIdByUserId removeObjectForKey:userId];
+        }
+        else if (eventId)
+        {
+            *eventId = eventIdByUserId[userId];
+        }
+        return cellData;
+    }
+}
+
+- (void)removeAllReadReceipts
+{
+    @synchronized(self)
+    {
+        [eventIdByUserId removeAllObjects];
+        [cellDataByUserId removeAllObjects];
+    }
+}
+
+@end
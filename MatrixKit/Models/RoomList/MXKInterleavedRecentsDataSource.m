@@ -18,6 +18,7 @@
 #import "MXKInterleavedRecentsDataSource.h"
 
 #import "MXKInterleavedRecentTableViewCell.h"
+#import "MXKRecentsOrderedIndex.h"
 
 #import "MXKAccountManager.h"
 
@@ -28,7 +29,12 @@
     /**
      The interleaved recents: cell data served by `MXKInterleavedRecentsDataSource`.
      */
-    NSMutableArray *interleavedCellDataArray;
+    MXKRecentsOrderedIndex *interleavedCellDataIndex;
+    
+    /**
+     The ordered cell data of each interleaved recents data source, as they were interleaved.
+     */
+    NSMapTable<MXKSessionRecentsDataSource*, NSMutableArray<id<MXKRecentCellDataStoring>>*> *interleavedCellDataArrays;
 }
 
 @end
@@ -40,7 +46,10 @@
     self = [super init];
     if (self)
     {
-        interleavedCellDataArray = [NSMutableArray array];
+        interleavedCellDataIndex = [[MXKRecentsOrderedIndex alloc] init];
+        interleavedCellDataIndex.interleavesRecentsDataSources = YES;
+        
+        interleavedCellDataArrays = [NSMapTable strongToStrongObjectsMapTable];
     }
     return self;
 }
@@ -49,7 +58,8 @@
 
 - (void)destroy
 {
-    interleavedCellDataArray = nil;
+    interleavedCellDataIndex = nil;
+    interleavedCellDataArrays = nil;
     
     [super destroy];
 }
@@ -202,9 +212,9 @@
             cellData = [recentsDataSource cellDataAtIndex:indexPath.row];
         }
         // Else all the cells have been interleaved.
-        else if (indexPath.row < interleavedCellDataArray.count)
+        else
         {
-            cellData = interleavedCellDataArray[indexPath.row];
+            cellData = [interleavedCellDataIndex cellDataAtIndex:indexPath.row];
         }
     }
     
@@ -225,26 +235,20 @@
             height = [recentsDataSource cellHeightAtIndex:indexPath.row];
         }
         // Else all the cells have been interleaved.
-        else if (indexPath.row < interleavedCellDataArray.count)
+        else
         {
-            id<MXKRecentCellDataStoring> recentCellData = interleavedCellDataArray[indexPath.row];
+            id<MXKRecentCellDataStoring> recentCellData = [interleavedCellDataIndex cellDataAtIndex:indexPath.row];
             
             // Select the related recent data source
             MXKSessionRecentsDataSource *recentsDataSource = recentCellData.recentsDataSource;
             if (recentsDataSource)
             {
-                // Count the index of this cell data in original data source array
-                NSInteger rank = 0;
-                for (NSInteger index = 0; index < indexPath.row; index++)
+                // Retrieve the index of this cell data in original data source array
+                NSUInteger rank = [[interleavedCellDataArrays objectForKey:recentsDataSource] indexOfObjectIdenticalTo:recentCellData];
+                if (rank != NSNotFound)
                 {
-                    id<MXKRecentCellDataStoring> cellData = interleavedCellDataArray[index];
-                    if (cellData.roomSummary == recentCellData.roomSummary)
-                    {
-                        rank++;
-                    }
+                    height = [recentsDataSource cellHeightAtIndex:rank];
                 }
-                
-                height = [recentsDataSource cellHeightAtIndex:rank];
             }
         }
     }
@@ -256,53 +260,66 @@
 {
     NSIndexPath *indexPath = nil;
     
+    // Look for the right data source
+    MXKSessionRecentsDataSource *recentsDataSource = [self recentsDataSourceForMatrixSession:matrixSession];
+    if (!recentsDataSource || [displayedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
+    {
+        return nil;
+    }
+    
     // Consider first the case where there is only one data source (no interleaving).
     if (displayedRecentsDataSourceArray.count == 1)
     {
-        MXKSessionRecentsDataSource *recentsDataSource = displayedRecentsDataSourceArray.firstObject;
-        if (recentsDataSource.mxSession == matrixSession)
+        NSUInteger index = [recentsDataSource cellIndexWithRoomId:roomId];
+        if (index != NSNotFound)
         {
-            // Look for the cell
-            for (NSInteger index = 0; index < recentsDataSource.numberOfCells; index ++)
-            {
-                id<MXKRecentCellDataStoring> recentCellData = [recentsDataSource cellDataAtIndex:index];
-                if ([roomId isEqualToString:recentCellData.roomSummary.roomId])
-                {
-                    // Got it
-                    indexPath = [NSIndexPath indexPathForRow:index inSection:0];
-                    break;
-                }
-            }
+            indexPath = [NSIndexPath indexPathForRow:index inSection:0];
         }
     }
-    else
+    // Check whether the source is not shrinked
+    else if ([shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
     {
-        // Look for the right data source
-        for (MXKSessionRecentsDataSource *recentsDataSource in displayedRecentsDataSourceArray)
+        NSUInteger index = [interleavedCellDataIndex indexOfCellDataWithRoomId:roomId inRecentsDataSource:recentsDataSource];
+        if (index != NSNotFound)
         {
-            if (recentsDataSource.mxSession == matrixSession)
+            indexPath = [NSIndexPath indexPathForRow:index inSection:0];
+        }
+    }
+    
+    return indexPath;
+}
+
+- (BOOL)checkCellDataConsistency
+{
+    BOOL isConsistent = [super checkCellDataConsistency];
+    
+    if (displayedRecentsDataSourceArray.count > 1)
+    {
+        isConsistent = [interleavedCellDataIndex checkConsistency] && isConsistent;
+        
+        // The interleaved cells are the ones of the interleaved data sources
+        NSUInteger interleavedCount = 0;
+        for (MXKSessionRecentsDataSource *recentsDataSource in interleavedCellDataArrays)
+        {
+            for (id<MXKRecentCellDataStoring> cellData in [interleavedCellDataArrays objectForKey:recentsDataSource])
             {
-                // Check whether the source is not shrinked
-                if ([shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
+                if ([interleavedCellDataIndex indexOfCellData:cellData] == NSNotFound)
                 {
-                    // Look for the cell
-                    for (NSInteger index = 0; index < interleavedCellDataArray.count; index ++)
-                    {
-                        id<MXKRecentCellDataStoring> recentCellData = interleavedCellDataArray[index];
-                        if ([roomId isEqualToString:recentCellData.roomSummary.roomId])
-                        {
-                            // Got it
-                            indexPath = [NSIndexPath indexPathForRow:index inSection:0];
-                            break;
-                        }
-                    }
+                    NSLog(@"[MXKInterleavedRecentsDataSource] checkCellDataConsistency: The room %@ is not interleaved", cellData.roomSummary.roomId);
+                    isConsistent = NO;
                 }
-                break;
+                interleavedCount++;
             }
         }
+        
+        if (interleavedCount != interleavedCellDataIndex.count)
+        {
+            NSLog(@"[MXKInterleavedRecentsDataSource] checkCellDataConsistency: %tu interleaved cells but %tu cells in the interleaved data sources", interleavedCellDataIndex.count, interleavedCount);
+            isConsistent = NO;
+        }
     }
     
-    return indexPath;
+    return isConsistent;
 }
 
 #pragma mark - UITableViewDataSource
@@ -327,7 +344,7 @@
         return recentsDataSource.numberOfCells;
     }
     
-    return interleavedCellDataArray.count;
+    return interleavedCellDataIndex.count;
 }
 
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath
@@ -362,86 +379,192 @@
 
 #pragma mark - MXKDataSourceDelegate
 
+- (void)dataSource:(MXKDataSource*)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet*)changeSet
+{
+    // Apply incrementally the change set of an interleaved data source
+    if (displayedRecentsDataSourceArray.count > 1)
+    {
+        MXKDataSourceChangeSet *interleavedChangeSet = [self interleaveChangeSet:changeSet ofRecentsDataSource:(MXKSessionRecentsDataSource*)dataSource];
+        if (interleavedChangeSet)
+        {
+            // Go through the legacy callback so that inherited classes which override it are still notified
+            pendingChangeSet = interleavedChangeSet;
+            [self dataSource:dataSource didCellChange:nil];
+            pendingChangeSet = nil;
+            return;
+        }
+    }
+    
+    // Else the cells are interleaved again, or the change set is forwarded as is when there is no interleaving.
+    [super dataSource:dataSource didCellChangeWithChangeSet:changeSet];
+}
+
 - (void)dataSource:(MXKDataSource*)dataSource didCellChange:(id)changes
 {
     // Consider first the case where there is only one data source (no interleaving).
     if (displayedRecentsDataSourceArray.count == 1)
     {
-        // Flush interleaved cells array, we will refer directly to the cell data of the unique data source.
-        [interleavedCellDataArray removeAllObjects];
+        // Flush interleaved cells, we will refer directly to the cell data of the unique data source.
+        [interleavedCellDataIndex removeAllCellData];
+        [interleavedCellDataArrays removeAllObjects];
     }
-    else
+    else if (!pendingChangeSet)
+    {
+        // The interleaved cells are up to date when a change set is pending
+        [self interleaveAllCellData];
+    }
+    
+    // Call super to keep update readyRecentsDataSourceArray.
+    [super dataSource:dataSource didCellChange:changes];
+}
+
+#pragma mark - Private methods
+
+// Merge the ordered cell data of the displayed data sources which are not shrinked
+- (void)interleaveAllCellData
+{
+    [interleavedCellDataArrays removeAllObjects];
+    
+    NSMutableArray *sortedCellDataArrays = [NSMutableArray arrayWithCapacity:displayedRecentsDataSourceArray.count];
+    for (MXKSessionRecentsDataSource *recentsDataSource in displayedRecentsDataSourceArray)
     {
-        // Handle here the specific case where a second source is just added.
-        // The empty interleaved cells array has to be prefilled with the cell data of the other source (except if this other source is shrinked).
-        if (!interleavedCellDataArray.count && displayedRecentsDataSourceArray.count == 2)
+        if ([shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
         {
-            // This is the first interleaving, look for the other source
-            MXKSessionRecentsDataSource *recentsDataSource = displayedRecentsDataSourceArray.firstObject;
-            if (recentsDataSource == dataSource)
+            NSMutableArray *cellDataArray = [NSMutableArray arrayWithCapacity:recentsDataSource.numberOfCells];
+            for (NSInteger index = 0; index < recentsDataSource.numberOfCells; index ++)
             {
-                recentsDataSource = displayedRecentsDataSourceArray.lastObject;
+                [cellDataArray addObject:[recentsDataSource cellDataAtIndex:index]];
             }
             
-            if ([shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
-            {
-                // Report all cell data
-                for (NSInteger index = 0; index < recentsDataSource.numberOfCells; index ++)
-                {
-                    [interleavedCellDataArray addObject:[recentsDataSource cellDataAtIndex:index]];
-                }
-            }
+            [interleavedCellDataArrays setObject:cellDataArray forKey:recentsDataSource];
+            [sortedCellDataArrays addObject:cellDataArray];
         }
-        
-        // Update now interleaved cells array, TODO take into account 'changes' parameter
-        MXKSessionRecentsDataSource *updateRecentsDataSource = (MXKSessionRecentsDataSource*)dataSource;
-        NSInteger numberOfUpdatedCells = 0;
-        // Check whether this dataSource is used
-        if ([displayedRecentsDataSourceArray indexOfObject:dataSource] != NSNotFound && [shrinkedRecentsDataSourceArray indexOfObject:dataSource] == NSNotFound)
+    }
+    
+    // The lists are already ordered, a k-way merge is enough
+    [interleavedCellDataIndex setAllCellDataWithSortedArrays:sortedCellDataArrays];
+}
+
+// Apply the change set of a data source to the interleaved cells.
+// Return the change set of the interleaved cells, nil if the change set cannot be applied incrementally.
+- (MXKDataSourceChangeSet*)interleaveChangeSet:(MXKDataSourceChangeSet*)changeSet ofRecentsDataSource:(MXKSessionRecentsDataSource*)recentsDataSource
+{
+    NSMutableArray<id<MXKRecentCellDataStoring>> *cellDataArray = [interleavedCellDataArrays objectForKey:recentsDataSource];
+    
+    // The data source must stay displayed, with the same cells as when they were interleaved
+    if (!cellDataArray || self.state != MXKDataSourceStateReady || !recentsDataSource.numberOfCells
+        || ![changeSet isValidForNumberOfRows:cellDataArray.count newNumberOfRows:recentsDataSource.numberOfCells])
+    {
+        return nil;
+    }
+    
+    // Retrieve the interleaved positions of the changed cells before any change
+    NSMutableArray<id<MXKRecentCellDataStoring>> *removedCellData = [NSMutableArray array];
+    NSMutableArray<NSNumber*> *deletedIndexes = [NSMutableArray array];
+    NSMutableArray<NSNumber*> *changedIndexes = [NSMutableArray array];
+    NSMutableArray<id<MXKRecentCellDataStoring>> *changedCellData = [NSMutableArray array];
+    NSMutableArray<id<MXKRecentCellDataStoring>> *insertedCellData = [NSMutableArray array];
+    NSMutableIndexSet *removedRows = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *insertedRows = [NSMutableIndexSet indexSet];
+    
+    for (NSIndexPath *indexPath in changeSet.deletedIndexPaths)
+    {
+        NSUInteger index = [interleavedCellDataIndex indexOfCellData:cellDataArray[indexPath.row]];
+        if (index == NSNotFound)
         {
-            numberOfUpdatedCells = updateRecentsDataSource.numberOfCells;
+            return nil;
         }
         
-        NSInteger currentCellIndex = 0;
-        NSInteger updatedCellIndex = 0;
-        id<MXKRecentCellDataStoring> updatedCellData = nil;
-        
-        if (numberOfUpdatedCells)
+        [removedCellData addObject:cellDataArray[indexPath.row]];
+        [deletedIndexes addObject:@(index)];
+        [removedRows addIndex:indexPath.row];
+    }
+    
+    for (NSIndexPath *indexPath in changeSet.updatedIndexPaths)
+    {
+        NSUInteger index = [interleavedCellDataIndex indexOfCellData:cellDataArray[indexPath.row]];
+        if (index == NSNotFound)
         {
-            updatedCellData = [updateRecentsDataSource cellDataAtIndex:updatedCellIndex++];
+            return nil;
         }
         
-        // Review all cell data items of the current list
-        while (currentCellIndex < interleavedCellDataArray.count)
+        [removedCellData addObject:cellDataArray[indexPath.row]];
+        [changedIndexes addObject:@(index)];
+        [changedCellData addObject:[recentsDataSource cellDataAtIndex:indexPath.row]];
+    }
+    
+    for (NSIndexPath *fromIndexPath in changeSet.movedIndexPaths)
+    {
+        NSIndexPath *toIndexPath = changeSet.movedIndexPaths[fromIndexPath];
+        NSUInteger index = [interleavedCellDataIndex indexOfCellData:cellDataArray[fromIndexPath.row]];
+        if (index == NSNotFound)
         {
-            id<MXKRecentCellDataStoring> currentCellData = interleavedCellDataArray[currentCellIndex];
-            
-            // Remove existing cell data of the updated data source
-            if (currentCellData.recentsDataSource == dataSource)
-            {
-                [interleavedCellDataArray removeObjectAtIndex:currentCellIndex];
-            }
-            else
-            {
-                while (updatedCellData && (updatedCellData.lastEvent.originServerTs > currentCellData.lastEvent.originServerTs))
-                {
-                    [interleavedCellDataArray insertObject:updatedCellData atIndex:currentCellIndex++];
-                    updatedCellData = [updateRecentsDataSource cellDataAtIndex:updatedCellIndex++];
-                }
-                
-                currentCellIndex++;
-            }
+            return nil;
         }
         
-        while (updatedCellData)
+        [removedCellData addObject:cellDataArray[fromIndexPath.row]];
+        [changedIndexes addObject:@(index)];
+        [changedCellData addObject:[recentsDataSource cellDataAtIndex:toIndexPath.row]];
+        [removedRows addIndex:fromIndexPath.row];
+        [insertedRows addIndex:toIndexPath.row];
+    }
+    
+    for (NSIndexPath *indexPath in changeSet.insertedIndexPaths)
+    {
+        [insertedCellData addObject:[recentsDataSource cellDataAtIndex:indexPath.row]];
+        [insertedRows addIndex:indexPath.row];
+    }
+    
+    // Update the cell data of the data source as they are interleaved
+    for (NSIndexPath *indexPath in changeSet.updatedIndexPaths)
+    {
+        cellDataArray[indexPath.row] = [recentsDataSource cellDataAtIndex:indexPath.row];
+    }
+    [cellDataArray removeObjectsAtIndexes:removedRows];
+    [insertedRows enumerateIndexesUsingBlock:^(NSUInteger row, BOOL *stop) {
+        [cellDataArray insertObject:[recentsDataSource cellDataAtIndex:row] atIndex:row];
+    }];
+    
+    // Reinsert the changed cell data at their new position
+    for (id<MXKRecentCellDataStoring> cellData in removedCellData)
+    {
+        [interleavedCellDataIndex removeCellData:cellData];
+    }
+    for (id<MXKRecentCellDataStoring> cellData in changedCellData)
+    {
+        [interleavedCellDataIndex addCellData:cellData];
+    }
+    for (id<MXKRecentCellDataStoring> cellData in insertedCellData)
+    {
+        [interleavedCellDataIndex addCellData:cellData];
+    }
+    
+    // Report the changes with the interleaved positions
+    MXKDataSourceChangeSet *interleavedChangeSet = [[MXKDataSourceChangeSet alloc] init];
+    for (NSNumber *index in deletedIndexes)
+    {
+        [interleavedChangeSet addDeletedIndexPath:[NSIndexPath indexPathForRow:index.unsignedIntegerValue inSection:0]];
+    }
+    for (NSUInteger change = 0; change < changedCellData.count; change++)
+    {
+        NSUInteger fromIndex = changedIndexes[change].unsignedIntegerValue;
+        NSUInteger toIndex = [interleavedCellDataIndex indexOfCellData:changedCellData[change]];
+        if (fromIndex == toIndex)
         {
-            [interleavedCellDataArray addObject:updatedCellData];
-            updatedCellData = [updateRecentsDataSource cellDataAtIndex:updatedCellIndex++];
+            [interleavedChangeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:fromIndex inSection:0]];
         }
+        else
+        {
+            [interleavedChangeSet addMoveFromIndexPath:[NSIndexPath indexPathForRow:fromIndex inSection:0]
+                                           toIndexPath:[NSIndexPath indexPathForRow:toIndex inSection:0]];
+        }
+    }
+    for (id<MXKRecentCellDataStoring> cellData in insertedCellData)
+    {
+        [interleavedChangeSet addInsertedIndexPath:[NSIndexPath indexPathForRow:[interleavedCellDataIndex indexOfCellData:cellData] inSection:0]];
     }
     
-    // Call super to keep update readyRecentsDataSourceArray.
-    [super dataSource:dataSource didCellChange:changes];
+    return interleavedChangeSet;
 }
 
 @end
@@ -19,6 +19,7 @@
 
 #import "MXKSessionRecentsDataSource.h"
 #import "MXEvent+MatrixKit.h"
+#import "MXKEventFormatter.h"
 
 @implementation MXKRecentCellData
 @synthesize roomSummary, recentsDataSource, lastEvent, roomDisplayname, lastEventTextMessage, lastEventAttributedTextMessage, lastEventDate;
@@ -60,8 +61,20 @@
     lastEventAttributedTextMessage = nil;
 }
 
+- (NSAttributedString*)lastEventAttributedTextMessage
+{
+    if (!lastEventAttributedTextMessage)
+    {
+        // The preview may not have been rendered yet
+        [self renderLastMessageIfNeeded];
+        lastEventAttributedTextMessage = roomSummary.lastMessageAttributedString;
+    }
+    return lastEventAttributedTextMessage;
+}
+
 - (NSString*)lastEventDate
 {
+    [self renderLastMessageIfNeeded];
     return (NSString*)roomSummary.lastMessageOthers[@"lastEventDate"];
 }
 
@@ -90,6 +103,17 @@
     [roomSummary markAllAsRead];
 }
 
+#pragma mark - Private methods
+
+- (void)renderLastMessageIfNeeded
+{
+    id<MXRoomSummaryUpdating> updater = roomSummary.mxSession.roomSummaryUpdateDelegate;
+    if ([updater isKindOfClass:MXKEventFormatter.class])
+    {
+        [(MXKEventFormatter*)updater renderLastMessageIfNeededForRoomSummary:roomSummary];
+    }
+}
+
 - (NSString*)description
 {
     return [NSString stringWithFormat:@"%@ %@: %@ - %@", super.description, self.roomSummary.roomId, self.roomDisplayname, self.lastEventTextMessage];
@@ -35,6 +35,12 @@
      Array of shrinked sources. Sub-list of displayedRecentsDataSourceArray.
      */
     NSMutableArray *shrinkedRecentsDataSourceArray;
+    
+    /**
+     The change set of the displayed cells, while it is being forwarded through `dataSource:didCellChange:`.
+     It is the change set of the data source displayed alone, or the one computed by an inherited class.
+     */
+    MXKDataSourceChangeSet *pendingChangeSet;
 }
 
 /**
@@ -111,6 +117,23 @@
  */
 - (CGFloat)cellHeightAtIndexPath:(NSIndexPath*)indexPath;
 
+/**
+ Get the recents data source of a matrix session.
+
+ @param mxSession the matrix session.
+ @return the recents data source, nil if the session has not been added.
+ */
+- (MXKSessionRecentsDataSource*)recentsDataSourceForMatrixSession:(MXSession*)mxSession;
+
+/**
+ Get the cell data related to the provided roomId and session.
+
+ @param roomId the room identifier.
+ @param mxSession the matrix session in which the room should be available.
+ @return the cell data, nil if the room is not in the recents of the session.
+ */
+- (id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString*)roomId andMatrixSession:(MXSession*)mxSession;
+
 /**
  Get the index path of the cell related to the provided roomId and session.
  
@@ -120,6 +143,17 @@
  */
 - (NSIndexPath*)cellIndexPathWithRoomId:(NSString*)roomId andMatrixSession:(MXSession*)mxSession;
 
+/**
+ Check that the recents data sources and their lookup by session are consistent,
+ and that the cell data of each recents data source are consistent (see `[MXKSessionRecentsDataSource checkCellDataConsistency]`).
+
+ This check goes through all the cell data, it is intended for tests and debugging.
+ The inconsistencies are logged.
+
+ @return YES if the cell data are consistent.
+ */
+- (BOOL)checkCellDataConsistency;
+
 /**
  Returns the room at the index path
  
@@ -35,6 +35,11 @@
      Array of `MXKSessionRecentsDataSource` instances (one by matrix session).
      */
     NSMutableArray *recentsDataSourceArray;
+    
+    /**
+     The `MXKSessionRecentsDataSource` instances by matrix session.
+     */
+    NSMapTable<MXSession*, MXKSessionRecentsDataSource*> *recentsDataSourcesBySession;
 }
 
 @end
@@ -48,6 +53,7 @@
     {
         mxSessionArray = [NSMutableArray array];
         recentsDataSourceArray = [NSMutableArray array];
+        recentsDataSourcesBySession = [NSMapTable strongToStrongObjectsMapTable];
         
         displayedRecentsDataSourceArray = [NSMutableArray array];
         shrinkedRecentsDataSourceArray = [NSMutableArray array];
@@ -83,6 +89,7 @@
         
         recentsDataSource.delegate = self;
         [recentsDataSourceArray addObject:recentsDataSource];
+        [recentsDataSourcesBySession setObject:recentsDataSource forKey:matrixSession];
         
         [recentsDataSource finalizeInitialization];
         
@@ -112,6 +119,7 @@
             
             [recentsDataSourceArray removeObjectAtIndex:index];
             [mxSessionArray removeObjectAtIndex:index];
+            [recentsDataSourcesBySession removeObjectForKey:matrixSession];
             
             // Loop on 'didCellChange' method to let inherited 'MXKRecentsDataSource' class handle this removed data source.
             [self dataSource:recentsDataSource didCellChange:nil];
@@ -198,6 +206,7 @@
     }
     displayedRecentsDataSourceArray = nil;
     recentsDataSourceArray = nil;
+    recentsDataSourcesBySession = nil;
     shrinkedRecentsDataSourceArray = nil;
     mxSessionArray = nil;
     
@@ -336,38 +345,65 @@
     return 0;
 }
 
+- (MXKSessionRecentsDataSource*)recentsDataSourceForMatrixSession:(MXSession*)matrixSession
+{
+    return matrixSession ? [recentsDataSourcesBySession objectForKey:matrixSession] : nil;
+}
+
+- (id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString*)roomId andMatrixSession:(MXSession*)matrixSession
+{
+    return [[self recentsDataSourceForMatrixSession:matrixSession] cellDataWithRoomId:roomId];
+}
+
 - (NSIndexPath*)cellIndexPathWithRoomId:(NSString*)roomId andMatrixSession:(MXSession*)matrixSession
 {
     NSIndexPath *indexPath = nil;
     
     // Look for the right data source
-    for (NSInteger section = 0; section < displayedRecentsDataSourceArray.count; section++)
+    MXKSessionRecentsDataSource *recentsDataSource = [self recentsDataSourceForMatrixSession:matrixSession];
+    NSUInteger section = recentsDataSource ? [displayedRecentsDataSourceArray indexOfObject:recentsDataSource] : NSNotFound;
+    
+    // Check whether the source is displayed and not shrinked
+    if (section != NSNotFound && [shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
     {
-        MXKSessionRecentsDataSource *recentsDataSource = displayedRecentsDataSourceArray[section];
-        if (recentsDataSource.mxSession == matrixSession)
+        NSUInteger index = [recentsDataSource cellIndexWithRoomId:roomId];
+        if (index != NSNotFound)
         {
-            // Check whether the source is not shrinked
-            if ([shrinkedRecentsDataSourceArray indexOfObject:recentsDataSource] == NSNotFound)
-            {
-                // Look for the cell
-                for (NSInteger index = 0; index < recentsDataSource.numberOfCells; index ++)
-                {
-                    id<MXKRecentCellDataStoring> recentCellData = [recentsDataSource cellDataAtIndex:index];
-                    if ([roomId isEqualToString:recentCellData.roomSummary.roomId])
-                    {
-                        // Got it
-                        indexPath = [NSIndexPath indexPathForRow:index inSection:section];
-                        break;
-                    }
-                }
-            }
-            break;
+            indexPath = [NSIndexPath indexPathForRow:index inSection:section];
         }
     }
     
     return indexPath;
 }
 
+- (BOOL)checkCellDataConsistency
+{
+    BOOL isConsistent = YES;
+    
+    if (recentsDataSourcesBySession.count != recentsDataSourceArray.count)
+    {
+        NSLog(@"[MXKRecentsDataSource] checkCellDataConsistency: %tu recents data sources but %tu indexed sessions", recentsDataSourceArray.count, recentsDataSourcesBySession.count);
+        isConsistent = NO;
+    }
+    
+    for (NSUInteger index = 0; index < recentsDataSourceArray.count; index++)
+    {
+        MXKSessionRecentsDataSource *recentsDataSource = recentsDataSourceArray[index];
+        if ([recentsDataSourcesBySession objectForKey:mxSessionArray[index]] != recentsDataSource)
+        {
+            NSLog(@"[MXKRecentsDataSource] checkCellDataConsistency: The recents data source %tu is not indexed for its session", index);
+            isConsistent = NO;
+        }
+        
+        if (![recentsDataSource checkCellDataConsistency])
+        {
+            isConsistent = NO;
+        }
+    }
+    
+    return isConsistent;
+}
+
 #pragma mark - UITableViewDataSource
 
 - (NSInteger)numberOfSectionsInTableView:(UITableView *)tableView
@@ -475,8 +511,27 @@
     return nil;
 }
 
+- (void)dataSource:(MXKDataSource*)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet*)changeSet
+{
+    // The change set is forwarded as is only when the data source is displayed alone, in the first section.
+    // Go through the legacy callback so that inherited classes which override it are still notified.
+    if (displayedRecentsDataSourceArray.count == 1 && displayedRecentsDataSourceArray.firstObject == dataSource
+        && [shrinkedRecentsDataSourceArray indexOfObject:dataSource] == NSNotFound)
+    {
+        pendingChangeSet = changeSet;
+    }
+    
+    [self dataSource:dataSource didCellChange:nil];
+    
+    pendingChangeSet = nil;
+}
+
 - (void)dataSource:(MXKDataSource*)dataSource didCellChange:(id)changes
 {
+    // The change set, if any, is obsolete if the displayed data sources change
+    MXKDataSourceChangeSet *changeSet = pendingChangeSet;
+    pendingChangeSet = nil;
+    
     // Keep update readyRecentsDataSourceArray by checking number of cells
     if (dataSource.state == MXKDataSourceStateReady)
     {
@@ -507,7 +562,14 @@
     }
     
     // Notify delegate
-    [self.delegate dataSource:self didCellChange:changes];
+    if (changeSet)
+    {
+        [self notifyDelegateWithChangeSet:changeSet];
+    }
+    else
+    {
+        [self.delegate dataSource:self didCellChange:changes];
+    }
 }
 
 - (void)dataSource:(MXKDataSource*)dataSource didStateChange:(MXKDataSourceState)state
@@ -0,0 +1,175 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "MXKRecentCellDataStoring.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKRecentsOrderedIndex` keeps the recent cell data ordered by the timestamp of their last event
+ (the most recent first), with a direct access by room id.
+
+ The cell data are kept in a sorted array: a room is found, removed and reinserted with binary searches.
+ The sort key of a cell data is captured when it is added, so that the index remains consistent even if
+ the cell data updates its last event in place. A changed room must then be removed and added again.
+
+ Rooms with the same last event timestamp are ordered by room id.
+ */
+@interface MXKRecentsOrderedIndex : NSObject
+
+/**
+ Tell whether the index interleaves the cell data of several recents data sources (one by session).
+ In this case, a cell data is identified by its room id and its recents data source, and the room id based
+ methods must not be used. It must be set before adding cell data. Default is NO.
+ */
+@property (nonatomic) BOOL interleavesRecentsDataSources;
+
+/**
+ The number of indexed cell data.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ The number of full sorts of the cell data since the creation of the index.
+ */
+@property (nonatomic, readonly) NSUInteger sortCount;
+
+/**
+ The number of `addCellDataArray:` calls since the creation of the index.
+ */
+@property (nonatomic, readonly) NSUInteger addCellDataArrayCount;
+
+/**
+ The ordered cell data.
+ */
+@property (nonatomic, readonly) NSArray<id<MXKRecentCellDataStoring>> *allCellData;
+
+/**
+ Replace the content of the index.
+
+ @param cellDataArray the cell data to index, in any order.
+ */
+- (void)setAllCellData:(NSArray<id<MXKRecentCellDataStoring>> *)cellDataArray;
+
+/**
+ Replace the content of the index by merging already ordered lists.
+
+ The lists are merged in O(n * k) for k lists (k-way merge), the cell data are sorted again only if a list
+ is actually not ordered.
+
+ @param sortedCellDataArrays the lists of cell data, each ordered by last event timestamp (the most recent first).
+ */
+- (void)setAllCellDataWithSortedArrays:(NSArray<NSArray<id<MXKRecentCellDataStoring>> *> *)sortedCellDataArrays;
+
+/**
+ Get the cell data at the given position.
+
+ @param index the position in the ordered cell data.
+ @return the cell data, nil if the index is out of bounds.
+ */
+- (nullable id<MXKRecentCellDataStoring>)cellDataAtIndex:(NSUInteger)index;
+
+/**
+ Get the cell data of a room.
+
+ @param roomId the room id.
+ @return the cell data, nil if the room is not indexed.
+ */
+- (nullable id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString *)roomId;
+
+/**
+ Get the position of the cell data of a room.
+
+ @param roomId the room id.
+ @return the position in the ordered cell data, NSNotFound if the room is not indexed.
+ */
+- (NSUInteger)indexOfCellDataWithRoomId:(NSString *)roomId;
+
+/**
+ Get the position of the cell data of a room in an interleaved recents data source
+ (see `interleavesRecentsDataSources`).
+
+ @param roomId the room id.
+ @param recentsDataSource the recents data source of the cell data.
+ @return the position in the ordered cell data, NSNotFound if the room is not indexed for this data source.
+ */
+- (NSUInteger)indexOfCellDataWithRoomId:(NSString *)roomId inRecentsDataSource:(MXKSessionRecentsDataSource *)recentsDataSource;
+
+/**
+ Get the position of a cell data, or of the cell data indexed for the same room.
+
+ @param cellData the cell data.
+ @return the position in the ordered cell data, NSNotFound if the room is not indexed.
+ */
+- (NSUInteger)indexOfCellData:(id<MXKRecentCellDataStoring>)cellData;
+
+/**
+ Add a cell data at its position.
+
+ An existing cell data for the same room is replaced.
+
+ @param cellData the cell data to add.
+ @return the position of the added cell data.
+ */
+- (NSUInteger)addCellData:(id<MXKRecentCellDataStoring>)cellData;
+
+/**
+ Add a set of cell data in one ordering pass.
+
+ Existing cell data for the same rooms are replaced. A few cell data are inserted at their position,
+ a large set is appended before sorting all the cell data once.
+
+ @param cellDataArray the cell data to add.
+ */
+- (void)addCellDataArray:(NSArray<id<MXKRecentCellDataStoring>> *)cellDataArray;
+
+/**
+ Remove the cell data of a room.
+
+ @param roomId the room id.
+ @return the position the cell data had before its removal, NSNotFound if the room was not indexed.
+ */
+- (NSUInteger)removeCellDataWithRoomId:(NSString *)roomId;
+
+/**
+ Remove a cell data, or the cell data indexed for the same room.
+
+ @param cellData the cell data.
+ @return the position the cell data had before its removal, NSNotFound if the room was not indexed.
+ */
+- (NSUInteger)removeCellData:(id<MXKRecentCellDataStoring>)cellData;
+
+/**
+ Remove all the cell data.
+ */
+- (void)removeAllCellData;
+
+/**
+ Check that the ordered cell data and their lookup by room id are consistent.
+
+ This check goes through all the cell data, it is intended for tests and debugging.
+ The inconsistencies are logged.
+
+ @return YES if the index is consistent.
+ */
+- (BOOL)checkConsistency;
+
+@end
+
+NS_ASSUME_NONNULL_END
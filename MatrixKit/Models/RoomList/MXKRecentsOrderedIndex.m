@@ -0,0 +1,418 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKRecentsOrderedIndex.h"
+
+/**
+ The maximum number of cell data added one by one by `addCellDataArray:`.
+ */
+#define MXKRECENTSORDEREDINDEX_MAX_BINARY_INSERTIONS 64
+
+#pragma mark - MXKRecentsOrderedIndexEntry
+
+/**
+ An indexed cell data with the sort key captured at its insertion.
+ */
+@interface MXKRecentsOrderedIndexEntry : NSObject
+{
+@public
+    id<MXKRecentCellDataStoring> cellData;
+    NSString *key;
+    uint64_t originServerTs;
+}
+@end
+
+@implementation MXKRecentsOrderedIndexEntry
+@end
+
+#pragma mark - MXKRecentsOrderedIndex
+
+@interface MXKRecentsOrderedIndex ()
+{
+    /**
+     The entries ordered by descending last event timestamp, then by room id.
+     */
+    NSMutableArray<MXKRecentsOrderedIndexEntry*> *entries;
+    
+    /**
+     The entries by key: the room id, prefixed by the recents data source when they are interleaved.
+     */
+    NSMutableDictionary<NSString*, MXKRecentsOrderedIndexEntry*> *entriesByKey;
+}
+
+@end
+
+// Order the entries by descending last event timestamp, then by key
+static NSComparisonResult compareEntries(MXKRecentsOrderedIndexEntry *entry1, MXKRecentsOrderedIndexEntry *entry2)
+{
+    if (entry1->originServerTs > entry2->originServerTs)
+    {
+        return NSOrderedAscending;
+    }
+    else if (entry1->originServerTs < entry2->originServerTs)
+    {
+        return NSOrderedDescending;
+    }
+    return [entry1->key compare:entry2->key];
+}
+
+@implementation MXKRecentsOrderedIndex
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        entries = [NSMutableArray array];
+        entriesByKey = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return entries.count;
+}
+
+- (NSArray<id<MXKRecentCellDataStoring>> *)allCellData
+{
+    NSMutableArray *allCellData = [NSMutableArray arrayWithCapacity:entries.count];
+    for (MXKRecentsOrderedIndexEntry *entry in entries)
+    {
+        [allCellData addObject:entry->cellData];
+    }
+    return allCellData;
+}
+
+- (void)setAllCellData:(NSArray<id<MXKRecentCellDataStoring>> *)cellDataArray
+{
+    [self removeAllCellData];
+    
+    for (id<MXKRecentCellDataStoring> cellData in cellDataArray)
+    {
+        MXKRecentsOrderedIndexEntry *entry = [self entryWithCellData:cellData];
+        if (entry && !entriesByKey[entry->key])
+        {
+            [entries addObject:entry];
+            entriesByKey[entry->key] = entry;
+        }
+    }
+    
+    // Sort once
+    [self sortEntries];
+}
+
+- (void)setAllCellDataWithSortedArrays:(NSArray<NSArray<id<MXKRecentCellDataStoring>> *> *)sortedCellDataArrays
+{
+    [self removeAllCellData];
+    
+    NSUInteger listCount = sortedCellDataArrays.count;
+    NSUInteger *positions = calloc(listCount, sizeof(NSUInteger));
+    NSMutableArray *heads = [NSMutableArray arrayWithCapacity:listCount];
+    for (NSUInteger list = 0; list < listCount; list++)
+    {
+        [heads addObject:[self nextEntryInArray:sortedCellDataArrays[list] position:&positions[list]]];
+    }
+    
+    // Take the most recent head at each step
+    BOOL isSorted = YES;
+    while (YES)
+    {
+        NSUInteger selectedList = NSNotFound;
+        for (NSUInteger list = 0; list < listCount; list++)
+        {
+            if (heads[list] != [NSNull null]
+                && (selectedList == NSNotFound || compareEntries(heads[list], heads[selectedList]) == NSOrderedAscending))
+            {
+                selectedList = list;
+            }
+        }
+        
+        if (selectedList == NSNotFound)
+        {
+            break;
+        }
+        
+        MXKRecentsOrderedIndexEntry *entry = heads[selectedList];
+        if (!entriesByKey[entry->key])
+        {
+            if (isSorted && entries.count && compareEntries(entries.lastObject, entry) != NSOrderedAscending)
+            {
+                // A list was not ordered
+                isSorted = NO;
+            }
+            [entries addObject:entry];
+            entriesByKey[entry->key] = entry;
+        }
+        
+        heads[selectedList] = [self nextEntryInArray:sortedCellDataArrays[selectedList] position:&positions[selectedList]];
+    }
+    
+    free(positions);
+    
+    if (!isSorted)
+    {
+        NSLog(@"[MXKRecentsOrderedIndex] setAllCellDataWithSortedArrays: The lists are not ordered. Sort the %tu cell data", entries.count);
+        [self sortEntries];
+    }
+}
+
+- (id<MXKRecentCellDataStoring>)cellDataAtIndex:(NSUInteger)index
+{
+    if (index < entries.count)
+    {
+        return entries[index]->cellData;
+    }
+    return nil;
+}
+
+- (id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString *)roomId
+{
+    return entriesByKey[roomId]->cellData;
+}
+
+- (NSUInteger)indexOfCellDataWithRoomId:(NSString *)roomId
+{
+    return [self indexOfEntryWithKey:roomId];
+}
+
+- (NSUInteger)indexOfCellDataWithRoomId:(NSString *)roomId inRecentsDataSource:(MXKSessionRecentsDataSource *)recentsDataSource
+{
+    return [self indexOfEntryWithKey:[self keyWithRoomId:roomId recentsDataSource:recentsDataSource]];
+}
+
+- (NSUInteger)indexOfCellData:(id<MXKRecentCellDataStoring>)cellData
+{
+    NSString *key = [self keyOfCellData:cellData];
+    if (key)
+    {
+        return [self indexOfEntryWithKey:key];
+    }
+    return NSNotFound;
+}
+
+- (NSUInteger)addCellData:(id<MXKRecentCellDataStoring>)cellData
+{
+    MXKRecentsOrderedIndexEntry *entry = [self entryWithCellData:cellData];
+    if (!entry)
+    {
+        return NSNotFound;
+    }
+    
+    [self removeEntryWithKey:entry->key];
+    
+    NSUInteger index = [self indexOfEntry:entry options:NSBinarySearchingInsertionIndex];
+    [entries insertObject:entry atIndex:index];
+    entriesByKey[entry->key] = entry;
+    
+    return index;
+}
+
+- (void)addCellDataArray:(NSArray<id<MXKRecentCellDataStoring>> *)cellDataArray
+{
+    _addCellDataArrayCount++;
+    
+    // Binary insertions move the following entries each time: prefer a single sort for a large set
+    if (cellDataArray.count <= MXKRECENTSORDEREDINDEX_MAX_BINARY_INSERTIONS)
+    {
+        for (id<MXKRecentCellDataStoring> cellData in cellDataArray)
+        {
+            [self addCellData:cellData];
+        }
+        return;
+    }
+    
+    NSMutableDictionary<NSString*, MXKRecentsOrderedIndexEntry*> *addedEntries = [NSMutableDictionary dictionaryWithCapacity:cellDataArray.count];
+    for (id<MXKRecentCellDataStoring> cellData in cellDataArray)
+    {
+        MXKRecentsOrderedIndexEntry *entry = [self entryWithCellData:cellData];
+        if (entry)
+        {
+            addedEntries[entry->key] = entry;
+        }
+    }
+    
+    // Remove the replaced entries in one pass
+    NSIndexSet *replacedIndexes = [entries indexesOfObjectsPassingTest:^BOOL(MXKRecentsOrderedIndexEntry *entry, NSUInteger index, BOOL *stop) {
+        return (addedEntries[entry->key] != nil);
+    }];
+    [entries removeObjectsAtIndexes:replacedIndexes];
+    
+    [entries addObjectsFromArray:addedEntries.allValues];
+    [entriesByKey addEntriesFromDictionary:addedEntries];
+    
+    [self sortEntries];
+}
+
+- (NSUInteger)removeCellDataWithRoomId:(NSString *)roomId
+{
+    return [self removeEntryWithKey:roomId];
+}
+
+- (NSUInteger)removeCellData:(id<MXKRecentCellDataStoring>)cellData
+{
+    NSString *key = [self keyOfCellData:cellData];
+    if (key)
+    {
+        return [self removeEntryWithKey:key];
+    }
+    return NSNotFound;
+}
+
+- (void)removeAllCellData
+{
+    [entries removeAllObjects];
+    [entriesByKey removeAllObjects];
+}
+
+- (BOOL)checkConsistency
+{
+    BOOL isConsistent = YES;
+    
+    if (entries.count != entriesByKey.count)
+    {
+        NSLog(@"[MXKRecentsOrderedIndex] checkConsistency: %tu entries but %tu keys", entries.count, entriesByKey.count);
+        isConsistent = NO;
+    }
+    
+    for (NSUInteger index = 0; index < entries.count; index++)
+    {
+        MXKRecentsOrderedIndexEntry *entry = entries[index];
+        
+        if (entriesByKey[entry->key] != entry)
+        {
+            NSLog(@"[MXKRecentsOrderedIndex] checkConsistency: The entry at %tu is not registered for its key %@", index, entry->key);
+            isConsistent = NO;
+        }
+        if (![entry->key isEqualToString:[self keyOfCellData:entry->cellData]])
+        {
+            NSLog(@"[MXKRecentsOrderedIndex] checkConsistency: The entry at %tu has the key %@ but its cell data is %@", index, entry->key, entry->cellData);
+            isConsistent = NO;
+        }
+        if (index && compareEntries(entries[index - 1], entry) != NSOrderedAscending)
+        {
+            NSLog(@"[MXKRecentsOrderedIndex] checkConsistency: The entries at %tu and %tu are not ordered", index - 1, index);
+            isConsistent = NO;
+        }
+        if ([self indexOfEntry:entry options:0] != index)
+        {
+            NSLog(@"[MXKRecentsOrderedIndex] checkConsistency: The entry at %tu cannot be found by a binary search", index);
+            isConsistent = NO;
+        }
+    }
+    
+    return isConsistent;
+}
+
+#pragma mark - Private methods
+
+- (NSString*)keyOfCellData:(id<MXKRecentCellDataStoring>)cellData
+{
+    NSString *roomId = cellData.roomSummary.roomId;
+    if (roomId)
+    {
+        return [self keyWithRoomId:roomId recentsDataSource:cellData.recentsDataSource];
+    }
+    return nil;
+}
+
+- (NSString*)keyWithRoomId:(NSString*)roomId recentsDataSource:(MXKSessionRecentsDataSource*)recentsDataSource
+{
+    if (_interleavesRecentsDataSources)
+    {
+        return [NSString stringWithFormat:@"%p|%@", recentsDataSource, roomId];
+    }
+    return roomId;
+}
+
+- (MXKRecentsOrderedIndexEntry*)entryWithCellData:(id<MXKRecentCellDataStoring>)cellData
+{
+    NSString *key = [self keyOfCellData:cellData];
+    if (!key)
+    {
+        return nil;
+    }
+    
+    MXKRecentsOrderedIndexEntry *entry = [MXKRecentsOrderedIndexEntry new];
+    entry->cellData = cellData;
+    entry->key = key;
+    entry->originServerTs = cellData.lastEvent.originServerTs;
+    return entry;
+}
+
+- (NSUInteger)indexOfEntryWithKey:(NSString*)key
+{
+    MXKRecentsOrderedIndexEntry *entry = entriesByKey[key];
+    if (entry)
+    {
+        return [self indexOfEntry:entry options:0];
+    }
+    return NSNotFound;
+}
+
+- (NSUInteger)removeEntryWithKey:(NSString*)key
+{
+    MXKRecentsOrderedIndexEntry *entry = entriesByKey[key];
+    if (!entry)
+    {
+        return NSNotFound;
+    }
+    
+    NSUInteger index = [self indexOfEntry:entry options:0];
+    if (index != NSNotFound)
+    {
+        [entries removeObjectAtIndex:index];
+    }
+    [entriesByKey removeObjectForKey:key];
+    
+    return index;
+}
+
+// Return the entry of the next valid cell data of the array, or NSNull at its end
+- (id)nextEntryInArray:(NSArray<id<MXKRecentCellDataStoring>>*)cellDataArray position:(NSUInteger*)position
+{
+    while (*position < cellDataArray.count)
+    {
+        MXKRecentsOrderedIndexEntry *entry = [self entryWithCellData:cellDataArray[(*position)++]];
+        if (entry)
+        {
+            return entry;
+        }
+    }
+    return [NSNull null];
+}
+
+- (void)sortEntries
+{
+    _sortCount++;
+    
+    [entries sortUsingComparator:^NSComparisonResult(MXKRecentsOrderedIndexEntry *entry1, MXKRecentsOrderedIndexEntry *entry2) {
+        return compareEntries(entry1, entry2);
+    }];
+}
+
+- (NSUInteger)indexOfEntry:(MXKRecentsOrderedIndexEntry*)entry options:(NSBinarySearchingOptions)options
+{
+    return [entries indexOfObject:entry
+                    inSortedRange:NSMakeRange(0, entries.count)
+                          options:options
+                  usingComparator:^NSComparisonResult(MXKRecentsOrderedIndexEntry *entry1, MXKRecentsOrderedIndexEntry *entry2) {
+                      return compareEntries(entry1, entry2);
+                  }];
+}
+
+@end
@@ -0,0 +1,108 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The duration of a display frame, used as delay by `MXKRecentsUpdateSchedulerModeLatency`.
+ */
+#define MXKRECENTSUPDATESCHEDULER_FRAME_DURATION (1.0 / 60)
+
+/**
+ The default time window of `MXKRecentsUpdateSchedulerModeThroughput`.
+ */
+#define MXKRECENTSUPDATESCHEDULER_DEFAULT_THROUGHPUT_WINDOW 0.5
+
+/**
+ The ways to coalesce the updates.
+ */
+typedef enum : NSUInteger {
+    /**
+     The updates are applied at the next display frame: each change is displayed with a minimal delay.
+     */
+    MXKRecentsUpdateSchedulerModeLatency,
+    
+    /**
+     The updates are applied at the end of a time window which starts with the first change:
+     a burst of changes is applied in a few batches.
+     */
+    MXKRecentsUpdateSchedulerModeThroughput
+    
+} MXKRecentsUpdateSchedulerMode;
+
+/**
+ `MXKRecentsUpdateScheduler` coalesces the changes of the rooms of a recents list.
+
+ The ids of the changed rooms are collected during a window defined by the mode, then the update block
+ is called once with all of them, so that they are applied in one batch.
+
+ The scheduler must be used on the main thread, on which the update block is called.
+ */
+@interface MXKRecentsUpdateScheduler : NSObject
+
+/**
+ Create a scheduler.
+
+ @param updateBlock the block called with the ids of the changed rooms.
+ @return the newly created instance.
+ */
+- (instancetype)initWithUpdateBlock:(void (^)(NSSet<NSString*> *roomIds))updateBlock;
+
+/**
+ The way to coalesce the updates.
+ Default is MXKRecentsUpdateSchedulerModeThroughput.
+ */
+@property (nonatomic) MXKRecentsUpdateSchedulerMode mode;
+
+/**
+ The time window of MXKRecentsUpdateSchedulerModeThroughput.
+ Default is MXKRECENTSUPDATESCHEDULER_DEFAULT_THROUGHPUT_WINDOW.
+ */
+@property (nonatomic) NSTimeInterval throughputWindow;
+
+/**
+ The number of rooms waiting for an update.
+ */
+@property (nonatomic, readonly) NSUInteger pendingCount;
+
+/**
+ The number of update block calls since the creation of the scheduler.
+ */
+@property (nonatomic, readonly) NSUInteger updateCount;
+
+/**
+ Mark a room as changed.
+
+ @param roomId the room id.
+ */
+- (void)setNeedsUpdateForRoomId:(NSString*)roomId;
+
+/**
+ Apply now the pending updates, if any.
+ */
+- (void)flush;
+
+/**
+ Discard the pending updates.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
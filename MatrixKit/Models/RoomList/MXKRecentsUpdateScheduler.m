@@ -0,0 +1,112 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKRecentsUpdateScheduler.h"
+
+@import MatrixSDK;
+
+@interface MXKRecentsUpdateScheduler ()
+{
+    void (^updateBlock)(NSSet<NSString*> *roomIds);
+    
+    /**
+     The ids of the rooms changed since the last update.
+     */
+    NSMutableSet<NSString*> *pendingRoomIds;
+    
+    /**
+     Incremented on each update and on cancellation, to ignore the obsolete scheduled updates.
+     */
+    NSUInteger generation;
+    
+    /**
+     Tell whether an update is scheduled.
+     */
+    BOOL isUpdateScheduled;
+}
+
+@end
+
+@implementation MXKRecentsUpdateScheduler
+
+- (instancetype)initWithUpdateBlock:(void (^)(NSSet<NSString *> *))theUpdateBlock
+{
+    self = [super init];
+    if (self)
+    {
+        updateBlock = theUpdateBlock;
+        pendingRoomIds = [NSMutableSet set];
+        
+        _mode = MXKRecentsUpdateSchedulerModeThroughput;
+        _throughputWindow = MXKRECENTSUPDATESCHEDULER_DEFAULT_THROUGHPUT_WINDOW;
+    }
+    return self;
+}
+
+- (NSUInteger)pendingCount
+{
+    return pendingRoomIds.count;
+}
+
+- (void)setNeedsUpdateForRoomId:(NSString *)roomId
+{
+    [pendingRoomIds addObject:roomId];
+    
+    // The window starts with the first change, so that a continuous flow of changes does not delay the update indefinitely
+    if (!isUpdateScheduled)
+    {
+        isUpdateScheduled = YES;
+        
+        NSTimeInterval delay = (_mode == MXKRecentsUpdateSchedulerModeLatency) ? MXKRECENTSUPDATESCHEDULER_FRAME_DURATION : _throughputWindow;
+        NSUInteger scheduledGeneration = generation;
+        
+        MXWeakify(self);
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            MXStrongifyAndReturnIfNil(self);
+            
+            if (scheduledGeneration == self->generation)
+            {
+                [self flush];
+            }
+        });
+    }
+}
+
+- (void)flush
+{
+    generation++;
+    isUpdateScheduled = NO;
+    
+    if (pendingRoomIds.count)
+    {
+        NSSet<NSString*> *roomIds = pendingRoomIds;
+        pendingRoomIds = [NSMutableSet set];
+        
+        _updateCount++;
+        updateBlock(roomIds);
+    }
+}
+
+- (void)cancel
+{
+    generation++;
+    isUpdateScheduled = NO;
+    
+    [pendingRoomIds removeAllObjects];
+}
+
+@end
@@ -20,6 +20,7 @@
 
 #import "MXKDataSource.h"
 #import "MXKRecentCellData.h"
+#import "MXKRecentsUpdateScheduler.h"
 
 /**
  Identifier to use for cells that display a room in the recents list.
@@ -54,6 +55,12 @@ extern NSString *const kMXKRecentCellIdentifier;
  */
 @property (nonatomic, readonly) BOOL hasUnread;
 
+/**
+ The scheduler which coalesces the changes of the room summaries before updating the recents.
+ Its mode can be tuned to favour the latency or the throughput.
+ */
+@property (nonatomic, readonly) MXKRecentsUpdateScheduler *updateScheduler;
+
 
 #pragma mark - Life cycle
 
@@ -79,6 +86,32 @@ extern NSString *const kMXKRecentCellIdentifier;
  */
 - (id<MXKRecentCellDataStoring>)cellDataAtIndex:(NSInteger)index;
 
+/**
+ Get the data of the cell which displays a room.
+
+ @param roomId the room id.
+ @return the cell data, nil if the room is not in the recents of the session.
+ */
+- (id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString*)roomId;
+
+/**
+ Get the index of the cell which displays a room, in the filtered recents if a search is in progress.
+
+ @param roomId the room id.
+ @return the index of the cell, NSNotFound if the room is not displayed.
+ */
+- (NSUInteger)cellIndexWithRoomId:(NSString*)roomId;
+
+/**
+ Check that the cell data and their lookup by room id are consistent, including in the filtered recents.
+
+ This check goes through all the cell data, it is intended for tests and debugging.
+ The inconsistencies are logged.
+
+ @return YES if the cell data are consistent.
+ */
+- (BOOL)checkCellDataConsistency;
+
 /**
  Get height of the cell at the given index.
 
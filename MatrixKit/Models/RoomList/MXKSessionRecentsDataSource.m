@@ -18,10 +18,10 @@
 #import "MXKSessionRecentsDataSource.h"
 
 #import "MXKRoomDataSourceManager.h"
+#import "MXKRecentsOrderedIndex.h"
 
 #pragma mark - Constant definitions
 NSString *const kMXKRecentCellIdentifier = @"kMXKRecentCellIdentifier";
-static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
 
 
 @interface MXKSessionRecentsDataSource ()
@@ -29,11 +29,16 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     MXKRoomDataSourceManager *roomDataSourceManager;
     
     /**
-     Internal array used to regulate change notifications.
-     Cell data changes are stored instantly in this array.
+     Internal ordered index used to regulate change notifications.
+     Cell data changes are stored instantly in this index.
      These changes are reported to the delegate only if no server sync is in progress.
      */
-    NSMutableArray *internalCellDataArray;
+    MXKRecentsOrderedIndex *internalCellDataIndex;
+    
+    /**
+     Tell whether some changes of `internalCellDataIndex` have not been reported yet in `cellDataArray`.
+     */
+    BOOL hasPendingChanges;
 
     /**
      Store the current search patterns list.
@@ -41,9 +46,9 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     NSArray* searchPatternsList;
     
     /**
-     Do not react on every summary change
+     The index of each cell of `filteredCellDataArray` by room id.
      */
-    MXThrottler *roomSummaryChangeThrottler;
+    NSMutableDictionary<NSString*, NSNumber*> *filteredCellIndexes;
 }
 
 @end
@@ -57,13 +62,18 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     {
         roomDataSourceManager = [MXKRoomDataSourceManager sharedManagerForMatrixSession:self.mxSession];
         
-        internalCellDataArray = [NSMutableArray array];
+        internalCellDataIndex = [[MXKRecentsOrderedIndex alloc] init];
         filteredCellDataArray = nil;
         
         // Set default data and view classes
         [self registerCellDataClass:MXKRecentCellData.class forCellIdentifier:kMXKRecentCellIdentifier];
         
-        roomSummaryChangeThrottler = [[MXThrottler alloc] initWithMinimumDelay:roomSummaryChangeThrottlerDelay];
+        // Do not react on every summary change
+        MXWeakify(self);
+        _updateScheduler = [[MXKRecentsUpdateScheduler alloc] initWithUpdateBlock:^(NSSet<NSString *> *roomIds) {
+            MXStrongifyAndReturnIfNil(self);
+            [self updateCellDataWithRoomIds:roomIds];
+        }];
     }
     return self;
 }
@@ -76,12 +86,13 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     [[NSNotificationCenter defaultCenter] removeObserver:self name:kMXSessionDidLeaveRoomNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:kMXSessionDirectRoomsDidChangeNotification object:nil];
     
-    [roomSummaryChangeThrottler cancelAll];
-    roomSummaryChangeThrottler = nil;
+    [_updateScheduler cancel];
+    _updateScheduler = nil;
     
     cellDataArray = nil;
-    internalCellDataArray = nil;
+    internalCellDataIndex = nil;
     filteredCellDataArray = nil;
+    filteredCellIndexes = nil;
     
     searchPatternsList = nil;
     
@@ -93,7 +104,7 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     if (MXSessionStateStoreDataReady <= self.mxSession.state)
     {
         // Check whether some data have been already load
-        if (0 == internalCellDataArray.count)
+        if (0 == internalCellDataIndex.count)
         {
             [self loadData];
         }
@@ -150,10 +161,12 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
         if (filteredCellDataArray)
         {
             [filteredCellDataArray removeAllObjects];
+            [filteredCellIndexes removeAllObjects];
         }
         else
         {
             filteredCellDataArray = [NSMutableArray arrayWithCapacity:cellDataArray.count];
+            filteredCellIndexes = [NSMutableDictionary dictionaryWithCapacity:cellDataArray.count];
         }
         
         for (id<MXKRecentCellDataStoring> cellData in cellDataArray)
@@ -162,6 +175,10 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
             {
                 if (cellData.roomDisplayname && [cellData.roomDisplayname rangeOfString:pattern options:NSCaseInsensitiveSearch].location != NSNotFound)
                 {
+                    if (cellData.roomSummary.roomId)
+                    {
+                        filteredCellIndexes[cellData.roomSummary.roomId] = @(filteredCellDataArray.count);
+                    }
                     [filteredCellDataArray addObject:cellData];
                     break;
                 }
@@ -171,6 +188,7 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     else
     {
         filteredCellDataArray = nil;
+        filteredCellIndexes = nil;
         searchPatternsList = nil;
     }
     
@@ -218,7 +236,7 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     [[NSNotificationCenter defaultCenter] removeObserver:self name:kMXSessionDirectRoomsDidChangeNotification object:nil];
     
     // Reset the table
-    [internalCellDataArray removeAllObjects];
+    [internalCellDataIndex removeAllCellData];
     
     // Retrieve the MXKCellData class to manage the data
     Class class = [self cellDataClassForCellIdentifier:kMXKRecentCellIdentifier];
@@ -226,6 +244,7 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
 
     NSDate *startDate = [NSDate date];
     
+    NSMutableArray<id<MXKRecentCellDataStoring>> *loadedCellDataArray = [NSMutableArray arrayWithCapacity:self.mxSession.roomsSummaries.count];
     for (MXRoomSummary *roomSummary in self.mxSession.roomsSummaries)
     {
         // Filter out private rooms with conference users
@@ -235,10 +254,13 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
             id<MXKRecentCellDataStoring> cellData = [[class alloc] initWithRoomSummary:roomSummary andRecentListDataSource:self];
             if (cellData)
             {
-                [internalCellDataArray addObject:cellData];
+                [loadedCellDataArray addObject:cellData];
             }
         }
     }
+    
+    // Sort them once
+    [internalCellDataIndex setAllCellData:loadedCellDataArray];
 
     NSLog(@"[MXKSessionRecentsDataSource] Loaded %tu recents in %.3fms", self.mxSession.rooms.count, [[NSDate date] timeIntervalSinceDate:startDate] * 1000);
 
@@ -250,6 +272,10 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     {
         [self sortCellDataAndNotifyChanges];
     }
+    else
+    {
+        hasPendingChanges = YES;
+    }
     
     // Listen to MXSession rooms count changes
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(didMXSessionHaveNewRoom:) name:kMXSessionNewRoomNotification object:nil];
@@ -271,61 +297,55 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
 }
 
 - (void)didRoomSummaryChanged:(NSNotification *)notif
-{    
-    [roomSummaryChangeThrottler throttle:^{
-        [self didRoomSummaryChanged2:notif];
-    }];
+{
+    MXRoomSummary *roomSummary = notif.object;
+    if (roomSummary.mxSession == self.mxSession)
+    {
+        // Coalesce the changes
+        if (internalCellDataIndex.count && roomSummary.roomId)
+        {
+            [_updateScheduler setNeedsUpdateForRoomId:roomSummary.roomId];
+        }
+    }
+    else if (!roomSummary)
+    {
+        // Inform the delegate that all the room summaries have been updated.
+        [self.delegate dataSource:self didCellChange:nil];
+    }
 }
 
-- (void)didRoomSummaryChanged2:(NSNotification *)notif
+// Apply the coalesced changes of room summaries
+- (void)updateCellDataWithRoomIds:(NSSet<NSString*> *)roomIds
 {
-    MXRoomSummary *roomSummary = notif.object;
-    if (roomSummary.mxSession == self.mxSession && internalCellDataArray.count)
+    NSMutableDictionary<NSString*, id> *cellDataByRoomId = [NSMutableDictionary dictionaryWithCapacity:roomIds.count];
+    Class class = [self cellDataClassForCellIdentifier:kMXKRecentCellIdentifier];
+    
+    for (NSString *roomId in roomIds)
     {
-        // Find the index of the related cell data
-        NSInteger index = NSNotFound;
-        for (index = 0; index < internalCellDataArray.count; index++)
+        // Find the related cell data
+        if (![internalCellDataIndex cellDataWithRoomId:roomId])
         {
-            id<MXKRecentCellDataStoring> theRoomData = [internalCellDataArray objectAtIndex:index];
-            if (theRoomData.roomSummary == roomSummary)
-            {
-                break;
-            }
+            NSLog(@"[MXKSessionRecentsDataSource] updateCellDataWithRoomIds: Cannot find the changed room summary for %@. It is probably not managed by this recents data source", roomId);
+            continue;
         }
         
-        if (index < internalCellDataArray.count)
+        MXRoomSummary *roomSummary = [self.mxSession roomSummaryWithRoomId:roomId];
+        if (roomSummary && !roomSummary.hiddenFromUser)
         {
-            if (roomSummary.hiddenFromUser)
-            {
-                [internalCellDataArray removeObjectAtIndex:index];
-            }
-            else
-            {
-                // Create a new instance to not modify the content of 'cellDataArray' (the copy is not a deep copy).
-                Class class = [self cellDataClassForCellIdentifier:kMXKRecentCellIdentifier];
-                id<MXKRecentCellDataStoring> cellData = [[class alloc] initWithRoomSummary:roomSummary andRecentListDataSource:self];
-                if (cellData)
-                {
-                    [internalCellDataArray replaceObjectAtIndex:index withObject:cellData];
-                }
-            }
-            
-            // Report change except if sync is in progress
-            if (!roomDataSourceManager.isServerSyncInProgress)
+            // Create a new instance to not modify the content of 'cellDataArray' (the copy is not a deep copy).
+            id<MXKRecentCellDataStoring> cellData = [[class alloc] initWithRoomSummary:roomSummary andRecentListDataSource:self];
+            if (cellData)
             {
-                [self sortCellDataAndNotifyChanges];
+                cellDataByRoomId[roomId] = cellData;
             }
         }
         else
         {
-            NSLog(@"[MXKSessionRecentsDataSource] didRoomLastMessageChanged: Cannot find the changed room summary for %@ (%@). It is probably not managed by this recents data source", roomSummary.roomId, roomSummary);
+            cellDataByRoomId[roomId] = [NSNull null];
         }
     }
-    else
-    {
-        // Inform the delegate that all the room summaries have been updated.
-        [self.delegate dataSource:self didCellChange:nil];
-    }
+    
+    [self setCellDataByRoomId:cellDataByRoomId];
 }
 
 - (void)didMXSessionHaveNewRoom:(NSNotification *)notif
@@ -348,13 +368,7 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
             id<MXKRecentCellDataStoring> cellData = [[class alloc] initWithRoomSummary:roomSummary andRecentListDataSource:self];
             if (cellData)
             {
-                [internalCellDataArray addObject:cellData];
-                
-                // Report change except if sync is in progress
-                if (!roomDataSourceManager.isServerSyncInProgress)
-                {
-                    [self sortCellDataAndNotifyChanges];
-                }
+                [self setCellData:cellData forRoomId:roomId];
             }
         }
     }
@@ -372,37 +386,146 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
         {
             NSLog(@"MXKSessionRecentsDataSource] Remove left room: %@", roomId);
             
-            [internalCellDataArray removeObject:roomData];
-            
-            // Report change except if sync is in progress
-            if (!roomDataSourceManager.isServerSyncInProgress)
-            {
-                [self sortCellDataAndNotifyChanges];
-            }
+            [self setCellData:nil forRoomId:roomId];
         }
     }
 }
 
-// Order cells
-- (void)sortCellDataAndNotifyChanges
+// Insert, move or remove the cell data of a room, and report the change except if sync is in progress
+- (void)setCellData:(id<MXKRecentCellDataStoring>)cellData forRoomId:(NSString*)roomId
+{
+    [self setCellDataByRoomId:@{roomId: cellData ? cellData : [NSNull null]}];
+}
+
+// Insert, move or remove the cell data of rooms (NSNull to remove) in one ordering pass,
+// and report the changes except if sync is in progress
+- (void)setCellDataByRoomId:(NSDictionary<NSString*, id> *)cellDataByRoomId
 {
-    // Order them by origin_server_ts
-    [internalCellDataArray sortUsingComparator:^NSComparisonResult(id<MXKRecentCellDataStoring> cellData1, id<MXKRecentCellDataStoring> cellData2)
+    if (!cellDataByRoomId.count)
+    {
+        return;
+    }
+    
+    BOOL canReportChanges = (!roomDataSourceManager.isServerSyncInProgress && !hasPendingChanges && !searchPatternsList
+                             && state == MXKDataSourceStateReady && cellDataArray);
+    
+    // Retrieve the current positions before any change
+    NSMutableDictionary<NSString*, NSNumber*> *previousIndexes = [NSMutableDictionary dictionaryWithCapacity:cellDataByRoomId.count];
+    if (canReportChanges)
+    {
+        for (NSString *roomId in cellDataByRoomId)
+        {
+            NSUInteger index = [internalCellDataIndex indexOfCellDataWithRoomId:roomId];
+            if (index != NSNotFound)
+            {
+                previousIndexes[roomId] = @(index);
+            }
+        }
+    }
+    
+    NSMutableArray<id<MXKRecentCellDataStoring>> *addedCellData = [NSMutableArray arrayWithCapacity:cellDataByRoomId.count];
+    for (NSString *roomId in cellDataByRoomId)
+    {
+        [internalCellDataIndex removeCellDataWithRoomId:roomId];
+        
+        id cellData = cellDataByRoomId[roomId];
+        if (cellData != [NSNull null])
+        {
+            [addedCellData addObject:cellData];
+        }
+    }
+    [internalCellDataIndex addCellDataArray:addedCellData];
+    
+    if (roomDataSourceManager.isServerSyncInProgress)
+    {
+        // The changes will be reported at the end of the sync
+        hasPendingChanges = YES;
+        return;
+    }
+    
+    if (!canReportChanges)
+    {
+        [self sortCellDataAndNotifyChanges];
+        return;
+    }
+    
+    // Compute the exact changes
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    NSMutableIndexSet *removedIndexes = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *insertedIndexes = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *unmovedIndexes = [NSMutableIndexSet indexSet];
+    
+    for (NSString *roomId in cellDataByRoomId)
     {
-        NSComparisonResult result = NSOrderedAscending;
-        if (cellData2.lastEvent.originServerTs > cellData1.lastEvent.originServerTs)
+        NSNumber *previousIndex = previousIndexes[roomId];
+        NSUInteger newIndex = NSNotFound;
+        if (cellDataByRoomId[roomId] != [NSNull null])
+        {
+            newIndex = [internalCellDataIndex indexOfCellDataWithRoomId:roomId];
+        }
+        
+        if (previousIndex)
+        {
+            [removedIndexes addIndex:previousIndex.unsignedIntegerValue];
+        }
+        if (newIndex != NSNotFound)
+        {
+            [insertedIndexes addIndex:newIndex];
+        }
+        
+        if (previousIndex && newIndex != NSNotFound)
+        {
+            if (previousIndex.unsignedIntegerValue == newIndex)
+            {
+                [unmovedIndexes addIndex:newIndex];
+            }
+            else
+            {
+                [changeSet addMoveFromIndexPath:[NSIndexPath indexPathForRow:previousIndex.unsignedIntegerValue inSection:0]
+                                    toIndexPath:[NSIndexPath indexPathForRow:newIndex inSection:0]];
+            }
+        }
+        else if (previousIndex)
         {
-            result = NSOrderedDescending;
+            [changeSet addDeletedIndexPath:[NSIndexPath indexPathForRow:previousIndex.unsignedIntegerValue inSection:0]];
         }
-        else if (cellData2.lastEvent.originServerTs == cellData1.lastEvent.originServerTs)
+        else if (newIndex != NSNotFound)
         {
-            result = NSOrderedSame;
+            [changeSet addInsertedIndexPath:[NSIndexPath indexPathForRow:newIndex inSection:0]];
         }
-        return result;
+    }
+    
+    // A room which keeps its position is reloaded in place only if no other row moves.
+    // Else its position among the other rows may change: it is deleted and inserted again.
+    BOOL hasOtherChanges = !changeSet.isEmpty;
+    [unmovedIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:index inSection:0];
+        if (hasOtherChanges)
+        {
+            [changeSet addDeletedIndexPath:indexPath];
+            [changeSet addInsertedIndexPath:indexPath];
+        }
+        else
+        {
+            [changeSet addUpdatedIndexPath:indexPath];
+        }
+    }];
+    
+    // Apply the same changes to the snapshot
+    [cellDataArray removeObjectsAtIndexes:removedIndexes];
+    [insertedIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        [self->cellDataArray insertObject:[self->internalCellDataIndex cellDataAtIndex:index] atIndex:index];
     }];
     
-    // Snapshot the cell data array
-    cellDataArray = [internalCellDataArray copy];
+    [self notifyDelegateWithChangeSet:changeSet];
+}
+
+// Snapshot the ordered cells and notify a full reload
+- (void)sortCellDataAndNotifyChanges
+{
+    // Snapshot the cell data index, which is already ordered by origin_server_ts
+    cellDataArray = [internalCellDataIndex.allCellData mutableCopy];
+    hasPendingChanges = NO;
     
     // Update search result if any
     if (searchPatternsList)
@@ -424,26 +547,74 @@ static NSTimeInterval const roomSummaryChangeThrottlerDelay = .5;
     [self.delegate dataSource:self didCellChange:nil];
 }
 
-// Find the cell data that stores information about the given room id
 - (id<MXKRecentCellDataStoring>)cellDataWithRoomId:(NSString*)roomId
 {
-    id<MXKRecentCellDataStoring> theRoomData;
+    return [internalCellDataIndex cellDataWithRoomId:roomId];
+}
+
+- (NSUInteger)cellIndexWithRoomId:(NSString*)roomId
+{
+    if (!roomId || !cellDataArray)
+    {
+        // No cell is displayed yet
+        return NSNotFound;
+    }
     
-    NSMutableArray *dataArray = internalCellDataArray;
-    if (!roomDataSourceManager.isServerSyncInProgress)
+    if (filteredCellDataArray)
+    {
+        NSNumber *index = filteredCellIndexes[roomId];
+        return index ? index.unsignedIntegerValue : NSNotFound;
+    }
+    
+    if (!hasPendingChanges)
+    {
+        // The displayed cells are the ones of the index
+        return [internalCellDataIndex indexOfCellDataWithRoomId:roomId];
+    }
+    
+    // The displayed cells have not been updated yet with the last changes (server sync in progress)
+    return [cellDataArray indexOfObjectPassingTest:^BOOL(id<MXKRecentCellDataStoring> cellData, NSUInteger index, BOOL *stop) {
+        return [roomId isEqualToString:cellData.roomSummary.roomId];
+    }];
+}
+
+- (BOOL)checkCellDataConsistency
+{
+    BOOL isConsistent = [internalCellDataIndex checkConsistency];
+    
+    if (!hasPendingChanges && cellDataArray && ![cellDataArray isEqualToArray:internalCellDataIndex.allCellData])
     {
-        dataArray = cellDataArray;
+        NSLog(@"[MXKSessionRecentsDataSource] checkCellDataConsistency: The displayed cells do not match the indexed cell data");
+        isConsistent = NO;
     }
     
-    for (id<MXKRecentCellDataStoring> roomData in dataArray)
+    if (filteredCellDataArray)
     {
-        if ([roomData.roomSummary.roomId isEqualToString:roomId])
+        if (filteredCellIndexes.count != filteredCellDataArray.count)
         {
-            theRoomData = roomData;
-            break;
+            NSLog(@"[MXKSessionRecentsDataSource] checkCellDataConsistency: %tu filtered cells but %tu filtered room ids", filteredCellDataArray.count, filteredCellIndexes.count);
+            isConsistent = NO;
+        }
+        
+        NSSet *displayedCellData = [NSSet setWithArray:cellDataArray];
+        for (NSUInteger index = 0; index < filteredCellDataArray.count; index++)
+        {
+            id<MXKRecentCellDataStoring> cellData = filteredCellDataArray[index];
+            NSNumber *filteredIndex = cellData.roomSummary.roomId ? filteredCellIndexes[cellData.roomSummary.roomId] : nil;
+            if (!filteredIndex || filteredIndex.unsignedIntegerValue != index)
+            {
+                NSLog(@"[MXKSessionRecentsDataSource] checkCellDataConsistency: The filtered cell at %tu (%@) is indexed at %@", index, cellData.roomSummary.roomId, filteredIndex);
+                isConsistent = NO;
+            }
+            if (![displayedCellData containsObject:cellData])
+            {
+                NSLog(@"[MXKSessionRecentsDataSource] checkCellDataConsistency: The filtered cell at %tu (%@) is not displayed", index, cellData.roomSummary.roomId);
+                isConsistent = NO;
+            }
         }
     }
-    return theRoomData;
+    
+    return isConsistent;
 }
 
 @end
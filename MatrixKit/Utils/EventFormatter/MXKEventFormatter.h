@@ -20,8 +20,15 @@
 #import <MatrixSDK/MatrixSDK.h>
 
 #import "MXKAppSettings.h"
+#import "MXKHTMLRenderer.h"
 
 @protocol MarkdownToHTMLRendererProtocol;
+
+/**
+ The render cache capacity of the formatters created by the kit for the room messages.
+ */
+#define MXKEVENTFORMATTER_DEFAULT_RENDER_CACHE_CAPACITY 500
+
 /**
  Formatting result codes.
  */
@@ -210,6 +217,88 @@ typedef enum : NSUInteger {
  */
 - (NSAttributedString*)renderString:(NSString*)string withPrefix:(NSString*)prefix forEvent:(MXEvent*)event;
 
+#pragma mark - Render cache
+
+/**
+ The attributed strings rendered for room messages can be cached, keyed by event id, replacing event id,
+ event state, sender and "in reply to" display names and formatter configuration.
+ Any change of a property listed by `renderCacheConfigurationKeyPaths` empties the cache.
+ 
+ The maximum number of cached strings. Default is 0: the cache is disabled.
+ MXKRoomDataSource enables it with MXKEVENTFORMATTER_DEFAULT_RENDER_CACHE_CAPACITY on the formatter it creates.
+ An inherited class which renders the events with its own properties must declare them through
+ `renderCacheConfigurationKeyPaths` or `renderCacheKeyForEvent:withRoomState:` before enabling the cache.
+ */
+@property (nonatomic) NSUInteger renderCacheCapacity;
+
+/**
+ The formatter properties used to render the events, observed through KVO.
+ A change of one of them empties the render cache.
+ 
+ Inherited classes must add the key paths of their own rendering properties to the ones of `super`.
+ 
+ @return the key paths.
+ */
++ (NSArray<NSString*>*)renderCacheConfigurationKeyPaths;
+
+/**
+ Build the key of the rendering of an event in the render cache.
+ 
+ Only room messages are cached: their rendering is the most expensive one (HTML), and it depends
+ only on the event content, the event state, the sender and replied user display names, and the formatter configuration.
+ Inherited classes whose rendering depends on other data can append it to the key of `super`,
+ or return nil to not cache the rendering of an event.
+ 
+ @param event the event to render.
+ @param roomState the room state right before the event.
+ @return the key, or nil if the rendering must not be cached.
+ */
+- (NSString*)renderCacheKeyForEvent:(MXEvent*)event withRoomState:(MXRoomState*)roomState;
+
+/**
+ Discard all the cached renderings of an event.
+
+ @param eventId the event id.
+ */
+- (void)invalidateRenderCacheForEventId:(NSString*)eventId;
+
+/**
+ Discard all the cached renderings.
+ */
+- (void)invalidateRenderCache;
+
+#pragma mark - Room summaries
+
+/**
+ Tell whether the previews of the last messages of the room summaries are rendered on demand.
+
+ When YES, a room summary update computes only the plain text of the last message, which is required to select it,
+ and keeps the sender display name. The attributed preview and the date string are rendered by
+ `renderLastMessageIfNeededForRoomSummary:` the first time they are displayed, then cached in the summary.
+ Default is NO.
+ */
+@property (nonatomic) BOOL renderLastMessageOnDemand;
+
+/**
+ The number of last message previews rendered by the formatter, during the summary updates or on demand.
+ */
+@property (nonatomic, readonly) NSUInteger renderedLastMessagesCount;
+
+/**
+ The number of last message previews whose rendering has been deferred (see `renderLastMessageOnDemand`).
+ */
+@property (nonatomic, readonly) NSUInteger deferredLastMessagesCount;
+
+/**
+ Render the preview of the last message of a room summary if its rendering has been deferred.
+
+ The rendered preview is stored in the store of the summary session.
+
+ @param summary the room summary.
+ @return YES if the preview has been rendered by this call.
+ */
+- (BOOL)renderLastMessageIfNeededForRoomSummary:(MXRoomSummary*)summary;
+
 #pragma mark - Conversion tools
 
 /**
@@ -271,6 +360,15 @@ typedef enum : NSUInteger {
 */
 @property (nonatomic) NSString *defaultCSS;
 
+/**
+ The single pass renderer used by the 'renderHTMLString' method for the HTML subset it supports.
+ The other HTML strings are rendered by DTCoreText with `defaultCSS`.
+ 
+ Default is a renderer matching the default CSS. As this renderer does not interpret CSS, it is reset
+ to nil when `defaultCSS` is changed: set a renderer styled like the new CSS to keep the fast path.
+ */
+@property (nonatomic) MXKHTMLRenderer *htmlRenderer;
+
 /**
  Default color used to display text content of event.
  Default is [UIColor blackColor].
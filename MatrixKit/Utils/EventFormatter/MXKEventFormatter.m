@@ -18,6 +18,8 @@
 
 #import "MXKEventFormatter.h"
 
+#import <stdatomic.h>
+
 @import MatrixSDK;
 @import DTCoreText;
 
@@ -28,9 +30,25 @@
 #import "MXRoom+Sync.h"
 
 #import "MXKRoomNameStringLocalizations.h"
+#import "MXKEventFormatterRenderCache.h"
 
 static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
 
+static void *kMXKEventFormatterRenderCacheConfigurationContext = &kMXKEventFormatterRenderCacheConfigurationContext;
+
+/**
+ A rendering stored in the render cache.
+ */
+@interface MXKEventFormatterRenderCacheEntry : NSObject
+
+@property (nonatomic) NSAttributedString *attributedString;
+@property (nonatomic) MXKEventFormatterError error;
+
+@end
+
+@implementation MXKEventFormatterRenderCacheEntry
+@end
+
 @interface MXKEventFormatter ()
 {
     /**
@@ -44,9 +62,21 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
     DTCSSStylesheet *dtCSS;
 
     /**
-     Links detector in strings.
+     The attributed strings rendered for room messages.
      */
-    NSDataDetector *linkDetector;
+    MXKEventFormatterRenderCache *renderCache;
+
+    /**
+     Incremented each time a property used to render the events changes.
+     */
+    NSUInteger renderCacheConfigurationVersion;
+
+    /**
+     The counters of the last message previews.
+     The room summaries may be updated on any queue: they are incremented atomically.
+     */
+    _Atomic(NSUInteger) renderedLastMessagesCounter;
+    _Atomic(NSUInteger) deferredLastMessagesCounter;
 }
 @end
 
@@ -80,6 +110,7 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
                 -coretext-fontname: Menlo-Regular; \
                 font-size: small; \
             }";
+        _htmlRenderer = [[MXKHTMLRenderer alloc] init];
 
         // Set default colors
         _defaultTextColor = [UIColor blackColor];
@@ -108,13 +139,28 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
         defaultRoomSummaryUpdater.ignoreRedactedEvent = !_settings.showRedactionsInRoomHistory;
         defaultRoomSummaryUpdater.roomNameStringLocalizations = [MXKRoomNameStringLocalizations new];
 
-        linkDetector = [NSDataDetector dataDetectorWithTypes:NSTextCheckingTypeLink error:nil];
-        
         _markdownToHTMLRenderer = [MarkdownToHTMLRendererHardBreaks new];
+        
+        // The render cache is disabled by default
+        renderCache = [[MXKEventFormatterRenderCache alloc] initWithCapacity:0];
+        
+        // Empty the render cache on any change of the rendering configuration
+        for (NSString *keyPath in [self.class renderCacheConfigurationKeyPaths])
+        {
+            [self addObserver:self forKeyPath:keyPath options:0 context:kMXKEventFormatterRenderCacheConfigurationContext];
+        }
     }
     return self;
 }
 
+- (void)dealloc
+{
+    for (NSString *keyPath in [self.class renderCacheConfigurationKeyPaths])
+    {
+        [self removeObserver:self forKeyPath:keyPath context:kMXKEventFormatterRenderCacheConfigurationContext];
+    }
+}
+
 - (void)initDateTimeFormatters
 {
     // Prepare internal date formatter
@@ -305,6 +351,41 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
         return nil;
     }
     
+    // Check whether this rendering is already available
+    NSString *renderCacheKey = [self renderCacheKeyForEvent:event withRoomState:roomState];
+    if (renderCacheKey)
+    {
+        MXKEventFormatterRenderCacheEntry *entry = [renderCache objectForKey:renderCacheKey];
+        if (entry)
+        {
+            *error = entry.error;
+            return entry.attributedString;
+        }
+    }
+    
+    NSAttributedString *attributedString = [self renderAttributedStringFromEvent:event withRoomState:roomState error:error];
+    
+    if (renderCacheKey && attributedString)
+    {
+        MXKEventFormatterRenderCacheEntry *entry = [[MXKEventFormatterRenderCacheEntry alloc] init];
+        entry.attributedString = attributedString;
+        entry.error = *error;
+        [renderCache setObject:entry forKey:renderCacheKey eventId:event.eventId];
+    }
+    
+    return attributedString;
+}
+
+/**
+ Render an event without using the render cache.
+
+ @param event the event to format.
+ @param roomState the room state right before the event.
+ @param error the error code.
+ @return the attributed string for the event.
+ */
+- (NSAttributedString *)renderAttributedStringFromEvent:(MXEvent *)event withRoomState:(MXRoomState *)roomState error:(MXKEventFormatterError *)error
+{
     BOOL isEventSenderMyUser = [event.sender isEqualToString:mxSession.myUserId];
     
     // Check first whether the event has been redacted
@@ -1608,37 +1689,14 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
     [str addAttribute:NSForegroundColorAttributeName value:[self textColorForEvent:event] range:wholeString];
     [str addAttribute:NSFontAttributeName value:[self fontForEvent:event] range:wholeString];
 
-    // If enabled, make links clickable
+    // Apply additional treatments
+    // If custom schemes are set, the http links are made clickable in the same pass as the matrix ids
     if (!([[_settings httpLinkScheme] isEqualToString: @"http"] &&
           [[_settings httpsLinkScheme] isEqualToString: @"https"]))
     {
-        NSArray *matches = [linkDetector matchesInString:[str string] options:0 range:wholeString];
-        for (NSTextCheckingResult *match in matches)
-        {
-            NSRange matchRange = [match range];
-            NSURL *matchUrl = [match URL];
-            NSURLComponents *url = [[NSURLComponents new] initWithURL:matchUrl resolvingAgainstBaseURL:NO];
-
-            if (url)
-            {
-                if ([url.scheme isEqualToString: @"http"])
-                {
-                    url.scheme = [_settings httpLinkScheme];
-                }
-                else if ([url.scheme isEqualToString: @"https"])
-                {
-                    url.scheme = [_settings httpsLinkScheme];
-                }
-
-                if (url.URL)
-                {
-                    [str addAttribute:NSLinkAttributeName value:url.URL range:matchRange];
-                }
-            }
-        }
+        return [self postRenderAttributedString:str httpLinkScheme:[_settings httpLinkScheme] httpsLinkScheme:[_settings httpsLinkScheme]];
     }
-
-    // Apply additional treatments
+    
     return [self postRenderAttributedString:str];
 }
 
@@ -1659,6 +1717,19 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
 
     // Apply the css style that corresponds to the event state
     UIFont *font = [self fontForEvent:event];
+    
+    // Use the single pass renderer when the HTML is part of the subset it supports
+    MXKHTMLRenderer *htmlRenderer = _htmlRenderer;
+    if (htmlRenderer)
+    {
+        NSAttributedString *str = [htmlRenderer renderHTMLString:html withFont:font textColor:[self textColorForEvent:event]];
+        if (str)
+        {
+            // Apply additional treatments. There is no artifact to remove.
+            return [self postRenderAttributedString:str];
+        }
+    }
+    
     NSDictionary *options = @{
                               DTUseiOS6Attributes: @(YES),              // Enable it to be able to display the attributed string in a UITextView
                               DTDefaultFontFamily: font.familyName,
@@ -1703,40 +1774,8 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
 {
     NSString *html = htmlString;
     
-    static NSRegularExpression *htmlATagRegex;
-    
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        htmlATagRegex = [NSRegularExpression regularExpressionWithPattern:kHTMLATagRegexPattern options:NSRegularExpressionCaseInsensitive error:nil];
-    });
-    
-    __block NSUInteger hrefCount = 0;
-    
-    __block NSRange inReplyToLinkRange = NSMakeRange(NSNotFound, 0);
-    __block NSRange inReplyToTextRange = NSMakeRange(NSNotFound, 0);
-    __block NSRange userIdRange = NSMakeRange(NSNotFound, 0);
-    
-    [htmlATagRegex enumerateMatchesInString:html
-                                    options:0
-                                      range:NSMakeRange(0, html.length)
-                                 usingBlock:^(NSTextCheckingResult *match, NSMatchingFlags flags, BOOL *stop) {
-                                     
-                                     if (hrefCount > 1)
-                                     {
-                                         *stop = YES;
-                                     }
-                                     else if (hrefCount == 0 && match.numberOfRanges >= 2)
-                                     {
-                                        inReplyToLinkRange = [match rangeAtIndex:1];
-                                        inReplyToTextRange = [match rangeAtIndex:2];
-                                     }
-                                     else if (hrefCount == 1 && match.numberOfRanges >= 2)
-                                     {
-                                         userIdRange = [match rangeAtIndex:2];
-                                     }
-                                     
-                                     hrefCount++;
-                                 }];
+    NSRange inReplyToLinkRange, inReplyToTextRange, userIdRange;
+    [self getReplyToLinkRange:&inReplyToLinkRange replyToTextRange:&inReplyToTextRange userIdRange:&userIdRange inHTMLString:html];
     
     // Note: Take care to replace text starting with the end
     
@@ -1781,7 +1820,58 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
     return html;
 }
 
+/**
+ Locate the links of a reply-to message header.
+
+ @param inReplyToLinkRange the range of the href of the "In reply to" link.
+ @param inReplyToTextRange the range of the text of the "In reply to" link.
+ @param userIdRange the range of the text of the replied user link.
+ @param htmlString an html string containing a reply-to message.
+ */
+- (void)getReplyToLinkRange:(NSRange*)inReplyToLinkRange replyToTextRange:(NSRange*)inReplyToTextRange userIdRange:(NSRange*)userIdRange inHTMLString:(NSString*)htmlString
+{
+    static NSRegularExpression *htmlATagRegex;
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        htmlATagRegex = [NSRegularExpression regularExpressionWithPattern:kHTMLATagRegexPattern options:NSRegularExpressionCaseInsensitive error:nil];
+    });
+    
+    __block NSUInteger hrefCount = 0;
+    
+    *inReplyToLinkRange = NSMakeRange(NSNotFound, 0);
+    *inReplyToTextRange = NSMakeRange(NSNotFound, 0);
+    *userIdRange = NSMakeRange(NSNotFound, 0);
+    
+    [htmlATagRegex enumerateMatchesInString:htmlString
+                                    options:0
+                                      range:NSMakeRange(0, htmlString.length)
+                                 usingBlock:^(NSTextCheckingResult *match, NSMatchingFlags flags, BOOL *stop) {
+                                     
+                                     if (hrefCount > 1)
+                                     {
+                                         *stop = YES;
+                                     }
+                                     else if (hrefCount == 0 && match.numberOfRanges >= 2)
+                                     {
+                                         *inReplyToLinkRange = [match rangeAtIndex:1];
+                                         *inReplyToTextRange = [match rangeAtIndex:2];
+                                     }
+                                     else if (hrefCount == 1 && match.numberOfRanges >= 2)
+                                     {
+                                         *userIdRange = [match rangeAtIndex:2];
+                                     }
+                                     
+                                     hrefCount++;
+                                 }];
+}
+
 - (NSAttributedString*)postRenderAttributedString:(NSAttributedString*)attributedString
+{
+    return [self postRenderAttributedString:attributedString httpLinkScheme:nil httpsLinkScheme:nil];
+}
+
+- (NSAttributedString*)postRenderAttributedString:(NSAttributedString*)attributedString httpLinkScheme:(NSString*)httpLinkScheme httpsLinkScheme:(NSString*)httpsLinkScheme
 {
     if (!attributedString)
     {
@@ -1820,7 +1910,7 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
         enabledMatrixIdsBitMask |= MXKTOOLS_GROUP_IDENTIFIER_BITWISE;
     }
 
-    return [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:enabledMatrixIdsBitMask];
+    return [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:enabledMatrixIdsBitMask httpLinkScheme:httpLinkScheme httpsLinkScheme:httpsLinkScheme];
 }
 
 - (NSAttributedString *)renderString:(NSString *)string withPrefix:(NSString *)prefix forEvent:(MXEvent *)event
@@ -1854,6 +1944,118 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
     _defaultCSS = [NSString stringWithFormat:@"%@%@", [MXKTools cssToMarkBlockquotes], defaultCSS];
 
     dtCSS = [[DTCSSStylesheet alloc] initWithStyleBlock:_defaultCSS];
+    
+    // The HTML renderer does not follow the CSS
+    _htmlRenderer = nil;
+}
+
+#pragma mark - Render cache
+
+- (NSUInteger)renderCacheCapacity
+{
+    return renderCache.capacity;
+}
+
+- (void)setRenderCacheCapacity:(NSUInteger)renderCacheCapacity
+{
+    // The cache is updated in place: it may be in use on the processing queue
+    renderCache.capacity = renderCacheCapacity;
+}
+
+- (void)invalidateRenderCacheForEventId:(NSString*)eventId
+{
+    if (eventId)
+    {
+        [renderCache removeObjectsForEventId:eventId];
+    }
+}
+
+- (void)invalidateRenderCache
+{
+    [renderCache removeAllObjects];
+}
+
++ (NSArray<NSString*>*)renderCacheConfigurationKeyPaths
+{
+    static NSArray<NSString*> *keyPaths;
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keyPaths = @[
+                     @"settings", @"isForSubtitle",
+                     @"treatMatrixUserIdAsLink", @"treatMatrixRoomIdAsLink", @"treatMatrixRoomAliasAsLink", @"treatMatrixEventIdAsLink", @"treatMatrixGroupIdAsLink",
+                     @"allowedHTMLTags", @"defaultCSS", @"htmlRenderer",
+                     @"defaultTextColor", @"subTitleTextColor", @"prefixTextColor", @"bingTextColor", @"encryptingTextColor", @"sendingTextColor", @"errorTextColor", @"htmlBlockquoteBorderColor",
+                     @"defaultTextFont", @"prefixTextFont", @"bingTextFont", @"stateEventTextFont", @"callNoticesTextFont", @"encryptedMessagesTextFont", @"singleEmojiTextFont", @"emojiOnlyTextFont"
+                     ];
+    });
+    
+    return keyPaths;
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context
+{
+    if (context == kMXKEventFormatterRenderCacheConfigurationContext)
+    {
+        @synchronized(renderCache)
+        {
+            renderCacheConfigurationVersion++;
+        }
+        [renderCache removeAllObjects];
+    }
+    else
+    {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+    }
+}
+
+- (NSString*)renderCacheKeyForEvent:(MXEvent*)event withRoomState:(MXRoomState*)roomState
+{
+    if (!renderCache.capacity || !event.eventId || event.eventType != MXEventTypeRoomMessage || event.redactedBecause || event.isEditEvent)
+    {
+        return nil;
+    }
+    
+    NSUInteger configurationVersion;
+    @synchronized(renderCache)
+    {
+        configurationVersion = renderCacheConfigurationVersion;
+    }
+    
+    // The room state dependent display names
+    NSString *senderDisplayName = roomState ? [self senderDisplayNameForEvent:event withRoomState:roomState] : event.sender;
+    
+    NSString *replyToDisplayName;
+    NSDictionary *relatesTo;
+    MXJSONModelSetDictionary(relatesTo, event.content[@"m.relates_to"]);
+    if ([relatesTo[@"m.in_reply_to"] isKindOfClass:NSDictionary.class])
+    {
+        NSString *formattedBody;
+        MXJSONModelSetString(formattedBody, event.content[@"formatted_body"]);
+        if (formattedBody)
+        {
+            NSRange inReplyToLinkRange, inReplyToTextRange, userIdRange;
+            [self getReplyToLinkRange:&inReplyToLinkRange replyToTextRange:&inReplyToTextRange userIdRange:&userIdRange inHTMLString:formattedBody];
+            if (userIdRange.location != NSNotFound)
+            {
+                replyToDisplayName = [roomState.members memberName:[formattedBody substringWithRange:userIdRange]];
+            }
+        }
+    }
+    
+    return [NSString stringWithFormat:@"%@|%@|%tu|%d|%tu|%@|%@|%tu|%@|%@|%d|%d",
+            event.eventId,
+            event.unsignedData.relations.replace.eventId,
+            (NSUInteger)event.sentState,
+            event.mxkIsHighlighted,
+            (NSUInteger)event.mxkEventFormatterError,
+            senderDisplayName,
+            replyToDisplayName,
+            configurationVersion,
+            _settings.httpLinkScheme,
+            _settings.httpsLinkScheme,
+            _settings.showUnsupportedEventsInRoomHistory,
+            _settings.showRedactionsInRoomHistory];
 }
 
 #pragma mark - MXRoomSummaryUpdating
@@ -1916,28 +2118,37 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
             // Store the potential error
             summary.lastMessageOthers[@"mxkEventFormatterError"] = @(error);
             
-            summary.lastMessageOthers[@"lastEventDate"] = [self dateStringFromEvent:event withTime:YES];
-
             // Check whether the sender name has to be added
-            NSString *prefix = nil;
-
-            if (event.eventType == MXEventTypeRoomMessage)
+            NSString *senderDisplayName = nil;
+            if ([self isLastMessagePrefixedWithSenderForEvent:event])
+            {
+                senderDisplayName = [self senderDisplayNameForEvent:event withRoomState:roomState];
+            }
+            
+            if (_renderLastMessageOnDemand)
             {
-                NSString *msgtype = event.content[@"msgtype"];
-                if ([msgtype isEqualToString:kMXMessageTypeEmote] == NO)
+                // Keep only the inputs of the rendering, the room may never be displayed
+                summary.lastMessageAttributedString = nil;
+                [summary.lastMessageOthers removeObjectForKey:@"lastEventDate"];
+                
+                if (senderDisplayName)
                 {
-                    NSString *senderDisplayName = [self senderDisplayNameForEvent:event withRoomState:roomState];
-                    prefix = [NSString stringWithFormat:@"%@: ", senderDisplayName];
+                    summary.lastMessageOthers[@"mxkLastMessageSenderDisplayName"] = senderDisplayName;
                 }
+                else
+                {
+                    [summary.lastMessageOthers removeObjectForKey:@"mxkLastMessageSenderDisplayName"];
+                }
+                summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] = @(YES);
+                
+                atomic_fetch_add_explicit(&deferredLastMessagesCounter, 1, memory_order_relaxed);
             }
-            else if (event.eventType == MXEventTypeSticker)
+            else
             {
-                NSString *senderDisplayName = [self senderDisplayNameForEvent:event withRoomState:roomState];
-                prefix = [NSString stringWithFormat:@"%@: ", senderDisplayName];
+                summary.lastMessageOthers[@"lastEventDate"] = [self dateStringFromEvent:event withTime:YES];
+                
+                [self renderLastMessageOfRoomSummary:summary withEvent:event senderDisplayName:senderDisplayName];
             }
-
-            // Compute the attribute text message
-            summary.lastMessageAttributedString = [self renderString:summary.lastMessageString withPrefix:prefix forEvent:event];
         }
     }
     
@@ -1950,6 +2161,79 @@ static NSString *const kHTMLATagRegexPattern = @"<a href=\"(.*?)\">([^<]*)</a>";
 }
 
 
+#pragma mark - Room summaries
+
+- (NSUInteger)renderedLastMessagesCount
+{
+    return atomic_load_explicit(&renderedLastMessagesCounter, memory_order_relaxed);
+}
+
+- (NSUInteger)deferredLastMessagesCount
+{
+    return atomic_load_explicit(&deferredLastMessagesCounter, memory_order_relaxed);
+}
+
+- (BOOL)renderLastMessageIfNeededForRoomSummary:(MXRoomSummary *)summary
+{
+    if (![summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] boolValue])
+    {
+        return NO;
+    }
+    
+    MXEvent *event = summary.lastMessageEvent;
+    if (!event)
+    {
+        return NO;
+    }
+    event.mxkEventFormatterError = [((NSNumber*)summary.lastMessageOthers[@"mxkEventFormatterError"]) intValue];
+    
+    summary.lastMessageOthers[@"lastEventDate"] = [self dateStringFromEvent:event withTime:YES];
+    
+    NSString *senderDisplayName = nil;
+    if ([self isLastMessagePrefixedWithSenderForEvent:event])
+    {
+        senderDisplayName = summary.lastMessageOthers[@"mxkLastMessageSenderDisplayName"];
+        if (!senderDisplayName)
+        {
+            senderDisplayName = event.sender;
+        }
+    }
+    
+    [self renderLastMessageOfRoomSummary:summary withEvent:event senderDisplayName:senderDisplayName];
+    
+    // Keep the rendering in the store, it will be saved with the next commit of the session
+    [summary.mxSession.store storeSummaryForRoom:summary.roomId summary:summary];
+    
+    return YES;
+}
+
+// Tell whether the preview of the last message starts with the sender display name
+- (BOOL)isLastMessagePrefixedWithSenderForEvent:(MXEvent*)event
+{
+    if (event.eventType == MXEventTypeRoomMessage)
+    {
+        NSString *msgtype = event.content[@"msgtype"];
+        return ([msgtype isEqualToString:kMXMessageTypeEmote] == NO);
+    }
+    
+    return (event.eventType == MXEventTypeSticker);
+}
+
+- (void)renderLastMessageOfRoomSummary:(MXRoomSummary*)summary withEvent:(MXEvent*)event senderDisplayName:(NSString*)senderDisplayName
+{
+    NSString *prefix = nil;
+    if (senderDisplayName)
+    {
+        prefix = [NSString stringWithFormat:@"%@: ", senderDisplayName];
+    }
+    
+    // Compute the attribute text message
+    summary.lastMessageAttributedString = [self renderString:summary.lastMessageString withPrefix:prefix forEvent:event];
+    [summary.lastMessageOthers removeObjectForKey:@"mxkLastMessageNeedsRendering"];
+    
+    atomic_fetch_add_explicit(&renderedLastMessagesCounter, 1, memory_order_relaxed);
+}
+
 #pragma mark - Conversion private methods
 
 /**
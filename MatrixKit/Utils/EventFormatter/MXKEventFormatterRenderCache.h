@@ -0,0 +1,80 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKEventFormatterRenderCache` is a bounded LRU cache of rendered event strings.
+
+ Each entry is associated to the id of the event it renders, so that all the renderings of an event
+ can be discarded at once. The cache is emptied on memory warning.
+ This class is thread safe.
+ */
+@interface MXKEventFormatterRenderCache : NSObject
+
+/**
+ Create a cache.
+
+ @param capacity the maximum number of entries.
+ @return the newly created instance.
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/**
+ The maximum number of entries. The least recently used entries are removed beyond this limit.
+ 0 disables the cache.
+ */
+@property (nonatomic) NSUInteger capacity;
+
+/**
+ The current number of entries.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Get an entry and mark it as the most recently used one.
+
+ @param key the key of the entry.
+ @return the cached object, or nil.
+ */
+- (nullable id)objectForKey:(NSString*)key;
+
+/**
+ Store an entry.
+
+ @param object the object to cache.
+ @param key the key of the entry.
+ @param eventId the id of the rendered event.
+ */
+- (void)setObject:(id)object forKey:(NSString*)key eventId:(NSString*)eventId;
+
+/**
+ Remove all the entries related to an event.
+
+ @param eventId the event id.
+ */
+- (void)removeObjectsForEventId:(NSString*)eventId;
+
+/**
+ Remove all the entries.
+ */
+- (void)removeAllObjects;
+
+@end
+
+NS_ASSUME_NONNULL_END
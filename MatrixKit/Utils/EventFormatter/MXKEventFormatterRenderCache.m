@@ -0,0 +1,208 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKEventFormatterRenderCache.h"
+
+#import <UIKit/UIKit.h>
+
+@import MatrixSDK;
+
+@interface MXKEventFormatterRenderCache ()
+{
+    /**
+     The cached objects by key.
+     */
+    NSMutableDictionary<NSString*, id> *objects;
+
+    /**
+     The keys ordered from the least to the most recently used.
+     */
+    NSMutableOrderedSet<NSString*> *keys;
+
+    /**
+     The event id of each key, and the keys of each event id.
+     */
+    NSMutableDictionary<NSString*, NSString*> *eventIdByKey;
+    NSMutableDictionary<NSString*, NSMutableSet<NSString*>*> *keysByEventId;
+
+    /**
+     Observe UIApplicationDidReceiveMemoryWarningNotification to empty the cache.
+     */
+    id UIApplicationDidReceiveMemoryWarningNotificationObserver;
+}
+
+@end
+
+@implementation MXKEventFormatterRenderCache
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self)
+    {
+        _capacity = capacity;
+
+        objects = [NSMutableDictionary dictionaryWithCapacity:capacity];
+        keys = [NSMutableOrderedSet orderedSetWithCapacity:capacity];
+        eventIdByKey = [NSMutableDictionary dictionaryWithCapacity:capacity];
+        keysByEventId = [NSMutableDictionary dictionary];
+
+        MXWeakify(self);
+        UIApplicationDidReceiveMemoryWarningNotificationObserver = [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidReceiveMemoryWarningNotification object:nil queue:nil usingBlock:^(NSNotification *notif) {
+
+            MXStrongifyAndReturnIfNil(self);
+            [self removeAllObjects];
+        }];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (UIApplicationDidReceiveMemoryWarningNotificationObserver)
+    {
+        [[NSNotificationCenter defaultCenter] removeObserver:UIApplicationDidReceiveMemoryWarningNotificationObserver];
+        UIApplicationDidReceiveMemoryWarningNotificationObserver = nil;
+    }
+}
+
+- (NSUInteger)capacity
+{
+    @synchronized(self)
+    {
+        return _capacity;
+    }
+}
+
+- (void)setCapacity:(NSUInteger)capacity
+{
+    @synchronized(self)
+    {
+        _capacity = capacity;
+        [self evictToCapacity];
+    }
+}
+
+- (NSUInteger)count
+{
+    @synchronized(self)
+    {
+        return objects.count;
+    }
+}
+
+- (id)objectForKey:(NSString*)key
+{
+    @synchronized(self)
+    {
+        id object = objects[key];
+        if (object)
+        {
+            // Move the key to the most recently used position
+            [keys removeObject:key];
+            [keys addObject:key];
+        }
+        return object;
+    }
+}
+
+- (void)setObject:(id)object forKey:(NSString*)key eventId:(NSString*)eventId
+{
+    @synchronized(self)
+    {
+        if (!_capacity)
+        {
+            return;
+        }
+
+        [self removeObjectForKey:key];
+
+        objects[key] = object;
+        [keys addObject:key];
+
+        eventIdByKey[key] = eventId;
+        NSMutableSet<NSString*> *eventKeys = keysByEventId[eventId];
+        if (!eventKeys)
+        {
+            eventKeys = [NSMutableSet set];
+            keysByEventId[eventId] = eventKeys;
+        }
+        [eventKeys addObject:key];
+
+        [self evictToCapacity];
+    }
+}
+
+- (void)removeObjectsForEventId:(NSString*)eventId
+{
+    @synchronized(self)
+    {
+        for (NSString *key in [keysByEventId[eventId] copy])
+        {
+            [self removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)removeAllObjects
+{
+    @synchronized(self)
+    {
+        [objects removeAllObjects];
+        [keys removeAllObjects];
+        [eventIdByKey removeAllObjects];
+        [keysByEventId removeAllObjects];
+    }
+}
+
+#pragma mark - Private methods
+
+// Must be called under @synchronized(self)
+- (void)evictToCapacity
+{
+    // Evict the least recently used entries
+    while (keys.count > _capacity)
+    {
+        [self removeObjectForKey:keys.firstObject];
+    }
+}
+
+// Must be called under @synchronized(self)
+- (void)removeObjectForKey:(NSString*)key
+{
+    if (!objects[key])
+    {
+        return;
+    }
+
+    [objects removeObjectForKey:key];
+    [keys removeObject:key];
+
+    NSString *eventId = eventIdByKey[key];
+    if (eventId)
+    {
+        [eventIdByKey removeObjectForKey:key];
+
+        NSMutableSet<NSString*> *eventKeys = keysByEventId[eventId];
+        [eventKeys removeObject:key];
+        if (!eventKeys.count)
+        {
+            [keysByEventId removeObjectForKey:eventId];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,74 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKHTMLRenderer` renders the HTML subset used by Matrix formatted bodies in a single pass.
+
+ It supports the b, strong, i, em, u, del, strike, s, code, pre, a, br, p, blockquote, ul, ol, li,
+ font and mx-reply tags, and the common character entities. The resulting attributed string matches
+ the DTCoreText rendering done by `MXKEventFormatter` with its default CSS (text, links, font traits,
+ code blocks, marked blockquotes, indents and paragraph spacing) once its artifacts are removed, so no
+ cleanup pass is required.
+
+ Any other HTML construct (tag, attribute, entity, comment or malformed markup) is rejected so that
+ the caller can fall back to DTCoreText.
+
+ This class is immutable and can be used from any thread.
+ */
+@interface MXKHTMLRenderer : NSObject
+
+/**
+ Create a renderer with the style of the `MXKEventFormatter` default CSS.
+ */
+- (instancetype)init;
+
+/**
+ Create a renderer.
+
+ @param codeFont the font of the code and preformatted texts.
+ @param codeBackgroundColor the background color of the code and preformatted texts.
+ @return the newly created instance.
+ */
+- (instancetype)initWithCodeFont:(UIFont*)codeFont codeBackgroundColor:(UIColor*)codeBackgroundColor NS_DESIGNATED_INITIALIZER;
+
+/**
+ The font of the code and preformatted texts. Default is Menlo-Regular 13.
+ */
+@property (nonatomic, readonly) UIFont *codeFont;
+
+/**
+ The background color of the code and preformatted texts. Default is #EEEEEE.
+ */
+@property (nonatomic, readonly) UIColor *codeBackgroundColor;
+
+/**
+ Render an HTML string.
+
+ @param htmlString the sanitised HTML string.
+ @param font the default font.
+ @param textColor the default text color.
+ @return the rendered string, or nil if the HTML string is not part of the supported subset.
+ */
+- (nullable NSAttributedString*)renderHTMLString:(NSString*)htmlString withFont:(UIFont*)font textColor:(UIColor*)textColor;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,957 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKHTMLRenderer.h"
+
+#import "MXKTools.h"
+
+// The indentation of the blockquote blocks and of the list items
+#define MXKHTMLRENDERER_BLOCKQUOTE_INDENT 25.0
+#define MXKHTMLRENDERER_LIST_INDENT 27.0
+
+// The position of the list item markers in the list indentation
+#define MXKHTMLRENDERER_LIST_MARKER_OFFSET 11.0
+
+// The vertical margins of the p, blockquote, ul and ol blocks in the DTCoreText default stylesheet (in em)
+#define MXKHTMLRENDERER_BLOCK_MARGIN 1.0
+
+// The character DTCoreText uses to render a <br>
+#define MXKHTMLRENDERER_LINE_SEPARATOR 0x2028
+
+static inline BOOL MXKHTMLRendererIsWhitespace(UTF32Char character)
+{
+    return (character == ' ' || character == '\t' || character == '\n' || character == '\r' || character == '\f');
+}
+
+static inline BOOL MXKHTMLRendererIsTagNameCharacter(unichar character)
+{
+    return ((character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9') || character == '-');
+}
+
+#pragma mark - MXKHTMLRendererState
+
+/**
+ The style applied by an opened HTML element.
+ */
+@interface MXKHTMLRendererState : NSObject <NSCopying>
+
+@property (nonatomic) NSString *tagName;
+
+@property (nonatomic) BOOL bold;
+@property (nonatomic) BOOL italic;
+@property (nonatomic) BOOL underline;
+@property (nonatomic) BOOL strikethrough;
+@property (nonatomic) BOOL code;
+@property (nonatomic) BOOL preformatted;
+@property (nonatomic) NSURL *link;
+@property (nonatomic) UIColor *color;
+@property (nonatomic) NSUInteger blockquoteLevel;
+@property (nonatomic) NSUInteger listLevel;
+
+/**
+ The paragraph spacing set by the closest block element, as DTCoreText does with the block margins.
+ */
+@property (nonatomic) CGFloat paragraphSpacingBefore;
+@property (nonatomic) CGFloat paragraphSpacing;
+
+/**
+ The numbering of the list opened by this element (if any). It is not inherited.
+ */
+@property (nonatomic) BOOL orderedList;
+@property (nonatomic) NSUInteger listItemCount;
+
+/**
+ The output length after the prefix of the list item opened by this element. It is not inherited.
+ */
+@property (nonatomic) NSUInteger listItemPrefixEnd;
+
+/**
+ Tell whether the whitespace is rendered as is.
+ */
+@property (nonatomic, readonly) BOOL preservesWhitespace;
+
+/**
+ The text attributes computed for this style.
+ */
+@property (nonatomic) NSDictionary<NSString*, id> *attributes;
+
+@end
+
+@implementation MXKHTMLRendererState
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    MXKHTMLRendererState *state = [[MXKHTMLRendererState allocWithZone:zone] init];
+    
+    state.bold = _bold;
+    state.italic = _italic;
+    state.underline = _underline;
+    state.strikethrough = _strikethrough;
+    state.code = _code;
+    state.preformatted = _preformatted;
+    state.link = _link;
+    state.color = _color;
+    state.blockquoteLevel = _blockquoteLevel;
+    state.listLevel = _listLevel;
+    state.paragraphSpacingBefore = _paragraphSpacingBefore;
+    state.paragraphSpacing = _paragraphSpacing;
+    
+    return state;
+}
+
+- (BOOL)preservesWhitespace
+{
+    // The default CSS applies "white-space: pre" to code too
+    return _preformatted || _code;
+}
+
+@end
+
+#pragma mark - MXKHTMLRendererBuilder
+
+/**
+ The rendering of one HTML string.
+ */
+@interface MXKHTMLRendererBuilder : NSObject
+{
+    MXKHTMLRenderer *renderer;
+    UIFont *defaultFont;
+    UIColor *defaultTextColor;
+    
+    /**
+     The opened elements. The first one is the root style.
+     */
+    NSMutableArray<MXKHTMLRendererState*> *stateStack;
+    
+    /**
+     The rendered characters.
+     */
+    unichar *output;
+    NSUInteger outputLength;
+    NSUInteger outputCapacity;
+    
+    /**
+     The attribute runs of the rendered characters.
+     */
+    NSMutableArray<NSValue*> *runRanges;
+    NSMutableArray<NSDictionary*> *runAttributes;
+    NSDictionary *currentRunAttributes;
+    NSUInteger currentRunStart;
+    
+    /**
+     The whitespace handling state.
+     */
+    BOOL lineHasContent;
+    BOOL hasPendingSpace;
+    BOOL skipsNextNewline;
+}
+
+- (instancetype)initWithRenderer:(MXKHTMLRenderer*)renderer font:(UIFont*)font textColor:(UIColor*)textColor;
+
+- (NSAttributedString*)attributedStringFromHTMLString:(NSString*)htmlString;
+
+@end
+
+@implementation MXKHTMLRendererBuilder
+
+- (instancetype)initWithRenderer:(MXKHTMLRenderer*)theRenderer font:(UIFont*)font textColor:(UIColor*)textColor
+{
+    self = [super init];
+    if (self)
+    {
+        renderer = theRenderer;
+        defaultFont = font;
+        defaultTextColor = textColor;
+        
+        stateStack = [NSMutableArray arrayWithObject:[[MXKHTMLRendererState alloc] init]];
+        runRanges = [NSMutableArray array];
+        runAttributes = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(output);
+}
+
+- (NSAttributedString*)attributedStringFromHTMLString:(NSString*)htmlString
+{
+    NSUInteger length = htmlString.length;
+    unichar *characters = malloc(MAX(length, 1) * sizeof(unichar));
+    [htmlString getCharacters:characters range:NSMakeRange(0, length)];
+    
+    BOOL success = YES;
+    NSUInteger index = 0;
+    while (success && index < length)
+    {
+        unichar character = characters[index];
+        if (character == '<')
+        {
+            success = [self parseTagInCharacters:characters length:length index:&index];
+        }
+        else if (character == '&')
+        {
+            UTF32Char decodedCharacter;
+            success = [MXKHTMLRendererBuilder parseEntityInCharacters:characters length:length index:&index character:&decodedCharacter];
+            if (success)
+            {
+                [self appendTextCharacter:decodedCharacter];
+            }
+        }
+        else
+        {
+            [self appendTextCharacter:character];
+            index++;
+        }
+    }
+    
+    free(characters);
+    
+    // All the elements must have been closed
+    if (!success || stateStack.count != 1)
+    {
+        return nil;
+    }
+    
+    [self closeRun];
+    
+    // Trim trailing whitespace and newlines like the DTCoreText artifacts removal does
+    NSCharacterSet *whitespaceAndNewlineCharacterSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    while (outputLength && [whitespaceAndNewlineCharacterSet characterIsMember:output[outputLength - 1]])
+    {
+        outputLength--;
+    }
+    
+    NSString *string = outputLength ? [[NSString alloc] initWithCharacters:output length:outputLength] : @"";
+    NSMutableAttributedString *attributedString = [[NSMutableAttributedString alloc] initWithString:string];
+    
+    [attributedString beginEditing];
+    for (NSUInteger runIndex = 0; runIndex < runRanges.count; runIndex++)
+    {
+        NSRange range = runRanges[runIndex].rangeValue;
+        if (range.location >= outputLength)
+        {
+            break;
+        }
+        range.length = MIN(range.length, outputLength - range.location);
+        
+        [attributedString setAttributes:runAttributes[runIndex] range:range];
+    }
+    [attributedString endEditing];
+    
+    return attributedString;
+}
+
+#pragma mark - Text output
+
+- (MXKHTMLRendererState*)state
+{
+    return stateStack.lastObject;
+}
+
+- (void)appendTextCharacter:(UTF32Char)character
+{
+    MXKHTMLRendererState *state = self.state;
+    
+    if (skipsNextNewline)
+    {
+        // A newline right after <pre> is ignored
+        skipsNextNewline = NO;
+        if (character == '\n')
+        {
+            return;
+        }
+    }
+    
+    if (state.preservesWhitespace)
+    {
+        if (character == '\r')
+        {
+            return;
+        }
+    }
+    else if (MXKHTMLRendererIsWhitespace(character))
+    {
+        // Collapse the whitespace
+        hasPendingSpace = YES;
+        return;
+    }
+    
+    if (hasPendingSpace)
+    {
+        hasPendingSpace = NO;
+        
+        // Leading whitespace is not rendered
+        if (lineHasContent)
+        {
+            [self appendOutputCharacter:' '];
+        }
+    }
+    
+    [self appendOutputCharacter:character];
+    lineHasContent = (character != '\n');
+}
+
+/**
+ Start a new line if the current one has some content.
+ */
+- (void)breakLine
+{
+    if (lineHasContent)
+    {
+        [self appendOutputCharacter:'\n'];
+        lineHasContent = NO;
+    }
+    hasPendingSpace = NO;
+}
+
+- (void)appendOutputCharacter:(UTF32Char)character
+{
+    // Update the attribute runs
+    NSDictionary *attributes = [self attributesForState:self.state];
+    if (attributes != currentRunAttributes)
+    {
+        [self closeRun];
+        currentRunAttributes = attributes;
+        currentRunStart = outputLength;
+    }
+    
+    if (outputLength + 2 > outputCapacity)
+    {
+        outputCapacity = MAX(64, outputCapacity * 2);
+        output = realloc(output, outputCapacity * sizeof(unichar));
+    }
+    
+    if (character > 0xFFFF)
+    {
+        UniChar surrogates[2];
+        CFStringGetSurrogatePairForLongCharacter(character, surrogates);
+        output[outputLength++] = surrogates[0];
+        output[outputLength++] = surrogates[1];
+    }
+    else
+    {
+        output[outputLength++] = (unichar)character;
+    }
+}
+
+- (void)closeRun
+{
+    if (currentRunAttributes && outputLength > currentRunStart)
+    {
+        [runRanges addObject:[NSValue valueWithRange:NSMakeRange(currentRunStart, outputLength - currentRunStart)]];
+        [runAttributes addObject:currentRunAttributes];
+    }
+    currentRunAttributes = nil;
+}
+
+- (NSDictionary*)attributesForState:(MXKHTMLRendererState*)state
+{
+    if (state.attributes)
+    {
+        return state.attributes;
+    }
+    
+    NSMutableDictionary *attributes = [NSMutableDictionary dictionary];
+    
+    UIFont *font = state.preservesWhitespace ? renderer.codeFont : defaultFont;
+    UIFontDescriptorSymbolicTraits traits = 0;
+    if (state.bold)
+    {
+        traits |= UIFontDescriptorTraitBold;
+    }
+    if (state.italic)
+    {
+        traits |= UIFontDescriptorTraitItalic;
+    }
+    if (traits)
+    {
+        UIFontDescriptor *fontDescriptor = [font.fontDescriptor fontDescriptorWithSymbolicTraits:(font.fontDescriptor.symbolicTraits | traits)];
+        if (fontDescriptor)
+        {
+            font = [UIFont fontWithDescriptor:fontDescriptor size:font.pointSize];
+        }
+    }
+    attributes[NSFontAttributeName] = font;
+    attributes[NSForegroundColorAttributeName] = state.color ?: defaultTextColor;
+    
+    if (state.preservesWhitespace)
+    {
+        attributes[NSBackgroundColorAttributeName] = renderer.codeBackgroundColor;
+    }
+    if (state.underline)
+    {
+        attributes[NSUnderlineStyleAttributeName] = @(NSUnderlineStyleSingle);
+    }
+    if (state.strikethrough)
+    {
+        attributes[NSStrikethroughStyleAttributeName] = @(NSUnderlineStyleSingle);
+    }
+    if (state.link)
+    {
+        attributes[NSLinkAttributeName] = state.link;
+    }
+    
+    if (state.blockquoteLevel || state.listLevel || state.paragraphSpacingBefore || state.paragraphSpacing)
+    {
+        CGFloat indent = state.blockquoteLevel * MXKHTMLRENDERER_BLOCKQUOTE_INDENT + state.listLevel * MXKHTMLRENDERER_LIST_INDENT;
+        
+        NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+        paragraphStyle.headIndent = indent;
+        paragraphStyle.firstLineHeadIndent = indent;
+        paragraphStyle.paragraphSpacingBefore = state.paragraphSpacingBefore;
+        paragraphStyle.paragraphSpacing = state.paragraphSpacing;
+        
+        if (state.listLevel)
+        {
+            // The first line starts with the "\t<marker>\t" prefix of the list item
+            paragraphStyle.firstLineHeadIndent = indent - MXKHTMLRENDERER_LIST_INDENT;
+            paragraphStyle.tabStops = @[
+                                        [[NSTextTab alloc] initWithTextAlignment:NSTextAlignmentLeft location:paragraphStyle.firstLineHeadIndent + MXKHTMLRENDERER_LIST_MARKER_OFFSET options:@{}],
+                                        [[NSTextTab alloc] initWithTextAlignment:NSTextAlignmentLeft location:indent options:@{}]
+                                        ];
+        }
+        
+        attributes[NSParagraphStyleAttributeName] = paragraphStyle;
+    }
+    
+    if (state.blockquoteLevel)
+    {
+        attributes[kMXKToolsBlockquoteMarkAttribute] = @(YES);
+    }
+    
+    state.attributes = attributes;
+    return attributes;
+}
+
+#pragma mark - Elements
+
+/**
+ Parse a tag and apply it.
+
+ @param characters the HTML string characters.
+ @param length the number of characters.
+ @param index the index of the '<' character. On success, it is moved after the tag.
+ @return NO if the tag is not supported.
+ */
+- (BOOL)parseTagInCharacters:(const unichar*)characters length:(NSUInteger)length index:(NSUInteger*)index
+{
+    NSUInteger position = *index + 1;
+    
+    BOOL isClosingTag = (position < length && characters[position] == '/');
+    if (isClosingTag)
+    {
+        position++;
+    }
+    
+    // Tag name. Comments, doctypes and bare '<' characters are not supported
+    NSUInteger nameStart = position;
+    while (position < length && (MXKHTMLRendererIsTagNameCharacter(characters[position])))
+    {
+        position++;
+    }
+    if (position == nameStart)
+    {
+        return NO;
+    }
+    NSString *tagName = [[NSString alloc] initWithCharacters:characters + nameStart length:position - nameStart].lowercaseString;
+    
+    // Attributes
+    NSMutableDictionary<NSString*, NSString*> *attributes;
+    BOOL isSelfClosing = NO;
+    while (YES)
+    {
+        while (position < length && MXKHTMLRendererIsWhitespace(characters[position]))
+        {
+            position++;
+        }
+        if (position >= length)
+        {
+            return NO;
+        }
+        
+        unichar character = characters[position];
+        if (character == '>')
+        {
+            position++;
+            break;
+        }
+        else if (character == '/')
+        {
+            position++;
+            if (position >= length || characters[position] != '>')
+            {
+                return NO;
+            }
+            isSelfClosing = YES;
+            continue;
+        }
+        else if (isClosingTag)
+        {
+            return NO;
+        }
+        
+        // Attribute name
+        NSUInteger attributeNameStart = position;
+        while (position < length && !MXKHTMLRendererIsWhitespace(characters[position]) && characters[position] != '=' && characters[position] != '>' && characters[position] != '/')
+        {
+            position++;
+        }
+        NSString *attributeName = [[NSString alloc] initWithCharacters:characters + attributeNameStart length:position - attributeNameStart].lowercaseString;
+        
+        while (position < length && MXKHTMLRendererIsWhitespace(characters[position]))
+        {
+            position++;
+        }
+        
+        // Attribute value
+        NSString *attributeValue = @"";
+        if (position < length && characters[position] == '=')
+        {
+            position++;
+            while (position < length && MXKHTMLRendererIsWhitespace(characters[position]))
+            {
+                position++;
+            }
+            if (position >= length)
+            {
+                return NO;
+            }
+            
+            NSUInteger valueStart, valueEnd;
+            unichar quote = characters[position];
+            if (quote == '"' || quote == '\'')
+            {
+                valueStart = ++position;
+                while (position < length && characters[position] != quote)
+                {
+                    position++;
+                }
+                if (position >= length)
+                {
+                    return NO;
+                }
+                valueEnd = position++;
+            }
+            else
+            {
+                valueStart = position;
+                while (position < length && !MXKHTMLRendererIsWhitespace(characters[position]) && characters[position] != '>')
+                {
+                    position++;
+                }
+                valueEnd = position;
+            }
+            
+            attributeValue = [MXKHTMLRendererBuilder decodeEntitiesInCharacters:characters + valueStart length:valueEnd - valueStart];
+            if (!attributeValue)
+            {
+                return NO;
+            }
+        }
+        
+        if (!attributes)
+        {
+            attributes = [NSMutableDictionary dictionary];
+        }
+        attributes[attributeName] = attributeValue;
+    }
+    
+    *index = position;
+    
+    if (isClosingTag)
+    {
+        return [self closeElement:tagName];
+    }
+    else if ([tagName isEqualToString:@"br"])
+    {
+        // DTCoreText renders it with a line separator
+        [self appendOutputCharacter:MXKHTMLRENDERER_LINE_SEPARATOR];
+        lineHasContent = NO;
+        hasPendingSpace = NO;
+        return !attributes.count;
+    }
+    else if (isSelfClosing)
+    {
+        return NO;
+    }
+    
+    return [self openElement:tagName withAttributes:attributes];
+}
+
+/**
+ The attributes supported by each element. The other attributes are ignored by DTCoreText.
+ */
++ (NSDictionary<NSString*, NSSet<NSString*>*>*)supportedAttributes
+{
+    static NSDictionary<NSString*, NSSet<NSString*>*> *supportedAttributes;
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        supportedAttributes = @{
+                                @"a": [NSSet setWithObjects:@"href", @"title", @"target", @"rel", nil],
+                                @"font": [NSSet setWithObjects:@"color", @"data-mx-color", @"data-mx-bg-color", nil],
+                                @"code": [NSSet setWithObjects:@"class", nil],
+                                @"pre": [NSSet setWithObjects:@"class", nil]
+                                };
+    });
+    
+    return supportedAttributes;
+}
+
+- (BOOL)openElement:(NSString*)tagName withAttributes:(NSDictionary<NSString*, NSString*>*)attributes
+{
+    NSSet<NSString*> *supportedAttributes = MXKHTMLRendererBuilder.supportedAttributes[tagName];
+    for (NSString *attributeName in attributes)
+    {
+        if (![supportedAttributes containsObject:attributeName])
+        {
+            return NO;
+        }
+    }
+    
+    MXKHTMLRendererState *parentState = self.state;
+    MXKHTMLRendererState *state = [parentState copy];
+    state.tagName = tagName;
+    
+    if ([tagName isEqualToString:@"b"] || [tagName isEqualToString:@"strong"])
+    {
+        state.bold = YES;
+    }
+    else if ([tagName isEqualToString:@"i"] || [tagName isEqualToString:@"em"])
+    {
+        state.italic = YES;
+    }
+    else if ([tagName isEqualToString:@"u"])
+    {
+        state.underline = YES;
+    }
+    else if ([tagName isEqualToString:@"del"] || [tagName isEqualToString:@"strike"] || [tagName isEqualToString:@"s"])
+    {
+        state.strikethrough = YES;
+    }
+    else if ([tagName isEqualToString:@"code"])
+    {
+        state.code = YES;
+    }
+    else if ([tagName isEqualToString:@"a"])
+    {
+        NSString *href = attributes[@"href"];
+        if (href)
+        {
+            state.link = [NSURL URLWithString:href];
+            if (!state.link)
+            {
+                return NO;
+            }
+        }
+    }
+    else if ([tagName isEqualToString:@"font"])
+    {
+        NSString *color = attributes[@"color"];
+        if (color)
+        {
+            state.color = [MXKHTMLRendererBuilder colorFromHexString:color];
+            if (!state.color)
+            {
+                return NO;
+            }
+        }
+    }
+    else if ([tagName isEqualToString:@"p"])
+    {
+        [self breakLine];
+        [self applyBlockMarginsToState:state];
+    }
+    else if ([tagName isEqualToString:@"mx-reply"])
+    {
+        [self breakLine];
+    }
+    else if ([tagName isEqualToString:@"pre"])
+    {
+        // The default CSS displays pre inline: there is no block margin
+        [self breakLine];
+        state.preformatted = YES;
+        skipsNextNewline = YES;
+    }
+    else if ([tagName isEqualToString:@"blockquote"])
+    {
+        [self breakLine];
+        [self applyBlockMarginsToState:state];
+        state.blockquoteLevel++;
+    }
+    else if ([tagName isEqualToString:@"ul"] || [tagName isEqualToString:@"ol"])
+    {
+        [self breakLine];
+        [self applyBlockMarginsToState:state];
+        state.listLevel++;
+        state.orderedList = [tagName isEqualToString:@"ol"];
+    }
+    else if ([tagName isEqualToString:@"li"])
+    {
+        if (![parentState.tagName isEqualToString:@"ul"] && ![parentState.tagName isEqualToString:@"ol"])
+        {
+            return NO;
+        }
+        
+        [self breakLine];
+        
+        // A list item has no margin: its paragraphs are not spaced
+        state.paragraphSpacingBefore = 0;
+        state.paragraphSpacing = 0;
+        [stateStack addObject:state];
+        
+        // Prefix the item like DTCoreText does
+        NSString *prefix;
+        if (parentState.orderedList)
+        {
+            parentState.listItemCount++;
+            prefix = [NSString stringWithFormat:@"\t%tu.\t", parentState.listItemCount];
+        }
+        else
+        {
+            prefix = @"\t•\t";
+        }
+        for (NSUInteger index = 0; index < prefix.length; index++)
+        {
+            [self appendOutputCharacter:[prefix characterAtIndex:index]];
+        }
+        state.listItemPrefixEnd = outputLength;
+        return YES;
+    }
+    else
+    {
+        return NO;
+    }
+    
+    [stateStack addObject:state];
+    return YES;
+}
+
+/**
+ Apply the vertical margins of a block element to the paragraphs it contains.
+
+ @param state the style of the block element.
+ */
+- (void)applyBlockMarginsToState:(MXKHTMLRendererState*)state
+{
+    CGFloat margin = MXKHTMLRENDERER_BLOCK_MARGIN * defaultFont.pointSize;
+    state.paragraphSpacingBefore = margin;
+    state.paragraphSpacing = margin;
+}
+
+- (BOOL)closeElement:(NSString*)tagName
+{
+    if ([tagName isEqualToString:@"br"])
+    {
+        return YES;
+    }
+    
+    // Only well formed HTML is supported
+    if (stateStack.count < 2 || ![self.state.tagName isEqualToString:tagName])
+    {
+        return NO;
+    }
+    
+    if ([tagName isEqualToString:@"li"] && outputLength == self.state.listItemPrefixEnd)
+    {
+        // An empty item ends its line too: its prefix is not line content
+        [self appendOutputCharacter:'\n'];
+        lineHasContent = NO;
+        hasPendingSpace = NO;
+    }
+    else if ([tagName isEqualToString:@"p"] || [tagName isEqualToString:@"mx-reply"] || [tagName isEqualToString:@"pre"]
+        || [tagName isEqualToString:@"blockquote"] || [tagName isEqualToString:@"ul"] || [tagName isEqualToString:@"ol"] || [tagName isEqualToString:@"li"])
+    {
+        [self breakLine];
+    }
+    skipsNextNewline = NO;
+    
+    [stateStack removeLastObject];
+    return YES;
+}
+
+#pragma mark - Character references
+
+/**
+ Parse a character reference.
+
+ @param characters the HTML string characters.
+ @param length the number of characters.
+ @param index the index of the '&' character. On success, it is moved after the reference.
+ @param character the decoded character.
+ @return NO if the reference is not supported.
+ */
++ (BOOL)parseEntityInCharacters:(const unichar*)characters length:(NSUInteger)length index:(NSUInteger*)index character:(UTF32Char*)character
+{
+    // Look for the terminating ';' among the next characters
+    NSUInteger nameStart = *index + 1;
+    NSUInteger position = nameStart;
+    while (position < length && position - nameStart < 10 && characters[position] != ';')
+    {
+        position++;
+    }
+    if (position >= length || characters[position] != ';' || position == nameStart)
+    {
+        return NO;
+    }
+    
+    NSString *name = [[NSString alloc] initWithCharacters:characters + nameStart length:position - nameStart];
+    
+    if ([name hasPrefix:@"#"])
+    {
+        BOOL isHexadecimal = (name.length > 1 && ([name characterAtIndex:1] == 'x' || [name characterAtIndex:1] == 'X'));
+        NSString *digits = [name substringFromIndex:(isHexadecimal ? 2 : 1)];
+        
+        NSCharacterSet *invalidCharacterSet = isHexadecimal ? [NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"].invertedSet : [NSCharacterSet decimalDigitCharacterSet].invertedSet;
+        if (!digits.length || [digits rangeOfCharacterFromSet:invalidCharacterSet].location != NSNotFound)
+        {
+            return NO;
+        }
+        
+        unsigned long long value = strtoull(digits.UTF8String, NULL, (isHexadecimal ? 16 : 10));
+        if (!value || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+        {
+            return NO;
+        }
+        *character = (UTF32Char)value;
+    }
+    else
+    {
+        static NSDictionary<NSString*, NSNumber*> *namedEntities;
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            namedEntities = @{
+                              @"amp": @('&'),
+                              @"lt": @('<'),
+                              @"gt": @('>'),
+                              @"quot": @('"'),
+                              @"apos": @('\''),
+                              @"nbsp": @(0xA0)
+                              };
+        });
+        
+        NSNumber *value = namedEntities[name];
+        if (!value)
+        {
+            return NO;
+        }
+        *character = value.unsignedIntValue;
+    }
+    
+    *index = position + 1;
+    return YES;
+}
+
++ (NSString*)decodeEntitiesInCharacters:(const unichar*)characters length:(NSUInteger)length
+{
+    NSMutableString *string = [NSMutableString stringWithCapacity:length];
+    
+    NSUInteger index = 0;
+    while (index < length)
+    {
+        if (characters[index] == '&')
+        {
+            UTF32Char character;
+            if (![self parseEntityInCharacters:characters length:length index:&index character:&character])
+            {
+                return nil;
+            }
+            
+            if (character > 0xFFFF)
+            {
+                UniChar surrogates[2];
+                CFStringGetSurrogatePairForLongCharacter(character, surrogates);
+                [string appendString:[NSString stringWithCharacters:surrogates length:2]];
+            }
+            else
+            {
+                unichar shortCharacter = (unichar)character;
+                [string appendString:[NSString stringWithCharacters:&shortCharacter length:1]];
+            }
+        }
+        else
+        {
+            NSUInteger start = index;
+            while (index < length && characters[index] != '&')
+            {
+                index++;
+            }
+            [string appendString:[NSString stringWithCharacters:characters + start length:index - start]];
+        }
+    }
+    
+    return string;
+}
+
++ (UIColor*)colorFromHexString:(NSString*)hexString
+{
+    NSString *digits = [hexString stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if (![digits hasPrefix:@"#"])
+    {
+        return nil;
+    }
+    digits = [digits substringFromIndex:1];
+    
+    if (digits.length == 3)
+    {
+        // Expand #RGB to #RRGGBB
+        unichar r = [digits characterAtIndex:0], g = [digits characterAtIndex:1], b = [digits characterAtIndex:2];
+        digits = [NSString stringWithFormat:@"%C%C%C%C%C%C", r, r, g, g, b, b];
+    }
+    
+    NSCharacterSet *invalidCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"].invertedSet;
+    if (digits.length != 6 || [digits rangeOfCharacterFromSet:invalidCharacterSet].location != NSNotFound)
+    {
+        return nil;
+    }
+    
+    return [MXKTools colorWithRGBValue:(NSUInteger)strtoul(digits.UTF8String, NULL, 16)];
+}
+
+@end
+
+#pragma mark - MXKHTMLRenderer
+
+@implementation MXKHTMLRenderer
+
+- (instancetype)init
+{
+    // The style of the MXKEventFormatter default CSS
+    UIFont *codeFont = [UIFont fontWithName:@"Menlo-Regular" size:13] ?: [UIFont systemFontOfSize:13];
+    return [self initWithCodeFont:codeFont codeBackgroundColor:[MXKTools colorWithRGBValue:0xEEEEEE]];
+}
+
+- (instancetype)initWithCodeFont:(UIFont*)codeFont codeBackgroundColor:(UIColor*)codeBackgroundColor
+{
+    self = [super init];
+    if (self)
+    {
+        _codeFont = codeFont;
+        _codeBackgroundColor = codeBackgroundColor;
+    }
+    return self;
+}
+
+- (NSAttributedString*)renderHTMLString:(NSString*)htmlString withFont:(UIFont*)font textColor:(UIColor*)textColor
+{
+    MXKHTMLRendererBuilder *builder = [[MXKHTMLRendererBuilder alloc] initWithRenderer:self font:font textColor:textColor];
+    return [builder attributedStringFromHTMLString:htmlString];
+}
+
+@end
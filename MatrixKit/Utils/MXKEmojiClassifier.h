@@ -0,0 +1,54 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKEmojiClassifier` recognises the strings made only of emojis.
+
+ The emoji characters are looked up in a precomputed two-level bitmap built from the Unicode
+ emoji test data. The keycap, flag, tag, modifier and ZWJ sequences are parsed in a single
+ forward pass over the string, without allocation.
+ The results for short strings are memoised.
+
+ This class is thread safe.
+ */
+@interface MXKEmojiClassifier : NSObject
+
+/**
+ Count the emojis of a string.
+
+ An emoji sequence (like a family or a flag) counts as one emoji.
+
+ @param string the string to classify.
+ @return the number of emojis, or 0 if the string is empty or contains other characters.
+ */
++ (NSUInteger)emojiCountInString:(NSString*)string;
+
+/**
+ Tell whether a code point is an emoji character, which can start an emoji sequence.
+
+ @param codePoint the Unicode code point.
+ @return YES if the code point is listed in the emoji test data.
+ */
++ (BOOL)isEmojiCodePoint:(UTF32Char)codePoint;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,392 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKEmojiClassifier.h"
+
+// The strings whose result is memoised
+#define MXKEMOJICLASSIFIER_MEMO_MAXIMUM_LENGTH 32
+#define MXKEMOJICLASSIFIER_MEMO_COUNT_LIMIT 1000
+
+#pragma mark - Emoji table
+
+/*
+ The emoji characters bitmap, for the code points U+0000 - U+1FFFF.
+
+ `kMXKEmojiClassifierBlockIndexes` gives for each block of 256 code points the index of its bitmap
+ in `kMXKEmojiClassifierBlocks`. The first bitmap is the one of the blocks without emoji.
+
+ It contains all the code points of the emoji-test.txt file (Unicode Emoji 15.1) except the
+ sequence components: U+FE0F, U+200D, U+20E3, the tags, and the keycap bases (digits, '#' and '*').
+ */
+static const uint8_t kMXKEmojiClassifierBlockIndexes[512] = {
+     1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     2,  3,  0,  4,  5,  6,  7,  8,  0,  9,  0, 10,  0,  0,  0,  0,
+    11,  0, 12,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    13, 14, 15, 16, 17, 18, 19, 20,  0, 21, 22,  0,  0,  0,  0,  0,
+};
+
+static const uint8_t kMXKEmojiClassifierBlocks[23][32] = {
+    // No emoji
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+0000 - U+00FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2000 - U+20FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2100 - U+21FF
+    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xF0, 0x03, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2300 - U+23FF
+    {0x00, 0x00, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0xFE, 0x0F, 0x07},
+    // U+2400 - U+24FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2500 - U+25FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78},
+    // U+2600 - U+26FF
+    {0x1F, 0x40, 0x32, 0x21, 0x4D, 0xC4, 0x00, 0x07, 0x05, 0xFF, 0x0F, 0x80, 0x69, 0x01, 0x00, 0xC8,
+     0x00, 0x00, 0xFC, 0x1A, 0x83, 0x0C, 0x03, 0x60, 0x30, 0xC1, 0x1A, 0x00, 0x00, 0x06, 0xBF, 0x27},
+    // U+2700 - U+27FF
+    {0x24, 0xBF, 0x54, 0x20, 0x02, 0x01, 0x18, 0x00, 0x90, 0x50, 0xB8, 0x00, 0x18, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0xE0, 0x00, 0x02, 0x00, 0x01, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2900 - U+29FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+2B00 - U+2BFF
+    {0xE0, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+3000 - U+30FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+3200 - U+32FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x80, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+1F000 - U+1F0FF
+    {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+1F100 - U+1F1FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xC0,
+     0x00, 0x40, 0xFE, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xFF, 0xFF, 0xFF},
+    // U+1F200 - U+1F2FF
+    {0x06, 0x00, 0x00, 0x04, 0x00, 0x80, 0xFC, 0x07, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    // U+1F300 - U+1F3FF
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xF3, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xCF, 0xCE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xB9, 0xFF},
+    // U+1F400 - U+1F4FF
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xBF},
+    // U+1F500 - U+1F5FF
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F, 0x00, 0x7E, 0xFF, 0xFF, 0xFF, 0x80, 0xF9, 0x07,
+     0x80, 0x3C, 0x61, 0x00, 0x30, 0x01, 0x06, 0x10, 0x1C, 0x00, 0x0E, 0x70, 0x0A, 0x81, 0x08, 0xFC},
+    // U+1F600 - U+1F6FF
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F, 0xF8, 0xE7, 0xF0, 0x3F, 0x1A, 0xF9, 0x1F},
+    // U+1F700 - U+1F7FF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x0F, 0x01, 0x00},
+    // U+1F900 - U+1F9FF
+    {0x00, 0xF0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF7, 0xBF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    // U+1FA00 - U+1FAFF
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x1F,
+     0xFF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xBF, 0x3F, 0xC0, 0xFF, 0x0F, 0xFF, 0x01, 0xFF, 0x01},
+};
+
+static inline BOOL MXKEmojiClassifierIsEmoji(UTF32Char codePoint)
+{
+    if (codePoint >= 0x20000)
+    {
+        return NO;
+    }
+    
+    const uint8_t *block = kMXKEmojiClassifierBlocks[kMXKEmojiClassifierBlockIndexes[codePoint >> 8]];
+    return (block[(codePoint & 0xFF) >> 3] >> (codePoint & 0x7)) & 0x1;
+}
+
+static inline BOOL MXKEmojiClassifierIsKeycapBase(UTF32Char codePoint)
+{
+    return ((codePoint >= '0' && codePoint <= '9') || codePoint == '#' || codePoint == '*');
+}
+
+static inline BOOL MXKEmojiClassifierIsRegionalIndicator(UTF32Char codePoint)
+{
+    return (codePoint >= 0x1F1E6 && codePoint <= 0x1F1FF);
+}
+
+static inline BOOL MXKEmojiClassifierIsModifier(UTF32Char codePoint)
+{
+    return (codePoint >= 0x1F3FB && codePoint <= 0x1F3FF);
+}
+
+static inline BOOL MXKEmojiClassifierIsTag(UTF32Char codePoint)
+{
+    return (codePoint >= 0xE0020 && codePoint <= 0xE007E);
+}
+
+#define MXKEMOJICLASSIFIER_VARIATION_SELECTOR_16 0xFE0F
+#define MXKEMOJICLASSIFIER_ZERO_WIDTH_JOINER 0x200D
+#define MXKEMOJICLASSIFIER_COMBINING_ENCLOSING_KEYCAP 0x20E3
+#define MXKEMOJICLASSIFIER_CANCEL_TAG 0xE007F
+
+#pragma mark - String reading
+
+/**
+ A forward reader of the code points of a string.
+ */
+typedef struct
+{
+    CFStringInlineBuffer buffer;
+    CFIndex length;
+    CFIndex index;
+} MXKEmojiClassifierReader;
+
+/**
+ Read the code point at a position.
+
+ @param reader the reader.
+ @param index the position, moved after the code point.
+ @return the code point, or 0 at the end of the string.
+ */
+static inline UTF32Char MXKEmojiClassifierCodePointAtIndex(MXKEmojiClassifierReader *reader, CFIndex *index)
+{
+    if (*index >= reader->length)
+    {
+        return 0;
+    }
+    
+    UniChar character = CFStringGetCharacterFromInlineBuffer(&reader->buffer, (*index)++);
+    if (CFStringIsSurrogateHighCharacter(character) && *index < reader->length)
+    {
+        UniChar lowCharacter = CFStringGetCharacterFromInlineBuffer(&reader->buffer, *index);
+        if (CFStringIsSurrogateLowCharacter(lowCharacter))
+        {
+            (*index)++;
+            return CFStringGetLongCharacterForSurrogatePair(character, lowCharacter);
+        }
+    }
+    
+    return character;
+}
+
+static inline UTF32Char MXKEmojiClassifierNextCodePoint(MXKEmojiClassifierReader *reader)
+{
+    return MXKEmojiClassifierCodePointAtIndex(reader, &reader->index);
+}
+
+static inline UTF32Char MXKEmojiClassifierPeekCodePoint(MXKEmojiClassifierReader *reader)
+{
+    CFIndex index = reader->index;
+    return MXKEmojiClassifierCodePointAtIndex(reader, &index);
+}
+
+/**
+ Consume the code point that has just been peeked.
+ */
+static inline void MXKEmojiClassifierSkipCodePoint(MXKEmojiClassifierReader *reader)
+{
+    MXKEmojiClassifierNextCodePoint(reader);
+}
+
+#pragma mark - Sequences parsing
+
+/**
+ Read what can follow an emoji character in a sequence: presentation selector, skin tone modifier and tags.
+
+ @return NO if the suffix is malformed.
+ */
+static BOOL MXKEmojiClassifierReadEmojiSuffix(MXKEmojiClassifierReader *reader)
+{
+    if (MXKEmojiClassifierPeekCodePoint(reader) == MXKEMOJICLASSIFIER_VARIATION_SELECTOR_16)
+    {
+        MXKEmojiClassifierSkipCodePoint(reader);
+    }
+    
+    if (MXKEmojiClassifierIsModifier(MXKEmojiClassifierPeekCodePoint(reader)))
+    {
+        MXKEmojiClassifierSkipCodePoint(reader);
+        
+        if (MXKEmojiClassifierPeekCodePoint(reader) == MXKEMOJICLASSIFIER_VARIATION_SELECTOR_16)
+        {
+            MXKEmojiClassifierSkipCodePoint(reader);
+        }
+    }
+    
+    if (MXKEmojiClassifierIsTag(MXKEmojiClassifierPeekCodePoint(reader)))
+    {
+        // Subdivision flags: the tags must end with a cancel tag
+        while (MXKEmojiClassifierIsTag(MXKEmojiClassifierPeekCodePoint(reader)))
+        {
+            MXKEmojiClassifierSkipCodePoint(reader);
+        }
+        
+        if (MXKEmojiClassifierNextCodePoint(reader) != MXKEMOJICLASSIFIER_CANCEL_TAG)
+        {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+/**
+ Read one emoji, which may be a sequence.
+
+ @return NO if the next characters are not an emoji.
+ */
+static BOOL MXKEmojiClassifierReadEmoji(MXKEmojiClassifierReader *reader)
+{
+    UTF32Char codePoint = MXKEmojiClassifierNextCodePoint(reader);
+    
+    if (MXKEmojiClassifierIsKeycapBase(codePoint))
+    {
+        // Keycap sequence
+        if (MXKEmojiClassifierPeekCodePoint(reader) == MXKEMOJICLASSIFIER_VARIATION_SELECTOR_16)
+        {
+            MXKEmojiClassifierSkipCodePoint(reader);
+        }
+        return (MXKEmojiClassifierNextCodePoint(reader) == MXKEMOJICLASSIFIER_COMBINING_ENCLOSING_KEYCAP);
+    }
+    
+    if (MXKEmojiClassifierIsRegionalIndicator(codePoint))
+    {
+        // Flag sequence
+        if (MXKEmojiClassifierIsRegionalIndicator(MXKEmojiClassifierPeekCodePoint(reader)))
+        {
+            MXKEmojiClassifierSkipCodePoint(reader);
+        }
+        return YES;
+    }
+    
+    if (!MXKEmojiClassifierIsEmoji(codePoint))
+    {
+        return NO;
+    }
+    
+    // Read the elements of a ZWJ sequence
+    while (YES)
+    {
+        if (!MXKEmojiClassifierReadEmojiSuffix(reader))
+        {
+            return NO;
+        }
+        
+        if (MXKEmojiClassifierPeekCodePoint(reader) != MXKEMOJICLASSIFIER_ZERO_WIDTH_JOINER)
+        {
+            return YES;
+        }
+        MXKEmojiClassifierSkipCodePoint(reader);
+        
+        if (!MXKEmojiClassifierIsEmoji(MXKEmojiClassifierNextCodePoint(reader)))
+        {
+            return NO;
+        }
+    }
+}
+
+static NSUInteger MXKEmojiClassifierCountEmojis(NSString *string)
+{
+    MXKEmojiClassifierReader reader;
+    reader.length = (CFIndex)string.length;
+    reader.index = 0;
+    CFStringInitInlineBuffer((__bridge CFStringRef)string, &reader.buffer, CFRangeMake(0, reader.length));
+    
+    NSUInteger emojiCount = 0;
+    while (reader.index < reader.length)
+    {
+        if (!MXKEmojiClassifierReadEmoji(&reader))
+        {
+            return 0;
+        }
+        emojiCount++;
+    }
+    
+    return emojiCount;
+}
+
+#pragma mark - MXKEmojiClassifier
+
+@implementation MXKEmojiClassifier
+
++ (NSUInteger)emojiCountInString:(NSString*)string
+{
+    if (!string.length)
+    {
+        return 0;
+    }
+    
+    if (string.length > MXKEMOJICLASSIFIER_MEMO_MAXIMUM_LENGTH)
+    {
+        return MXKEmojiClassifierCountEmojis(string);
+    }
+    
+    // Short strings like reactions are often classified again
+    static NSCache<NSString*, NSNumber*> *memo;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        memo = [[NSCache alloc] init];
+        memo.countLimit = MXKEMOJICLASSIFIER_MEMO_COUNT_LIMIT;
+    });
+    
+    NSNumber *emojiCount = [memo objectForKey:string];
+    if (!emojiCount)
+    {
+        emojiCount = @(MXKEmojiClassifierCountEmojis(string));
+        [memo setObject:emojiCount forKey:[string copy]];
+    }
+    
+    return emojiCount.unsignedIntegerValue;
+}
+
++ (BOOL)isEmojiCodePoint:(UTF32Char)codePoint
+{
+    return MXKEmojiClassifierIsEmoji(codePoint);
+}
+
+@end
@@ -0,0 +1,144 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default byte budget of the shared cache: 50 MB.
+ */
+#define MXKIMAGECACHE_DEFAULT_TOTAL_COST_LIMIT (50 * 1024 * 1024)
+
+/**
+ `MXKImageCache` is a LRU cache of decoded pictures bounded by the memory used by their bitmaps.
+
+ A picture is cached for a content URI, the pixel size it was decoded to, whether it was decoded
+ to fill or to fit this size, and an optional variant (another rendering of the same content,
+ like a server side thumbnail), so that the views displaying the same picture at the same size
+ share the same bitmap.
+ The cost of an entry is the byte size of its bitmap: a few large photos evict as much as the
+ equivalent surface of small avatars.
+ The cache is trimmed to a quarter of its budget on memory warning.
+ This class is thread safe.
+ */
+@interface MXKImageCache : NSObject
+
+/**
+ The cache shared by the MXKImageView instances.
+ */
++ (MXKImageCache*)sharedCache;
+
+/**
+ Create a cache.
+
+ @param totalCostLimit the byte budget.
+ @return the newly created instance.
+ */
+- (instancetype)initWithTotalCostLimit:(NSUInteger)totalCostLimit;
+
+/**
+ The byte budget. The least recently used pictures are removed beyond this limit.
+ */
+@property (nonatomic) NSUInteger totalCostLimit;
+
+/**
+ The byte size of the cached bitmaps.
+ */
+@property (nonatomic, readonly) NSUInteger totalCost;
+
+/**
+ The number of cached pictures.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Get a picture and mark it as the most recently used one.
+
+ @param contentURI the content URI of the picture.
+ @param pixelSize the pixel size the picture was decoded to (CGSizeZero for the original size).
+ @param fill YES if the picture was decoded to fill the pixel size, NO if it was decoded to fit in it.
+ @param variant the rendering variant (nil for the picture as is).
+ @return the cached picture, or nil.
+ */
+- (nullable UIImage*)imageForContentURI:(NSString*)contentURI pixelSize:(CGSize)pixelSize fill:(BOOL)fill variant:(nullable NSString*)variant;
+
+/**
+ Store a picture.
+ A picture costing more than the whole budget is not cached.
+
+ @param image the decoded picture.
+ @param contentURI the content URI of the picture.
+ @param pixelSize the pixel size the picture was decoded to (CGSizeZero for the original size).
+ @param fill YES if the picture was decoded to fill the pixel size, NO if it was decoded to fit in it.
+ @param variant the rendering variant (nil for the picture as is).
+ */
+- (void)setImage:(UIImage*)image forContentURI:(NSString*)contentURI pixelSize:(CGSize)pixelSize fill:(BOOL)fill variant:(nullable NSString*)variant;
+
+/**
+ Remove all the sizes and variants of a picture.
+
+ @param contentURI the content URI of the picture.
+ */
+- (void)removeImagesForContentURI:(NSString*)contentURI;
+
+/**
+ Remove the least recently used pictures until the cache costs no more than `cost`.
+
+ @param cost the byte size to reach.
+ */
+- (void)trimToCost:(NSUInteger)cost;
+
+/**
+ Remove all the pictures.
+ */
+- (void)removeAllImages;
+
+/**
+ The byte size of the bitmap of a picture.
+
+ @param image the picture.
+ @return its cost.
+ */
++ (NSUInteger)costForImage:(UIImage*)image;
+
+#pragma mark - Statistics
+
+/**
+ The number of lookups that found a picture, and of those which did not.
+ */
+@property (nonatomic, readonly) NSUInteger hitCount;
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/**
+ The number of pictures removed to respect the budget.
+ */
+@property (nonatomic, readonly) NSUInteger evictionCount;
+
+/**
+ The ratio of lookups that found a picture (0 when there was no lookup).
+ */
+@property (nonatomic, readonly) double hitRate;
+
+/**
+ Reset the statistics counters.
+ */
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,316 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKImageCache.h"
+
+@import MatrixSDK;
+
+@interface MXKImageCache ()
+{
+    /**
+     The cached pictures by key.
+     */
+    NSMutableDictionary<NSString*, UIImage*> *images;
+    
+    /**
+     The cost of each key.
+     */
+    NSMutableDictionary<NSString*, NSNumber*> *costByKey;
+    
+    /**
+     The keys ordered from the least to the most recently used.
+     */
+    NSMutableOrderedSet<NSString*> *keys;
+    
+    /**
+     The keys of each content URI.
+     */
+    NSMutableDictionary<NSString*, NSMutableSet<NSString*>*> *keysByContentURI;
+    NSMutableDictionary<NSString*, NSString*> *contentURIByKey;
+    
+    /**
+     Observe UIApplicationDidReceiveMemoryWarningNotification to trim the cache.
+     */
+    id UIApplicationDidReceiveMemoryWarningNotificationObserver;
+}
+
+@end
+
+@implementation MXKImageCache
+
++ (MXKImageCache*)sharedCache
+{
+    static MXKImageCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[MXKImageCache alloc] initWithTotalCostLimit:MXKIMAGECACHE_DEFAULT_TOTAL_COST_LIMIT];
+    });
+    return sharedCache;
+}
+
+- (instancetype)initWithTotalCostLimit:(NSUInteger)totalCostLimit
+{
+    self = [super init];
+    if (self)
+    {
+        _totalCostLimit = totalCostLimit;
+        
+        images = [NSMutableDictionary dictionary];
+        costByKey = [NSMutableDictionary dictionary];
+        keys = [NSMutableOrderedSet orderedSet];
+        keysByContentURI = [NSMutableDictionary dictionary];
+        contentURIByKey = [NSMutableDictionary dictionary];
+        
+        MXWeakify(self);
+        UIApplicationDidReceiveMemoryWarningNotificationObserver = [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidReceiveMemoryWarningNotification object:nil queue:nil usingBlock:^(NSNotification *notif) {
+            
+            MXStrongifyAndReturnIfNil(self);
+            // Keep the most recently used pictures, which are probably displayed
+            [self trimToCost:self.totalCostLimit / 4];
+        }];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (UIApplicationDidReceiveMemoryWarningNotificationObserver)
+    {
+        [[NSNotificationCenter defaultCenter] removeObserver:UIApplicationDidReceiveMemoryWarningNotificationObserver];
+        UIApplicationDidReceiveMemoryWarningNotificationObserver = nil;
+    }
+}
+
+- (void)setTotalCostLimit:(NSUInteger)totalCostLimit
+{
+    @synchronized(self)
+    {
+        _totalCostLimit = totalCostLimit;
+        [self evictToCost:totalCostLimit];
+    }
+}
+
+- (NSUInteger)totalCost
+{
+    @synchronized(self)
+    {
+        return _totalCost;
+    }
+}
+
+- (NSUInteger)count
+{
+    @synchronized(self)
+    {
+        return images.count;
+    }
+}
+
+- (UIImage*)imageForContentURI:(NSString*)contentURI pixelSize:(CGSize)pixelSize fill:(BOOL)fill variant:(NSString*)variant
+{
+    NSString *key = [self keyForContentURI:contentURI pixelSize:pixelSize fill:fill variant:variant];
+    
+    @synchronized(self)
+    {
+        UIImage *image = images[key];
+        if (image)
+        {
+            _hitCount++;
+            
+            // Move the key to the most recently used position
+            [keys removeObject:key];
+            [keys addObject:key];
+        }
+        else
+        {
+            _missCount++;
+        }
+        return image;
+    }
+}
+
+- (void)setImage:(UIImage*)image forContentURI:(NSString*)contentURI pixelSize:(CGSize)pixelSize fill:(BOOL)fill variant:(NSString*)variant
+{
+    NSString *key = [self keyForContentURI:contentURI pixelSize:pixelSize fill:fill variant:variant];
+    NSUInteger cost = [MXKImageCache costForImage:image];
+    
+    @synchronized(self)
+    {
+        [self removeImageForKey:key];
+        
+        if (cost > _totalCostLimit)
+        {
+            return;
+        }
+        
+        images[key] = image;
+        costByKey[key] = @(cost);
+        [keys addObject:key];
+        _totalCost += cost;
+        
+        contentURIByKey[key] = contentURI;
+        NSMutableSet<NSString*> *contentKeys = keysByContentURI[contentURI];
+        if (!contentKeys)
+        {
+            contentKeys = [NSMutableSet set];
+            keysByContentURI[contentURI] = contentKeys;
+        }
+        [contentKeys addObject:key];
+        
+        [self evictToCost:_totalCostLimit];
+    }
+}
+
+- (void)removeImagesForContentURI:(NSString*)contentURI
+{
+    @synchronized(self)
+    {
+        for (NSString *key in [keysByContentURI[contentURI] copy])
+        {
+            [self removeImageForKey:key];
+        }
+    }
+}
+
+- (void)trimToCost:(NSUInteger)cost
+{
+    @synchronized(self)
+    {
+        [self evictToCost:cost];
+    }
+}
+
+- (void)removeAllImages
+{
+    @synchronized(self)
+    {
+        [images removeAllObjects];
+        [costByKey removeAllObjects];
+        [keys removeAllObjects];
+        [keysByContentURI removeAllObjects];
+        [contentURIByKey removeAllObjects];
+        _totalCost = 0;
+    }
+}
+
++ (NSUInteger)costForImage:(UIImage*)image
+{
+    CGImageRef cgImage = image.CGImage;
+    if (cgImage)
+    {
+        return CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage);
+    }
+    
+    // Assume 4 bytes per pixel for the pictures which are not backed by a bitmap
+    return (NSUInteger)(image.size.width * image.scale * image.size.height * image.scale * 4);
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)hitCount
+{
+    @synchronized(self)
+    {
+        return _hitCount;
+    }
+}
+
+- (NSUInteger)missCount
+{
+    @synchronized(self)
+    {
+        return _missCount;
+    }
+}
+
+- (NSUInteger)evictionCount
+{
+    @synchronized(self)
+    {
+        return _evictionCount;
+    }
+}
+
+- (double)hitRate
+{
+    @synchronized(self)
+    {
+        NSUInteger lookupCount = _hitCount + _missCount;
+        return lookupCount ? (double)_hitCount / lookupCount : 0;
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self)
+    {
+        _hitCount = 0;
+        _missCount = 0;
+        _evictionCount = 0;
+    }
+}
+
+#pragma mark - Private methods
+
+- (NSString*)keyForContentURI:(NSString*)contentURI pixelSize:(CGSize)pixelSize fill:(BOOL)fill variant:(NSString*)variant
+{
+    // The original size is the same in both modes
+    BOOL isResized = pixelSize.width > 0 && pixelSize.height > 0;
+    NSString *mode = (isResized && fill) ? @"fill" : @"fit";
+    
+    return [NSString stringWithFormat:@"%@|%.0fx%.0f|%@|%@", contentURI, ceil(pixelSize.width), ceil(pixelSize.height), mode, variant ?: @""];
+}
+
+// Must be called under @synchronized(self)
+- (void)evictToCost:(NSUInteger)cost
+{
+    while (_totalCost > cost && keys.count)
+    {
+        [self removeImageForKey:keys.firstObject];
+        _evictionCount++;
+    }
+}
+
+// Must be called under @synchronized(self)
+- (void)removeImageForKey:(NSString*)key
+{
+    if (!images[key])
+    {
+        return;
+    }
+    
+    _totalCost -= costByKey[key].unsignedIntegerValue;
+    
+    [images removeObjectForKey:key];
+    [costByKey removeObjectForKey:key];
+    [keys removeObject:key];
+    
+    NSString *contentURI = contentURIByKey[key];
+    if (contentURI)
+    {
+        [contentURIByKey removeObjectForKey:key];
+        
+        NSMutableSet<NSString*> *contentKeys = keysByContentURI[contentURI];
+        [contentKeys removeObject:key];
+        if (!contentKeys.count)
+        {
+            [keysByContentURI removeObjectForKey:contentURI];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,62 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `MXKImageDecoder` loads pictures from files off the main thread.
+
+ The pictures are downsampled to the pixel size at which they will be displayed with ImageIO
+ and decoded before being returned, so that UIKit does not decode the full resolution bitmap
+ on the main thread when they are drawn for the first time.
+ */
+@interface MXKImageDecoder : NSObject
+
+/**
+ Load and decode a picture synchronously. This method may be called from any thread.
+
+ @param filePath the path of the picture file.
+ @param pixelSize the size in pixels of the area where the picture will be displayed.
+                  CGSizeZero keeps the original size of the picture.
+ @param fill YES if the picture must fill the area (aspect fill), NO if it must fit in it (aspect fit).
+ @return the decoded image, with its EXIF orientation applied, or nil if the file is not a picture.
+ */
++ (nullable UIImage*)decodedImageWithContentsOfFile:(NSString*)filePath
+                                        toPixelSize:(CGSize)pixelSize
+                                               fill:(BOOL)fill;
+
+/**
+ Load and decode a picture on a background queue.
+
+ @param filePath the path of the picture file.
+ @param pixelSize the size in pixels of the area where the picture will be displayed.
+                  CGSizeZero keeps the original size of the picture.
+ @param fill YES if the picture must fill the area (aspect fill), NO if it must fit in it (aspect fit).
+ @param completion the block called on the main queue with the decoded image (nil on failure).
+                   It is not called if the operation is cancelled.
+ @return the operation, which can be cancelled.
+ */
++ (NSOperation*)decodeImageWithContentsOfFile:(NSString*)filePath
+                                  toPixelSize:(CGSize)pixelSize
+                                         fill:(BOOL)fill
+                                   completion:(void (^)(UIImage * _Nullable image))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,130 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKImageDecoder.h"
+
+#import <ImageIO/ImageIO.h>
+
+@import MatrixSDK;
+
+// The number of pictures decoded in parallel
+#define MXKIMAGEDECODER_MAX_CONCURRENT_OPERATIONS 2
+
+@implementation MXKImageDecoder
+
++ (NSOperationQueue*)decodingQueue
+{
+    static NSOperationQueue *decodingQueue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        decodingQueue = [[NSOperationQueue alloc] init];
+        decodingQueue.name = @"MXKImageDecoder";
+        decodingQueue.qualityOfService = NSQualityOfServiceUserInitiated;
+        decodingQueue.maxConcurrentOperationCount = MXKIMAGEDECODER_MAX_CONCURRENT_OPERATIONS;
+    });
+    return decodingQueue;
+}
+
++ (UIImage*)decodedImageWithContentsOfFile:(NSString*)filePath toPixelSize:(CGSize)pixelSize fill:(BOOL)fill
+{
+    if (!filePath)
+    {
+        return nil;
+    }
+    
+    // Do not let ImageIO keep the full size decoded picture
+    NSDictionary *sourceOptions = @{(id)kCGImageSourceShouldCache: @NO};
+    CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)[NSURL fileURLWithPath:filePath], (__bridge CFDictionaryRef)sourceOptions);
+    if (!source)
+    {
+        return nil;
+    }
+    
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(source, 0, nil));
+    CGFloat width = [properties[(id)kCGImagePropertyPixelWidth] doubleValue];
+    CGFloat height = [properties[(id)kCGImagePropertyPixelHeight] doubleValue];
+    if (!width || !height)
+    {
+        CFRelease(source);
+        return nil;
+    }
+    
+    // The EXIF orientations from 5 to 8 rotate the picture by 90°
+    if ([properties[(id)kCGImagePropertyOrientation] integerValue] >= kCGImagePropertyOrientationLeftMirrored)
+    {
+        CGFloat swap = width;
+        width = height;
+        height = swap;
+    }
+    
+    CGFloat scale = 1;
+    if (pixelSize.width > 0 && pixelSize.height > 0)
+    {
+        CGFloat widthScale = pixelSize.width / width;
+        CGFloat heightScale = pixelSize.height / height;
+        scale = MIN(1, fill ? MAX(widthScale, heightScale) : MIN(widthScale, heightScale));
+    }
+    
+    // The thumbnail is rendered into a new bitmap: it is already decoded when it is returned.
+    NSDictionary *thumbnailOptions = @{
+                                       (id)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+                                       (id)kCGImageSourceCreateThumbnailWithTransform: @YES,
+                                       (id)kCGImageSourceShouldCacheImmediately: @YES,
+                                       (id)kCGImageSourceThumbnailMaxPixelSize: @(ceil(MAX(width, height) * scale))
+                                       };
+    CGImageRef cgImage = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)thumbnailOptions);
+    CFRelease(source);
+    
+    if (!cgImage)
+    {
+        return nil;
+    }
+    
+    UIImage *image = [UIImage imageWithCGImage:cgImage scale:1.0 orientation:UIImageOrientationUp];
+    CGImageRelease(cgImage);
+    return image;
+}
+
++ (NSOperation*)decodeImageWithContentsOfFile:(NSString*)filePath toPixelSize:(CGSize)pixelSize fill:(BOOL)fill completion:(void (^)(UIImage *image))completion
+{
+    NSBlockOperation *operation = [[NSBlockOperation alloc] init];
+    
+    MXWeakify(operation);
+    [operation addExecutionBlock:^{
+        MXStrongifyAndReturnIfNil(operation);
+        
+        if (operation.isCancelled)
+        {
+            return;
+        }
+        
+        UIImage *image = [MXKImageDecoder decodedImageWithContentsOfFile:filePath toPixelSize:pixelSize fill:fill];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            // The operation is cancelled on the main queue: this check cannot race with it
+            if (!operation.isCancelled)
+            {
+                completion(image);
+            }
+        });
+    }];
+    
+    [[MXKImageDecoder decodingQueue] addOperation:operation];
+    return operation;
+}
+
+@end
@@ -0,0 +1,95 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default line fragment padding of a UITextView.
+ */
+extern const CGFloat kMXKTextMeasurementEngineTextViewLineFragmentPadding;
+
+/**
+ The default text container inset of a UITextView.
+ */
+extern const UIEdgeInsets kMXKTextMeasurementEngineTextViewTextContainerInset;
+
+/**
+ `MXKTextMeasurementEngine` measures attributed texts with TextKit.
+
+ It reproduces the result of `[UITextView sizeThatFits:]` for a text view with the same
+ text container inset and line fragment padding, but it can be used from any thread:
+ each thread uses its own TextKit stack.
+ */
+@interface MXKTextMeasurementEngine : NSObject
+
+/**
+ Compute the size a UITextView needs to display an attributed text.
+
+ @param attributedText the text to measure.
+ @param maxWidth the width of the text view.
+ @param textContainerInset the text container inset of the text view.
+ @param lineFragmentPadding the line fragment padding of the text view container.
+ @return the size fitting the text.
+ */
++ (CGSize)sizeOfAttributedText:(NSAttributedString*)attributedText
+              withMaximumWidth:(CGFloat)maxWidth
+            textContainerInset:(UIEdgeInsets)textContainerInset
+           lineFragmentPadding:(CGFloat)lineFragmentPadding;
+
+/**
+ Same as `sizeOfAttributedText:withMaximumWidth:textContainerInset:lineFragmentPadding:` with the
+ UITextView default line fragment padding.
+ */
++ (CGSize)sizeOfAttributedText:(NSAttributedString*)attributedText
+              withMaximumWidth:(CGFloat)maxWidth
+            textContainerInset:(UIEdgeInsets)textContainerInset;
+
+/**
+ Lay out an attributed text once and return the vertical position of some of its characters.
+
+ This lets a caller locate several parts of a long text in linear time, instead of measuring
+ each prefix of the text.
+
+ @param characterIndexes the indexes of the characters to locate, in the attributed text.
+ @param attributedText the laid out text.
+ @param maxWidth the width of the text view.
+ @param textContainerInset the text container inset of the text view.
+ @return for each character, the y origin of its line fragment in the text view coordinates.
+ */
++ (NSArray<NSNumber*>*)lineFragmentOriginsOfCharactersAtIndexes:(NSArray<NSNumber*>*)characterIndexes
+                                               inAttributedText:(NSAttributedString*)attributedText
+                                               withMaximumWidth:(CGFloat)maxWidth
+                                             textContainerInset:(UIEdgeInsets)textContainerInset;
+
+/**
+ The reference measurement done with a UITextView.
+
+ It must be called on the main thread.
+
+ @param attributedText the text to measure.
+ @param maxWidth the width of the text view.
+ @param textContainerInset the text container inset of the text view.
+ @return the size fitting the text.
+ */
++ (CGSize)textViewSizeOfAttributedText:(NSAttributedString*)attributedText
+                      withMaximumWidth:(CGFloat)maxWidth
+                    textContainerInset:(UIEdgeInsets)textContainerInset;
+
+@end
+
+NS_ASSUME_NONNULL_END
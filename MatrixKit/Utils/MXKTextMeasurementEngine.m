@@ -0,0 +1,174 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import "MXKTextMeasurementEngine.h"
+
+const CGFloat kMXKTextMeasurementEngineTextViewLineFragmentPadding = 5;
+const UIEdgeInsets kMXKTextMeasurementEngineTextViewTextContainerInset = {8, 0, 8, 0};
+
+static NSString *const kMXKTextMeasurementEngineThreadStackKey = @"kMXKTextMeasurementEngineThreadStackKey";
+
+/**
+ The TextKit objects used for measurement on a thread.
+ TextKit objects which are not attached to a view can be used off the main thread,
+ but they must not be shared between threads.
+ */
+@interface MXKTextMeasurementStack : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+@property (nonatomic, readonly) NSLayoutManager *layoutManager;
+@property (nonatomic, readonly) NSTextContainer *textContainer;
+
+@end
+
+@implementation MXKTextMeasurementStack
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        _textStorage = [[NSTextStorage alloc] init];
+        _layoutManager = [[NSLayoutManager alloc] init];
+        _textContainer = [[NSTextContainer alloc] initWithSize:CGSizeZero];
+
+        [_layoutManager addTextContainer:_textContainer];
+        [_textStorage addLayoutManager:_layoutManager];
+    }
+    return self;
+}
+
+@end
+
+@implementation MXKTextMeasurementEngine
+
++ (CGSize)sizeOfAttributedText:(NSAttributedString*)attributedText withMaximumWidth:(CGFloat)maxWidth textContainerInset:(UIEdgeInsets)textContainerInset
+{
+    return [self sizeOfAttributedText:attributedText withMaximumWidth:maxWidth textContainerInset:textContainerInset lineFragmentPadding:kMXKTextMeasurementEngineTextViewLineFragmentPadding];
+}
+
++ (CGSize)sizeOfAttributedText:(NSAttributedString*)attributedText withMaximumWidth:(CGFloat)maxWidth textContainerInset:(UIEdgeInsets)textContainerInset lineFragmentPadding:(CGFloat)lineFragmentPadding
+{
+    if (!attributedText.length)
+    {
+        return CGSizeZero;
+    }
+
+    MXKTextMeasurementStack *stack = [self currentThreadStack];
+
+    CGFloat containerWidth = MAX(0, maxWidth - textContainerInset.left - textContainerInset.right);
+    stack.textContainer.size = CGSizeMake(containerWidth, CGFLOAT_MAX);
+    stack.textContainer.lineFragmentPadding = lineFragmentPadding;
+
+    [stack.textStorage setAttributedString:attributedText];
+    [stack.layoutManager ensureLayoutForTextContainer:stack.textContainer];
+
+    // The used rect includes the line fragment padding, and the extra line fragment of a trailing new line
+    CGRect usedRect = [stack.layoutManager usedRectForTextContainer:stack.textContainer];
+
+    CGSize size;
+    size.width = ceil(usedRect.size.width + textContainerInset.left + textContainerInset.right);
+    size.height = ceil(usedRect.size.height + textContainerInset.top + textContainerInset.bottom);
+
+    // Release the text
+    [stack.textStorage deleteCharactersInRange:NSMakeRange(0, stack.textStorage.length)];
+
+    return size;
+}
+
++ (NSArray<NSNumber*>*)lineFragmentOriginsOfCharactersAtIndexes:(NSArray<NSNumber*>*)characterIndexes inAttributedText:(NSAttributedString*)attributedText withMaximumWidth:(CGFloat)maxWidth textContainerInset:(UIEdgeInsets)textContainerInset
+{
+    NSMutableArray<NSNumber*> *origins = [NSMutableArray arrayWithCapacity:characterIndexes.count];
+    
+    if (!attributedText.length)
+    {
+        for (NSUInteger index = 0; index < characterIndexes.count; index++)
+        {
+            [origins addObject:@(textContainerInset.top)];
+        }
+        return origins;
+    }
+
+    MXKTextMeasurementStack *stack = [self currentThreadStack];
+
+    CGFloat containerWidth = MAX(0, maxWidth - textContainerInset.left - textContainerInset.right);
+    stack.textContainer.size = CGSizeMake(containerWidth, CGFLOAT_MAX);
+    stack.textContainer.lineFragmentPadding = kMXKTextMeasurementEngineTextViewLineFragmentPadding;
+
+    [stack.textStorage setAttributedString:attributedText];
+    [stack.layoutManager ensureLayoutForTextContainer:stack.textContainer];
+
+    for (NSNumber *characterIndex in characterIndexes)
+    {
+        CGFloat originY;
+        if (characterIndex.unsignedIntegerValue < attributedText.length)
+        {
+            NSUInteger glyphIndex = [stack.layoutManager glyphIndexForCharacterAtIndex:characterIndex.unsignedIntegerValue];
+            originY = [stack.layoutManager lineFragmentRectForGlyphAtIndex:glyphIndex effectiveRange:NULL].origin.y;
+        }
+        else
+        {
+            // The character is after the end of the text: locate the end of the layout
+            originY = [stack.layoutManager usedRectForTextContainer:stack.textContainer].size.height;
+        }
+        [origins addObject:@(textContainerInset.top + originY)];
+    }
+
+    // Release the text
+    [stack.textStorage deleteCharactersInRange:NSMakeRange(0, stack.textStorage.length)];
+
+    return origins;
+}
+
++ (CGSize)textViewSizeOfAttributedText:(NSAttributedString*)attributedText withMaximumWidth:(CGFloat)maxWidth textContainerInset:(UIEdgeInsets)textContainerInset
+{
+    NSParameterAssert([NSThread isMainThread]);
+
+    static UITextView* measurementTextView = nil;
+
+    if (!attributedText.length)
+    {
+        return CGSizeZero;
+    }
+
+    if (!measurementTextView)
+    {
+        measurementTextView = [[UITextView alloc] init];
+    }
+
+    measurementTextView.textContainerInset = textContainerInset;
+    measurementTextView.frame = CGRectMake(0, 0, maxWidth, MAXFLOAT);
+    measurementTextView.attributedText = attributedText;
+
+    return [measurementTextView sizeThatFits:measurementTextView.frame.size];
+}
+
+#pragma mark - Private methods
+
++ (MXKTextMeasurementStack*)currentThreadStack
+{
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+
+    MXKTextMeasurementStack *stack = threadDictionary[kMXKTextMeasurementEngineThreadStackKey];
+    if (!stack)
+    {
+        stack = [[MXKTextMeasurementStack alloc] init];
+        threadDictionary[kMXKTextMeasurementEngineThreadStackKey] = stack;
+    }
+    return stack;
+}
+
+@end
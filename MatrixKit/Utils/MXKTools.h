@@ -52,6 +52,11 @@ typedef struct
     
 } MXKImageCompressionSizes;
 
+/**
+ Attribute in an NSAttributedString that marks a blockquote block that was in the original HTML string.
+ */
+extern NSString *const kMXKToolsBlockquoteMarkAttribute;
+
 @interface MXKTools : NSObject
 
 #pragma mark - Strings
@@ -367,6 +372,26 @@ manualChangeMessageForVideo:(NSString*)manualChangeMessageForVideo
  */
 + (NSAttributedString*)createLinksInAttributedString:(NSAttributedString*)attributedString forEnabledMatrixIds:(NSInteger)enabledMatrixIdsBitMask;
 
+/**
+ Make some matrix identifiers and the http links clickable in the string content.
+ 
+ The links and all the enabled types of identifier are found in a single traversal of the string.
+ The identifiers which are part of an http link or of an existing link are ignored.
+ 
+ @param attributedString an attributed string.
+ @param enabledMatrixIdsBitMask the bitmask used to list the types of matrix id to process (see MXKTOOLS_XXX__BITWISE).
+ @param httpLinkScheme the scheme of the links created for the http URLs.
+ @param httpsLinkScheme the scheme of the links created for the https URLs.
+ When a scheme is set, the links without scheme (domains followed by a path, e-mail addresses and mailto links)
+ are created in the same pass. When both schemes are nil, no link is created for the http(s) URLs: the UI
+ detects them at display.
+ @return the resulting string.
+ */
++ (NSAttributedString*)createLinksInAttributedString:(NSAttributedString*)attributedString
+                                 forEnabledMatrixIds:(NSInteger)enabledMatrixIdsBitMask
+                                      httpLinkScheme:(NSString*)httpLinkScheme
+                                     httpsLinkScheme:(NSString*)httpsLinkScheme;
+
 #pragma mark - HTML processing - blockquote display handling
 
 /**
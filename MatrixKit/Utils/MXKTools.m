@@ -23,6 +23,7 @@
 @import DTCoreText;
 
 #import "NSBundle+MatrixKit.h"
+#import "MXKEmojiClassifier.h"
 
 #pragma mark - Constants definitions
 
@@ -33,14 +34,6 @@
 NSString *const kMXKToolsBlockquoteMarkAttribute = @"kMXKToolsBlockquoteMarkAttribute";
 
 #pragma mark - MXKTools static private members
-// The regex used to find matrix ids.
-static NSRegularExpression *userIdRegex;
-static NSRegularExpression *roomIdRegex;
-static NSRegularExpression *roomAliasRegex;
-static NSRegularExpression *eventIdRegex;
-static NSRegularExpression *groupIdRegex;
-// A regex to find http URLs.
-static NSRegularExpression *httpLinksRegex;
 // A regex to find all HTML tags
 static NSRegularExpression *htmlTagsRegex;
 
@@ -51,13 +44,6 @@ static NSRegularExpression *htmlTagsRegex;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
         
-        userIdRegex = [NSRegularExpression regularExpressionWithPattern:kMXToolsRegexStringForMatrixUserIdentifier options:NSRegularExpressionCaseInsensitive error:nil];
-        roomIdRegex = [NSRegularExpression regularExpressionWithPattern:kMXToolsRegexStringForMatrixRoomIdentifier options:NSRegularExpressionCaseInsensitive error:nil];
-        roomAliasRegex = [NSRegularExpression regularExpressionWithPattern:kMXToolsRegexStringForMatrixRoomAlias options:NSRegularExpressionCaseInsensitive error:nil];
-        eventIdRegex = [NSRegularExpression regularExpressionWithPattern:kMXToolsRegexStringForMatrixEventIdentifier options:NSRegularExpressionCaseInsensitive error:nil];
-        groupIdRegex = [NSRegularExpression regularExpressionWithPattern:kMXToolsRegexStringForMatrixGroupIdentifier options:NSRegularExpressionCaseInsensitive error:nil];
-        
-        httpLinksRegex = [NSRegularExpression regularExpressionWithPattern:@"(?i)\\b(https?://.*)\\b" options:NSRegularExpressionCaseInsensitive error:nil];
         htmlTagsRegex  = [NSRegularExpression regularExpressionWithPattern:@"<(\\w+)[^>]*>" options:NSRegularExpressionCaseInsensitive error:nil];        
     });
 }
@@ -74,105 +60,11 @@ static NSRegularExpression *htmlTagsRegex;
     return [MXKTools isEmojiString:string singleEmoji:NO];
 }
 
-// Highly inspired from https://stackoverflow.com/a/34659249
 + (BOOL)isEmojiString:(NSString*)string singleEmoji:(BOOL)singleEmoji
 {
-    if (string.length == 0)
-    {
-        return NO;
-    }
-
-    __block BOOL result = YES;
-
-    NSRange stringRange = NSMakeRange(0, [string length]);
-
-    [string enumerateSubstringsInRange:stringRange
-                               options:NSStringEnumerationByComposedCharacterSequences
-                            usingBlock:^(NSString *substring,
-                                         NSRange substringRange,
-                                         NSRange enclosingRange,
-                                         BOOL *stop)
-     {
-         BOOL isEmoji = NO;
-
-         if (singleEmoji && !NSEqualRanges(stringRange, substringRange))
-         {
-             // The string contains several characters. Go out
-             result = NO;
-             *stop = YES;
-             return;
-         }
-
-         const unichar hs = [substring characterAtIndex:0];
-         // Surrogate pair
-         if (0xd800 <= hs &&
-             hs <= 0xdbff)
-         {
-             if (substring.length > 1)
-             {
-                 const unichar ls = [substring characterAtIndex:1];
-                 const int uc = ((hs - 0xd800) * 0x400) + (ls - 0xdc00) + 0x10000;
-                 if (0x1d000 <= uc &&
-                     uc <= 0x1f9ff)
-                 {
-                     isEmoji = YES;
-                 }
-             }
-         }
-         else if (substring.length > 1)
-         {
-             const unichar ls = [substring characterAtIndex:1];
-             if (ls == 0x20e3 ||
-                 ls == 0xfe0f ||
-                 ls == 0xd83c)
-             {
-                 isEmoji = YES;
-             }
-         }
-         else
-         {
-             // Non surrogate
-             if (0x2100 <= hs &&
-                 hs <= 0x27ff)
-             {
-                 isEmoji = YES;
-             }
-             else if (0x2B05 <= hs &&
-                      hs <= 0x2b07)
-             {
-                 isEmoji = YES;
-             }
-             else if (0x2934 <= hs &&
-                      hs <= 0x2935)
-             {
-                 isEmoji = YES;
-             }
-             else if (0x3297 <= hs &&
-                      hs <= 0x3299)
-             {
-                 isEmoji = YES;
-             }
-             else if (hs == 0xa9 ||
-                      hs == 0xae ||
-                      hs == 0x303d ||
-                      hs == 0x3030 ||
-                      hs == 0x2b55 ||
-                      hs == 0x2b1c ||
-                      hs == 0x2b1b ||
-                      hs == 0x2b50)
-             {
-                 isEmoji = YES;
-             }
-         }
-
-         if (!isEmoji)
-         {
-             result = NO;
-             *stop = YES;
-         }
-     }];
-
-    return result;
+    NSUInteger emojiCount = [MXKEmojiClassifier emojiCountInString:string];
+    
+    return singleEmoji ? (emojiCount == 1) : (emojiCount > 0);
 }
 
 #pragma mark - Time interval
@@ -1035,108 +927,200 @@ manualChangeMessageForVideo:(NSString*)manualChangeMessageForVideo
 }
 
 + (NSAttributedString*)createLinksInAttributedString:(NSAttributedString*)attributedString forEnabledMatrixIds:(NSInteger)enabledMatrixIdsBitMask
+{
+    return [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:enabledMatrixIdsBitMask httpLinkScheme:nil httpsLinkScheme:nil];
+}
+
++ (NSAttributedString*)createLinksInAttributedString:(NSAttributedString*)attributedString
+                                 forEnabledMatrixIds:(NSInteger)enabledMatrixIdsBitMask
+                                      httpLinkScheme:(NSString*)httpLinkScheme
+                                     httpsLinkScheme:(NSString*)httpsLinkScheme
 {
     if (!attributedString)
     {
         return nil;
     }
     
-    NSMutableAttributedString *postRenderAttributedString;
-    
-    // If enabled, make user id clickable
-    if (enabledMatrixIdsBitMask & MXKTOOLS_USER_IDENTIFIER_BITWISE)
+    BOOL rewritesHttpLinks = (httpLinkScheme || httpsLinkScheme);
+    if (!enabledMatrixIdsBitMask && !rewritesHttpLinks)
     {
-        [MXKTools createLinksInAttributedString:attributedString matchingRegex:userIdRegex withWorkingAttributedString:&postRenderAttributedString];
+        return attributedString;
     }
     
-    // If enabled, make room id clickable
-    if (enabledMatrixIdsBitMask & MXKTOOLS_ROOM_IDENTIFIER_BITWISE)
-    {
-        [MXKTools createLinksInAttributedString:attributedString matchingRegex:roomIdRegex withWorkingAttributedString:&postRenderAttributedString];
-    }
+    NSString *string = attributedString.string;
+    NSRange wholeString = NSMakeRange(0, attributedString.length);
     
-    // If enabled, make room alias clickable
-    if (enabledMatrixIdsBitMask & MXKTOOLS_ROOM_ALIAS_BITWISE)
-    {
-        [MXKTools createLinksInAttributedString:attributedString matchingRegex:roomAliasRegex withWorkingAttributedString:&postRenderAttributedString];
-    }
+    // Locate the existing links once
+    NSMutableIndexSet *existingLinkIndexes = [NSMutableIndexSet indexSet];
+    [attributedString enumerateAttribute:NSLinkAttributeName inRange:wholeString options:0 usingBlock:^(id value, NSRange range, BOOL *stop) {
+        
+        if (value)
+        {
+            [existingLinkIndexes addIndexesInRange:range];
+        }
+    }];
+    
+    NSMutableArray<NSValue*> *linkRanges = [NSMutableArray array];
+    NSMutableArray *links = [NSMutableArray array];
+    
+    // Find the http links and the enabled matrix identifiers in a single traversal of the string.
+    // The http links come first in the regex so that the identifiers they contain are not matched.
+    NSRegularExpression *linksRegex = [MXKTools linksRegexForEnabledMatrixIds:enabledMatrixIdsBitMask matchingLinksWithoutScheme:rewritesHttpLinks];
+    [linksRegex enumerateMatchesInString:string options:0 range:wholeString usingBlock:^(NSTextCheckingResult *match, NSMatchingFlags flags, BOOL *stop) {
+        
+        // Do not create a link if there is already one on the found match
+        if ([existingLinkIndexes intersectsIndexesInRange:match.range])
+        {
+            return;
+        }
+        
+        NSRange linkRange = match.range;
+        id link;
+        
+        if ([match rangeAtIndex:1].location != NSNotFound)
+        {
+            // The http links are automatically generated by the UI afterwards.
+            // Create them here only if their scheme must be changed.
+            if (rewritesHttpLinks)
+            {
+                link = [MXKTools urlForHttpLink:[string substringWithRange:linkRange] httpLinkScheme:httpLinkScheme httpsLinkScheme:httpsLinkScheme];
+            }
+        }
+        else
+        {
+            // Caution: We need here to escape the non-ASCII characters (like '#' in room alias)
+            // to convert the link into a legal URL string.
+            link = [[string substringWithRange:linkRange] stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        }
+        
+        if (link)
+        {
+            [linkRanges addObject:[NSValue valueWithRange:linkRange]];
+            [links addObject:link];
+        }
+    }];
     
-    // If enabled, make event id clickable
-    if (enabledMatrixIdsBitMask & MXKTOOLS_EVENT_IDENTIFIER_BITWISE)
+    // Create the output string only if it is necessary because attributed strings cost CPU
+    if (!links.count)
     {
-        [MXKTools createLinksInAttributedString:attributedString matchingRegex:eventIdRegex withWorkingAttributedString:&postRenderAttributedString];
+        return attributedString;
     }
     
-    // If enabled, make group id clickable
-    if (enabledMatrixIdsBitMask & MXKTOOLS_GROUP_IDENTIFIER_BITWISE)
+    NSMutableAttributedString *mutableAttributedString = [[NSMutableAttributedString alloc] initWithAttributedString:attributedString];
+    [mutableAttributedString beginEditing];
+    for (NSUInteger index = 0; index < links.count; index++)
     {
-        [MXKTools createLinksInAttributedString:attributedString matchingRegex:groupIdRegex withWorkingAttributedString:&postRenderAttributedString];
+        [mutableAttributedString addAttribute:NSLinkAttributeName value:links[index] range:linkRanges[index].rangeValue];
     }
+    [mutableAttributedString endEditing];
     
-    return postRenderAttributedString ? postRenderAttributedString : attributedString;
+    return mutableAttributedString;
 }
 
-+ (void)createLinksInAttributedString:(NSAttributedString*)attributedString matchingRegex:(NSRegularExpression*)regex withWorkingAttributedString:(NSMutableAttributedString* __autoreleasing *)mutableAttributedString
+/**
+ Get the regex matching the http links and some matrix identifiers.
+ 
+ The http links are matched by the first capture group, without their trailing punctuation.
+ Do not use NSDataDetector with NSTextCheckingTypeLink because is not able to
+ manage URLs with 2 hashes like "https://matrix.to/#/#matrix:matrix.org".
+ Such URL is not valid but web browsers can open them and users C+P them...
+ 
+ @param enabledMatrixIdsBitMask the bitmask used to list the types of matrix id to match.
+ @param matchesLinksWithoutScheme YES to match in the first capture group the links that the UI would detect
+ without http scheme too: the domains followed by a path, the e-mail addresses and the mailto links.
+ @return the regex.
+ */
++ (NSRegularExpression*)linksRegexForEnabledMatrixIds:(NSInteger)enabledMatrixIdsBitMask matchingLinksWithoutScheme:(BOOL)matchesLinksWithoutScheme
 {
-    __block NSArray *linkMatches;
+    static NSMutableDictionary<NSNumber*, NSRegularExpression*> *linksRegexes;
     
-    // Enumerate each string matching the regex
-    [regex enumerateMatchesInString:attributedString.string options:0 range:NSMakeRange(0, attributedString.length) usingBlock:^(NSTextCheckingResult *match, NSMatchingFlags flags, BOOL *stop) {
-        
-        // Do not create a link if there is already one on the found match
-        __block BOOL hasAlreadyLink = NO;
-        [attributedString enumerateAttributesInRange:match.range options:0 usingBlock:^(NSDictionary<NSString *,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
-            
-            if (attrs[NSLinkAttributeName])
-            {
-                hasAlreadyLink = YES;
-                *stop = YES;
-            }
-        }];
+    @synchronized(MXKTools.class)
+    {
+        if (!linksRegexes)
+        {
+            linksRegexes = [NSMutableDictionary dictionary];
+        }
         
-        // Do not create a link if the match is part of an http link.
-        // The http link will be automatically generated by the UI afterwards.
-        // So, do not break it now by adding a link on a subset of this http link.
-        if (!hasAlreadyLink)
+        NSNumber *regexKey = @((enabledMatrixIdsBitMask << 1) | matchesLinksWithoutScheme);
+        NSRegularExpression *linksRegex = linksRegexes[regexKey];
+        if (!linksRegex)
         {
-            if (!linkMatches)
+            // A link does not end with a punctuation character: "(https://matrix.org)." links "https://matrix.org"
+            NSString *linkEnd = @"(?<![.,;:!?'\")\\]}>])";
+            
+            NSMutableArray<NSString*> *linkPatterns = [NSMutableArray arrayWithObject:[NSString stringWithFormat:@"(?:https?://|www\\.)\\S+%@", linkEnd]];
+            if (matchesLinksWithoutScheme)
             {
-                // Search for the links in the string only once
-                // Do not use NSDataDetector with NSTextCheckingTypeLink because is not able to
-                // manage URLs with 2 hashes like "https://matrix.to/#/#matrix:matrix.org"
-                // Such URL is not valid but web browsers can open them and users C+P them...
-                // NSDataDetector does not support it but UITextView and UIDataDetectorTypeLink
-                // detect them when they are displayed. So let the UI create the link at display.
-                linkMatches = [httpLinksRegex matchesInString:attributedString.string options:0 range:NSMakeRange(0, attributedString.length)];
+                [linkPatterns addObject:[NSString stringWithFormat:@"mailto:\\S+%@", linkEnd]];
+                [linkPatterns addObject:@"[A-Z0-9._%+-]+@[A-Z0-9-]+(?:\\.[A-Z0-9-]+)*\\.[A-Z]{2,}\\b"];
+                [linkPatterns addObject:[NSString stringWithFormat:@"[A-Z0-9-]+(?:\\.[A-Z0-9-]+)*\\.[A-Z]{2,}/\\S*%@", linkEnd]];
             }
             
-            for (NSTextCheckingResult *linkMatch in linkMatches)
+            NSMutableArray<NSString*> *patterns = [NSMutableArray arrayWithObject:[NSString stringWithFormat:@"(\\b(?:%@))", [linkPatterns componentsJoinedByString:@"|"]]];
+            
+            NSArray<NSNumber*> *bitmasks = @[@(MXKTOOLS_USER_IDENTIFIER_BITWISE), @(MXKTOOLS_ROOM_IDENTIFIER_BITWISE), @(MXKTOOLS_ROOM_ALIAS_BITWISE), @(MXKTOOLS_EVENT_IDENTIFIER_BITWISE), @(MXKTOOLS_GROUP_IDENTIFIER_BITWISE)];
+            NSArray<NSString*> *identifierPatterns = @[kMXToolsRegexStringForMatrixUserIdentifier, kMXToolsRegexStringForMatrixRoomIdentifier, kMXToolsRegexStringForMatrixRoomAlias, kMXToolsRegexStringForMatrixEventIdentifier, kMXToolsRegexStringForMatrixGroupIdentifier];
+            
+            for (NSUInteger index = 0; index < bitmasks.count; index++)
             {
-                // If the match is fully in the link, skip it
-                if (NSIntersectionRange(match.range, linkMatch.range).length == match.range.length)
+                if (enabledMatrixIdsBitMask & bitmasks[index].integerValue)
                 {
-                    hasAlreadyLink = YES;
-                    break;
+                    [patterns addObject:[NSString stringWithFormat:@"(?:%@)", identifierPatterns[index]]];
                 }
             }
+            
+            linksRegex = [NSRegularExpression regularExpressionWithPattern:[patterns componentsJoinedByString:@"|"] options:NSRegularExpressionCaseInsensitive error:nil];
+            linksRegexes[regexKey] = linksRegex;
         }
         
-        if (!hasAlreadyLink)
+        return linksRegex;
+    }
+}
+
+/**
+ Build the URL of an http link with custom schemes.
+ 
+ The links without scheme are completed: "http://" for the domains and "mailto:" for the e-mail addresses.
+ 
+ @param httpLink the link text.
+ @param httpLinkScheme the scheme to use for the http links.
+ @param httpsLinkScheme the scheme to use for the https links.
+ @return the URL, or nil if the link is not a valid URL.
+ */
++ (NSURL*)urlForHttpLink:(NSString*)httpLink httpLinkScheme:(NSString*)httpLinkScheme httpsLinkScheme:(NSString*)httpsLinkScheme
+{
+    NSString *lowercaseHttpLink = httpLink.lowercaseString;
+    if (![lowercaseHttpLink hasPrefix:@"http://"] && ![lowercaseHttpLink hasPrefix:@"https://"] && ![lowercaseHttpLink hasPrefix:@"mailto:"])
+    {
+        if (![lowercaseHttpLink hasPrefix:@"www."] && [httpLink rangeOfString:@"@"].location != NSNotFound && [httpLink rangeOfString:@"/"].location == NSNotFound)
         {
-            // Create the output string only if it is necessary because attributed strings cost CPU
-            if (!*mutableAttributedString)
-            {
-                *mutableAttributedString = [[NSMutableAttributedString alloc] initWithAttributedString:attributedString];
-            }
-            
-            // Make the link clickable
-            // Caution: We need here to escape the non-ASCII characters (like '#' in room alias)
-            // to convert the link into a legal URL string.
-            NSString *link = [attributedString.string substringWithRange:match.range];
-            link = [link stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
-            [*mutableAttributedString addAttribute:NSLinkAttributeName value:link range:match.range];
+            httpLink = [@"mailto:" stringByAppendingString:httpLink];
         }
-    }];
+        else
+        {
+            httpLink = [@"http://" stringByAppendingString:httpLink];
+        }
+    }
+    
+    NSURL *url = [NSURL URLWithString:httpLink];
+    if (!url)
+    {
+        return nil;
+    }
+    
+    NSURLComponents *urlComponents = [[NSURLComponents alloc] initWithURL:url resolvingAgainstBaseURL:NO];
+    
+    NSString *scheme = urlComponents.scheme.lowercaseString;
+    if ([scheme isEqualToString:@"http"] && httpLinkScheme)
+    {
+        urlComponents.scheme = httpLinkScheme;
+    }
+    else if ([scheme isEqualToString:@"https"] && httpsLinkScheme)
+    {
+        urlComponents.scheme = httpsLinkScheme;
+    }
+    
+    return urlComponents.URL;
 }
 
 #pragma mark - HTML processing - blockquote display handling
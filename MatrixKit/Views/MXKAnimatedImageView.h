@@ -0,0 +1,83 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+@class MXKAttachment;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The default number of decoded frames kept by an animated image view.
+ */
+#define MXKANIMATEDIMAGEVIEW_DEFAULT_FRAME_BUFFER_COUNT 3
+
+/**
+ `MXKAnimatedImageView` plays animated GIF (and APNG) pictures natively.
+
+ The frames are decoded on demand on a background queue, a few frames ahead of the displayed one:
+ only a small ring of decoded frames is kept in memory, whatever the length of the animation.
+ All the animated image views are driven by a single shared display link, and honour the delay
+ of each frame. The playback is paused while the view is not visible.
+
+ Setting the `image` property displays a static picture and discards the animated one.
+ `startAnimating` and `stopAnimating` resume and pause the animation.
+ */
+@interface MXKAnimatedImageView : UIImageView
+
+/**
+ The number of decoded frames kept in memory, including the displayed one.
+ Default is MXKANIMATEDIMAGEVIEW_DEFAULT_FRAME_BUFFER_COUNT.
+ */
+@property (nonatomic) NSUInteger frameBufferCount;
+
+/**
+ The number of frames of the current picture (0 if there is none).
+ */
+@property (nonatomic, readonly) NSUInteger frameCount;
+
+/**
+ Display an animated picture stored in a file. The file is read lazily, it must remain available.
+
+ @param filePath the path of the picture file.
+ @return NO if the file is not a picture.
+ */
+- (BOOL)setAnimatedImageWithContentsOfFile:(NSString*)filePath;
+
+/**
+ Display an animated picture.
+
+ @param data the picture data.
+ @return NO if the data is not a picture.
+ */
+- (BOOL)setAnimatedImageData:(NSData*)data;
+
+/**
+ Download (and decrypt) an attachment and display it.
+ Unencrypted attachments are read from the media cache file.
+
+ @param attachment the animated picture attachment.
+ @param onSuccess a block called when the picture is displayed (optional).
+ @param onFailure a block called on failure (optional).
+ */
+- (void)setAnimatedImageWithAttachment:(MXKAttachment*)attachment
+                               success:(nullable void (^)(void))onSuccess
+                               failure:(nullable void (^)(NSError * _Nullable error))onFailure;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,630 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKAnimatedImageView.h"
+
+#import <ImageIO/ImageIO.h>
+
+#import "MXKAttachment.h"
+
+@import MatrixSDK;
+
+// The delay applied to the frames declaring no or a too short delay, as the browsers do
+static const NSTimeInterval kMXKAnimatedImageViewDefaultFrameDelay = 0.1;
+static const NSTimeInterval kMXKAnimatedImageViewMinimumFrameDelay = 0.011;
+
+@interface MXKAnimatedImageView ()
+
+- (void)displayLinkDidFire:(CFTimeInterval)timestamp;
+
+@end
+
+#pragma mark - Shared display link
+
+/**
+ `MXKAnimatedImageDisplayLink` drives all the playing animated image views from a single display link.
+ The display link only runs while some views are playing.
+ */
+@interface MXKAnimatedImageDisplayLink : NSObject
+{
+    CADisplayLink *displayLink;
+    NSHashTable<MXKAnimatedImageView*> *views;
+}
+
++ (MXKAnimatedImageDisplayLink*)sharedDisplayLink;
+
+- (void)addView:(MXKAnimatedImageView*)view;
+- (void)removeView:(MXKAnimatedImageView*)view;
+
+@end
+
+@implementation MXKAnimatedImageDisplayLink
+
++ (MXKAnimatedImageDisplayLink*)sharedDisplayLink
+{
+    static MXKAnimatedImageDisplayLink *sharedDisplayLink;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedDisplayLink = [[MXKAnimatedImageDisplayLink alloc] init];
+    });
+    return sharedDisplayLink;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        views = [NSHashTable weakObjectsHashTable];
+    }
+    return self;
+}
+
+- (void)addView:(MXKAnimatedImageView*)view
+{
+    [views addObject:view];
+    
+    if (!displayLink)
+    {
+        displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(onDisplayLink:)];
+        // Keep playing while the user scrolls
+        [displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+}
+
+- (void)removeView:(MXKAnimatedImageView*)view
+{
+    [views removeObject:view];
+    [self stopIfUnused];
+}
+
+- (void)onDisplayLink:(CADisplayLink*)link
+{
+    for (MXKAnimatedImageView *view in views.allObjects)
+    {
+        [view displayLinkDidFire:link.timestamp];
+    }
+    
+    // The released views are removed from the weak hash table
+    [self stopIfUnused];
+}
+
+- (void)stopIfUnused
+{
+    if (displayLink && !views.allObjects.count)
+    {
+        [displayLink invalidate];
+        displayLink = nil;
+    }
+}
+
+@end
+
+#pragma mark - MXKAnimatedImageView
+
+@interface MXKAnimatedImageView ()
+{
+    CGImageSourceRef imageSource;
+    
+    /**
+     Incremented each time the picture changes, to discard the frames decoded for a previous one.
+     */
+    NSUInteger sourceGeneration;
+    
+    /**
+     The delay of each frame, and the number of times the animation must be played (0 for ever).
+     */
+    NSArray<NSNumber*> *frameDelays;
+    NSUInteger loopCount;
+    NSUInteger completedLoopCount;
+    
+    /**
+     The decoded frames by index, and the indexes of the frames being decoded.
+     */
+    NSMutableDictionary<NSNumber*, UIImage*> *frames;
+    NSMutableIndexSet *decodingFrameIndexes;
+    dispatch_queue_t decodingQueue;
+    
+    /**
+     The indexes of the frames which cannot be decoded. They are skipped by the animation.
+     */
+    NSMutableIndexSet *failedFrameIndexes;
+    
+    NSUInteger currentFrameIndex;
+    
+    /**
+     The time spent on the current frame, and the timestamp of the last display link call.
+     */
+    NSTimeInterval currentFrameElapsedTime;
+    CFTimeInterval lastTimestamp;
+    
+    BOOL shouldAnimate;
+    BOOL isFinished;
+    BOOL isRegistered;
+    
+    /**
+     The attachment being loaded by setAnimatedImageWithAttachment.
+     */
+    MXKAttachment *pendingAttachment;
+}
+
+@end
+
+@implementation MXKAnimatedImageView
+
+- (instancetype)initWithFrame:(CGRect)frame
+{
+    self = [super initWithFrame:frame];
+    if (self)
+    {
+        [self commonInit];
+    }
+    return self;
+}
+
+- (instancetype)initWithCoder:(NSCoder *)aDecoder
+{
+    self = [super initWithCoder:aDecoder];
+    if (self)
+    {
+        [self commonInit];
+    }
+    return self;
+}
+
+- (void)commonInit
+{
+    _frameBufferCount = MXKANIMATEDIMAGEVIEW_DEFAULT_FRAME_BUFFER_COUNT;
+    frames = [NSMutableDictionary dictionary];
+    decodingFrameIndexes = [NSMutableIndexSet indexSet];
+    failedFrameIndexes = [NSMutableIndexSet indexSet];
+    shouldAnimate = YES;
+}
+
+- (void)dealloc
+{
+    if (imageSource)
+    {
+        CFRelease(imageSource);
+    }
+}
+
+#pragma mark - Picture
+
+- (BOOL)setAnimatedImageWithContentsOfFile:(NSString*)filePath
+{
+    NSDictionary *options = @{(id)kCGImageSourceShouldCache: @NO};
+    CGImageSourceRef source = filePath ? CGImageSourceCreateWithURL((__bridge CFURLRef)[NSURL fileURLWithPath:filePath], (__bridge CFDictionaryRef)options) : NULL;
+    return [self setImageSource:source];
+}
+
+- (BOOL)setAnimatedImageData:(NSData*)data
+{
+    NSDictionary *options = @{(id)kCGImageSourceShouldCache: @NO};
+    CGImageSourceRef source = data ? CGImageSourceCreateWithData((__bridge CFDataRef)data, (__bridge CFDictionaryRef)options) : NULL;
+    return [self setImageSource:source];
+}
+
+- (void)setAnimatedImageWithAttachment:(MXKAttachment*)attachment success:(void (^)(void))onSuccess failure:(void (^)(NSError *error))onFailure
+{
+    [self resetAnimatedImage];
+    pendingAttachment = attachment;
+    
+    MXWeakify(self);
+    void (^onLoaded)(BOOL) = ^(BOOL loaded) {
+        MXStrongifyAndReturnIfNil(self);
+        
+        if (loaded)
+        {
+            if (onSuccess) onSuccess();
+        }
+        else if (onFailure)
+        {
+            onFailure([NSError errorWithDomain:kMXKAttachmentErrorDomain code:0 userInfo:@{@"err": @"error_get_image_from_data"}]);
+        }
+    };
+    
+    // Ignore the failure if another picture has been set in the meantime
+    void (^onLoadingFailure)(NSError*) = ^(NSError *error) {
+        MXStrongifyAndReturnIfNil(self);
+        
+        if (self->pendingAttachment == attachment && onFailure)
+        {
+            onFailure(error);
+        }
+    };
+    
+    if (attachment.isEncrypted)
+    {
+        // The decrypted data is kept compressed: only the buffered frames are decoded
+        [attachment getAttachmentData:^(NSData *data) {
+            MXStrongifyAndReturnIfNil(self);
+            
+            if (self->pendingAttachment == attachment)
+            {
+                onLoaded([self setAnimatedImageData:data]);
+            }
+        } failure:onLoadingFailure];
+    }
+    else
+    {
+        [attachment prepare:^{
+            MXStrongifyAndReturnIfNil(self);
+            
+            if (self->pendingAttachment == attachment)
+            {
+                onLoaded([self setAnimatedImageWithContentsOfFile:attachment.cacheFilePath]);
+            }
+        } failure:onLoadingFailure];
+    }
+}
+
+- (void)setImage:(UIImage *)image
+{
+    [self resetAnimatedImage];
+    [super setImage:image];
+}
+
+- (BOOL)setImageSource:(CGImageSourceRef)source
+{
+    [self resetAnimatedImage];
+    
+    if (!source)
+    {
+        return NO;
+    }
+    
+    size_t count = CGImageSourceGetCount(source);
+    if (!count)
+    {
+        CFRelease(source);
+        return NO;
+    }
+    
+    imageSource = source;
+    _frameCount = count;
+    
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyProperties(source, nil));
+    NSNumber *loopCountValue = properties[(id)kCGImagePropertyGIFDictionary][(id)kCGImagePropertyGIFLoopCount];
+    if (!loopCountValue)
+    {
+        loopCountValue = properties[(id)kCGImagePropertyPNGDictionary][(id)kCGImagePropertyAPNGLoopCount];
+    }
+    loopCount = loopCountValue.unsignedIntegerValue;
+    
+    NSMutableArray<NSNumber*> *delays = [NSMutableArray arrayWithCapacity:count];
+    for (size_t index = 0; index < count; index++)
+    {
+        [delays addObject:@([self delayOfFrameAtIndex:index])];
+    }
+    frameDelays = delays;
+    
+    // Nothing is displayed until the first frame is decoded
+    [super setImage:nil];
+    
+    [self requestFrames];
+    [self updateAnimationState];
+    return YES;
+}
+
+- (void)resetAnimatedImage
+{
+    if (imageSource)
+    {
+        CFRelease(imageSource);
+        imageSource = NULL;
+    }
+    
+    sourceGeneration++;
+    pendingAttachment = nil;
+    
+    _frameCount = 0;
+    frameDelays = nil;
+    loopCount = 0;
+    completedLoopCount = 0;
+    [frames removeAllObjects];
+    [decodingFrameIndexes removeAllIndexes];
+    [failedFrameIndexes removeAllIndexes];
+    
+    currentFrameIndex = 0;
+    currentFrameElapsedTime = 0;
+    isFinished = NO;
+    
+    [self updateAnimationState];
+}
+
+- (NSTimeInterval)delayOfFrameAtIndex:(size_t)index
+{
+    NSDictionary *properties = CFBridgingRelease(CGImageSourceCopyPropertiesAtIndex(imageSource, index, nil));
+    
+    NSNumber *delay;
+    NSDictionary *gifProperties = properties[(id)kCGImagePropertyGIFDictionary];
+    if (gifProperties)
+    {
+        delay = gifProperties[(id)kCGImagePropertyGIFUnclampedDelayTime] ?: gifProperties[(id)kCGImagePropertyGIFDelayTime];
+    }
+    else
+    {
+        NSDictionary *pngProperties = properties[(id)kCGImagePropertyPNGDictionary];
+        delay = pngProperties[(id)kCGImagePropertyAPNGUnclampedDelayTime] ?: pngProperties[(id)kCGImagePropertyAPNGDelayTime];
+    }
+    
+    return (delay.doubleValue < kMXKAnimatedImageViewMinimumFrameDelay) ? kMXKAnimatedImageViewDefaultFrameDelay : delay.doubleValue;
+}
+
+#pragma mark - Frames buffer
+
+- (void)setFrameBufferCount:(NSUInteger)frameBufferCount
+{
+    _frameBufferCount = MAX(frameBufferCount, 1);
+    [self requestFrames];
+}
+
+/**
+ Drop the frames out of the buffer window and decode the missing ones.
+ */
+- (void)requestFrames
+{
+    if (!imageSource)
+    {
+        return;
+    }
+    
+    NSMutableIndexSet *window = [NSMutableIndexSet indexSet];
+    
+    // Keep only the displayed frame while the view is off screen
+    NSUInteger windowSize = self.window ? MIN(_frameBufferCount, _frameCount) : 1;
+    for (NSUInteger offset = 0; offset < windowSize; offset++)
+    {
+        [window addIndex:(currentFrameIndex + offset) % _frameCount];
+    }
+    
+    for (NSNumber *index in frames.allKeys)
+    {
+        if (![window containsIndex:index.unsignedIntegerValue])
+        {
+            [frames removeObjectForKey:index];
+        }
+    }
+    
+    [window enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        if (!self->frames[@(index)] && ![self->decodingFrameIndexes containsIndex:index] && ![self->failedFrameIndexes containsIndex:index])
+        {
+            [self decodeFrameAtIndex:index];
+        }
+    }];
+}
+
+- (void)decodeFrameAtIndex:(NSUInteger)index
+{
+    if (!decodingQueue)
+    {
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+        decodingQueue = dispatch_queue_create("MXKAnimatedImageView", attributes);
+    }
+    
+    [decodingFrameIndexes addIndex:index];
+    
+    CGImageSourceRef source = (CGImageSourceRef)CFRetain(imageSource);
+    NSUInteger generation = sourceGeneration;
+    
+    // Decode the frames to the pixel size of the view
+    CGFloat scale = self.window ? self.window.screen.scale : [UIScreen mainScreen].scale;
+    CGFloat maxPixelSize = MAX(self.bounds.size.width, self.bounds.size.height) * scale;
+    
+    Class viewClass = self.class;
+    MXWeakify(self);
+    dispatch_async(decodingQueue, ^{
+        
+        UIImage *frame = [viewClass decodedFrameAtIndex:index ofSource:source maxPixelSize:maxPixelSize];
+        CFRelease(source);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MXStrongifyAndReturnIfNil(self);
+            
+            if (generation != self->sourceGeneration)
+            {
+                return;
+            }
+            
+            [self->decodingFrameIndexes removeIndex:index];
+            if (frame)
+            {
+                self->frames[@(index)] = frame;
+                
+                if (index == self->currentFrameIndex)
+                {
+                    [self displayFrame:frame];
+                }
+            }
+            else
+            {
+                // Do not decode it again on each display link call
+                NSLog(@"[MXKAnimatedImageView] decodeFrameAtIndex: Cannot decode the frame %tu", index);
+                [self->failedFrameIndexes addIndex:index];
+                [self updateAnimationState];
+            }
+        });
+    });
+}
+
+- (void)displayFrame:(UIImage*)frame
+{
+    // Do not reset the animated picture
+    [super setImage:frame];
+}
+
++ (UIImage*)decodedFrameAtIndex:(NSUInteger)index ofSource:(CGImageSourceRef)source maxPixelSize:(CGFloat)maxPixelSize
+{
+    CGImageRef cgImage;
+    if (maxPixelSize > 0)
+    {
+        // The thumbnail is rendered into a new bitmap: it is already decoded when it is returned.
+        NSDictionary *options = @{
+                                  (id)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+                                  (id)kCGImageSourceCreateThumbnailWithTransform: @YES,
+                                  (id)kCGImageSourceShouldCacheImmediately: @YES,
+                                  (id)kCGImageSourceThumbnailMaxPixelSize: @(ceil(maxPixelSize))
+                                  };
+        cgImage = CGImageSourceCreateThumbnailAtIndex(source, index, (__bridge CFDictionaryRef)options);
+    }
+    else
+    {
+        NSDictionary *options = @{(id)kCGImageSourceShouldCacheImmediately: @YES};
+        cgImage = CGImageSourceCreateImageAtIndex(source, index, (__bridge CFDictionaryRef)options);
+    }
+    
+    if (!cgImage)
+    {
+        return nil;
+    }
+    
+    UIImage *frame = [UIImage imageWithCGImage:cgImage];
+    CGImageRelease(cgImage);
+    return frame;
+}
+
+#pragma mark - Playback
+
+- (void)displayLinkDidFire:(CFTimeInterval)timestamp
+{
+    if (!lastTimestamp)
+    {
+        lastTimestamp = timestamp;
+        return;
+    }
+    
+    currentFrameElapsedTime += timestamp - lastTimestamp;
+    lastTimestamp = timestamp;
+    
+    NSTimeInterval delay = frameDelays[currentFrameIndex].doubleValue;
+    if (currentFrameElapsedTime < delay)
+    {
+        return;
+    }
+    
+    // Skip the frames which cannot be decoded
+    NSUInteger nextFrameIndex = (currentFrameIndex + 1) % _frameCount;
+    while ([failedFrameIndexes containsIndex:nextFrameIndex] && nextFrameIndex != currentFrameIndex)
+    {
+        nextFrameIndex = (nextFrameIndex + 1) % _frameCount;
+    }
+    
+    // Wait for the next frame if its decoding is late, rather than skipping it
+    UIImage *nextFrame = frames[@(nextFrameIndex)];
+    if (!nextFrame)
+    {
+        [self requestFrames];
+        return;
+    }
+    
+    if (nextFrameIndex <= currentFrameIndex && loopCount && ++completedLoopCount >= loopCount)
+    {
+        // Stay on the last frame
+        isFinished = YES;
+        [self updateAnimationState];
+        return;
+    }
+    
+    // Do not try to catch up after a stall
+    currentFrameElapsedTime -= delay;
+    if (currentFrameElapsedTime > frameDelays[nextFrameIndex].doubleValue)
+    {
+        currentFrameElapsedTime = 0;
+    }
+    
+    currentFrameIndex = nextFrameIndex;
+    [self displayFrame:nextFrame];
+    
+    [self requestFrames];
+}
+
+- (void)updateAnimationState
+{
+    BOOL isVisible = self.window && !self.hidden && self.alpha > 0;
+    // At least 2 frames must be decodable
+    BOOL animate = imageSource && _frameCount > failedFrameIndexes.count + 1 && shouldAnimate && !isFinished && isVisible;
+    
+    if (animate && !isRegistered)
+    {
+        lastTimestamp = 0;
+        [[MXKAnimatedImageDisplayLink sharedDisplayLink] addView:self];
+        isRegistered = YES;
+    }
+    else if (!animate && isRegistered)
+    {
+        [[MXKAnimatedImageDisplayLink sharedDisplayLink] removeView:self];
+        isRegistered = NO;
+    }
+}
+
+- (void)startAnimating
+{
+    if (imageSource)
+    {
+        shouldAnimate = YES;
+        [self updateAnimationState];
+    }
+    else
+    {
+        [super startAnimating];
+    }
+}
+
+- (void)stopAnimating
+{
+    if (imageSource)
+    {
+        shouldAnimate = NO;
+        [self updateAnimationState];
+    }
+    else
+    {
+        [super stopAnimating];
+    }
+}
+
+- (BOOL)isAnimating
+{
+    return imageSource ? isRegistered : [super isAnimating];
+}
+
+#pragma mark - Visibility
+
+- (void)didMoveToWindow
+{
+    [super didMoveToWindow];
+    
+    [self updateAnimationState];
+    
+    // Release the buffered frames while the view is off screen, and decode them again when it comes back
+    [self requestFrames];
+}
+
+- (void)setHidden:(BOOL)hidden
+{
+    [super setHidden:hidden];
+    [self updateAnimationState];
+}
+
+- (void)setAlpha:(CGFloat)alpha
+{
+    [super setAlpha:alpha];
+    [self updateAnimationState];
+}
+
+@end
@@ -109,8 +109,8 @@ andImageOrientation:(UIImageOrientation)orientation
 @property (nonatomic, readonly) BOOL fullScreen;
 
 // the image is cached in memory.
-// The medias manager uses a LRU cache.
-// to avoid loading from the file system.
+// The decoded pictures are stored in the shared MXKImageCache for the pixel size of the view
+// to avoid loading and decoding them again.
 @property (nonatomic) BOOL enableInMemoryCache;
 
 // mediaManager folder where the image is stored
@@ -21,6 +21,8 @@
 #import "MXKAttachment.h"
 
 #import "MXKTools.h"
+#import "MXKImageDecoder.h"
+#import "MXKImageCache.h"
 
 @interface MXKImageView ()
 {
@@ -58,6 +60,16 @@
 
     // Current attachment being displayed in the MXKImageView
     MXKAttachment *currentAttachment;
+    
+    // The pending decoding of the picture file
+    NSOperation *decodingOperation;
+    
+    // The variant under which the picture is stored in the shared image cache
+    NSString *imageCacheVariant;
+    
+    // The picture file of the displayed image, and the pixel size it has been decoded to
+    NSString *imageFilePath;
+    CGSize imagePixelSize;
 }
 @end
 
@@ -70,6 +82,8 @@
 {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
     
+    [decodingOperation cancel];
+    
     [self stopActivityIndicator];
     
     if (loadingView)
@@ -210,6 +224,10 @@
     // remove the observers
     [[NSNotificationCenter defaultCenter] removeObserver:self];
     
+    // The pending picture must not replace this one
+    [self cancelImageDecoding];
+    imageFilePath = nil;
+    
     currentImage = anImage;
     imageView.image = anImage;
 
@@ -367,6 +385,8 @@
         imageView.image = self.image;
     }
     
+    [self decodeImageAgainIfNeeded];
+    
     CGRect tabBarFrame = CGRectZero;
     UITabBarController *tabBarController = nil;
     UIEdgeInsets safeAreaInsets = UIEdgeInsetsZero;
@@ -555,6 +575,9 @@ andImageOrientation:(UIImageOrientation)orientation
 {
     // Remove any pending observers
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
+    // Cancel the decoding of the previous picture (the view may be reused)
+    [self cancelImageDecoding];
 
     // Reset other data
     currentAttachment = nil;
@@ -595,20 +618,24 @@ andImageOrientation:(UIImageOrientation)orientation
                                                             inFolder:mediaFolder];
     }
     
-    UIImage* image = _enableInMemoryCache ? [MXMediaManager loadThroughCacheWithFilePath:cacheFilePath] : [MXMediaManager loadPictureFromFilePath:cacheFilePath];
+    // The server side thumbnails are other pictures of the same content
+    imageCacheVariant = isThumbnail ? [NSString stringWithFormat:@"thumbnail_%.0fx%.0f_%lu", thumbnailViewSize.width, thumbnailViewSize.height, (unsigned long)thumbnailMethod] : nil;
+    
+    CGSize pixelSize = [self decodingPixelSize];
+    UIImage* image = _enableInMemoryCache ? [[MXKImageCache sharedCache] imageForContentURI:mxcURI pixelSize:pixelSize fill:[self decodingFill] variant:imageCacheVariant] : nil;
     if (image)
     {
-        if (imageOrientation != UIImageOrientationUp)
-        {
-            self.image = [UIImage imageWithCGImage:image.CGImage scale:1.0 orientation:imageOrientation];
-        }
-        else
-        {
-            self.image = image;
-        }
-        
+        [self displayLoadedImage:image];
+        imageFilePath = cacheFilePath;
+        imagePixelSize = pixelSize;
         [self stopActivityIndicator];
     }
+    else if ([[NSFileManager defaultManager] fileExistsAtPath:cacheFilePath])
+    {
+        // Set preview until the picture file is decoded
+        self.image = previewImage;
+        [self loadImageFromFilePath:cacheFilePath];
+    }
     else
     {
         // Set preview until the image is loaded
@@ -669,6 +696,7 @@ andImageOrientation:(UIImageOrientation)orientation
 {
     // Remove any pending observers
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self cancelImageDecoding];
     
     // Set default orientation
     imageOrientation = UIImageOrientationUp;
@@ -734,6 +762,7 @@ andImageOrientation:(UIImageOrientation)orientation
 {
     // Remove any pending observers
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self cancelImageDecoding];
     
     // Store image orientation
     imageOrientation = attachment.thumbnailOrientation;
@@ -786,6 +815,94 @@ andImageOrientation:(UIImageOrientation)orientation
     }];
 }
 
+#pragma mark - Picture decoding
+
+- (void)loadImageFromFilePath:(NSString*)filePath
+{
+    [self cancelImageDecoding];
+    
+    CGSize pixelSize = [self decodingPixelSize];
+    BOOL fill = [self decodingFill];
+    
+    NSString *contentURI = mxcURI;
+    NSString *variant = imageCacheVariant;
+    BOOL cacheInMemory = _enableInMemoryCache && contentURI;
+    
+    MXWeakify(self);
+    decodingOperation = [MXKImageDecoder decodeImageWithContentsOfFile:filePath toPixelSize:pixelSize fill:fill completion:^(UIImage *image) {
+        MXStrongifyAndReturnIfNil(self);
+        
+        self->decodingOperation = nil;
+        [self stopActivityIndicator];
+        
+        if (image)
+        {
+            if (cacheInMemory)
+            {
+                [[MXKImageCache sharedCache] setImage:image forContentURI:contentURI pixelSize:pixelSize fill:fill variant:variant];
+            }
+            [self displayLoadedImage:image];
+            self->imageFilePath = filePath;
+            self->imagePixelSize = pixelSize;
+            
+            // The view may have grown during the decoding
+            [self setNeedsLayout];
+        }
+        else
+        {
+            // Do not try to decode this file again
+            self->imageFilePath = nil;
+        }
+    }];
+}
+
+- (CGSize)decodingPixelSize
+{
+    // Keep the full resolution when the picture may be zoomed in
+    if (stretchable || _fullScreen)
+    {
+        return CGSizeZero;
+    }
+    
+    CGFloat scale = self.window ? self.window.screen.scale : [UIScreen mainScreen].scale;
+    return CGSizeMake(self.bounds.size.width * scale, self.bounds.size.height * scale);
+}
+
+- (BOOL)decodingFill
+{
+    return (self.contentMode == UIViewContentModeScaleAspectFill || self.contentMode == UIViewContentModeScaleToFill);
+}
+
+- (void)decodeImageAgainIfNeeded
+{
+    // The picture has been decoded at full resolution, or is being decoded
+    if (!imageFilePath || imagePixelSize.width <= 0 || imagePixelSize.height <= 0 || decodingOperation)
+    {
+        return;
+    }
+    
+    // Decode the picture again only when the view needs more pixels than the displayed image
+    CGSize pixelSize = [self decodingPixelSize];
+    if (stretchable || _fullScreen || pixelSize.width > imagePixelSize.width || pixelSize.height > imagePixelSize.height)
+    {
+        // Keep the displayed image until the new one is decoded
+        [self loadImageFromFilePath:imageFilePath];
+    }
+}
+
+- (void)cancelImageDecoding
+{
+    [decodingOperation cancel];
+    decodingOperation = nil;
+}
+
+- (void)displayLoadedImage:(UIImage*)image
+{
+    // The decoded image is already upright: MXKImageDecoder applies the orientation of the picture file.
+    // Do not rotate it again with the stored image orientation.
+    self.image = image;
+}
+
 - (void)updateProgressUI:(NSDictionary*)downloadStatsDict
 {
     // Sanity check: updateProgressUI may be called while there is no stats available
@@ -856,20 +973,9 @@ andImageOrientation:(UIImageOrientation)orientation
         case MXMediaLoaderStateDownloadCompleted:
         {
             [self stopActivityIndicator];
-            // update the image
-            UIImage* image = [MXMediaManager loadPictureFromFilePath:loader.downloadOutputFilePath];
-            if (image)
-            {
-                if (imageOrientation != UIImageOrientationUp)
-                {
-                    self.image = [UIImage imageWithCGImage:image.CGImage scale:1.0 orientation:imageOrientation];
-                }
-                else
-                {
-                    self.image = image;
-                }
-            }
             [[NSNotificationCenter defaultCenter] removeObserver:self name:kMXMediaLoaderStateDidChangeNotification object:loader];
+            // update the image
+            [self loadImageFromFilePath:loader.downloadOutputFilePath];
             break;
         }
         case MXMediaLoaderStateDownloadFailed:
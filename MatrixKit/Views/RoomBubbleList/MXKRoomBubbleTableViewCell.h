@@ -19,9 +19,9 @@
 #import "MXKCellRendering.h"
 #import "MXKReceiptSendersContainer.h"
 
-#import <WebKit/WebKit.h>
 
 @class MXKImageView;
+@class MXKAnimatedImageView;
 @class MXKPieChartView;
 @class MXKRoomBubbleCellData;
 
@@ -137,7 +137,7 @@ extern NSString *const kMXKRoomBubbleCellUrlItemInteraction;
  To optimize bubbles rendering, we advise to define a .xib for each kind of bubble layout (with or without sender's information, with or without attachment...).
  Each inherited class should define only the actual displayed items.
  */
-@interface MXKRoomBubbleTableViewCell : MXKTableViewCell <MXKCellRendering, UITextViewDelegate, WKNavigationDelegate>
+@interface MXKRoomBubbleTableViewCell : MXKTableViewCell <MXKCellRendering, UITextViewDelegate>
 {
 @protected
     /**
@@ -233,9 +233,16 @@ extern NSString *const kMXKRoomBubbleCellUrlItemInteraction;
 @property (nonatomic) NSLayoutConstraint *readMarkerViewHeightConstraint;
 
 /**
- The potential webview used to render an attachment (for example an animated gif).
+ The potential view used to render an animated attachment (an animated gif).
  */
-@property (nonatomic) WKWebView *attachmentWebView;
+@property (nonatomic) MXKAnimatedImageView *attachmentAnimatedImageView;
+
+/**
+ The view previously used to render an animated attachment.
+ 
+ It is now an alias of `attachmentAnimatedImageView`, animated gifs are not rendered in a web view anymore.
+ */
+@property (nonatomic, readonly) UIView *attachmentWebView __deprecated_msg("Use attachmentAnimatedImageView instead");
 
 /**
  Called during the designated initializer of the UITableViewCell class to set the default
@@ -19,6 +19,7 @@
 #import "MXKRoomBubbleTableViewCell.h"
 
 #import "MXKImageView.h"
+#import "MXKAnimatedImageView.h"
 #import "MXKPieChartView.h"
 #import "MXKRoomBubbleCellData.h"
 #import "MXKTools.h"
@@ -873,40 +874,31 @@ static BOOL _disableLongPressGestureOnEvent;
                 [self stopProgressUI];
                 [[NSNotificationCenter defaultCenter] removeObserver:self name:kMXMediaLoaderStateDidChangeNotification object:nil];
                 
-                // Animated gif is displayed in a webview added on the attachment view
-                self.attachmentWebView = [[WKWebView alloc] initWithFrame:self.attachmentView.bounds];
-                self.attachmentWebView.opaque = NO;
-                self.attachmentWebView.backgroundColor = [UIColor clearColor];
-                self.attachmentWebView.contentMode = UIViewContentModeScaleAspectFit;
-                self.attachmentWebView.autoresizingMask = (UIViewAutoresizingFlexibleLeftMargin | UIViewAutoresizingFlexibleRightMargin | UIViewAutoresizingFlexibleTopMargin | UIViewAutoresizingFlexibleBottomMargin);
-                self.attachmentWebView.userInteractionEnabled = NO;
-                self.attachmentWebView.hidden = YES;
-                [self.attachmentView addSubview:self.attachmentWebView];
-                
-                __weak WKWebView *weakAnimatedGifViewer = self.attachmentWebView;
-                __weak typeof(self) weakSelf = self;
+                // Animated gif is displayed in an animated image view added on the attachment view
+                if (!self.attachmentAnimatedImageView)
+                {
+                    self.attachmentAnimatedImageView = [[MXKAnimatedImageView alloc] initWithFrame:self.attachmentView.bounds];
+                    self.attachmentAnimatedImageView.backgroundColor = [UIColor clearColor];
+                    self.attachmentAnimatedImageView.contentMode = UIViewContentModeScaleAspectFit;
+                    self.attachmentAnimatedImageView.autoresizingMask = (UIViewAutoresizingFlexibleLeftMargin | UIViewAutoresizingFlexibleRightMargin | UIViewAutoresizingFlexibleTopMargin | UIViewAutoresizingFlexibleBottomMargin);
+                    self.attachmentAnimatedImageView.userInteractionEnabled = NO;
+                    [self.attachmentView addSubview:self.attachmentAnimatedImageView];
+                }
+                self.attachmentAnimatedImageView.hidden = YES;
                 
-                void (^onDownloaded)(NSData *) = ^(NSData *data){
+                MXWeakify(self);
+                [self.attachmentAnimatedImageView setAnimatedImageWithAttachment:bubbleData.attachment success:^{
+                    MXStrongifyAndReturnIfNil(self);
                     
-                    if (weakAnimatedGifViewer && weakAnimatedGifViewer.superview)
-                    {
-                        WKWebView *strongAnimatedGifViewer = weakAnimatedGifViewer;
-                        strongAnimatedGifViewer.navigationDelegate = weakSelf;
-                        [strongAnimatedGifViewer loadData:data MIMEType:@"image/gif" characterEncodingName:@"UTF-8" baseURL:[NSURL URLWithString:@"http://"]];
-                    }
-                };
-                
-                void (^onFailure)(NSError *) = ^(NSError *error){
+                    // The animated image view is ready to replace the attachment view.
+                    self.attachmentAnimatedImageView.hidden = NO;
+                    self.attachmentView.image = nil;
+                    
+                } failure:^(NSError *error) {
                     
                     NSLog(@"[MXKRoomBubbleTableViewCell] gif download failed");
                     // Notify the end user
                     [[NSNotificationCenter defaultCenter] postNotificationName:kMXKErrorNotification object:error];
-                };
-                
-                [bubbleData.attachment getAttachmentData:^(NSData *data) {
-                    onDownloaded(data);
-                } failure:^(NSError *error) {
-                    onFailure(error);
                 }];
             }
             else
@@ -983,11 +975,10 @@ static BOOL _disableLongPressGestureOnEvent;
     [htmlBlockquoteSideBorderViews removeAllObjects];
     htmlBlockquoteSideBorderViews = nil;
 
-    if (_attachmentWebView)
+    if (_attachmentAnimatedImageView)
     {
-        [_attachmentWebView removeFromSuperview];
-        _attachmentWebView.navigationDelegate = nil;
-        _attachmentWebView = nil;
+        [_attachmentAnimatedImageView removeFromSuperview];
+        _attachmentAnimatedImageView = nil;
     }
     
     if (_readMarkerView)
@@ -1150,6 +1141,11 @@ API_AVAILABLE(ios(10.0)) {
     [self resetAttachmentViewBottomConstraintConstant];
 }
 
+- (UIView *)attachmentWebView
+{
+    return _attachmentAnimatedImageView;
+}
+
 #pragma mark - Attachment progress handling
 
 - (void)updateProgressUI:(NSDictionary*)statisticsDict
@@ -1535,18 +1531,6 @@ static NSMutableDictionary *childClasses;
     return shouldInteractWithURL;
 }
 
-#pragma mark - WKNavigationDelegate
-
-- (void)webView:(WKWebView *)webView didFinishNavigation:(WKNavigation *)navigation
-{
-    if (webView == _attachmentWebView && self.attachmentView)
-    {
-        // The attachment webview is ready to replace the attachment view.
-        _attachmentWebView.hidden = NO;
-        self.attachmentView.image = nil;
-    }
-}
-
 #pragma mark - UIGestureRecognizerDelegate
 
 - (BOOL)gestureRecognizer:(UIGestureRecognizer *)gestureRecognizer shouldReceiveTouch:(UITouch *)touch
@@ -0,0 +1,245 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXK3PIDLookupScheduler.h"
+
+/**
+ A local stub of an identity server: the email addresses starting with "bob" are bound to "@bob:matrix.org",
+ the requests are answered asynchronously, and the requested chunks and the concurrency are recorded.
+ */
+@interface MXK3PIDLookupStubIdentityServer : NSObject
+
+@property (nonatomic) NSMutableArray<NSArray<NSArray<NSString*>*>*> *requestedChunks;
+@property (nonatomic) NSUInteger inFlightCount;
+@property (nonatomic) NSUInteger maxInFlightCount;
+@property (nonatomic) BOOL failRequests;
+
+- (MXK3PIDLookupBlock)lookupBlock;
+
+@end
+
+@implementation MXK3PIDLookupStubIdentityServer
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        _requestedChunks = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (MXK3PIDLookupBlock)lookupBlock
+{
+    return ^(NSArray<NSArray<NSString *> *> *threepids, void (^success)(NSArray<NSArray<NSString *> *> *), void (^failure)(NSError *)) {
+        
+        @synchronized (self)
+        {
+            [self.requestedChunks addObject:threepids];
+            self.inFlightCount++;
+            self.maxInFlightCount = MAX(self.maxInFlightCount, self.inFlightCount);
+        }
+        
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.01 * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+            
+            @synchronized (self)
+            {
+                self.inFlightCount--;
+            }
+            
+            if (self.failRequests)
+            {
+                failure([NSError errorWithDomain:@"MXK3PIDLookupStubIdentityServer" code:0 userInfo:nil]);
+                return;
+            }
+            
+            NSMutableArray<NSArray<NSString*>*> *discoveredUsers = [NSMutableArray array];
+            for (NSArray<NSString*> *threepid in threepids)
+            {
+                if ([threepid[1] hasPrefix:@"bob"])
+                {
+                    [discoveredUsers addObject:@[threepid[0], threepid[1], @"@bob:matrix.org"]];
+                }
+            }
+            success(discoveredUsers);
+        });
+    };
+}
+
+@end
+
+
+@interface MXK3PIDLookupSchedulerTests : XCTestCase
+{
+    dispatch_queue_t queue;
+    MXK3PIDLookupStubIdentityServer *identityServer;
+    MXK3PIDLookupScheduler *scheduler;
+}
+
+@end
+
+@implementation MXK3PIDLookupSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    queue = dispatch_queue_create("MXK3PIDLookupSchedulerTests", DISPATCH_QUEUE_SERIAL);
+    identityServer = [[MXK3PIDLookupStubIdentityServer alloc] init];
+    scheduler = [[MXK3PIDLookupScheduler alloc] initWithQueue:queue lookupBlock:identityServer.lookupBlock];
+}
+
+- (NSArray<NSArray<NSString*>*>*)threepidsCount:(NSUInteger)count
+{
+    NSMutableArray<NSArray<NSString*>*> *threepids = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        NSString *name = (index % 10) ? @"alice" : @"bob";
+        [threepids addObject:@[kMX3PIDMediumEmail, [NSString stringWithFormat:@"%@%tu@example.org", name, index]]];
+    }
+    return threepids;
+}
+
+- (void)testChunksAndConcurrency
+{
+    scheduler.chunkSize = 100;
+    scheduler.maxConcurrentLookups = 3;
+    
+    // Pass every 3PID twice
+    NSArray *threepids = [self threepidsCount:1050];
+    threepids = [threepids arrayByAddingObjectsFromArray:threepids];
+    
+    NSMutableDictionary<NSString*, NSString*> *matrixIDBy3PID = [NSMutableDictionary dictionary];
+    matrixIDBy3PID[@"alice1@example.org"] = @"@alice:matrix.org";
+    NSMutableSet<NSString*> *lookedUpAddresses = [NSMutableSet set];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"lookup"];
+    
+    dispatch_async(queue, ^{
+        NSUInteger count = [self->scheduler lookup3PIDs:threepids lastLookupDates:nil onChunk:^(NSArray<NSString *> *addresses, NSDictionary<NSString *,NSString *> *matrixIDByAddress) {
+            
+            // Merge the chunk
+            for (NSString *address in addresses)
+            {
+                XCTAssertFalse([lookedUpAddresses containsObject:address]);
+                [lookedUpAddresses addObject:address];
+                matrixIDBy3PID[address] = matrixIDByAddress[address];
+            }
+            
+        } completion:^(BOOL success) {
+            
+            XCTAssertTrue(success);
+            XCTAssertFalse(self->scheduler.isLookingUp);
+            [expectation fulfill];
+        }];
+        
+        XCTAssertEqual(count, 1050);
+    });
+    
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssertEqual(identityServer.requestedChunks.count, 11);
+    for (NSArray *chunk in identityServer.requestedChunks)
+    {
+        XCTAssertLessThanOrEqual(chunk.count, 100);
+    }
+    XCTAssertLessThanOrEqual(identityServer.maxInFlightCount, 3);
+    
+    XCTAssertEqual(lookedUpAddresses.count, 1050);
+    XCTAssertEqual(matrixIDBy3PID.count, 105);
+    XCTAssertEqualObjects(matrixIDBy3PID[@"bob0@example.org"], @"@bob:matrix.org");
+    XCTAssertNil(matrixIDBy3PID[@"alice1@example.org"], @"A 3PID which is not bound anymore must be removed");
+}
+
+- (void)testFreshnessTTL
+{
+    scheduler.freshnessTTL = 3600;
+    
+    NSArray *threepids = [self threepidsCount:10];
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+    NSDictionary *lastLookupDates = @{
+                                      @"bob0@example.org": @(now - 60),         // fresh
+                                      @"alice1@example.org": @(now - 7200),     // stale
+                                      };
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"lookup"];
+    
+    dispatch_async(queue, ^{
+        NSUInteger count = [self->scheduler lookup3PIDs:threepids lastLookupDates:lastLookupDates onChunk:^(NSArray<NSString *> *addresses, NSDictionary<NSString *,NSString *> *matrixIDByAddress) {
+            XCTAssertFalse([addresses containsObject:@"bob0@example.org"]);
+            XCTAssertTrue([addresses containsObject:@"alice1@example.org"]);
+        } completion:^(BOOL success) {
+            XCTAssertTrue(success);
+            [expectation fulfill];
+        }];
+        
+        XCTAssertEqual(count, 9);
+    });
+    
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqual(identityServer.requestedChunks.count, 1);
+}
+
+- (void)testFailure
+{
+    scheduler.chunkSize = 4;
+    identityServer.failRequests = YES;
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"lookup"];
+    
+    dispatch_async(queue, ^{
+        [self->scheduler lookup3PIDs:[self threepidsCount:10] lastLookupDates:nil onChunk:^(NSArray<NSString *> *addresses, NSDictionary<NSString *,NSString *> *matrixIDByAddress) {
+            XCTFail(@"No chunk must be reported on failure");
+        } completion:^(BOOL success) {
+            XCTAssertFalse(success);
+            [expectation fulfill];
+        }];
+    });
+    
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqual(identityServer.requestedChunks.count, 3);
+}
+
+- (void)testCancel
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"cancel"];
+    
+    dispatch_async(queue, ^{
+        [self->scheduler lookup3PIDs:[self threepidsCount:10] lastLookupDates:nil onChunk:^(NSArray<NSString *> *addresses, NSDictionary<NSString *,NSString *> *matrixIDByAddress) {
+            XCTFail(@"The results of a cancelled lookup must be ignored");
+        } completion:^(BOOL success) {
+            XCTFail(@"A cancelled lookup must not complete");
+        }];
+        
+        [self->scheduler cancel];
+        XCTAssertFalse(self->scheduler.isLookingUp);
+        
+        // Let the stub answer
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.2 * NSEC_PER_SEC)), self->queue, ^{
+            [expectation fulfill];
+        });
+    });
+    
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+@end
@@ -0,0 +1,196 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
+
+#import "MatrixKit.h"
+#import "MXKAnimatedImageView.h"
+
+@interface MXKAnimatedImageView (MXKAnimatedImageViewTests)
+
++ (UIImage*)decodedFrameAtIndex:(NSUInteger)index ofSource:(CGImageSourceRef)source maxPixelSize:(CGFloat)maxPixelSize;
+
+@end
+
+/**
+ An animated image view which fails to decode some frames, and counts the decodings by frame index.
+ */
+@interface MXKAnimatedImageViewTestsFailingView : MXKAnimatedImageView
+
++ (void)resetWithFailedFrameIndexes:(NSIndexSet*)failedFrameIndexes;
++ (NSUInteger)decodingCountOfFrameAtIndex:(NSUInteger)index;
+
+@end
+
+static NSIndexSet *MXKAnimatedImageViewTestsFailedFrameIndexes;
+static NSCountedSet<NSNumber*> *MXKAnimatedImageViewTestsDecodedFrameIndexes;
+
+@implementation MXKAnimatedImageViewTestsFailingView
+
++ (void)resetWithFailedFrameIndexes:(NSIndexSet*)failedFrameIndexes
+{
+    @synchronized(self)
+    {
+        MXKAnimatedImageViewTestsFailedFrameIndexes = failedFrameIndexes;
+        MXKAnimatedImageViewTestsDecodedFrameIndexes = [NSCountedSet set];
+    }
+}
+
++ (NSUInteger)decodingCountOfFrameAtIndex:(NSUInteger)index
+{
+    @synchronized(self)
+    {
+        return [MXKAnimatedImageViewTestsDecodedFrameIndexes countForObject:@(index)];
+    }
+}
+
++ (UIImage *)decodedFrameAtIndex:(NSUInteger)index ofSource:(CGImageSourceRef)source maxPixelSize:(CGFloat)maxPixelSize
+{
+    @synchronized(self)
+    {
+        [MXKAnimatedImageViewTestsDecodedFrameIndexes addObject:@(index)];
+        if ([MXKAnimatedImageViewTestsFailedFrameIndexes containsIndex:index])
+        {
+            return nil;
+        }
+    }
+    return [super decodedFrameAtIndex:index ofSource:source maxPixelSize:maxPixelSize];
+}
+
+@end
+
+@interface MXKAnimatedImageViewTests : XCTestCase
+
+@end
+
+@implementation MXKAnimatedImageViewTests
+
+/**
+ Build an animated gif.
+
+ @param frameCount the number of frames.
+ @return the gif data.
+ */
+- (NSData*)gifDataWithFrameCount:(NSUInteger)frameCount
+{
+    NSMutableData *data = [NSMutableData data];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, kUTTypeGIF, frameCount, nil);
+    
+    NSDictionary *gifProperties = @{(id)kCGImagePropertyGIFDictionary: @{(id)kCGImagePropertyGIFLoopCount: @0}};
+    CGImageDestinationSetProperties(destination, (__bridge CFDictionaryRef)gifProperties);
+    
+    NSDictionary *frameProperties = @{(id)kCGImagePropertyGIFDictionary: @{(id)kCGImagePropertyGIFDelayTime: @0.05}};
+    for (NSUInteger index = 0; index < frameCount; index++)
+    {
+        UIGraphicsBeginImageContextWithOptions(CGSizeMake(20, 20), YES, 1.0);
+        [[UIColor colorWithWhite:(CGFloat)index / frameCount alpha:1] setFill];
+        UIRectFill(CGRectMake(0, 0, 20, 20));
+        UIImage *frame = UIGraphicsGetImageFromCurrentImageContext();
+        UIGraphicsEndImageContext();
+        
+        CGImageDestinationAddImage(destination, frame.CGImage, (__bridge CFDictionaryRef)frameProperties);
+    }
+    
+    CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return data;
+}
+
+- (void)testFirstFrame
+{
+    MXKAnimatedImageView *imageView = [[MXKAnimatedImageView alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    
+    XCTAssertTrue([imageView setAnimatedImageData:[self gifDataWithFrameCount:10]]);
+    XCTAssertEqual(imageView.frameCount, 10);
+    
+    // The first frame is decoded in background
+    XCTAssertNil(imageView.image);
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"image != nil"] evaluatedWithObject:imageView handler:nil];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    // The view is not in a window: it does not play
+    XCTAssertFalse(imageView.isAnimating);
+}
+
+- (void)testStaticImage
+{
+    MXKAnimatedImageView *imageView = [[MXKAnimatedImageView alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    XCTAssertTrue([imageView setAnimatedImageData:[self gifDataWithFrameCount:3]]);
+    
+    // Setting a static picture discards the animated one
+    UIImage *image = [[UIImage alloc] init];
+    imageView.image = image;
+    XCTAssertEqual(imageView.frameCount, 0);
+    XCTAssertEqual(imageView.image, image);
+}
+
+- (void)testInvalidData
+{
+    MXKAnimatedImageView *imageView = [[MXKAnimatedImageView alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    XCTAssertFalse([imageView setAnimatedImageData:[@"not a gif" dataUsingEncoding:NSUTF8StringEncoding]]);
+    XCTAssertEqual(imageView.frameCount, 0);
+}
+
+- (void)testFailedFrameIsDecodedOnce
+{
+    [MXKAnimatedImageViewTestsFailingView resetWithFailedFrameIndexes:[NSIndexSet indexSetWithIndex:1]];
+    
+    UIWindow *window = [[UIWindow alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+    MXKAnimatedImageViewTestsFailingView *imageView = [[MXKAnimatedImageViewTestsFailingView alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    [window addSubview:imageView];
+    XCTAssertTrue([imageView setAnimatedImageData:[self gifDataWithFrameCount:3]]);
+    
+    // Let the display link play several loops
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Playback"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssertEqual([MXKAnimatedImageViewTestsFailingView decodingCountOfFrameAtIndex:1], 1, @"A frame which cannot be decoded must not be decoded again");
+    XCTAssertNotNil(imageView.image);
+    XCTAssertTrue(imageView.isAnimating, @"The other frames must still be played");
+    
+    [imageView removeFromSuperview];
+}
+
+- (void)testAnimationStopsWithoutDecodableFrames
+{
+    NSMutableIndexSet *failedFrameIndexes = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(1, 2)];
+    [MXKAnimatedImageViewTestsFailingView resetWithFailedFrameIndexes:failedFrameIndexes];
+    
+    UIWindow *window = [[UIWindow alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+    MXKAnimatedImageViewTestsFailingView *imageView = [[MXKAnimatedImageViewTestsFailingView alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    [window addSubview:imageView];
+    XCTAssertTrue([imageView setAnimatedImageData:[self gifDataWithFrameCount:3]]);
+    XCTAssertTrue(imageView.isAnimating);
+    
+    // Only the first frame can be displayed: the animation stops
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"isAnimating == NO"] evaluatedWithObject:imageView handler:nil];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssertNotNil(imageView.image);
+    XCTAssertEqual([MXKAnimatedImageViewTestsFailingView decodingCountOfFrameAtIndex:1], 1);
+    XCTAssertEqual([MXKAnimatedImageViewTestsFailingView decodingCountOfFrameAtIndex:2], 1);
+    
+    [imageView removeFromSuperview];
+}
+
+@end
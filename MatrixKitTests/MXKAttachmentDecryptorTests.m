@@ -0,0 +1,249 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import <CommonCrypto/CommonCrypto.h>
+#import <mach/mach.h>
+
+#import "MatrixKit.h"
+#import "MXKAttachmentDecryptor.h"
+
+// The size of the generated encrypted fixture
+static const NSUInteger kFixtureSize = 300 * 1024 * 1024;
+
+// The maximum memory growth allowed while decrypting the fixture
+static const int64_t kMaxMemoryGrowth = 16 * 1024 * 1024;
+
+@interface MXKAttachmentDecryptorTests : XCTestCase
+{
+    NSMutableArray<NSString*> *tempPaths;
+}
+@end
+
+@implementation MXKAttachmentDecryptorTests
+
+- (void)setUp
+{
+    [super setUp];
+    tempPaths = [NSMutableArray array];
+}
+
+- (void)tearDown
+{
+    for (NSString *path in tempPaths)
+    {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    }
+    [super tearDown];
+}
+
+- (NSString*)tempPath
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    [tempPaths addObject:path];
+    return path;
+}
+
+/**
+ The physical memory footprint of the process.
+ */
+- (int64_t)memoryFootprint
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+    {
+        return 0;
+    }
+    return (int64_t)info.phys_footprint;
+}
+
+/**
+ Encrypt `size` bytes of generated plaintext into a file, chunk by chunk.
+
+ @param size the size of the plaintext.
+ @param path the path of the encrypted file.
+ @return the information on the encrypted content.
+ */
+- (MXEncryptedContentFile*)writeEncryptedFixtureOfSize:(NSUInteger)size toPath:(NSString*)path
+{
+    uint8_t key[kCCKeySizeAES256];
+    uint8_t iv[kCCBlockSizeAES128] = {0};
+    XCTAssertEqual(SecRandomCopyBytes(kSecRandomDefault, sizeof(key), key), errSecSuccess);
+    XCTAssertEqual(SecRandomCopyBytes(kSecRandomDefault, 8, iv), errSecSuccess);
+    
+    CCCryptorRef cryptor;
+    CCCryptorCreateWithMode(kCCEncrypt, kCCModeCTR, kCCAlgorithmAES, ccNoPadding, iv, key, sizeof(key), nil, 0, 0, kCCModeOptionCTR_BE, &cryptor);
+    CC_SHA256_CTX sha256;
+    CC_SHA256_Init(&sha256);
+    
+    NSOutputStream *outputStream = [NSOutputStream outputStreamToFileAtPath:path append:NO];
+    [outputStream open];
+    
+    const NSUInteger chunkSize = 1024 * 1024;
+    uint8_t *chunk = malloc(chunkSize);
+    for (NSUInteger offset = 0; offset < size; offset += chunkSize)
+    {
+        NSUInteger length = MIN(chunkSize, size - offset);
+        for (NSUInteger i = 0; i < length; i++)
+        {
+            chunk[i] = (uint8_t)(offset + i);
+        }
+        size_t outLength;
+        CCCryptorUpdate(cryptor, chunk, length, chunk, chunkSize, &outLength);
+        CC_SHA256_Update(&sha256, chunk, (CC_LONG)outLength);
+        XCTAssertEqual([outputStream write:chunk maxLength:outLength], (NSInteger)outLength);
+    }
+    free(chunk);
+    
+    [outputStream close];
+    CCCryptorRelease(cryptor);
+    
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &sha256);
+    
+    NSString *k = [[[[NSData dataWithBytes:key length:sizeof(key)] base64EncodedStringWithOptions:0]
+                    stringByReplacingOccurrencesOfString:@"+" withString:@"-"]
+                   stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    
+    return [MXEncryptedContentFile modelFromJSON:@{
+                                                   @"v": @"v2",
+                                                   @"url": @"mxc://matrix.org/fixture",
+                                                   @"hashes": @{
+                                                           @"sha256": [[NSData dataWithBytes:digest length:sizeof(digest)] base64EncodedStringWithOptions:0]
+                                                           },
+                                                   @"key": @{
+                                                           @"kty": @"oct",
+                                                           @"key_ops": @[@"encrypt", @"decrypt"],
+                                                           @"k": [k stringByReplacingOccurrencesOfString:@"=" withString:@""],
+                                                           @"alg": @"A256CTR"
+                                                           },
+                                                   @"iv": [[NSData dataWithBytes:iv length:sizeof(iv)] base64EncodedStringWithOptions:0]
+                                                   }];
+}
+
+- (void)testDecryptionMatchesMXEncryptedAttachments
+{
+    NSString *encryptedPath = [self tempPath];
+    MXEncryptedContentFile *contentFile = [self writeEncryptedFixtureOfSize:100000 toPath:encryptedPath];
+    
+    NSOutputStream *outputStream = [NSOutputStream outputStreamToMemory];
+    NSError *error = [MXEncryptedAttachments decryptAttachment:contentFile inputStream:[NSInputStream inputStreamWithFileAtPath:encryptedPath] outputStream:outputStream];
+    XCTAssertNil(error);
+    NSData *expectedData = [outputStream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    
+    // Use a buffer size that is not a multiple of the AES block size
+    MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:contentFile];
+    decryptor.bufferSize = 1000;
+    
+    NSMutableData *data = [NSMutableData data];
+    XCTAssertTrue([decryptor decryptFileAtPath:encryptedPath toConsumer:^BOOL(const void *bytes, NSUInteger length) {
+        XCTAssertLessThanOrEqual(length, 1000);
+        [data appendBytes:bytes length:length];
+        return YES;
+    } progress:nil error:&error]);
+    XCTAssertNil(error);
+    XCTAssertEqualObjects(data, expectedData);
+}
+
+- (void)testHashMismatch
+{
+    NSString *encryptedPath = [self tempPath];
+    MXEncryptedContentFile *contentFile = [self writeEncryptedFixtureOfSize:1000 toPath:encryptedPath];
+    contentFile.hashes = @{@"sha256": @"47DEQpj8HBSa+/TImW+5JCeuQeRkm5NMpJWZG3hSuFU"};
+    
+    NSString *decryptedPath = [self tempPath];
+    MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:contentFile];
+    
+    NSError *error;
+    XCTAssertFalse([decryptor decryptFileAtPath:encryptedPath toFileAtPath:decryptedPath progress:nil error:&error]);
+    XCTAssertNotNil(error);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:decryptedPath], @"A partially decrypted file must not be left behind");
+}
+
+- (void)testConsumerFailureStopsDecryption
+{
+    NSString *encryptedPath = [self tempPath];
+    MXEncryptedContentFile *contentFile = [self writeEncryptedFixtureOfSize:100000 toPath:encryptedPath];
+    
+    MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:contentFile];
+    decryptor.bufferSize = 1000;
+    
+    __block NSUInteger consumedChunksCount = 0;
+    NSError *error;
+    XCTAssertFalse([decryptor decryptFileAtPath:encryptedPath toConsumer:^BOOL(const void *bytes, NSUInteger length) {
+        // Fail on the second chunk
+        return (++consumedChunksCount < 2);
+    } progress:nil error:&error]);
+    
+    XCTAssertEqualObjects(error.domain, kMXKAttachmentErrorDomain);
+    XCTAssertEqual(consumedChunksCount, 2, @"No chunk must be delivered after a failure");
+}
+
+- (void)testLargeFileDecryptionMemory
+{
+    NSString *encryptedPath = [self tempPath];
+    MXEncryptedContentFile *contentFile = [self writeEncryptedFixtureOfSize:kFixtureSize toPath:encryptedPath];
+    
+    NSString *decryptedPath = [self tempPath];
+    MXKAttachmentDecryptor *decryptor = [[MXKAttachmentDecryptor alloc] initWithContentFile:contentFile];
+    
+    int64_t baseline = [self memoryFootprint];
+    __block int64_t peak = baseline;
+    __block int64_t lastDecryptedBytesCount = 0;
+    __block NSUInteger progressCount = 0;
+    
+    NSError *error;
+    BOOL success = [decryptor decryptFileAtPath:encryptedPath toFileAtPath:decryptedPath progress:^(int64_t decryptedBytesCount, int64_t totalBytesCount) {
+        
+        XCTAssertGreaterThan(decryptedBytesCount, lastDecryptedBytesCount);
+        XCTAssertEqual(totalBytesCount, (int64_t)kFixtureSize);
+        lastDecryptedBytesCount = decryptedBytesCount;
+        progressCount++;
+        
+        // Sampling every 16 chunks is enough to observe any growth
+        if (progressCount % 16 == 0)
+        {
+            peak = MAX(peak, [self memoryFootprint]);
+        }
+        
+    } error:&error];
+    peak = MAX(peak, [self memoryFootprint]);
+    
+    XCTAssertTrue(success);
+    XCTAssertNil(error);
+    XCTAssertEqual(lastDecryptedBytesCount, (int64_t)kFixtureSize);
+    XCTAssertGreaterThanOrEqual(progressCount, kFixtureSize / MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE);
+    XCTAssertEqual([[[NSFileManager defaultManager] attributesOfItemAtPath:decryptedPath error:nil] fileSize], kFixtureSize);
+    XCTAssertLessThan(peak - baseline, kMaxMemoryGrowth, @"The decryption must not hold the attachment in memory");
+    
+    // Check the plaintext at the chunk boundaries
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForReadingAtPath:decryptedPath];
+    for (unsigned long long offset = MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE - 8; offset < kFixtureSize; offset += 7 * MXKATTACHMENTDECRYPTOR_DEFAULT_BUFFER_SIZE)
+    {
+        [fileHandle seekToFileOffset:offset];
+        NSData *bytes = [fileHandle readDataOfLength:16];
+        for (NSUInteger i = 0; i < bytes.length; i++)
+        {
+            XCTAssertEqual(((const uint8_t*)bytes.bytes)[i], (uint8_t)(offset + i));
+        }
+    }
+    [fileHandle closeFile];
+}
+
+@end
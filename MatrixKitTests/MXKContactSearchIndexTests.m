@@ -0,0 +1,218 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKContactSearchIndex.h"
+
+@interface MXKContactSearchIndexTests : XCTestCase
+
+@end
+
+@implementation MXKContactSearchIndexTests
+
+/**
+ Synthetic contacts with various first names, last names, emails and phone numbers.
+ */
+- (NSArray<MXKContact*>*)contactsCount:(NSUInteger)count
+{
+    NSArray<NSString*> *firstNames = @[@"Alexander", @"Alice", @"Bob", @"Chloé", @"David", @"Élodie", @"Fatima", @"Grégoire", @"Hiroshi", @"Ingrid"];
+    NSArray<NSString*> *lastNames = @[@"Smith", @"Müller", @"Dupont", @"Tanaka", @"García", @"Rossi", @"Novák", @"Kowalski", @"Andersson", @"Brown", @"Nguyen"];
+    
+    NSMutableArray<MXKContact*> *contacts = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        NSString *firstName = firstNames[index % firstNames.count];
+        NSString *lastName = lastNames[(index / firstNames.count) % lastNames.count];
+        NSString *displayName = [NSString stringWithFormat:@"%@ %@ %tu", firstName, lastName, index];
+        
+        MXKEmail *email = [[MXKEmail alloc] initWithEmailAddress:[NSString stringWithFormat:@"user%tu@example.org", index] type:@"home" contactID:nil matrixID:nil];
+        MXKPhoneNumber *phoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:[NSString stringWithFormat:@"07700 %06tu", index] type:@"mobile" contactID:nil matrixID:nil];
+        
+        [contacts addObject:[[MXKContact alloc] initContactWithDisplayName:displayName emails:@[email] phoneNumbers:@[phoneNumber] andThumbnail:nil]];
+    }
+    return contacts;
+}
+
+- (NSSet<NSString*>*)contactIDsOfContacts:(NSArray<MXKContact*>*)contacts
+{
+    NSMutableSet<NSString*> *contactIDs = [NSMutableSet setWithCapacity:contacts.count];
+    for (MXKContact *contact in contacts)
+    {
+        [contactIDs addObject:contact.contactID];
+    }
+    return contactIDs;
+}
+
+- (NSArray<MXKContact*>*)contacts:(NSArray<MXKContact*>*)contacts matchingPatterns:(NSArray<NSString*>*)patterns
+{
+    NSMutableArray<MXKContact*> *matchingContacts = [NSMutableArray array];
+    for (MXKContact *contact in contacts)
+    {
+        if ([contact matchedWithPatterns:patterns])
+        {
+            [matchingContacts addObject:contact];
+        }
+    }
+    return matchingContacts;
+}
+
+- (void)testMatchingPatternsAsMXKContact
+{
+    NSArray<MXKContact*> *contacts = [self contactsCount:2000];
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+    XCTAssertEqual(searchIndex.count, 2000);
+    
+    // Patterns without diacritics must match like [MXKContact matchedWithPatterns:]
+    NSArray<NSArray<NSString*>*> *queries = @[@[@"a"], @[@"al"], @[@"ALEX"], @[@"alexander"], @[@"smith"], @[@"bob", @"brown"],
+                                              @[@"tanaka", @"12"], @[@"user12@"], @[@"example"], @[@"07700 0001"], @[@"7700000123"],
+                                              @[@"xyz"], @[@"rossi", @"ingrid", @"1"]];
+    for (NSArray<NSString*> *patterns in queries)
+    {
+        NSSet *expected = [self contactIDsOfContacts:[self contacts:contacts matchingPatterns:patterns]];
+        NSSet *result = [self contactIDsOfContacts:[searchIndex contactsMatchingPatterns:patterns]];
+        XCTAssertEqualObjects(result, expected, @"Patterns: %@", patterns);
+    }
+    
+    // The index ignores the diacritics
+    XCTAssertEqual([searchIndex contactsMatchingPatterns:@[@"chloe", @"muller"]].count,
+                   [searchIndex contactsMatchingPatterns:@[@"Chloé", @"Müller"]].count);
+    XCTAssertGreaterThan([searchIndex contactsMatchingPatterns:@[@"chloe", @"muller"]].count, 0);
+    
+    // No pattern matches all the contacts
+    XCTAssertEqual([searchIndex contactsMatchingPatterns:@[]].count, 2000);
+}
+
+- (void)testInternationalPhoneNumberPatterns
+{
+    NSMutableArray<MXKContact*> *contacts = [NSMutableArray arrayWithArray:[self contactsCount:100]];
+    for (NSString *number in @[@"+44 7700 900123", @"+447700900456", @"0044 7700 900789"])
+    {
+        MXKPhoneNumber *phoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:number type:@"mobile" contactID:nil matrixID:nil];
+        [contacts addObject:[[MXKContact alloc] initContactWithDisplayName:@"Abroad" emails:@[] phoneNumbers:@[phoneNumber] andThumbnail:nil]];
+    }
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+    
+    // The whitespace of a phone number pattern is ignored like in [MXKPhoneNumber matchedWithPatterns:]
+    for (NSArray<NSString*> *patterns in @[@[@"+44 7700"], @[@"+447700"], @[@"0044 7700 9"], @[@"7700 900"]])
+    {
+        NSSet *expected = [self contactIDsOfContacts:[self contacts:contacts matchingPatterns:patterns]];
+        NSSet *result = [self contactIDsOfContacts:[searchIndex contactsMatchingPatterns:patterns]];
+        XCTAssertEqualObjects(result, expected, @"Patterns: %@", patterns);
+    }
+    XCTAssertGreaterThanOrEqual([searchIndex contactsMatchingPatterns:@[@"+44 7700"]].count, 2);
+}
+
+- (void)testMatrixContacts
+{
+    MXKContact *bob = [[MXKContact alloc] initMatrixContactWithDisplayName:@"Robert" andMatrixID:@"@bob:matrix.org"];
+    MXKContact *alice = [[MXKContact alloc] initMatrixContactWithDisplayName:@"Alice" andMatrixID:@"@alice:matrix.org"];
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:@[bob, alice]];
+    
+    // A matrix id matches any pattern, its homeserver name is ignored
+    XCTAssertEqualObjects([searchIndex contactsMatchingPatterns:@[@"bob", @"nothing"]], @[bob]);
+    XCTAssertEqual([searchIndex contactsMatchingPatterns:@[@"matrix.org"]].count, 0);
+    
+    // Prefixes
+    XCTAssertEqualObjects([searchIndex contactsWithPrefix:@"bo"], @[bob]);
+    XCTAssertEqualObjects([searchIndex contactsWithPrefix:@"@ali"], @[alice]);
+    XCTAssertEqualObjects([searchIndex contactsWithPrefix:@"rob"], @[bob]);
+    XCTAssertEqual([searchIndex contactsWithPrefix:@"bert"].count, 0);
+}
+
+- (void)testPrefixAsMXKContact
+{
+    NSArray<MXKContact*> *contacts = [self contactsCount:500];
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+    
+    for (NSString *prefix in @[@"a", @"ALI", @"smi", @"user4", @"07700 0004", @"0770000", @"12", @"zz"])
+    {
+        NSMutableSet *expected = [NSMutableSet set];
+        for (MXKContact *contact in contacts)
+        {
+            if ([contact hasPrefix:prefix])
+            {
+                [expected addObject:contact.contactID];
+            }
+        }
+        XCTAssertEqualObjects([self contactIDsOfContacts:[searchIndex contactsWithPrefix:prefix]], expected, @"Prefix: %@", prefix);
+    }
+}
+
+- (void)testIncrementalUpdates
+{
+    NSArray<MXKContact*> *contacts = [self contactsCount:100];
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+    
+    MXKContact *contact = contacts[42];
+    XCTAssertTrue([[searchIndex contactsMatchingPatterns:@[@"42"]] containsObject:contact]);
+    
+    // Remove
+    [searchIndex removeContactWithContactID:contact.contactID];
+    XCTAssertEqual(searchIndex.count, 99);
+    XCTAssertFalse([[searchIndex contactsMatchingPatterns:@[@"42"]] containsObject:contact]);
+    XCTAssertFalse([[searchIndex contactsWithPrefix:@"user42@"] containsObject:contact]);
+    
+    // Add back, then update
+    [searchIndex addContact:contact];
+    XCTAssertTrue([[searchIndex contactsMatchingPatterns:@[@"42"]] containsObject:contact]);
+    
+    contact.displayName = @"Zoé Zimmermann";
+    [searchIndex addContact:contact];
+    XCTAssertEqual(searchIndex.count, 100);
+    XCTAssertEqualObjects([searchIndex contactsMatchingPatterns:@[@"zoe"]], @[contact]);
+    XCTAssertEqualObjects([searchIndex contactsWithPrefix:@"zimm"], @[contact]);
+    XCTAssertFalse([[searchIndex contactsMatchingPatterns:@[@"Alexander", @"42"]] containsObject:contact]);
+    
+    [searchIndex removeAllContacts];
+    XCTAssertEqual(searchIndex.count, 0);
+    XCTAssertEqual([searchIndex contactsMatchingPatterns:@[@"a"]].count, 0);
+}
+
+/**
+ Type a name one character at a time in a book of 50k contacts.
+ */
+- (void)testTypingBenchmark
+{
+    NSArray<MXKContact*> *contacts = [self contactsCount:50000];
+    MXKContactSearchIndex *searchIndex = [[MXKContactSearchIndex alloc] initWithContacts:contacts];
+    NSString *text = @"alexander smith 4";
+    
+    // Check the results once against a scan of the contacts
+    NSArray<NSString*> *patterns = [text componentsSeparatedByString:@" "];
+    XCTAssertEqualObjects([self contactIDsOfContacts:[searchIndex contactsMatchingPatterns:patterns]],
+                          [self contactIDsOfContacts:[self contacts:contacts matchingPatterns:patterns]]);
+    
+    [self measureBlock:^{
+        for (NSUInteger length = 1; length <= text.length; length++)
+        {
+            NSMutableArray<NSString*> *patterns = [NSMutableArray array];
+            for (NSString *pattern in [[text substringToIndex:length] componentsSeparatedByString:@" "])
+            {
+                if (pattern.length)
+                {
+                    [patterns addObject:pattern];
+                }
+            }
+            [searchIndex contactsMatchingPatterns:patterns];
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,312 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKContactsCacheStore.h"
+#import "MXKContactsCacheDictionary.h"
+
+@interface MXKContactsCacheStoreTests : XCTestCase
+{
+    NSString *filePath;
+    NSData *key;
+}
+
+@end
+
+@implementation MXKContactsCacheStoreTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MXKContactsCacheStoreTests"];
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    
+    NSMutableData *keyData = [NSMutableData dataWithLength:32];
+    XCTAssertEqual(SecRandomCopyBytes(kSecRandomDefault, keyData.length, keyData.mutableBytes), errSecSuccess);
+    key = keyData;
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    
+    [super tearDown];
+}
+
+- (NSData*)recordAtIndex:(NSUInteger)index revision:(NSUInteger)revision
+{
+    return [[NSString stringWithFormat:@"Contact %tu - revision %tu", index, revision] dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (unsigned long long)fileSize
+{
+    return [[NSFileManager defaultManager] attributesOfItemAtPath:filePath error:nil].fileSize;
+}
+
+- (void)checkPersistenceWithKey:(NSData*)theKey
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:theKey];
+    
+    for (NSUInteger index = 0; index < 1000; index++)
+    {
+        [store setRecord:[self recordAtIndex:index revision:0] forKey:[NSString stringWithFormat:@"contact%tu", index]];
+    }
+    
+    // A record bigger than a block
+    NSMutableData *bigRecord = [NSMutableData dataWithLength:3 * MXKCONTACTSCACHESTORE_DEFAULT_BLOCK_SIZE + 7];
+    memset(bigRecord.mutableBytes, 'x', bigRecord.length);
+    [store setRecord:bigRecord forKey:@"big"];
+    
+    [store removeRecordForKey:@"contact10"];
+    XCTAssertTrue([store synchronize]);
+    
+    // Reopen
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:theKey];
+    XCTAssertEqual(store.count, 1000);
+    XCTAssertEqualObjects([store recordForKey:@"contact0"], [self recordAtIndex:0 revision:0]);
+    XCTAssertEqualObjects([store recordForKey:@"contact999"], [self recordAtIndex:999 revision:0]);
+    XCTAssertNil([store recordForKey:@"contact10"]);
+    XCTAssertEqualObjects([store recordForKey:@"big"], bigRecord);
+}
+
+- (void)testPersistence
+{
+    [self checkPersistenceWithKey:key];
+}
+
+- (void)testPersistenceInPlainText
+{
+    [self checkPersistenceWithKey:nil];
+    
+    NSData *fileContent = [NSData dataWithContentsOfFile:filePath];
+    XCTAssertNotEqual([fileContent rangeOfData:[self recordAtIndex:0 revision:0] options:0 range:NSMakeRange(0, fileContent.length)].location, NSNotFound);
+}
+
+- (void)testEncryption
+{
+    [self checkPersistenceWithKey:key];
+    
+    NSData *fileContent = [NSData dataWithContentsOfFile:filePath];
+    XCTAssertEqual([fileContent rangeOfData:[@"Contact" dataUsingEncoding:NSUTF8StringEncoding] options:0 range:NSMakeRange(0, fileContent.length)].location, NSNotFound);
+    
+    // A file encrypted with another key is discarded
+    NSMutableData *otherKey = [key mutableCopy];
+    ((uint8_t*)otherKey.mutableBytes)[0] ^= 0xFF;
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:otherKey];
+    XCTAssertEqual(store.count, 0);
+}
+
+- (void)testAppendOnlyUpdates
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    
+    NSMutableDictionary<NSString*, NSData*> *records = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < 1000; index++)
+    {
+        records[[NSString stringWithFormat:@"contact%tu", index]] = [self recordAtIndex:index revision:0];
+    }
+    [store setRecords:records];
+    XCTAssertTrue([store synchronize]);
+    uint64_t logSize = store.logSize;
+    
+    // Unchanged records are not written again
+    [store setRecords:records];
+    XCTAssertTrue([store synchronize]);
+    XCTAssertEqual(store.logSize, logSize);
+    
+    // A change appends only the changed record
+    records[@"contact5"] = [self recordAtIndex:5 revision:1];
+    [store setRecords:records];
+    XCTAssertTrue([store synchronize]);
+    XCTAssertEqual(store.logSize, logSize + 17 + @"contact5".length + records[@"contact5"].length);
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    XCTAssertEqualObjects([store recordForKey:@"contact5"], [self recordAtIndex:5 revision:1]);
+}
+
+- (void)testCompaction
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    
+    for (NSUInteger revision = 0; revision < 20; revision++)
+    {
+        for (NSUInteger index = 0; index < 500; index++)
+        {
+            [store setRecord:[self recordAtIndex:index revision:revision] forKey:[NSString stringWithFormat:@"contact%tu", index]];
+        }
+        XCTAssertTrue([store synchronize]);
+        
+        // The log never grows much beyond twice the live records
+        XCTAssertLessThanOrEqual(store.logSize, MAX(64 * 1024, 2 * store.liveRecordsSize));
+    }
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    XCTAssertEqual(store.count, 500);
+    XCTAssertEqualObjects([store recordForKey:@"contact42"], [self recordAtIndex:42 revision:19]);
+    
+    // Removing all the records removes the file
+    [store setRecords:@{}];
+    XCTAssertTrue([store synchronize]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:filePath]);
+}
+
+- (void)checkTruncatedLogWithKey:(NSData*)theKey
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:theKey];
+    for (NSUInteger index = 0; index < 100; index++)
+    {
+        [store setRecord:[self recordAtIndex:index revision:0] forKey:[NSString stringWithFormat:@"contact%tu", index]];
+    }
+    XCTAssertTrue([store synchronize]);
+    store = nil;
+    
+    // Simulate an interrupted write of the last record
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForUpdatingAtPath:filePath];
+    [fileHandle truncateFileAtOffset:(self.fileSize - 5)];
+    [fileHandle closeFile];
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:theKey];
+    XCTAssertEqual(store.count, 99);
+    XCTAssertEqualObjects([store recordForKey:@"contact98"], [self recordAtIndex:98 revision:0]);
+    
+    // The store can be updated after the recovery
+    [store setRecord:[self recordAtIndex:99 revision:1] forKey:@"contact99"];
+    XCTAssertTrue([store synchronize]);
+    
+    // The records read from the file before its truncation are still readable
+    XCTAssertEqualObjects([store recordForKey:@"contact0"], [self recordAtIndex:0 revision:0]);
+    XCTAssertEqualObjects([store recordForKey:@"contact98"], [self recordAtIndex:98 revision:0]);
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:theKey];
+    XCTAssertEqual(store.count, 100);
+    XCTAssertEqualObjects([store recordForKey:@"contact99"], [self recordAtIndex:99 revision:1]);
+}
+
+- (void)testTruncatedLog
+{
+    [self checkTruncatedLogWithKey:key];
+}
+
+- (void)testTruncatedLogInPlainText
+{
+    [self checkTruncatedLogWithKey:nil];
+}
+
+- (void)testFailedAppendRollBack
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    for (NSUInteger index = 0; index < 10; index++)
+    {
+        [store setRecord:[self recordAtIndex:index revision:0] forKey:[NSString stringWithFormat:@"contact%tu", index]];
+    }
+    XCTAssertTrue([store synchronize]);
+    store = nil;
+    
+    // Make the writes fail
+    [[NSFileManager defaultManager] setAttributes:@{NSFilePosixPermissions: @(0444)} ofItemAtPath:filePath error:nil];
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    uint64_t logSize = store.logSize;
+    uint64_t liveRecordsSize = store.liveRecordsSize;
+    
+    // A record spanning several blocks fails at its first full block
+    NSMutableData *bigRecord = [NSMutableData dataWithLength:3 * MXKCONTACTSCACHESTORE_DEFAULT_BLOCK_SIZE];
+    memset(bigRecord.mutableBytes, 'x', bigRecord.length);
+    [store setRecord:bigRecord forKey:@"contact5"];
+    
+    XCTAssertEqual(store.logSize, logSize);
+    XCTAssertEqual(store.liveRecordsSize, liveRecordsSize);
+    XCTAssertEqual(store.count, 10);
+    XCTAssertEqualObjects([store recordForKey:@"contact5"], [self recordAtIndex:5 revision:0], @"The previous record must be kept");
+    XCTAssertEqualObjects([store recordForKey:@"contact9"], [self recordAtIndex:9 revision:0]);
+    
+    // The next appends start from the last good offset
+    [[NSFileManager defaultManager] setAttributes:@{NSFilePosixPermissions: @(0644)} ofItemAtPath:filePath error:nil];
+    [store setRecord:[self recordAtIndex:10 revision:0] forKey:@"contact10"];
+    XCTAssertTrue([store synchronize]);
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    XCTAssertEqual(store.count, 11);
+    XCTAssertEqualObjects([store recordForKey:@"contact5"], [self recordAtIndex:5 revision:0]);
+    XCTAssertEqualObjects([store recordForKey:@"contact10"], [self recordAtIndex:10 revision:0]);
+}
+
+#pragma mark - MXKContactsCacheDictionary
+
+- (void)testCacheDictionaryLazyDecoding
+{
+    MXKContactsCacheDictionary *contacts = [[MXKContactsCacheDictionary alloc] init];
+    for (NSUInteger index = 0; index < 100; index++)
+    {
+        MXKContact *contact = [[MXKContact alloc] initMatrixContactWithDisplayName:[NSString stringWithFormat:@"User %tu", index] andMatrixID:[NSString stringWithFormat:@"@user%tu:matrix.org", index]];
+        contacts[contact.contactID] = contact;
+    }
+    
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    XCTAssertTrue([contacts writeToCacheStore:store]);
+    XCTAssertEqual(store.count, 100);
+    
+    // Reopen: no record is decoded until its contact is accessed
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    MXKContactsCacheDictionary *cachedContacts = [[MXKContactsCacheDictionary alloc] initWithCacheStore:store];
+    XCTAssertEqual(cachedContacts.count, 100);
+    XCTAssertEqual(cachedContacts.undecodedContactsCount, 100);
+    
+    NSArray<NSString*> *contactIDs = contacts.allKeys;
+    XCTAssertEqualObjects(cachedContacts[contactIDs[0]].displayName, contacts[contactIDs[0]].displayName);
+    XCTAssertEqual(cachedContacts.undecodedContactsCount, 99);
+    
+    // Only the changed records are written: the other ones are not decoded
+    cachedContacts[contactIDs[0]].displayName = @"Renamed";
+    [cachedContacts setNeedsWriteForContactID:contactIDs[0]];
+    [cachedContacts removeObjectForKey:contactIDs[1]];
+    XCTAssertTrue([cachedContacts writeToCacheStore:store]);
+    XCTAssertEqual(cachedContacts.count, 99);
+    XCTAssertEqual(cachedContacts.undecodedContactsCount, 98);
+    
+    store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    cachedContacts = [[MXKContactsCacheDictionary alloc] initWithCacheStore:store];
+    XCTAssertEqual(cachedContacts.count, 99);
+    XCTAssertEqualObjects(cachedContacts[contactIDs[0]].displayName, @"Renamed");
+    XCTAssertNil(cachedContacts[contactIDs[1]]);
+    XCTAssertEqualObjects(cachedContacts[contactIDs[2]].displayName, contacts[contactIDs[2]].displayName);
+    XCTAssertEqual(cachedContacts.allValues.count, 99);
+}
+
+- (void)testCacheDictionaryCorruptedRecord
+{
+    MXKContactsCacheStore *store = [[MXKContactsCacheStore alloc] initWithFilePath:filePath key:key];
+    MXKContact *contact = [[MXKContact alloc] initMatrixContactWithDisplayName:@"User" andMatrixID:@"@user:matrix.org"];
+    [store setRecord:[MXKContactsCacheDictionary recordOfContact:contact] forKey:contact.contactID];
+    [store setRecord:[@"corrupted" dataUsingEncoding:NSUTF8StringEncoding] forKey:@"corrupted"];
+    XCTAssertTrue([store synchronize]);
+    
+    // The corrupted contact is dropped when it is decoded, and removed by the next write
+    MXKContactsCacheDictionary *cachedContacts = [[MXKContactsCacheDictionary alloc] initWithCacheStore:store];
+    XCTAssertEqual(cachedContacts.count, 2);
+    XCTAssertEqual(cachedContacts.allValues.count, 1);
+    XCTAssertEqual(cachedContacts.count, 1);
+    
+    XCTAssertTrue([cachedContacts writeToCacheStore:store]);
+    XCTAssertEqualObjects(store.allKeys, @[contact.contactID]);
+}
+
+@end
@@ -0,0 +1,258 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKDataSourceChangeSet.h"
+
+/**
+ A single section table view data source backed by an array of rows.
+ */
+@interface MXKDataSourceChangeSetTestsTableDataSource : NSObject <UITableViewDataSource>
+
+@property (nonatomic) NSMutableArray<NSString*> *rows;
+
+@end
+
+@implementation MXKDataSourceChangeSetTestsTableDataSource
+
+- (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section
+{
+    return self.rows.count;
+}
+
+- (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath
+{
+    UITableViewCell *cell = [tableView dequeueReusableCellWithIdentifier:@"cell" forIndexPath:indexPath];
+    cell.textLabel.text = self.rows[indexPath.row];
+    return cell;
+}
+
+@end
+
+@interface MXKDataSourceChangeSetTests : XCTestCase
+{
+    UITableView *tableView;
+    MXKDataSourceChangeSetTestsTableDataSource *tableDataSource;
+}
+
+@end
+
+@implementation MXKDataSourceChangeSetTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    tableDataSource = [[MXKDataSourceChangeSetTestsTableDataSource alloc] init];
+    tableDataSource.rows = [@[@"a", @"b", @"c", @"d", @"e"] mutableCopy];
+    
+    tableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 1000) style:UITableViewStylePlain];
+    [tableView registerClass:UITableViewCell.class forCellReuseIdentifier:@"cell"];
+    tableView.dataSource = tableDataSource;
+    [tableView reloadData];
+    [tableView layoutIfNeeded];
+}
+
+- (void)tearDown
+{
+    tableView = nil;
+    tableDataSource = nil;
+    
+    [super tearDown];
+}
+
+- (NSIndexPath*)indexPathForRow:(NSInteger)row
+{
+    return [NSIndexPath indexPathForRow:row inSection:0];
+}
+
+- (void)applyChangeSet:(MXKDataSourceChangeSet*)changeSet
+{
+    [tableView beginUpdates];
+    [changeSet applyToTableView:tableView withRowAnimation:UITableViewRowAnimationNone];
+    [tableView endUpdates];
+    [tableView layoutIfNeeded];
+}
+
+- (NSArray<NSString*>*)displayedRows
+{
+    NSMutableArray<NSString*> *displayedRows = [NSMutableArray array];
+    for (NSInteger row = 0; row < [tableView numberOfRowsInSection:0]; row++)
+    {
+        UITableViewCell *cell = [tableView cellForRowAtIndexPath:[self indexPathForRow:row]];
+        [displayedRows addObject:cell.textLabel.text ?: @""];
+    }
+    return displayedRows;
+}
+
+#pragma mark - Content
+
+- (void)testEmpty
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    XCTAssertTrue(changeSet.isEmpty);
+    XCTAssertEqual(changeSet.cellCountDelta, 0);
+    XCTAssertTrue([changeSet isValidForNumberOfRows:5 newNumberOfRows:5]);
+    XCTAssertFalse([changeSet isValidForNumberOfRows:5 newNumberOfRows:6]);
+}
+
+- (void)testDeletedRowsAreNotUpdated
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:1]];
+    [changeSet addDeletedIndexPath:[self indexPathForRow:1]];
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:1]];
+    
+    XCTAssertEqualObjects(changeSet.deletedIndexPaths, @[[self indexPathForRow:1]]);
+    XCTAssertEqual(changeSet.updatedIndexPaths.count, 0);
+    XCTAssertEqual(changeSet.cellCountDelta, -1);
+}
+
+- (void)testMovedRowsAreNotUpdated
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:2]];
+    [changeSet addMoveFromIndexPath:[self indexPathForRow:2] toIndexPath:[self indexPathForRow:0]];
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:2]];
+    
+    XCTAssertEqual(changeSet.updatedIndexPaths.count, 0);
+    XCTAssertEqualObjects(changeSet.movedIndexPaths, @{[self indexPathForRow:2]: [self indexPathForRow:0]});
+    XCTAssertFalse(changeSet.isEmpty);
+    XCTAssertEqual(changeSet.cellCountDelta, 0);
+}
+
+#pragma mark - Validity
+
+- (void)testValidity
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addDeletedIndexPath:[self indexPathForRow:4]];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:0]];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:1]];
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:2]];
+    
+    XCTAssertEqual(changeSet.cellCountDelta, 1);
+    XCTAssertTrue([changeSet isValidForNumberOfRows:5 newNumberOfRows:6]);
+    
+    // The number of rows must match the changes
+    XCTAssertFalse([changeSet isValidForNumberOfRows:5 newNumberOfRows:5]);
+    XCTAssertFalse([changeSet isValidForNumberOfRows:6 newNumberOfRows:6]);
+    
+    // The deleted and updated rows refer to the rows before the changes
+    XCTAssertFalse([changeSet isValidForNumberOfRows:4 newNumberOfRows:5]);
+}
+
+- (void)testValidityOfInsertions
+{
+    // The inserted rows refer to the rows after the changes
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:5]];
+    XCTAssertTrue([changeSet isValidForNumberOfRows:5 newNumberOfRows:6]);
+    
+    changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:6]];
+    XCTAssertFalse([changeSet isValidForNumberOfRows:5 newNumberOfRows:6]);
+}
+
+- (void)testValidityOfMoves
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addMoveFromIndexPath:[self indexPathForRow:4] toIndexPath:[self indexPathForRow:0]];
+    XCTAssertTrue([changeSet isValidForNumberOfRows:5 newNumberOfRows:5]);
+    XCTAssertFalse([changeSet isValidForNumberOfRows:4 newNumberOfRows:4]);
+    
+    changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addMoveFromIndexPath:[self indexPathForRow:0] toIndexPath:[self indexPathForRow:5]];
+    XCTAssertFalse([changeSet isValidForNumberOfRows:5 newNumberOfRows:5]);
+}
+
+- (void)testValidityOfSections
+{
+    // Only single section tables are supported
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addUpdatedIndexPath:[NSIndexPath indexPathForRow:0 inSection:1]];
+    XCTAssertFalse([changeSet isValidForNumberOfRows:5 newNumberOfRows:5]);
+}
+
+#pragma mark - Application
+
+- (void)testApplyInsertionsAndDeletions
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    
+    // Remove "b" and "e", insert "x" at the top and "y" at the bottom
+    [tableDataSource.rows removeObjectAtIndex:4];
+    [tableDataSource.rows removeObjectAtIndex:1];
+    [changeSet addDeletedIndexPath:[self indexPathForRow:1]];
+    [changeSet addDeletedIndexPath:[self indexPathForRow:4]];
+    
+    [tableDataSource.rows insertObject:@"x" atIndex:0];
+    [tableDataSource.rows addObject:@"y"];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:0]];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:4]];
+    
+    XCTAssertTrue([changeSet isValidForNumberOfRows:[tableView numberOfRowsInSection:0] newNumberOfRows:tableDataSource.rows.count]);
+    
+    XCTAssertNoThrow([self applyChangeSet:changeSet]);
+    XCTAssertEqualObjects(self.displayedRows, (@[@"x", @"a", @"c", @"d", @"y"]));
+}
+
+- (void)testApplyUpdates
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    
+    tableDataSource.rows[2] = @"C";
+    [changeSet addUpdatedIndexPath:[self indexPathForRow:2]];
+    
+    XCTAssertTrue([changeSet isValidForNumberOfRows:[tableView numberOfRowsInSection:0] newNumberOfRows:tableDataSource.rows.count]);
+    
+    XCTAssertNoThrow([self applyChangeSet:changeSet]);
+    XCTAssertEqualObjects(self.displayedRows, (@[@"a", @"b", @"C", @"d", @"e"]));
+}
+
+- (void)testApplyMoves
+{
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    
+    // Move "d" to the top
+    [tableDataSource.rows removeObjectAtIndex:3];
+    [tableDataSource.rows insertObject:@"d" atIndex:0];
+    [changeSet addMoveFromIndexPath:[self indexPathForRow:3] toIndexPath:[self indexPathForRow:0]];
+    
+    XCTAssertTrue([changeSet isValidForNumberOfRows:[tableView numberOfRowsInSection:0] newNumberOfRows:tableDataSource.rows.count]);
+    
+    XCTAssertNoThrow([self applyChangeSet:changeSet]);
+    XCTAssertEqualObjects(self.displayedRows, (@[@"d", @"a", @"b", @"c", @"e"]));
+}
+
+- (void)testMissedChangesInvalidateTheNextChangeSet
+{
+    // The table misses a first change: "a" is removed
+    [tableDataSource.rows removeObjectAtIndex:0];
+    
+    // The next change set only reports the insertion of "f"
+    [tableDataSource.rows addObject:@"f"];
+    MXKDataSourceChangeSet *changeSet = [[MXKDataSourceChangeSet alloc] init];
+    [changeSet addInsertedIndexPath:[self indexPathForRow:4]];
+    
+    // It cannot be applied on top of the displayed rows, a full reload is required
+    XCTAssertFalse([changeSet isValidForNumberOfRows:[tableView numberOfRowsInSection:0] newNumberOfRows:tableDataSource.rows.count]);
+}
+
+@end
@@ -0,0 +1,137 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKEmojiClassifier.h"
+
+@interface MXKEmojiClassifierTests : XCTestCase
+
+@end
+
+@implementation MXKEmojiClassifierTests
+
+/**
+ Load the emoji sequences listed in the emoji-test.txt file of the test bundle.
+
+ @return the emoji strings.
+ */
+- (NSArray<NSString*>*)emojiTestStrings
+{
+    NSString *path = [[NSBundle bundleForClass:self.class] pathForResource:@"emoji-test" ofType:@"txt"];
+    NSString *emojiTestData = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+
+    NSMutableArray<NSString*> *emojis = [NSMutableArray array];
+    for (NSString *line in [emojiTestData componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]])
+    {
+        // Format: code points; status # emoji name
+        NSString *data = [line componentsSeparatedByString:@"#"].firstObject;
+        NSArray<NSString*> *fields = [data componentsSeparatedByString:@";"];
+        if (fields.count != 2)
+        {
+            continue;
+        }
+
+        NSMutableString *emoji = [NSMutableString string];
+        NSArray<NSString*> *codePoints = [[fields[0] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] componentsSeparatedByString:@" "];
+        for (NSString *codePoint in codePoints)
+        {
+            UTF32Char character = (UTF32Char)strtoul(codePoint.UTF8String, NULL, 16);
+            NSString *characterString = [[NSString alloc] initWithBytes:&character length:sizeof(character) encoding:NSUTF32LittleEndianStringEncoding];
+            [emoji appendString:characterString];
+        }
+        [emojis addObject:emoji];
+    }
+
+    return emojis;
+}
+
+- (void)testEmojiTestDataConformance
+{
+    NSArray<NSString*> *emojis = self.emojiTestStrings;
+    XCTAssertGreaterThan(emojis.count, 4000);
+
+    NSString *previousEmoji;
+    for (NSString *emoji in emojis)
+    {
+        XCTAssertEqual([MXKEmojiClassifier emojiCountInString:emoji], 1, @"%@ must be one emoji", emoji);
+        XCTAssertTrue([MXKTools isSingleEmojiString:emoji], @"%@ must be a single emoji", emoji);
+
+        // A skin tone modifier would be attached to the previous emoji
+        BOOL startsWithModifier = NO;
+        for (NSString *modifier in @[@"\U0001F3FB", @"\U0001F3FC", @"\U0001F3FD", @"\U0001F3FE", @"\U0001F3FF"])
+        {
+            startsWithModifier |= [emoji hasPrefix:modifier];
+        }
+
+        if (previousEmoji && !startsWithModifier)
+        {
+            NSString *emojis = [previousEmoji stringByAppendingString:emoji];
+            XCTAssertEqual([MXKEmojiClassifier emojiCountInString:emojis], 2, @"%@ must be two emojis", emojis);
+            XCTAssertTrue([MXKTools isEmojiOnlyString:emojis]);
+            XCTAssertFalse([MXKTools isSingleEmojiString:emojis]);
+        }
+        previousEmoji = emoji;
+    }
+}
+
+- (void)testNonEmojiStrings
+{
+    NSArray<NSString*> *strings = @[
+                                    @"",
+                                    @"a",
+                                    @"1",
+                                    @"#",
+                                    @"→",
+                                    @"😀a",
+                                    @"a😀",
+                                    @"😀 😀",
+                                    @"1️",
+                                    @"👨‍",
+                                    @"\U0001F3F4\U000E0067\U000E0062",
+                                    ];
+
+    for (NSString *string in strings)
+    {
+        XCTAssertEqual([MXKEmojiClassifier emojiCountInString:string], 0, @"\"%@\" is not made of emojis", string);
+        XCTAssertFalse([MXKTools isEmojiOnlyString:string]);
+    }
+}
+
+- (void)testSequences
+{
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:@"👍🏽"], 1, @"A skin tone modifier is part of the emoji");
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:@"👨‍👩‍👧‍👦"], 1, @"A ZWJ sequence is one emoji");
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:@"🇫🇷🇬🇧"], 2, @"Regional indicators are paired");
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:@"1️⃣#️⃣"], 2);
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:@"©®"], 2);
+}
+
+- (void)testMemoisedResults
+{
+    NSString *reaction = @"👍";
+
+    XCTAssertTrue([MXKTools isSingleEmojiString:reaction]);
+    XCTAssertTrue([MXKTools isSingleEmojiString:reaction]);
+
+    NSString *longString = [@"" stringByPaddingToLength:100 withString:@"😀" startingAtIndex:0];
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:longString], 50);
+    XCTAssertEqual([MXKEmojiClassifier emojiCountInString:longString], 50);
+}
+
+@end
@@ -18,6 +18,37 @@
 #import <XCTest/XCTest.h>
 
 #import "MatrixKit.h"
+#import "MXKRecentsTestSession.h"
+
+/**
+ A formatter which renders the messages with its own property and data.
+ */
+@interface MXKEventFormatterTestsRenderingFormatter : MXKEventFormatter
+
+@property (nonatomic) NSString *messagePrefix;
+@property (nonatomic) NSString *roomTag;
+
+@end
+
+@implementation MXKEventFormatterTestsRenderingFormatter
+
++ (NSArray<NSString *> *)renderCacheConfigurationKeyPaths
+{
+    return [[super renderCacheConfigurationKeyPaths] arrayByAddingObject:@"messagePrefix"];
+}
+
+- (NSString *)renderCacheKeyForEvent:(MXEvent *)event withRoomState:(MXRoomState *)roomState
+{
+    NSString *key = [super renderCacheKeyForEvent:event withRoomState:roomState];
+    return key ? [NSString stringWithFormat:@"%@|%@", key, self.roomTag] : nil;
+}
+
+- (NSAttributedString *)renderString:(NSString *)string forEvent:(MXEvent *)event
+{
+    return [super renderString:(self.messagePrefix ? [self.messagePrefix stringByAppendingString:string] : string) forEvent:event];
+}
+
+@end
 
 @interface MXEventFormatterTests : XCTestCase
 {
@@ -131,4 +162,173 @@
     XCTAssertEqual(ranges, 1, @"There should be no link in this case. We let the UI manage the link");
 }
 
+- (void)useCustomLinkSchemes
+{
+    MXKAppSettings *settings = [[MXKAppSettings alloc] init];
+    settings.httpLinkScheme = @"myhttp";
+    settings.httpsLinkScheme = @"myhttps";
+    eventFormatter.settings = settings;
+}
+
+// The link set on the whole substring, as a string
+- (NSString*)linkInAttributedString:(NSAttributedString*)as ofSubstring:(NSString*)substring
+{
+    NSRange range = [as.string rangeOfString:substring];
+    if (range.location == NSNotFound)
+    {
+        return nil;
+    }
+    
+    NSRange linkRange;
+    id link = [as attribute:NSLinkAttributeName atIndex:range.location effectiveRange:&linkRange];
+    if (!NSEqualRanges(NSIntersectionRange(range, linkRange), range))
+    {
+        return nil;
+    }
+    return [link isKindOfClass:NSURL.class] ? ((NSURL*)link).absoluteString : link;
+}
+
+- (void)testCustomSchemeLinks
+{
+    [self useCustomLinkSchemes];
+    
+    NSString *s = @"See https://matrix.org/docs and http://example.org";
+    NSAttributedString *as = [eventFormatter renderString:s forEvent:anEvent];
+    
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"https://matrix.org/docs"], @"myhttps://matrix.org/docs");
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"http://example.org"], @"myhttp://example.org");
+}
+
+- (void)testCustomSchemeLinksWithoutScheme
+{
+    [self useCustomLinkSchemes];
+    
+    // The links detected without explicit http(s) scheme are kept
+    NSString *s = @"Go to matrix.org/x or write to alice@example.org or mailto:bob@example.org";
+    NSAttributedString *as = [eventFormatter renderString:s forEvent:anEvent];
+    
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"matrix.org/x"], @"myhttp://matrix.org/x");
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"alice@example.org"], @"mailto:alice@example.org");
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"bob@example.org"], @"mailto:bob@example.org");
+}
+
+- (void)testCustomSchemeLinkFollowedByMatrixIds
+{
+    [self useCustomLinkSchemes];
+    
+    // The matrix ids after a URL on the same line are links too
+    NSString *s = @"See https://matrix.org/docs with @alice:matrix.org in #matrix:matrix.org";
+    NSAttributedString *as = [eventFormatter renderString:s forEvent:anEvent];
+    
+    XCTAssertEqualObjects([self linkInAttributedString:as ofSubstring:@"https://matrix.org/docs"], @"myhttps://matrix.org/docs");
+    XCTAssertNotNil([self linkInAttributedString:as ofSubstring:@"@alice:matrix.org"]);
+    XCTAssertNotNil([self linkInAttributedString:as ofSubstring:@"#matrix:matrix.org"]);
+}
+
+#pragma mark - Render cache
+
+- (void)testRenderCacheDisabledByDefault
+{
+    XCTAssertEqual(eventFormatter.renderCacheCapacity, 0);
+    XCTAssertNil([eventFormatter renderCacheKeyForEvent:anEvent withRoomState:nil]);
+    
+    MXKEventFormatterError error;
+    NSAttributedString *as = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    NSAttributedString *as2 = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertNotEqual(as, as2);
+    XCTAssertEqualObjects(as.string, as2.string);
+}
+
+- (void)testRenderCache
+{
+    eventFormatter.renderCacheCapacity = 500;
+    
+    MXKEventFormatterError error;
+    NSAttributedString *as = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertNotNil(as);
+
+    NSAttributedString *as2 = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertEqual(as, as2, @"The second rendering must come from the cache");
+    XCTAssertEqual(error, MXKEventFormatterErrorNone);
+
+    [eventFormatter invalidateRenderCacheForEventId:anEvent.eventId];
+    as2 = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertNotEqual(as, as2, @"The event must be rendered again after invalidation");
+    XCTAssertEqualObjects(as.string, as2.string);
+}
+
+- (void)testRenderCacheConfigurationChange
+{
+    eventFormatter.renderCacheCapacity = 500;
+    
+    MXKEventFormatterError error;
+    NSAttributedString *as = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+
+    eventFormatter.defaultTextColor = [UIColor greenColor];
+
+    NSAttributedString *as2 = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertNotEqual(as, as2, @"A configuration change must invalidate the cache");
+    XCTAssertEqualObjects([as2 attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:nil], [UIColor greenColor]);
+}
+
+- (void)testRenderCacheSubclassHooks
+{
+    MXKEventFormatterTestsRenderingFormatter *formatter = [[MXKEventFormatterTestsRenderingFormatter alloc] initWithMatrixSession:nil];
+    formatter.renderCacheCapacity = 500;
+    
+    MXKEventFormatterError error;
+    NSAttributedString *as = [formatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertEqual([formatter attributedStringFromEvent:anEvent withRoomState:nil error:&error], as);
+    
+    // A change of a property declared by the subclass empties the cache
+    formatter.messagePrefix = @"> ";
+    NSAttributedString *as2 = [formatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    XCTAssertNotEqual(as, as2);
+    XCTAssertEqualObjects(as2.string, [@"> " stringByAppendingString:as.string]);
+    
+    // As a change of the data added by the subclass to the key
+    formatter.roomTag = @"m.favourite";
+    XCTAssertNotEqual([formatter attributedStringFromEvent:anEvent withRoomState:nil error:&error], as2);
+}
+
+- (void)testRenderCacheCapacityChange
+{
+    eventFormatter.renderCacheCapacity = 500;
+    
+    MXKEventFormatterError error;
+    NSAttributedString *as = [eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error];
+    
+    // Change the capacity while events are rendered on another queue
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        MXKEventFormatterError error2;
+        for (NSUInteger index = 0; index < 200; index++)
+        {
+            [self->eventFormatter attributedStringFromEvent:self->anEvent withRoomState:nil error:&error2];
+        }
+    });
+    for (NSUInteger index = 0; index < 200; index++)
+    {
+        eventFormatter.renderCacheCapacity = (index % 2) ? 500 : 1;
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    // Disabling the cache empties it
+    eventFormatter.renderCacheCapacity = 0;
+    XCTAssertEqual(eventFormatter.renderCacheCapacity, 0);
+    XCTAssertNil([eventFormatter renderCacheKeyForEvent:anEvent withRoomState:nil]);
+    XCTAssertNotEqual([eventFormatter attributedStringFromEvent:anEvent withRoomState:nil error:&error], as);
+}
+
+- (void)testRoomDataSourceRenderCache
+{
+    MXKRecentsTestSession *session = [[MXKRecentsTestSession alloc] initWithRoomsCount:0];
+    MXKRoomDataSource *dataSource = [[MXKRoomDataSource alloc] initWithRoomId:@"!room:matrix.org" andMatrixSession:session];
+    
+    // The formatter created by the room data source caches the room messages
+    XCTAssertEqual(dataSource.eventFormatter.renderCacheCapacity, MXKEVENTFORMATTER_DEFAULT_RENDER_CACHE_CAPACITY);
+    
+    [dataSource destroy];
+}
+
 @end
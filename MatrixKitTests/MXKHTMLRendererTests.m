@@ -0,0 +1,261 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKHTMLRenderer.h"
+
+@interface MXKHTMLRendererTests : XCTestCase
+{
+    MXKHTMLRenderer *htmlRenderer;
+    MXKEventFormatter *eventFormatter;
+    MXEvent *anEvent;
+    UIFont *font;
+}
+
+@end
+
+@implementation MXKHTMLRendererTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    htmlRenderer = [[MXKHTMLRenderer alloc] init];
+    font = [UIFont systemFontOfSize:14];
+
+    eventFormatter = [[MXKEventFormatter alloc] initWithMatrixSession:nil];
+
+    anEvent = [[MXEvent alloc] init];
+    anEvent.roomId = @"aRoomId";
+    anEvent.eventId = @"anEventId";
+    anEvent.wireType = kMXEventTypeStringRoomMessage;
+    anEvent.originServerTs = (uint64_t) ([[NSDate date] timeIntervalSince1970] * 1000);
+    anEvent.wireContent = @{
+                            @"msgtype": kMXMessageTypeText,
+                            @"body": @"deded",
+                            };
+}
+
+- (void)tearDown
+{
+    htmlRenderer = nil;
+    eventFormatter = nil;
+    anEvent = nil;
+
+    [super tearDown];
+}
+
+/**
+ The supported HTML strings and their expected rendered text.
+ */
+- (NSDictionary<NSString*, NSString*>*)goldenCorpus
+{
+    return @{
+             @"Hello <b>world</b>": @"Hello world",
+             @"<i>a</i> <em>b</em> <strong>c</strong>": @"a b c",
+             @"<del>old</del> <u>under</u> <strike>through</strike>": @"old under through",
+             @"<a href=\"https://matrix.org\">Matrix</a>": @"Matrix",
+             @"<p>First</p><p>Second</p>": @"First\nSecond",
+             @"Line 1<br>Line 2<br/>Line 3": @"Line 1\u2028Line 2\u2028Line 3",
+             @"<blockquote><p>Quote</p></blockquote><p>Reply</p>": @"Quote\nReply",
+             @"<ul><li>one</li><li>two</li></ul>": @"\t•\tone\n\t•\ttwo",
+             @"<ol><li>one</li><li>two</li></ol>": @"\t1.\tone\n\t2.\ttwo",
+             @"<ul><li></li><li> </li><li>three</li></ul>": @"\t•\t\n\t•\t\n\t•\tthree",
+             @"<ol><li>one</li><li></li></ol><p>After</p>": @"\t1.\tone\n\t2.\t\nAfter",
+             @"<pre><code>let a = 1;\n  print(a)\n</code></pre>": @"let a = 1;\n  print(a)",
+             @"<font color=\"#ff0000\">red</font> &amp; &lt;tag&gt; &#x1F600;": @"red & <tag> 😀",
+             @"  Collapsed   \n  whitespace  ": @"Collapsed whitespace",
+             };
+}
+
+/**
+ The markdown bodies whose formatted bodies, as emitted by the event formatter, are compared with DTCoreText.
+ */
+- (NSArray<NSString*>*)markdownCorpus
+{
+    return @[
+             @"Hello **world**",
+             @"First paragraph\n\nSecond *paragraph*",
+             @"> Quote\n\nReply",
+             @"> Quote on\n> two lines\n\nReply with a [link](https://matrix.org)",
+             @"- one\n- two\n\nAfter the list",
+             @"1. one\n2. two",
+             @"- item\n\n  with a paragraph\n- other",
+             @"Some `code` and\n\n```\nlet a = 1;\n```\n\nAfter the code",
+             ];
+}
+
+#pragma mark - Golden outputs
+
+- (void)testGoldenCorpus
+{
+    NSDictionary<NSString*, NSString*> *corpus = self.goldenCorpus;
+    for (NSString *html in corpus)
+    {
+        NSAttributedString *attributedString = [htmlRenderer renderHTMLString:html withFont:font textColor:UIColor.blackColor];
+
+        XCTAssertNotNil(attributedString, @"\"%@\" must be supported", html);
+        XCTAssertEqualObjects(attributedString.string, corpus[html], @"Unexpected rendering of \"%@\"", html);
+    }
+}
+
+- (void)testAttributes
+{
+    NSString *html = @"<b>bold</b> <a href=\"https://matrix.org/?a=1&amp;b=2\">link</a> <code>code</code> <font color=\"#ff0000\">red</font>";
+    NSAttributedString *attributedString = [htmlRenderer renderHTMLString:html withFont:font textColor:UIColor.blackColor];
+    XCTAssertEqualObjects(attributedString.string, @"bold link code red");
+
+    UIFont *boldFont = [attributedString attribute:NSFontAttributeName atIndex:0 effectiveRange:nil];
+    XCTAssertTrue(boldFont.fontDescriptor.symbolicTraits & UIFontDescriptorTraitBold);
+
+    NSURL *link = [attributedString attribute:NSLinkAttributeName atIndex:5 effectiveRange:nil];
+    XCTAssertEqualObjects(link.absoluteString, @"https://matrix.org/?a=1&b=2");
+
+    UIFont *codeFont = [attributedString attribute:NSFontAttributeName atIndex:10 effectiveRange:nil];
+    XCTAssertEqualObjects(codeFont.fontName, @"Menlo-Regular");
+
+    UIColor *color = [attributedString attribute:NSForegroundColorAttributeName atIndex:15 effectiveRange:nil];
+    XCTAssertEqualObjects(color, [MXKTools colorWithRGBValue:0xFF0000]);
+}
+
+- (void)testBlockquoteMark
+{
+    NSAttributedString *attributedString = [htmlRenderer renderHTMLString:@"<blockquote><p>Quote</p></blockquote><p>Reply</p>" withFont:font textColor:UIColor.blackColor];
+
+    NSMutableArray<NSValue*> *blockquoteRanges = [NSMutableArray array];
+    [MXKTools enumerateMarkedBlockquotesInAttributedString:attributedString usingBlock:^(NSRange range, BOOL *stop) {
+        [blockquoteRanges addObject:[NSValue valueWithRange:range]];
+    }];
+
+    XCTAssertEqual(blockquoteRanges.count, 1);
+    XCTAssertEqualObjects([attributedString.string substringWithRange:blockquoteRanges.firstObject.rangeValue], @"Quote\n");
+}
+
+- (void)testUnsupportedHTML
+{
+    NSArray<NSString*> *unsupportedHTMLStrings = @[
+                                                   @"<h3>Title</h3>",
+                                                   @"<table><tr><td>cell</td></tr></table>",
+                                                   @"<p style=\"color: red\">styled</p>",
+                                                   @"<ol start=\"3\"><li>three</li></ol>",
+                                                   @"<!-- comment -->text",
+                                                   @"<b>unclosed",
+                                                   @"<b><i>misnested</b></i>",
+                                                   @"<li>orphan item</li>",
+                                                   @"&unknown; entity",
+                                                   @"<font color=\"red\">named color</font>",
+                                                   ];
+
+    for (NSString *html in unsupportedHTMLStrings)
+    {
+        XCTAssertNil([htmlRenderer renderHTMLString:html withFont:font textColor:UIColor.blackColor], @"\"%@\" must be left to DTCoreText", html);
+    }
+}
+
+#pragma mark - Equivalence with DTCoreText
+
+- (void)assertRenderingEquivalenceWithDTCoreTextOfHTMLString:(NSString*)html
+{
+    eventFormatter.htmlRenderer = htmlRenderer;
+    NSAttributedString *attributedString = [eventFormatter renderHTMLString:html forEvent:anEvent withRoomState:nil];
+
+    eventFormatter.htmlRenderer = nil;
+    NSAttributedString *referenceAttributedString = [eventFormatter renderHTMLString:html forEvent:anEvent withRoomState:nil];
+
+    XCTAssertEqualObjects(attributedString.string, referenceAttributedString.string, @"Text mismatch for \"%@\"", html);
+    if (![attributedString.string isEqualToString:referenceAttributedString.string])
+    {
+        return;
+    }
+
+    NSMutableIndexSet *blockquoteIndexes = [NSMutableIndexSet indexSet];
+    [MXKTools enumerateMarkedBlockquotesInAttributedString:attributedString usingBlock:^(NSRange range, BOOL *stop) {
+        [blockquoteIndexes addIndexesInRange:range];
+    }];
+    NSMutableIndexSet *referenceBlockquoteIndexes = [NSMutableIndexSet indexSet];
+    [MXKTools enumerateMarkedBlockquotesInAttributedString:referenceAttributedString usingBlock:^(NSRange range, BOOL *stop) {
+        [referenceBlockquoteIndexes addIndexesInRange:range];
+    }];
+
+    NSString *string = attributedString.string;
+    for (NSUInteger index = 0; index < string.length; index++)
+    {
+        if ([[NSCharacterSet whitespaceAndNewlineCharacterSet] characterIsMember:[string characterAtIndex:index]])
+        {
+            // Only the visible characters matter
+            continue;
+        }
+
+        NSDictionary *attributes = [attributedString attributesAtIndex:index effectiveRange:nil];
+        NSDictionary *referenceAttributes = [referenceAttributedString attributesAtIndex:index effectiveRange:nil];
+
+        UIFont *characterFont = attributes[NSFontAttributeName];
+        UIFont *referenceFont = referenceAttributes[NSFontAttributeName];
+        UIFontDescriptorSymbolicTraits traitsMask = UIFontDescriptorTraitBold | UIFontDescriptorTraitItalic | UIFontDescriptorTraitMonoSpace;
+        XCTAssertEqual(characterFont.fontDescriptor.symbolicTraits & traitsMask, referenceFont.fontDescriptor.symbolicTraits & traitsMask, @"Font mismatch at %tu for \"%@\"", index, html);
+
+        NSURL *link = attributes[NSLinkAttributeName];
+        NSURL *referenceLink = referenceAttributes[NSLinkAttributeName];
+        XCTAssertEqualObjects(link.absoluteString, referenceLink.absoluteString, @"Link mismatch at %tu for \"%@\"", index, html);
+
+        XCTAssertEqual([blockquoteIndexes containsIndex:index], [referenceBlockquoteIndexes containsIndex:index], @"Blockquote mismatch at %tu for \"%@\"", index, html);
+
+        NSParagraphStyle *paragraphStyle = attributes[NSParagraphStyleAttributeName] ?: NSParagraphStyle.defaultParagraphStyle;
+        NSParagraphStyle *referenceParagraphStyle = referenceAttributes[NSParagraphStyleAttributeName] ?: NSParagraphStyle.defaultParagraphStyle;
+        XCTAssertEqualWithAccuracy(paragraphStyle.paragraphSpacingBefore, referenceParagraphStyle.paragraphSpacingBefore, 0.5, @"Paragraph spacing before mismatch at %tu for \"%@\"", index, html);
+        XCTAssertEqualWithAccuracy(paragraphStyle.paragraphSpacing, referenceParagraphStyle.paragraphSpacing, 0.5, @"Paragraph spacing mismatch at %tu for \"%@\"", index, html);
+        XCTAssertEqualWithAccuracy(paragraphStyle.headIndent, referenceParagraphStyle.headIndent, 0.5, @"Indent mismatch at %tu for \"%@\"", index, html);
+    }
+}
+
+- (void)testEquivalenceWithDTCoreText
+{
+    for (NSString *html in self.goldenCorpus)
+    {
+        [self assertRenderingEquivalenceWithDTCoreTextOfHTMLString:html];
+    }
+}
+
+- (void)testEquivalenceWithDTCoreTextOfFormattedBodies
+{
+    for (NSString *markdown in self.markdownCorpus)
+    {
+        // Use the formatted body that is sent for this message
+        NSString *html = [eventFormatter htmlStringFromMarkdownString:markdown];
+        XCTAssertNotNil([htmlRenderer renderHTMLString:html withFont:font textColor:UIColor.blackColor], @"The formatted body \"%@\" must be supported", html);
+
+        [self assertRenderingEquivalenceWithDTCoreTextOfHTMLString:html];
+    }
+}
+
+- (void)testParagraphSpacing
+{
+    NSAttributedString *attributedString = [htmlRenderer renderHTMLString:@"<p>First</p><ul><li>item</li></ul>" withFont:font textColor:UIColor.blackColor];
+    XCTAssertEqualObjects(attributedString.string, @"First\n\t•\titem");
+
+    // The paragraphs are spaced by the 1em margins of DTCoreText, but not the list items
+    NSParagraphStyle *paragraphStyle = [attributedString attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:nil];
+    XCTAssertEqual(paragraphStyle.paragraphSpacingBefore, font.pointSize);
+    XCTAssertEqual(paragraphStyle.paragraphSpacing, font.pointSize);
+
+    NSParagraphStyle *itemParagraphStyle = [attributedString attribute:NSParagraphStyleAttributeName atIndex:attributedString.length - 1 effectiveRange:nil];
+    XCTAssertEqual(itemParagraphStyle.paragraphSpacing, 0);
+}
+
+@end
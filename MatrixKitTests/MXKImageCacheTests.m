@@ -0,0 +1,125 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKImageCache.h"
+
+@interface MXKImageCacheTests : XCTestCase
+
+@end
+
+@implementation MXKImageCacheTests
+
+- (UIImage*)imageWithPixelSize:(CGSize)size
+{
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1.0);
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    return image;
+}
+
+- (void)testKeys
+{
+    MXKImageCache *cache = [[MXKImageCache alloc] initWithTotalCostLimit:MXKIMAGECACHE_DEFAULT_TOTAL_COST_LIMIT];
+    UIImage *image = [self imageWithPixelSize:CGSizeMake(10, 10)];
+    
+    [cache setImage:image forContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:NO variant:nil];
+    
+    XCTAssertEqual([cache imageForContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:NO variant:nil], image);
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(20, 20) fill:NO variant:nil]);
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:NO variant:@"rounded"]);
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/b" pixelSize:CGSizeMake(10, 10) fill:NO variant:nil]);
+    
+    XCTAssertEqual(cache.hitCount, 1);
+    XCTAssertEqual(cache.missCount, 3);
+    XCTAssertEqualWithAccuracy(cache.hitRate, 0.25, 0.001);
+    
+    [cache setImage:image forContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:NO variant:@"rounded"];
+    [cache removeImagesForContentURI:@"mxc://matrix.org/a"];
+    XCTAssertEqual(cache.count, 0);
+    XCTAssertEqual(cache.totalCost, 0);
+}
+
+- (void)testFillKeys
+{
+    MXKImageCache *cache = [[MXKImageCache alloc] initWithTotalCostLimit:MXKIMAGECACHE_DEFAULT_TOTAL_COST_LIMIT];
+    UIImage *image = [self imageWithPixelSize:CGSizeMake(10, 10)];
+    
+    // A picture decoded to fit in a size is not the one decoded to fill it
+    [cache setImage:image forContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:NO variant:nil];
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/a" pixelSize:CGSizeMake(10, 10) fill:YES variant:nil]);
+    
+    // The original size is the same in both modes
+    [cache setImage:image forContentURI:@"mxc://matrix.org/b" pixelSize:CGSizeZero fill:NO variant:nil];
+    XCTAssertEqual([cache imageForContentURI:@"mxc://matrix.org/b" pixelSize:CGSizeZero fill:YES variant:nil], image);
+}
+
+- (void)testCostBudget
+{
+    UIImage *avatar = [self imageWithPixelSize:CGSizeMake(100, 100)];
+    UIImage *photo = [self imageWithPixelSize:CGSizeMake(1000, 1000)];
+    NSUInteger avatarCost = [MXKImageCache costForImage:avatar];
+    NSUInteger photoCost = [MXKImageCache costForImage:photo];
+    XCTAssertGreaterThanOrEqual(avatarCost, 100 * 100 * 4);
+    
+    MXKImageCache *cache = [[MXKImageCache alloc] initWithTotalCostLimit:photoCost + 10 * avatarCost];
+    
+    for (NSUInteger i = 0; i < 10; i++)
+    {
+        [cache setImage:avatar forContentURI:[NSString stringWithFormat:@"mxc://matrix.org/avatar%tu", i] pixelSize:CGSizeMake(100, 100) fill:NO variant:nil];
+    }
+    XCTAssertEqual(cache.totalCost, 10 * avatarCost);
+    
+    // Use the first avatar so that it becomes the most recently used one
+    XCTAssertNotNil([cache imageForContentURI:@"mxc://matrix.org/avatar0" pixelSize:CGSizeMake(100, 100) fill:NO variant:nil]);
+    
+    // The photo fits in the remaining budget
+    [cache setImage:photo forContentURI:@"mxc://matrix.org/photo" pixelSize:CGSizeZero fill:NO variant:nil];
+    XCTAssertEqual(cache.count, 11);
+    XCTAssertEqual(cache.evictionCount, 0);
+    
+    // A second photo evicts the least recently used entries, until it fits
+    [cache setImage:photo forContentURI:@"mxc://matrix.org/photo2" pixelSize:CGSizeZero fill:NO variant:nil];
+    XCTAssertLessThanOrEqual(cache.totalCost, cache.totalCostLimit);
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/avatar1" pixelSize:CGSizeMake(100, 100) fill:NO variant:nil]);
+    XCTAssertNotNil([cache imageForContentURI:@"mxc://matrix.org/photo2" pixelSize:CGSizeZero fill:NO variant:nil]);
+    
+    // A picture larger than the budget is not cached
+    [cache setImage:[self imageWithPixelSize:CGSizeMake(2000, 2000)] forContentURI:@"mxc://matrix.org/huge" pixelSize:CGSizeZero fill:NO variant:nil];
+    XCTAssertNil([cache imageForContentURI:@"mxc://matrix.org/huge" pixelSize:CGSizeZero fill:NO variant:nil]);
+}
+
+- (void)testMemoryWarning
+{
+    UIImage *avatar = [self imageWithPixelSize:CGSizeMake(100, 100)];
+    NSUInteger avatarCost = [MXKImageCache costForImage:avatar];
+    MXKImageCache *cache = [[MXKImageCache alloc] initWithTotalCostLimit:8 * avatarCost];
+    
+    for (NSUInteger i = 0; i < 8; i++)
+    {
+        [cache setImage:avatar forContentURI:[NSString stringWithFormat:@"mxc://matrix.org/avatar%tu", i] pixelSize:CGSizeMake(100, 100) fill:NO variant:nil];
+    }
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    
+    XCTAssertEqual(cache.count, 2);
+    XCTAssertNotNil([cache imageForContentURI:@"mxc://matrix.org/avatar7" pixelSize:CGSizeMake(100, 100) fill:NO variant:nil]);
+}
+
+@end
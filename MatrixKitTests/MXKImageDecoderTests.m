@@ -0,0 +1,96 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKImageDecoder.h"
+
+@interface MXKImageDecoderTests : XCTestCase
+{
+    NSString *filePath;
+}
+@end
+
+@implementation MXKImageDecoderTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    // A 400x200 px picture
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(400, 200), YES, 1.0);
+    [[UIColor redColor] setFill];
+    UIRectFill(CGRectMake(0, 0, 400, 200));
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.png", [NSUUID UUID].UUIDString]];
+    [UIImagePNGRepresentation(image) writeToFile:filePath atomically:YES];
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    [super tearDown];
+}
+
+- (void)testDownsampling
+{
+    UIImage *image = [MXKImageDecoder decodedImageWithContentsOfFile:filePath toPixelSize:CGSizeMake(100, 100) fill:NO];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 100);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 50);
+    
+    image = [MXKImageDecoder decodedImageWithContentsOfFile:filePath toPixelSize:CGSizeMake(100, 100) fill:YES];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 200);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 100);
+}
+
+- (void)testNoUpsampling
+{
+    UIImage *image = [MXKImageDecoder decodedImageWithContentsOfFile:filePath toPixelSize:CGSizeMake(1000, 1000) fill:YES];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 400);
+    
+    image = [MXKImageDecoder decodedImageWithContentsOfFile:filePath toPixelSize:CGSizeZero fill:NO];
+    XCTAssertEqual(CGImageGetWidth(image.CGImage), 400);
+    XCTAssertEqual(CGImageGetHeight(image.CGImage), 200);
+}
+
+- (void)testInvalidFile
+{
+    XCTAssertNil([MXKImageDecoder decodedImageWithContentsOfFile:@"/nonexistent.png" toPixelSize:CGSizeZero fill:NO]);
+}
+
+- (void)testCancellation
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"decoded"];
+    
+    NSOperation *cancelledOperation = [MXKImageDecoder decodeImageWithContentsOfFile:filePath toPixelSize:CGSizeMake(10, 10) fill:NO completion:^(UIImage *image) {
+        XCTFail(@"A cancelled decoding must not complete");
+    }];
+    [cancelledOperation cancel];
+    
+    [MXKImageDecoder decodeImageWithContentsOfFile:filePath toPixelSize:CGSizeMake(10, 10) fill:NO completion:^(UIImage *image) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertNotNil(image);
+        [expectation fulfill];
+    }];
+    
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+@end
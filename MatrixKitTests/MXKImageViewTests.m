@@ -0,0 +1,127 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+
+@interface MXKImageView (MXKImageViewTests)
+
+- (void)loadImageFromFilePath:(NSString*)filePath;
+
+@end
+
+@interface MXKImageViewTests : XCTestCase
+{
+    NSString *filePath;
+    CGFloat scale;
+}
+@end
+
+@implementation MXKImageViewTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    // A 400x200 px picture
+    UIGraphicsBeginImageContextWithOptions(CGSizeMake(400, 200), YES, 1.0);
+    [[UIColor redColor] setFill];
+    UIRectFill(CGRectMake(0, 0, 400, 200));
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.png", [NSUUID UUID].UUIDString]];
+    [UIImagePNGRepresentation(image) writeToFile:filePath atomically:YES];
+    
+    scale = [UIScreen mainScreen].scale;
+}
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
+    [super tearDown];
+}
+
+- (void)waitForImageWidth:(size_t)width inImageView:(MXKImageView*)imageView
+{
+    NSPredicate *predicate = [NSPredicate predicateWithBlock:^BOOL(MXKImageView *view, NSDictionary *bindings) {
+        return view.image && CGImageGetWidth(view.image.CGImage) == width;
+    }];
+    [self expectationForPredicate:predicate evaluatedWithObject:imageView handler:nil];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+- (void)testDecodingAgainWhenTheViewGrows
+{
+    MXKImageView *imageView = [[MXKImageView alloc] initWithFrame:CGRectMake(0, 0, 20, 10)];
+    
+    [imageView loadImageFromFilePath:filePath];
+    [self waitForImageWidth:20 * scale inImageView:imageView];
+    
+    imageView.frame = CGRectMake(0, 0, 50, 25);
+    [imageView setNeedsLayout];
+    [imageView layoutIfNeeded];
+    
+    [self waitForImageWidth:50 * scale inImageView:imageView];
+}
+
+- (void)testNoDecodingWhenTheViewShrinks
+{
+    MXKImageView *imageView = [[MXKImageView alloc] initWithFrame:CGRectMake(0, 0, 50, 25)];
+    
+    [imageView loadImageFromFilePath:filePath];
+    [self waitForImageWidth:50 * scale inImageView:imageView];
+    UIImage *image = imageView.image;
+    
+    imageView.frame = CGRectMake(0, 0, 20, 10);
+    [imageView setNeedsLayout];
+    [imageView layoutIfNeeded];
+    
+    // Let a potential decoding complete
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Layout"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.3 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssertEqual(imageView.image, image, @"The larger image must be kept");
+}
+
+- (void)testNoDecodingOfAnImageSetByTheCaller
+{
+    MXKImageView *imageView = [[MXKImageView alloc] initWithFrame:CGRectMake(0, 0, 20, 10)];
+    
+    [imageView loadImageFromFilePath:filePath];
+    [self waitForImageWidth:20 * scale inImageView:imageView];
+    
+    UIImage *image = [[UIImage alloc] init];
+    imageView.image = image;
+    imageView.frame = CGRectMake(0, 0, 50, 25);
+    [imageView setNeedsLayout];
+    [imageView layoutIfNeeded];
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Layout"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.3 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssertEqual(imageView.image, image);
+}
+
+@end
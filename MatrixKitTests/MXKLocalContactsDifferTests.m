@@ -0,0 +1,228 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKLocalContactsDiffer.h"
+
+/**
+ The number of hash and equality checks done on the contact ids.
+ */
+static NSUInteger MXKLocalContactsDifferTestsKeyOperationsCount = 0;
+
+/**
+ A contact id which counts the hash and equality checks done by the collections.
+ */
+@interface MXKLocalContactsDifferTestsContactID : NSString
+{
+    NSString *string;
+}
+
+- (instancetype)initWithContactIDString:(NSString*)contactIDString;
+
+@end
+
+@implementation MXKLocalContactsDifferTestsContactID
+
+- (instancetype)initWithContactIDString:(NSString*)contactIDString
+{
+    self = [super init];
+    if (self)
+    {
+        string = [contactIDString copy];
+    }
+    return self;
+}
+
+- (NSUInteger)length
+{
+    return string.length;
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    return [string characterAtIndex:index];
+}
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+    [string getCharacters:buffer range:range];
+}
+
+- (NSUInteger)hash
+{
+    MXKLocalContactsDifferTestsKeyOperationsCount++;
+    return string.hash;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    MXKLocalContactsDifferTestsKeyOperationsCount++;
+    return [string isEqual:object];
+}
+
+- (BOOL)isEqualToString:(NSString *)aString
+{
+    MXKLocalContactsDifferTestsKeyOperationsCount++;
+    return [string isEqualToString:aString];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    // Immutable: keep counting in the collections which copy their keys
+    return self;
+}
+
+@end
+
+@interface MXKLocalContactsDifferTests : XCTestCase
+{
+    /**
+     Tell whether the contact ids count their hash and equality checks.
+     */
+    BOOL countsKeyOperations;
+}
+
+@end
+
+@implementation MXKLocalContactsDifferTests
+
+- (NSString*)contactIDAtIndex:(NSUInteger)index
+{
+    NSString *contactID = [NSString stringWithFormat:@"Local_%tu", index];
+    return countsKeyOperations ? [[MXKLocalContactsDifferTestsContactID alloc] initWithContactIDString:contactID] : contactID;
+}
+
+/**
+ The fingerprint of a synthetic contact.
+ */
+- (uint64_t)fingerprintOfContactAtIndex:(NSUInteger)index revision:(NSUInteger)revision
+{
+    return [MXKLocalContactsDiffer fingerprintOfFields:@[[NSString stringWithFormat:@"Contact %tu", index],
+                                                         [NSString stringWithFormat:@"mobile:+4479%08tu", index],
+                                                         @"",
+                                                         [NSString stringWithFormat:@"home:contact%tu@example.org", index],
+                                                         @"",
+                                                         [NSString stringWithFormat:@"%tu", revision]]];
+}
+
+- (NSDictionary<NSString*, NSNumber*>*)fingerprintsOfContactsCount:(NSUInteger)count
+{
+    NSMutableDictionary<NSString*, NSNumber*> *fingerprints = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        fingerprints[[self contactIDAtIndex:index]] = @([self fingerprintOfContactAtIndex:index revision:0]);
+    }
+    return fingerprints;
+}
+
+/**
+ Refresh a contacts book of `count` contacts where 1% of the contacts changed, 1% were removed and 1% were added.
+ */
+- (MXKLocalContactsDiffer*)refreshContactsCount:(NSUInteger)count previousFingerprints:(NSDictionary*)previousFingerprints
+{
+    MXKLocalContactsDiffer *differ = [[MXKLocalContactsDiffer alloc] initWithPreviousFingerprints:previousFingerprints];
+    for (NSUInteger index = 0; index < count + count / 100; index++)
+    {
+        if (index % 100 == 1)
+        {
+            // Removed
+            continue;
+        }
+        NSUInteger revision = (index % 100 == 2) ? 1 : 0;
+        [differ addContactID:[self contactIDAtIndex:index] fingerprint:[self fingerprintOfContactAtIndex:index revision:revision]];
+    }
+    return differ;
+}
+
+- (void)testDiff
+{
+    NSDictionary *previousFingerprints = [self fingerprintsOfContactsCount:1000];
+    MXKLocalContactsDiffer *differ = [self refreshContactsCount:1000 previousFingerprints:previousFingerprints];
+    
+    XCTAssertEqual(differ.addedContactIDs.count, 10);
+    XCTAssertEqual(differ.changedContactIDs.count, 10);
+    XCTAssertEqual(differ.removedContactIDs.count, 10);
+    XCTAssertTrue([differ.removedContactIDs containsObject:@"Local_101"]);
+    XCTAssertTrue([differ.changedContactIDs containsObject:@"Local_102"]);
+    XCTAssertTrue([differ.addedContactIDs containsObject:@"Local_1005"]);
+    XCTAssertEqual(differ.fingerprints.count, 1000);
+    XCTAssertTrue(differ.hasChanges);
+    
+    // No change since the last refresh
+    MXKLocalContactsDiffer *differ2 = [[MXKLocalContactsDiffer alloc] initWithPreviousFingerprints:differ.fingerprints];
+    for (NSString *contactID in differ.fingerprints)
+    {
+        XCTAssertFalse([differ2 addContactID:contactID fingerprint:differ.fingerprints[contactID].unsignedLongLongValue]);
+    }
+    XCTAssertFalse(differ2.hasChanges);
+}
+
+- (void)testKeepContact
+{
+    MXKLocalContactsDiffer *differ = [[MXKLocalContactsDiffer alloc] initWithPreviousFingerprints:@{@"Local_1": @(42)}];
+    
+    XCTAssertTrue([differ keepContactID:@"Local_1"]);
+    XCTAssertFalse([differ keepContactID:@"Local_2"], @"An unknown contact must be fingerprinted");
+    XCTAssertEqualObjects(differ.fingerprints, @{@"Local_1": @(42)});
+    XCTAssertFalse(differ.hasChanges);
+}
+
+- (void)testFingerprintFieldsSeparation
+{
+    XCTAssertNotEqual([MXKLocalContactsDiffer fingerprintOfFields:@[@"ab", @"c"]], [MXKLocalContactsDiffer fingerprintOfFields:@[@"a", @"bc"]]);
+}
+
+- (void)testRefreshScalesLinearly
+{
+    // Count the operations on the contact ids rather than the duration, which depends on the machine load
+    countsKeyOperations = YES;
+    
+    NSDictionary *previousFingerprints10k = [self fingerprintsOfContactsCount:10000];
+    NSDictionary *previousFingerprints20k = [self fingerprintsOfContactsCount:20000];
+    
+    MXKLocalContactsDifferTestsKeyOperationsCount = 0;
+    MXKLocalContactsDiffer *differ10k = [self refreshContactsCount:10000 previousFingerprints:previousFingerprints10k];
+    NSUInteger operations10k = MXKLocalContactsDifferTestsKeyOperationsCount;
+    
+    MXKLocalContactsDifferTestsKeyOperationsCount = 0;
+    MXKLocalContactsDiffer *differ20k = [self refreshContactsCount:20000 previousFingerprints:previousFingerprints20k];
+    NSUInteger operations20k = MXKLocalContactsDifferTestsKeyOperationsCount;
+    
+    countsKeyOperations = NO;
+    
+    NSLog(@"[MXKLocalContactsDifferTests] Refresh 10k contacts: %tu key operations, 20k contacts: %tu key operations", operations10k, operations20k);
+    
+    XCTAssertEqual(differ10k.changedContactIDs.count, 100);
+    XCTAssertEqual(differ20k.changedContactIDs.count, 200);
+    
+    // A constant number of hashed lookups per contact, where a quadratic refresh would compare each contact to all the others
+    XCTAssertGreaterThan(operations10k, 10000);
+    XCTAssertLessThan(operations20k, operations10k * 3);
+}
+
+- (void)testRefresh20kContactsPerformance
+{
+    NSDictionary *previousFingerprints = [self fingerprintsOfContactsCount:20000];
+    
+    [self measureBlock:^{
+        [self refreshContactsCount:20000 previousFingerprints:previousFingerprints];
+    }];
+}
+
+@end
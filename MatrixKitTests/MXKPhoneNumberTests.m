@@ -0,0 +1,90 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+
+@import libPhoneNumber_iOS;
+
+@interface MXKPhoneNumberTests : XCTestCase
+
+@end
+
+@implementation MXKPhoneNumberTests
+
+- (void)testNationalNumber
+{
+    MXKPhoneNumber *phoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:@"06 12 34 56 78" type:@"mobile" contactID:nil matrixID:nil];
+    
+    // A national number cannot be parsed without default region
+    XCTAssertNil(phoneNumber.msisdn);
+    XCTAssertNil(phoneNumber.nbPhoneNumber);
+    
+    phoneNumber.defaultCountryCode = @"FR";
+    XCTAssertEqualObjects(phoneNumber.e164, @"+33612345678");
+    XCTAssertEqualObjects(phoneNumber.msisdn, @"33612345678");
+    XCTAssertEqualObjects(phoneNumber.regionCode, @"FR");
+    XCTAssertTrue(phoneNumber.isValidNumber);
+    XCTAssertNotNil(phoneNumber.nbPhoneNumber);
+    
+    // A country change parses it again
+    phoneNumber.defaultCountryCode = @"BE";
+    XCTAssertNotEqualObjects(phoneNumber.msisdn, @"33612345678");
+}
+
+- (void)testInternationalNumber
+{
+    MXKPhoneNumber *phoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:@"+33 6 12 34 56 78" type:@"mobile" contactID:nil matrixID:nil];
+    MXKPhoneNumber *samePhoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:@"+33 6 12 34 56 78" type:@"home" contactID:nil matrixID:nil];
+    
+    XCTAssertEqualObjects(phoneNumber.msisdn, @"33612345678");
+    
+    // Identical numbers are parsed once, but do not share the same mutable NBPhoneNumber instance
+    XCTAssertEqualObjects(phoneNumber.nbPhoneNumber.nationalNumber, samePhoneNumber.nbPhoneNumber.nationalNumber);
+    XCTAssertNotEqual(phoneNumber.nbPhoneNumber, samePhoneNumber.nbPhoneNumber);
+    samePhoneNumber.nbPhoneNumber.nationalNumber = @(0);
+    XCTAssertEqualObjects(phoneNumber.nbPhoneNumber.nationalNumber, @(612345678));
+    MXKPhoneNumber *otherPhoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:@"+33 6 12 34 56 78" type:@"work" contactID:nil matrixID:nil];
+    XCTAssertEqualObjects(otherPhoneNumber.nbPhoneNumber.nationalNumber, @(612345678));
+    
+    // A country change does not parse again an international number
+    NBPhoneNumber *nbPhoneNumber = phoneNumber.nbPhoneNumber;
+    phoneNumber.defaultCountryCode = @"GB";
+    XCTAssertEqual(phoneNumber.nbPhoneNumber, nbPhoneNumber);
+    XCTAssertEqualObjects(phoneNumber.regionCode, @"FR");
+}
+
+- (void)testArchivedParsedForms
+{
+    MXKPhoneNumber *phoneNumber = [[MXKPhoneNumber alloc] initWithTextNumber:@"06 12 34 56 78" type:@"mobile" contactID:nil matrixID:nil];
+    phoneNumber.defaultCountryCode = @"FR";
+    
+    MXKPhoneNumber *restoredPhoneNumber = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:phoneNumber]];
+    
+    XCTAssertEqualObjects(restoredPhoneNumber.defaultCountryCode, @"FR");
+    XCTAssertEqualObjects(restoredPhoneNumber.e164, @"+33612345678");
+    XCTAssertEqualObjects(restoredPhoneNumber.msisdn, @"33612345678");
+    XCTAssertEqualObjects(restoredPhoneNumber.regionCode, @"FR");
+    XCTAssertTrue(restoredPhoneNumber.isValidNumber);
+    
+    // The NBPhoneNumber instance is still available
+    XCTAssertEqualObjects([[NBPhoneNumberUtil sharedInstance] format:restoredPhoneNumber.nbPhoneNumber numberFormat:NBEPhoneNumberFormatE164 error:nil], @"+33612345678");
+}
+
+@end
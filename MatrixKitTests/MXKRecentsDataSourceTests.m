@@ -0,0 +1,242 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKRecentsTestSession.h"
+
+#define MXKRECENTSDATASOURCETESTS_ROOMS_COUNT 20
+
+@interface MXKRecentsDataSourceTests : XCTestCase
+{
+    MXKRecentsTestSession *session;
+    MXKRecentsTestDataSourceDelegate *delegate;
+}
+
+@end
+
+@implementation MXKRecentsDataSourceTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    // The even rooms are named "Matrix <index>", the odd ones "Room <index>"
+    session = [self sessionWithRoomsCount:MXKRECENTSDATASOURCETESTS_ROOMS_COUNT];
+    delegate = [[MXKRecentsTestDataSourceDelegate alloc] init];
+}
+
+- (void)tearDown
+{
+    delegate = nil;
+    session = nil;
+    
+    [super tearDown];
+}
+
+- (MXKRecentsTestSession*)sessionWithRoomsCount:(NSUInteger)roomsCount
+{
+    MXKRecentsTestSession *testSession = [[MXKRecentsTestSession alloc] initWithRoomsCount:roomsCount];
+    for (NSUInteger index = 0; index < roomsCount; index++)
+    {
+        MXRoomSummary *summary = [testSession roomSummaryWithRoomId:[NSString stringWithFormat:@"!room%tu:matrix.org", index]];
+        summary.displayname = [NSString stringWithFormat:@"%@ %tu", (index % 2) ? @"Room" : @"Matrix", index];
+    }
+    return testSession;
+}
+
+- (MXKSessionRecentsDataSource*)loadedSessionRecentsDataSource
+{
+    MXKSessionRecentsDataSource *dataSource = [[MXKSessionRecentsDataSource alloc] initWithMatrixSession:session];
+    dataSource.delegate = delegate;
+    [dataSource finalizeInitialization];
+    return dataSource;
+}
+
+#pragma mark - MXKSessionRecentsDataSource
+
+- (void)testLoadData
+{
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    
+    XCTAssertEqual(dataSource.state, MXKDataSourceStateReady);
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSDATASOURCETESTS_ROOMS_COUNT);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    // The first rooms are the most recent ones
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room0:matrix.org"], 0);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room7:matrix.org"], 7);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!unknown:matrix.org"], NSNotFound);
+    
+    [dataSource destroy];
+}
+
+- (void)testInsert
+{
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    delegate.changeSetCount = 0;
+    
+    [session addRoomWithId:@"!new:matrix.org" originServerTs:100];
+    
+    XCTAssertEqual(delegate.changeSetCount, 1);
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSDATASOURCETESTS_ROOMS_COUNT + 1);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!new:matrix.org"], 0);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room0:matrix.org"], 1);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room19:matrix.org"], MXKRECENTSDATASOURCETESTS_ROOMS_COUNT);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+- (void)testRemove
+{
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    delegate.changeSetCount = 0;
+    
+    [session leaveRoomWithId:@"!room5:matrix.org"];
+    
+    XCTAssertEqual(delegate.changeSetCount, 1);
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSDATASOURCETESTS_ROOMS_COUNT - 1);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room5:matrix.org"], NSNotFound);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room6:matrix.org"], 5);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+- (void)testMove
+{
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    
+    [session receiveMessageInRoomWithId:@"!room12:matrix.org" originServerTs:100];
+    [dataSource.updateScheduler flush];
+    
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room12:matrix.org"], 0);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room0:matrix.org"], 1);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+- (void)testSearch
+{
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    
+    [dataSource searchWithPatterns:@[@"matrix"]];
+    
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSDATASOURCETESTS_ROOMS_COUNT / 2);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room4:matrix.org"], 2);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room5:matrix.org"], NSNotFound);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    // Changes during the search
+    [session leaveRoomWithId:@"!room0:matrix.org"];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room4:matrix.org"], 1);
+    
+    [session addRoomWithId:@"!new:matrix.org" originServerTs:100];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [session receiveMessageInRoomWithId:@"!room18:matrix.org" originServerTs:200];
+    [dataSource.updateScheduler flush];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room18:matrix.org"], 0);
+    
+    // End of the search
+    [dataSource searchWithPatterns:nil];
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSDATASOURCETESTS_ROOMS_COUNT);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room18:matrix.org"], 0);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!new:matrix.org"], 1);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room5:matrix.org"], 6);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+- (void)testCellIndexBeforeDisplay
+{
+    // The data are loaded during a server sync: the cells are not displayed until its end
+    session.syncInProgress = YES;
+    MXKSessionRecentsDataSource *dataSource = [self loadedSessionRecentsDataSource];
+    
+    XCTAssertNil([dataSource valueForKey:@"cellDataArray"]);
+    XCTAssertNotNil([dataSource cellDataWithRoomId:@"!room0:matrix.org"]);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room0:matrix.org"], NSNotFound);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room1:matrix.org"], NSNotFound);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    session.syncInProgress = NO;
+    [[NSNotificationCenter defaultCenter] postNotificationName:kMXKRoomDataSourceSyncStatusChanged object:nil];
+    
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room0:matrix.org"], 0);
+    XCTAssertEqual([dataSource cellIndexWithRoomId:@"!room1:matrix.org"], 1);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+#pragma mark - MXKRecentsDataSource
+
+- (void)testRecentsDataSource
+{
+    MXKRecentsTestSession *otherSession = [self sessionWithRoomsCount:5];
+    
+    MXKRecentsDataSource *dataSource = [[MXKRecentsDataSource alloc] initWithMatrixSession:session];
+    dataSource.delegate = delegate;
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource addMatrixSession:otherSession];
+    XCTAssertEqual(dataSource.displayedRecentsDataSourcesCount, 2);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    NSIndexPath *indexPath = [dataSource cellIndexPathWithRoomId:@"!room3:matrix.org" andMatrixSession:otherSession];
+    XCTAssertEqual(indexPath.section, 1);
+    XCTAssertEqual(indexPath.row, 3);
+    
+    // Insertions and removals in both sessions
+    [session addRoomWithId:@"!new:matrix.org" originServerTs:100];
+    [otherSession leaveRoomWithId:@"!room0:matrix.org"];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    XCTAssertEqual([dataSource cellIndexPathWithRoomId:@"!new:matrix.org" andMatrixSession:session].row, 0);
+    XCTAssertEqual([dataSource cellIndexPathWithRoomId:@"!room3:matrix.org" andMatrixSession:otherSession].row, 2);
+    XCTAssertNil([dataSource cellIndexPathWithRoomId:@"!room0:matrix.org" andMatrixSession:otherSession]);
+    
+    // Search
+    [dataSource searchWithPatterns:@[@"room"]];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    XCTAssertEqual([dataSource cellIndexPathWithRoomId:@"!room3:matrix.org" andMatrixSession:otherSession].row, 1);
+    XCTAssertNil([dataSource cellIndexPathWithRoomId:@"!room2:matrix.org" andMatrixSession:otherSession]);
+    
+    [otherSession receiveMessageInRoomWithId:@"!room4:matrix.org" originServerTs:100];
+    [[dataSource recentsDataSourceForMatrixSession:otherSession].updateScheduler flush];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource searchWithPatterns:nil];
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    // Session removal
+    [dataSource removeMatrixSession:otherSession];
+    XCTAssertEqual(dataSource.displayedRecentsDataSourcesCount, 1);
+    XCTAssertNil([dataSource cellIndexPathWithRoomId:@"!room3:matrix.org" andMatrixSession:otherSession]);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    [dataSource destroy];
+}
+
+@end
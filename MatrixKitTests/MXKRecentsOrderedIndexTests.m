@@ -0,0 +1,262 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKRecentsOrderedIndex.h"
+
+#define MXKRECENTSORDEREDINDEXTESTS_ROOMS_COUNT 10000
+
+/**
+ A recent cell data whose last event timestamp is set by the test.
+ */
+@interface MXKRecentsOrderedIndexTestCellData : MXKRecentCellData
+
+@property (nonatomic) uint64_t originServerTs;
+
+/**
+ The recents data source to report, if any.
+ */
+@property (nonatomic) MXKSessionRecentsDataSource *testRecentsDataSource;
+
+@end
+
+@implementation MXKRecentsOrderedIndexTestCellData
+
+- (MXEvent *)lastEvent
+{
+    MXEvent *event = [[MXEvent alloc] init];
+    event.originServerTs = self.originServerTs;
+    return event;
+}
+
+- (MXKSessionRecentsDataSource *)recentsDataSource
+{
+    return self.testRecentsDataSource ?: super.recentsDataSource;
+}
+
+@end
+
+@interface MXKRecentsOrderedIndexTests : XCTestCase
+
+@end
+
+@implementation MXKRecentsOrderedIndexTests
+
+- (MXKRecentsOrderedIndexTestCellData*)cellDataWithRoomId:(NSString*)roomId originServerTs:(uint64_t)originServerTs
+{
+    MXRoomSummary *roomSummary = [[MXRoomSummary alloc] initWithRoomId:roomId andMatrixSession:nil];
+    MXKRecentsOrderedIndexTestCellData *cellData = [[MXKRecentsOrderedIndexTestCellData alloc] initWithRoomSummary:roomSummary andRecentListDataSource:nil];
+    cellData.originServerTs = originServerTs;
+    return cellData;
+}
+
+- (void)assertOrderedIndex:(MXKRecentsOrderedIndex*)orderedIndex
+{
+    XCTAssertTrue([orderedIndex checkConsistency]);
+    
+    NSArray<id<MXKRecentCellDataStoring>> *allCellData = orderedIndex.allCellData;
+    XCTAssertEqual(allCellData.count, orderedIndex.count);
+    
+    for (NSUInteger index = 0; index < allCellData.count; index++)
+    {
+        id<MXKRecentCellDataStoring> cellData = allCellData[index];
+        XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:cellData.roomSummary.roomId], index);
+        XCTAssertEqual([orderedIndex cellDataWithRoomId:cellData.roomSummary.roomId], cellData);
+        
+        if (index)
+        {
+            XCTAssertGreaterThanOrEqual(allCellData[index - 1].lastEvent.originServerTs, cellData.lastEvent.originServerTs);
+        }
+    }
+}
+
+- (void)assertInterleavedOrderedIndex:(MXKRecentsOrderedIndex*)orderedIndex
+{
+    XCTAssertTrue([orderedIndex checkConsistency]);
+    
+    NSArray<id<MXKRecentCellDataStoring>> *allCellData = orderedIndex.allCellData;
+    for (NSUInteger index = 0; index < allCellData.count; index++)
+    {
+        XCTAssertEqual([orderedIndex indexOfCellData:allCellData[index]], index);
+        XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:allCellData[index].roomSummary.roomId inRecentsDataSource:allCellData[index].recentsDataSource], index);
+        
+        if (index)
+        {
+            XCTAssertGreaterThanOrEqual(allCellData[index - 1].lastEvent.originServerTs, allCellData[index].lastEvent.originServerTs);
+        }
+    }
+}
+
+- (void)testOrder
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    [orderedIndex setAllCellData:@[[self cellDataWithRoomId:@"!a" originServerTs:1],
+                                   [self cellDataWithRoomId:@"!b" originServerTs:3],
+                                   [self cellDataWithRoomId:@"!c" originServerTs:2]]];
+    
+    XCTAssertEqual(orderedIndex.count, 3);
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:0].roomSummary.roomId, @"!b");
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:1].roomSummary.roomId, @"!c");
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:2].roomSummary.roomId, @"!a");
+    XCTAssertNil([orderedIndex cellDataAtIndex:3]);
+    
+    // A new message in the last room moves it first
+    XCTAssertEqual([orderedIndex removeCellDataWithRoomId:@"!a"], 2);
+    XCTAssertEqual([orderedIndex addCellData:[self cellDataWithRoomId:@"!a" originServerTs:4]], 0);
+    
+    // Adding a cell data for an indexed room replaces it
+    XCTAssertEqual([orderedIndex addCellData:[self cellDataWithRoomId:@"!b" originServerTs:0]], 2);
+    XCTAssertEqual(orderedIndex.count, 3);
+    
+    XCTAssertEqual([orderedIndex removeCellDataWithRoomId:@"!unknown"], NSNotFound);
+    XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:@"!unknown"], NSNotFound);
+    
+    [self assertOrderedIndex:orderedIndex];
+}
+
+- (void)testSortKeyCapturedAtInsertion
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    MXKRecentsOrderedIndexTestCellData *cellData = [self cellDataWithRoomId:@"!a" originServerTs:1];
+    [orderedIndex addCellData:cellData];
+    [orderedIndex addCellData:[self cellDataWithRoomId:@"!b" originServerTs:2]];
+    
+    // The cell data updates its last event in place: the room is still found
+    cellData.originServerTs = 3;
+    XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:@"!a"], 1);
+    XCTAssertEqual([orderedIndex removeCellDataWithRoomId:@"!a"], 1);
+    XCTAssertEqual([orderedIndex addCellData:cellData], 0);
+}
+
+- (void)testRandomChanges
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    
+    NSMutableArray *cellDataArray = [NSMutableArray arrayWithCapacity:1000];
+    for (NSUInteger index = 0; index < 1000; index++)
+    {
+        [cellDataArray addObject:[self cellDataWithRoomId:[NSString stringWithFormat:@"!room%tu", index] originServerTs:arc4random_uniform(100)]];
+    }
+    [orderedIndex setAllCellData:cellDataArray];
+    [self assertOrderedIndex:orderedIndex];
+    
+    for (NSUInteger change = 0; change < 1000; change++)
+    {
+        NSString *roomId = [NSString stringWithFormat:@"!room%u", arc4random_uniform(1200)];
+        if (arc4random_uniform(4) == 0)
+        {
+            [orderedIndex removeCellDataWithRoomId:roomId];
+            XCTAssertNil([orderedIndex cellDataWithRoomId:roomId]);
+        }
+        else
+        {
+            NSUInteger index = [orderedIndex addCellData:[self cellDataWithRoomId:roomId originServerTs:arc4random_uniform(200)]];
+            XCTAssertEqualObjects([orderedIndex cellDataAtIndex:index].roomSummary.roomId, roomId);
+        }
+    }
+    [self assertOrderedIndex:orderedIndex];
+    
+    // Batches of changes, inserted one by one or sorted once
+    for (NSUInteger batchSize = 10; batchSize <= 500; batchSize *= 50)
+    {
+        NSMutableArray *batch = [NSMutableArray arrayWithCapacity:batchSize];
+        for (NSUInteger change = 0; change < batchSize; change++)
+        {
+            NSString *roomId = [NSString stringWithFormat:@"!room%u", arc4random_uniform(1200)];
+            [batch addObject:[self cellDataWithRoomId:roomId originServerTs:arc4random_uniform(300)]];
+        }
+        [orderedIndex addCellDataArray:batch];
+        [self assertOrderedIndex:orderedIndex];
+    }
+}
+
+- (void)testKWayMerge
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    orderedIndex.interleavesRecentsDataSources = YES;
+    
+    // The same room in two sessions is indexed twice
+    MXKRecentsOrderedIndexTestCellData *cellData1 = [self cellDataWithRoomId:@"!a" originServerTs:5];
+    MXKRecentsOrderedIndexTestCellData *cellData2 = [self cellDataWithRoomId:@"!a" originServerTs:4];
+    cellData2.testRecentsDataSource = [[MXKSessionRecentsDataSource alloc] init];
+    
+    NSArray *sortedCellDataArray1 = @[cellData1,
+                                      [self cellDataWithRoomId:@"!b" originServerTs:3],
+                                      [self cellDataWithRoomId:@"!c" originServerTs:1]];
+    NSArray *sortedCellDataArray2 = @[cellData2,
+                                      [self cellDataWithRoomId:@"!d" originServerTs:2]];
+    [orderedIndex setAllCellDataWithSortedArrays:@[sortedCellDataArray1, sortedCellDataArray2, @[]]];
+    
+    XCTAssertEqual(orderedIndex.count, 5);
+    XCTAssertEqual([orderedIndex indexOfCellData:cellData1], 0);
+    XCTAssertEqual([orderedIndex indexOfCellData:cellData2], 1);
+    XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:@"!a" inRecentsDataSource:cellData2.recentsDataSource], 1);
+    XCTAssertEqual([orderedIndex indexOfCellDataWithRoomId:@"!d" inRecentsDataSource:cellData2.recentsDataSource], NSNotFound);
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:4].roomSummary.roomId, @"!c");
+    [self assertInterleavedOrderedIndex:orderedIndex];
+    
+    // Remove the room from the second session only
+    XCTAssertEqual([orderedIndex removeCellData:cellData2], 1);
+    XCTAssertEqual([orderedIndex indexOfCellData:cellData1], 0);
+    XCTAssertEqual([orderedIndex indexOfCellData:cellData2], NSNotFound);
+}
+
+- (void)testKWayMergeOfUnorderedLists
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    
+    [orderedIndex setAllCellDataWithSortedArrays:@[@[[self cellDataWithRoomId:@"!a" originServerTs:1],
+                                                     [self cellDataWithRoomId:@"!b" originServerTs:3]],
+                                                   @[[self cellDataWithRoomId:@"!c" originServerTs:2]]]];
+    
+    // The cell data are sorted anyway
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:0].roomSummary.roomId, @"!b");
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:1].roomSummary.roomId, @"!c");
+    XCTAssertEqualObjects([orderedIndex cellDataAtIndex:2].roomSummary.roomId, @"!a");
+    [self assertOrderedIndex:orderedIndex];
+}
+
+- (void)testPerformanceOfNewMessages
+{
+    MXKRecentsOrderedIndex *orderedIndex = [[MXKRecentsOrderedIndex alloc] init];
+    
+    NSMutableArray *cellDataArray = [NSMutableArray arrayWithCapacity:MXKRECENTSORDEREDINDEXTESTS_ROOMS_COUNT];
+    for (NSUInteger index = 0; index < MXKRECENTSORDEREDINDEXTESTS_ROOMS_COUNT; index++)
+    {
+        [cellDataArray addObject:[self cellDataWithRoomId:[NSString stringWithFormat:@"!room%tu", index] originServerTs:index]];
+    }
+    [orderedIndex setAllCellData:cellDataArray];
+    
+    __block uint64_t originServerTs = MXKRECENTSORDEREDINDEXTESTS_ROOMS_COUNT;
+    [self measureBlock:^{
+        
+        // A new message in 1000 random rooms
+        for (NSUInteger change = 0; change < 1000; change++)
+        {
+            MXKRecentsOrderedIndexTestCellData *cellData = cellDataArray[arc4random_uniform(MXKRECENTSORDEREDINDEXTESTS_ROOMS_COUNT)];
+            NSString *roomId = cellData.roomSummary.roomId;
+            
+            [orderedIndex removeCellDataWithRoomId:roomId];
+            cellData.originServerTs = originServerTs++;
+            XCTAssertEqual([orderedIndex addCellData:cellData], 0);
+        }
+    }];
+}
+
+@end
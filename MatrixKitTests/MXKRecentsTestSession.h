@@ -0,0 +1,126 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "MatrixKit.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A room summary whose last message timestamp is set by the test.
+ */
+@interface MXKRecentsTestRoomSummary : MXRoomSummary
+
+@property (nonatomic) uint64_t originServerTs;
+
+@end
+
+/**
+ A memory store which records the stored room summaries.
+ */
+@interface MXKRecentsTestStore : MXMemoryStore
+
+/**
+ The ids of the rooms whose summary has been stored, in the order of the calls.
+ */
+@property (nonatomic, readonly) NSArray<NSString*> *storedSummaryRoomIds;
+
+@end
+
+/**
+ A Matrix session which serves test room summaries, without any server.
+
+ The changes of its rooms are notified as a real session does.
+ */
+@interface MXKRecentsTestSession : MXSession
+
+/**
+ Create a session with rooms named "!room<index>:matrix.org", the first ones being the most recent.
+
+ @param roomsCount the number of rooms.
+ @return the newly created instance.
+ */
+- (instancetype)initWithRoomsCount:(NSUInteger)roomsCount;
+
+/**
+ Tell whether a server sync is in progress: the session state is then `MXSessionStateSyncInProgress`.
+ Default is NO, the session is running.
+ */
+@property (nonatomic) BOOL syncInProgress;
+
+/**
+ The store of the session.
+ */
+@property (nonatomic, readonly) MXKRecentsTestStore *testStore;
+
+/**
+ Add a room summary built by the test, without notification.
+
+ @param roomSummary the room summary.
+ */
+- (void)addRoomSummary:(MXRoomSummary*)roomSummary;
+
+/**
+ Join a room, and post kMXSessionNewRoomNotification.
+
+ @param roomId the room id.
+ @param originServerTs the timestamp of its last message.
+ */
+- (void)addRoomWithId:(NSString*)roomId originServerTs:(uint64_t)originServerTs;
+
+/**
+ Leave a room, and post kMXSessionDidLeaveRoomNotification.
+
+ @param roomId the room id.
+ */
+- (void)leaveRoomWithId:(NSString*)roomId;
+
+/**
+ Receive a message in a room, and post kMXRoomSummaryDidChangeNotification.
+
+ @param roomId the room id.
+ @param originServerTs the timestamp of the message.
+ */
+- (void)receiveMessageInRoomWithId:(NSString*)roomId originServerTs:(uint64_t)originServerTs;
+
+@end
+
+/**
+ A data source delegate which counts the notifications.
+ */
+@interface MXKRecentsTestDataSourceDelegate : NSObject <MXKDataSourceDelegate>
+
+/**
+ The number of `dataSource:didCellChange:` calls, which reload all the cells.
+ */
+@property (nonatomic) NSUInteger reloadCount;
+
+/**
+ The number of `dataSource:didCellChangeWithChangeSet:` calls, and the last change set.
+ */
+@property (nonatomic) NSUInteger changeSetCount;
+@property (nonatomic, nullable) MXKDataSourceChangeSet *lastChangeSet;
+
+/**
+ Tell whether `dataSource:didCellChangeWithChangeSet:` is implemented. Default is YES.
+ */
+@property (nonatomic) BOOL supportsChangeSets;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,205 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import "MXKRecentsTestSession.h"
+
+#pragma mark - MXKRecentsTestRoomSummary
+
+@implementation MXKRecentsTestRoomSummary
+
+- (MXEvent *)lastMessageEvent
+{
+    MXEvent *event = [[MXEvent alloc] init];
+    event.roomId = self.roomId;
+    event.originServerTs = self.originServerTs;
+    return event;
+}
+
+@end
+
+#pragma mark - MXKRecentsTestStore
+
+@interface MXKRecentsTestStore ()
+{
+    NSMutableArray<NSString*> *storedSummaryRoomIds;
+}
+
+@end
+
+@implementation MXKRecentsTestStore
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        storedSummaryRoomIds = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (NSArray<NSString *> *)storedSummaryRoomIds
+{
+    return storedSummaryRoomIds;
+}
+
+- (void)storeSummaryForRoom:(NSString *)roomId summary:(MXRoomSummary *)summary
+{
+    [storedSummaryRoomIds addObject:roomId];
+    [super storeSummaryForRoom:roomId summary:summary];
+}
+
+@end
+
+#pragma mark - MXKRecentsTestSession
+
+@interface MXKRecentsTestSession ()
+{
+    NSMutableDictionary<NSString*, MXRoomSummary*> *roomSummaries;
+}
+
+@end
+
+@implementation MXKRecentsTestSession
+
+- (instancetype)initWithRoomsCount:(NSUInteger)roomsCount
+{
+    MXCredentials *credentials = [[MXCredentials alloc] initWithHomeServer:@"http://localhost:8008" userId:@"@test:localhost" accessToken:@"token"];
+    MXRestClient *restClient = [[MXRestClient alloc] initWithCredentials:credentials andOnUnrecognizedCertificateBlock:nil];
+    
+    self = [super initWithMatrixRestClient:restClient];
+    if (self)
+    {
+        _testStore = [[MXKRecentsTestStore alloc] init];
+        
+        roomSummaries = [NSMutableDictionary dictionaryWithCapacity:roomsCount];
+        for (NSUInteger index = 0; index < roomsCount; index++)
+        {
+            NSString *roomId = [NSString stringWithFormat:@"!room%tu:matrix.org", index];
+            MXKRecentsTestRoomSummary *roomSummary = [[MXKRecentsTestRoomSummary alloc] initWithRoomId:roomId andMatrixSession:self];
+            roomSummary.originServerTs = roomsCount - index;
+            roomSummaries[roomId] = roomSummary;
+        }
+    }
+    return self;
+}
+
+- (MXSessionState)state
+{
+    return _syncInProgress ? MXSessionStateSyncInProgress : MXSessionStateRunning;
+}
+
+- (id<MXStore>)store
+{
+    return _testStore;
+}
+
+- (NSArray<MXRoom *> *)rooms
+{
+    return @[];
+}
+
+- (NSArray<MXRoomSummary *> *)roomsSummaries
+{
+    return roomSummaries.allValues;
+}
+
+- (MXRoomSummary *)roomSummaryWithRoomId:(NSString *)roomId
+{
+    return roomSummaries[roomId];
+}
+
+- (void)fixRoomsSummariesLastMessage
+{
+}
+
+- (void)addRoomSummary:(MXRoomSummary*)roomSummary
+{
+    roomSummaries[roomSummary.roomId] = roomSummary;
+}
+
+- (void)addRoomWithId:(NSString*)roomId originServerTs:(uint64_t)originServerTs
+{
+    MXKRecentsTestRoomSummary *roomSummary = [[MXKRecentsTestRoomSummary alloc] initWithRoomId:roomId andMatrixSession:self];
+    roomSummary.originServerTs = originServerTs;
+    roomSummaries[roomId] = roomSummary;
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:kMXSessionNewRoomNotification object:self userInfo:@{kMXSessionNotificationRoomIdKey: roomId}];
+}
+
+- (void)leaveRoomWithId:(NSString*)roomId
+{
+    [roomSummaries removeObjectForKey:roomId];
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:kMXSessionDidLeaveRoomNotification object:self userInfo:@{kMXSessionNotificationRoomIdKey: roomId}];
+}
+
+- (void)receiveMessageInRoomWithId:(NSString*)roomId originServerTs:(uint64_t)originServerTs
+{
+    MXKRecentsTestRoomSummary *roomSummary = (MXKRecentsTestRoomSummary*)roomSummaries[roomId];
+    roomSummary.originServerTs = originServerTs;
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:kMXRoomSummaryDidChangeNotification object:roomSummary userInfo:nil];
+}
+
+@end
+
+#pragma mark - MXKRecentsTestDataSourceDelegate
+
+@implementation MXKRecentsTestDataSourceDelegate
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self)
+    {
+        _supportsChangeSets = YES;
+    }
+    return self;
+}
+
+- (BOOL)respondsToSelector:(SEL)aSelector
+{
+    if (aSelector == @selector(dataSource:didCellChangeWithChangeSet:))
+    {
+        return _supportsChangeSets;
+    }
+    return [super respondsToSelector:aSelector];
+}
+
+- (Class<MXKCellRendering>)cellViewClassForCellData:(MXKCellData*)cellData
+{
+    return nil;
+}
+
+- (NSString *)cellReuseIdentifierForCellData:(MXKCellData*)cellData
+{
+    return nil;
+}
+
+- (void)dataSource:(MXKDataSource*)dataSource didCellChange:(id)changes
+{
+    _reloadCount++;
+}
+
+- (void)dataSource:(MXKDataSource*)dataSource didCellChangeWithChangeSet:(MXKDataSourceChangeSet*)changeSet
+{
+    _changeSetCount++;
+    _lastChangeSet = changeSet;
+}
+
+@end
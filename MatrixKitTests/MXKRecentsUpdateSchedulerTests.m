@@ -0,0 +1,244 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKRecentsUpdateScheduler.h"
+#import "MXKRecentsOrderedIndex.h"
+#import "MXKRecentsTestSession.h"
+
+/**
+ The replayed burst: the summary changes of an initial sync over 1000 rooms.
+ */
+#define MXKRECENTSUPDATESCHEDULERTESTS_BURST_CHANGES_COUNT 5000
+#define MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT 1000
+
+/**
+ The number of slices of the burst, which are received on separate run loop iterations.
+ */
+#define MXKRECENTSUPDATESCHEDULERTESTS_BURST_SLICES_COUNT 50
+
+@interface MXKRecentsUpdateSchedulerTests : XCTestCase
+{
+    /**
+     The room ids of the burst, in the order of their changes.
+     */
+    NSMutableArray<NSString*> *burst;
+    
+    MXKRecentsTestSession *session;
+    MXKSessionRecentsDataSource *dataSource;
+    MXKRecentsTestDataSourceDelegate *delegate;
+    
+    /**
+     The ordered index of the data source, and its counters before the burst.
+     */
+    MXKRecentsOrderedIndex *orderedIndex;
+    NSUInteger initialSortCount;
+    NSUInteger initialAddCellDataArrayCount;
+}
+
+@end
+
+@implementation MXKRecentsUpdateSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    // Record a burst where the most active rooms change several times: the room of a change follows a
+    // deterministic pseudo random sequence, skewed towards the first rooms.
+    burst = [NSMutableArray arrayWithCapacity:MXKRECENTSUPDATESCHEDULERTESTS_BURST_CHANGES_COUNT];
+    uint32_t seed = 42;
+    for (NSUInteger change = 0; change < MXKRECENTSUPDATESCHEDULERTESTS_BURST_CHANGES_COUNT; change++)
+    {
+        seed = seed * 1103515245 + 12345;
+        uint32_t random = (seed >> 16) % MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT;
+        uint32_t roomIndex = (random * random) / MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT;
+        [burst addObject:[NSString stringWithFormat:@"!room%u:matrix.org", roomIndex]];
+    }
+    
+    // Load the recents of the rooms
+    session = [[MXKRecentsTestSession alloc] initWithRoomsCount:MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT];
+    delegate = [[MXKRecentsTestDataSourceDelegate alloc] init];
+    dataSource = [[MXKSessionRecentsDataSource alloc] initWithMatrixSession:session];
+    dataSource.delegate = delegate;
+    [dataSource finalizeInitialization];
+    
+    XCTAssertEqual(dataSource.state, MXKDataSourceStateReady);
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT);
+    
+    orderedIndex = [dataSource valueForKey:@"internalCellDataIndex"];
+    initialSortCount = orderedIndex.sortCount;
+    initialAddCellDataArrayCount = orderedIndex.addCellDataArrayCount;
+    delegate.reloadCount = 0;
+    delegate.changeSetCount = 0;
+}
+
+- (void)tearDown
+{
+    [dataSource destroy];
+    dataSource = nil;
+    delegate = nil;
+    session = nil;
+    orderedIndex = nil;
+    burst = nil;
+    
+    [super tearDown];
+}
+
+/**
+ Post the summary changes of a range of the burst. Each change brings a more recent message.
+ */
+- (void)replayBurstInRange:(NSRange)range
+{
+    for (NSUInteger change = range.location; change < NSMaxRange(range); change++)
+    {
+        [session receiveMessageInRoomWithId:burst[change] originServerTs:(MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT + change + 1)];
+    }
+}
+
+/**
+ Check the data source after the whole burst has been applied.
+ */
+- (void)assertBurstApplied
+{
+    XCTAssertEqual(dataSource.updateScheduler.pendingCount, 0);
+    XCTAssertEqual(dataSource.numberOfCells, MXKRECENTSUPDATESCHEDULERTESTS_BURST_ROOMS_COUNT);
+    XCTAssertTrue([dataSource checkCellDataConsistency]);
+    
+    // The room of the last change comes first
+    XCTAssertEqualObjects([dataSource cellDataAtIndex:0].roomSummary.roomId, burst.lastObject);
+    for (NSInteger index = 1; index < dataSource.numberOfCells; index++)
+    {
+        XCTAssertGreaterThanOrEqual([dataSource cellDataAtIndex:index - 1].lastEvent.originServerTs, [dataSource cellDataAtIndex:index].lastEvent.originServerTs);
+    }
+}
+
+- (void)testBurstInASingleRunLoopIteration
+{
+    [self replayBurstInRange:NSMakeRange(0, burst.count)];
+    
+    // Nothing is applied before the end of the window
+    XCTAssertEqual(dataSource.updateScheduler.pendingCount, [NSSet setWithArray:burst].count);
+    XCTAssertEqual(orderedIndex.addCellDataArrayCount, initialAddCellDataArrayCount);
+    XCTAssertEqual(orderedIndex.sortCount, initialSortCount);
+    XCTAssertEqual(delegate.changeSetCount + delegate.reloadCount, 0);
+    
+    [dataSource.updateScheduler flush];
+    
+    // One ordering pass and one notification for the whole burst
+    XCTAssertEqual(dataSource.updateScheduler.updateCount, 1);
+    XCTAssertEqual(orderedIndex.addCellDataArrayCount, initialAddCellDataArrayCount + 1);
+    XCTAssertLessThanOrEqual(orderedIndex.sortCount, initialSortCount + 1);
+    XCTAssertEqual(delegate.changeSetCount, 1);
+    XCTAssertEqual(delegate.reloadCount, 0);
+    
+    [self assertBurstApplied];
+}
+
+/**
+ Replay the burst slice by slice, and end a scheduler window every `slicesByWindow` slices.
+
+ @return the number of windows.
+ */
+- (NSUInteger)replayBurstInSlicesWithWindowsOf:(NSUInteger)slicesByWindow
+{
+    NSUInteger sliceLength = MXKRECENTSUPDATESCHEDULERTESTS_BURST_CHANGES_COUNT / MXKRECENTSUPDATESCHEDULERTESTS_BURST_SLICES_COUNT;
+    NSUInteger windowsCount = 0;
+    
+    for (NSUInteger slice = 0; slice < MXKRECENTSUPDATESCHEDULERTESTS_BURST_SLICES_COUNT; slice++)
+    {
+        [self replayBurstInRange:NSMakeRange(slice * sliceLength, sliceLength)];
+        
+        if ((slice + 1) % slicesByWindow == 0 || slice + 1 == MXKRECENTSUPDATESCHEDULERTESTS_BURST_SLICES_COUNT)
+        {
+            [dataSource.updateScheduler flush];
+            windowsCount++;
+        }
+    }
+    
+    return windowsCount;
+}
+
+- (void)testThroughputWindows
+{
+    // A window spans 10 slices
+    NSUInteger windowsCount = [self replayBurstInSlicesWithWindowsOf:10];
+    XCTAssertEqual(windowsCount, 5);
+    
+    // One ordering pass and one notification by window instead of one by change
+    XCTAssertEqual(dataSource.updateScheduler.updateCount, windowsCount);
+    XCTAssertEqual(orderedIndex.addCellDataArrayCount, initialAddCellDataArrayCount + windowsCount);
+    XCTAssertLessThanOrEqual(orderedIndex.sortCount, initialSortCount + windowsCount);
+    XCTAssertEqual(delegate.changeSetCount, windowsCount);
+    XCTAssertEqual(delegate.reloadCount, 0);
+    
+    [self assertBurstApplied];
+}
+
+- (void)testLatencyWindows
+{
+    // A window by slice, as with one display frame by run loop iteration
+    NSUInteger windowsCount = [self replayBurstInSlicesWithWindowsOf:1];
+    XCTAssertEqual(windowsCount, MXKRECENTSUPDATESCHEDULERTESTS_BURST_SLICES_COUNT);
+    
+    XCTAssertEqual(dataSource.updateScheduler.updateCount, windowsCount);
+    XCTAssertEqual(orderedIndex.addCellDataArrayCount, initialAddCellDataArrayCount + windowsCount);
+    XCTAssertLessThanOrEqual(orderedIndex.sortCount, initialSortCount + windowsCount);
+    XCTAssertEqual(delegate.changeSetCount, windowsCount);
+    XCTAssertEqual(delegate.reloadCount, 0);
+    
+    [self assertBurstApplied];
+}
+
+- (void)testChangesOfOtherSessionsAreIgnored
+{
+    MXKRecentsTestSession *otherSession = [[MXKRecentsTestSession alloc] initWithRoomsCount:10];
+    [otherSession receiveMessageInRoomWithId:@"!room0:matrix.org" originServerTs:UINT32_MAX];
+    
+    XCTAssertEqual(dataSource.updateScheduler.pendingCount, 0);
+}
+
+- (void)testFlushAndCancel
+{
+    NSMutableArray<NSSet<NSString*>*> *updates = [NSMutableArray array];
+    MXKRecentsUpdateScheduler *scheduler = [[MXKRecentsUpdateScheduler alloc] initWithUpdateBlock:^(NSSet<NSString *> *roomIds) {
+        [updates addObject:roomIds];
+    }];
+    
+    [scheduler setNeedsUpdateForRoomId:@"!a:matrix.org"];
+    [scheduler setNeedsUpdateForRoomId:@"!a:matrix.org"];
+    [scheduler setNeedsUpdateForRoomId:@"!b:matrix.org"];
+    [scheduler flush];
+    
+    XCTAssertEqual(updates.count, 1);
+    XCTAssertEqualObjects(updates.firstObject, ([NSSet setWithObjects:@"!a:matrix.org", @"!b:matrix.org", nil]));
+    
+    // Nothing to flush
+    [scheduler flush];
+    XCTAssertEqual(updates.count, 1);
+    
+    [scheduler setNeedsUpdateForRoomId:@"!c:matrix.org"];
+    [scheduler cancel];
+    XCTAssertEqual(scheduler.pendingCount, 0);
+    [scheduler flush];
+    XCTAssertEqual(updates.count, 1);
+    XCTAssertEqual(scheduler.updateCount, 1);
+}
+
+@end
@@ -0,0 +1,165 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+
+// The positions may differ by the rounding of a line height
+#define MXKROOMBUBBLECELLDATAWITHAPPENDINGMODETESTS_ACCURACY 1.0
+
+/**
+ A cell data built directly from a list of components.
+ */
+@interface MXKRoomBubbleCellDataWithAppendingModeTestsCellData : MXKRoomBubbleCellDataWithAppendingMode
+
+- (instancetype)initWithComponents:(NSArray<MXKRoomBubbleComponent*>*)components;
+
+- (void)invalidateComponentsPosition;
+
+@end
+
+@implementation MXKRoomBubbleCellDataWithAppendingModeTestsCellData
+
+- (instancetype)initWithComponents:(NSArray<MXKRoomBubbleComponent*>*)components
+{
+    self = [super init];
+    if (self)
+    {
+        bubbleComponents = [NSMutableArray arrayWithArray:components];
+        self.maxTextViewWidth = 200;
+    }
+    return self;
+}
+
+- (void)invalidateComponentsPosition
+{
+    shouldUpdateComponentsPosition = YES;
+}
+
+@end
+
+@interface MXKRoomBubbleCellDataWithAppendingModeTests : XCTestCase
+{
+    MXKEventFormatter *eventFormatter;
+}
+
+@end
+
+@implementation MXKRoomBubbleCellDataWithAppendingModeTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    eventFormatter = [[MXKEventFormatter alloc] initWithMatrixSession:nil];
+}
+
+- (void)tearDown
+{
+    eventFormatter = nil;
+
+    [super tearDown];
+}
+
+- (MXKRoomBubbleCellDataWithAppendingModeTestsCellData*)cellDataWithComponentCount:(NSUInteger)componentCount
+{
+    NSMutableArray<MXKRoomBubbleComponent*> *components = [NSMutableArray arrayWithCapacity:componentCount];
+
+    for (NSUInteger index = 0; index < componentCount; index++)
+    {
+        MXEvent *event = [[MXEvent alloc] init];
+        event.roomId = @"aRoomId";
+        event.eventId = [NSString stringWithFormat:@"anEventId%tu", index];
+        event.sender = @"@alice:matrix.org";
+        event.wireType = kMXEventTypeStringRoomMessage;
+        event.originServerTs = (uint64_t) ([[NSDate date] timeIntervalSince1970] * 1000) + index;
+
+        // Vary the number of lines of the messages
+        NSString *body = (index % 3) ? @"A short message" : @"A longer message which should be displayed on several lines in the bubble of the cell";
+        event.wireContent = @{
+                              @"msgtype": kMXMessageTypeText,
+                              @"body": body,
+                              };
+
+        MXKRoomBubbleComponent *component = [[MXKRoomBubbleComponent alloc] initWithEvent:event roomState:nil eventFormatter:eventFormatter session:nil];
+        if (component)
+        {
+            [components addObject:component];
+        }
+    }
+
+    return [[MXKRoomBubbleCellDataWithAppendingModeTestsCellData alloc] initWithComponents:components];
+}
+
+- (void)testComponentsPosition
+{
+    MXKRoomBubbleCellDataWithAppendingModeTestsCellData *cellData = [self cellDataWithComponentCount:5];
+    [cellData invalidateComponentsPosition];
+    [cellData prepareBubbleComponentsPosition];
+
+    // Compare with the measurement of each prefix of the bubble text
+    NSMutableAttributedString *attributedString;
+    for (MXKRoomBubbleComponent *component in cellData.bubbleComponents)
+    {
+        XCTAssertNotNil(component.attributedTextMessage);
+
+        if (!attributedString)
+        {
+            attributedString = [[NSMutableAttributedString alloc] initWithAttributedString:component.attributedTextMessage];
+            XCTAssertEqual(component.position.y, MXKROOMBUBBLECELLDATA_TEXTVIEW_DEFAULT_VERTICAL_INSET);
+        }
+        else
+        {
+            [attributedString appendAttributedString:component.attributedTextMessage];
+
+            CGFloat positionY = MXKROOMBUBBLECELLDATA_TEXTVIEW_DEFAULT_VERTICAL_INSET + [cellData rawTextHeight:attributedString] - [cellData rawTextHeight:component.attributedTextMessage];
+            XCTAssertEqualWithAccuracy(component.position.y, positionY, MXKROOMBUBBLECELLDATAWITHAPPENDINGMODETESTS_ACCURACY);
+        }
+
+        [attributedString appendAttributedString:[MXKRoomBubbleCellDataWithAppendingMode messageSeparator]];
+    }
+}
+
+#pragma mark - Benchmarks
+
+- (void)measureComponentsPositionWithComponentCount:(NSUInteger)componentCount
+{
+    MXKRoomBubbleCellDataWithAppendingModeTestsCellData *cellData = [self cellDataWithComponentCount:componentCount];
+    XCTAssertEqual(cellData.bubbleComponents.count, componentCount);
+
+    [self measureBlock:^{
+        [cellData invalidateComponentsPosition];
+        [cellData prepareBubbleComponentsPosition];
+    }];
+}
+
+- (void)testComponentsPositionPerformanceWith5Components
+{
+    [self measureComponentsPositionWithComponentCount:5];
+}
+
+- (void)testComponentsPositionPerformanceWith50Components
+{
+    [self measureComponentsPositionWithComponentCount:50];
+}
+
+- (void)testComponentsPositionPerformanceWith500Components
+{
+    [self measureComponentsPositionWithComponentCount:500];
+}
+
+@end
@@ -0,0 +1,134 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+
+@interface MXKRoomBubbleHeightCacheTests : XCTestCase
+
+@end
+
+@implementation MXKRoomBubbleHeightCacheTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    [MXKRoomBubbleHeightCache resetCounters];
+}
+
+- (void)testKey
+{
+    MXKRoomBubbleHeightCache *heightCache = [[MXKRoomBubbleHeightCache alloc] init];
+    [heightCache setHeight:42 forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge];
+    
+    CGFloat height = 0;
+    XCTAssertTrue([heightCache getHeight:&height forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge]);
+    XCTAssertEqual(height, 42);
+    
+    // Each part of the key matters
+    XCTAssertFalse([heightCache getHeight:&height forCellViewClass:MXKRoomOutgoingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge]);
+    XCTAssertFalse([heightCache getHeight:&height forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:375 contentSizeCategory:UIContentSizeCategoryLarge]);
+    XCTAssertFalse([heightCache getHeight:&height forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryExtraLarge]);
+    
+    // A size transition back to a previous width hits the cache
+    [heightCache setHeight:30 forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:375 contentSizeCategory:UIContentSizeCategoryLarge];
+    XCTAssertTrue([heightCache getHeight:&height forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge]);
+    XCTAssertEqual(height, 42);
+    
+    XCTAssertEqual(MXKRoomBubbleHeightCache.hitCount, 2);
+    XCTAssertEqual(MXKRoomBubbleHeightCache.missCount, 3);
+    
+    [heightCache removeAllHeights];
+    XCTAssertFalse([heightCache getHeight:&height forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge]);
+    
+    [MXKRoomBubbleHeightCache resetCounters];
+    XCTAssertEqual(MXKRoomBubbleHeightCache.hitCount, 0);
+    XCTAssertEqual(MXKRoomBubbleHeightCache.missCount, 0);
+}
+
+/**
+ Check that a change of the cell data removes its cached heights.
+ */
+- (void)assertChange:(void (^)(MXKRoomBubbleCellData *cellData))change ofCellData:(MXKRoomBubbleCellData*)cellData invalidates:(BOOL)invalidates
+{
+    [cellData.heightCache setHeight:42 forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge];
+    
+    change(cellData);
+    
+    BOOL isCached = [cellData.heightCache getHeight:NULL forCellViewClass:MXKRoomIncomingTextMsgBubbleCell.class withMaximumWidth:320 contentSizeCategory:UIContentSizeCategoryLarge];
+    XCTAssertEqual(isCached, !invalidates);
+}
+
+- (void)testInvalidationByLayoutFlags
+{
+    MXKRoomBubbleCellData *cellData = [[MXKRoomBubbleCellData alloc] init];
+    XCTAssertNotNil(cellData.heightCache);
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.isPaginationFirstBubble = YES;
+    } ofCellData:cellData invalidates:YES];
+    
+    // Setting the same value keeps the heights
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.isPaginationFirstBubble = YES;
+    } ofCellData:cellData invalidates:NO];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.shouldHideSenderInformation = YES;
+    } ofCellData:cellData invalidates:YES];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.collapsed = YES;
+    } ofCellData:cellData invalidates:YES];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.collapsedAttributedTextMessage = [[NSAttributedString alloc] initWithString:@"3 membership changes"];
+    } ofCellData:cellData invalidates:YES];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.attributedTextMessage = [[NSAttributedString alloc] initWithString:@"Hello"];
+    } ofCellData:cellData invalidates:YES];
+}
+
+- (void)testInvalidationByNeighbours
+{
+    MXKRoomBubbleCellData *cellData = [[MXKRoomBubbleCellData alloc] init];
+    MXKRoomBubbleCellData *previousCellData = [[MXKRoomBubbleCellData alloc] init];
+    MXKRoomBubbleCellData *nextCellData = [[MXKRoomBubbleCellData alloc] init];
+    
+    // The cell becomes the head of a collapsable series, then is linked to a previous one, as the data source does
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.nextCollapsableCellData = nextCellData;
+    } ofCellData:cellData invalidates:YES];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.prevCollapsableCellData = previousCellData;
+    } ofCellData:cellData invalidates:YES];
+    
+    // The removal of the previous cell data makes it the head again
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.prevCollapsableCellData = nil;
+    } ofCellData:cellData invalidates:YES];
+    
+    [self assertChange:^(MXKRoomBubbleCellData *cellData) {
+        cellData.nextCollapsableCellData = nextCellData;
+    } ofCellData:cellData invalidates:NO];
+}
+
+@end
@@ -0,0 +1,299 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKRoomBubblePositionIndex.h"
+#import "MXKRecentsTestSession.h"
+
+#define MXKROOMBUBBLEPOSITIONINDEXTESTS_BUBBLES_COUNT 10000
+
+@interface MXKRoomDataSource (MXKRoomBubblePositionIndexTests)
+
+- (void)queueEventForProcessing:(MXEvent*)event withRoomState:(MXRoomState*)roomState direction:(MXTimelineDirection)direction;
+- (void)processQueuedEvents:(void (^)(NSUInteger addedHistoryCellNb, NSUInteger addedLiveCellNb))onComplete;
+
+@end
+
+/**
+ A room data source which processes the events queued by the test, without any room timeline.
+ */
+@interface MXKRoomBubblePositionIndexTestsDataSource : MXKRoomDataSource
+
+- (void)becomeReady;
+
+@end
+
+@implementation MXKRoomBubblePositionIndexTestsDataSource
+
+- (void)becomeReady
+{
+    state = MXKDataSourceStateReady;
+}
+
+@end
+
+@interface MXKRoomBubblePositionIndexTests : XCTestCase
+{
+    NSMutableArray *bubbles;
+}
+
+@end
+
+@implementation MXKRoomBubblePositionIndexTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    // Synthetic bubbles
+    bubbles = [NSMutableArray arrayWithCapacity:MXKROOMBUBBLEPOSITIONINDEXTESTS_BUBBLES_COUNT];
+    for (NSUInteger index = 0; index < MXKROOMBUBBLEPOSITIONINDEXTESTS_BUBBLES_COUNT; index++)
+    {
+        [bubbles addObject:[[NSObject alloc] init]];
+    }
+}
+
+- (void)tearDown
+{
+    bubbles = nil;
+    [super tearDown];
+}
+
+- (void)assertPositionIndex:(MXKRoomBubblePositionIndex*)positionIndex describesCellDatas:(NSArray*)cellDatas
+{
+    XCTAssertEqual(positionIndex.count, cellDatas.count);
+    [cellDatas enumerateObjectsUsingBlock:^(id cellData, NSUInteger index, BOOL *stop) {
+        XCTAssertEqual([positionIndex indexOfCellData:cellData], index);
+    }];
+}
+
+- (void)testPrependAndAppend
+{
+    NSMutableArray *cellDatas = [NSMutableArray array];
+    MXKRoomBubblePositionIndex *positionIndex = [[MXKRoomBubblePositionIndex alloc] init];
+
+    // Mimic back and forward paginations
+    for (NSUInteger index = 0; index < 100; index++)
+    {
+        id cellData = bubbles[index];
+        if (index % 2)
+        {
+            [cellDatas insertObject:cellData atIndex:0];
+            [positionIndex insertCellData:cellData atIndex:0];
+        }
+        else
+        {
+            [cellDatas addObject:cellData];
+            [positionIndex insertCellData:cellData atIndex:positionIndex.count];
+        }
+    }
+
+    [self assertPositionIndex:positionIndex describesCellDatas:cellDatas];
+    XCTAssertEqual([positionIndex indexOfCellData:bubbles.lastObject], NSNotFound);
+}
+
+- (void)testInsertAndRemoveInTheMiddle
+{
+    NSMutableArray *cellDatas = [NSMutableArray arrayWithArray:[bubbles subarrayWithRange:NSMakeRange(0, 100)]];
+    MXKRoomBubblePositionIndex *positionIndex = [[MXKRoomBubblePositionIndex alloc] initWithCellDatas:cellDatas];
+
+    // Remove the first, the last and a middle bubble
+    for (id cellData in @[cellDatas.firstObject, cellDatas.lastObject, cellDatas[42]])
+    {
+        [cellDatas removeObject:cellData];
+        [positionIndex removeCellData:cellData];
+    }
+    [self assertPositionIndex:positionIndex describesCellDatas:cellDatas];
+
+    // Split a bubble
+    [cellDatas insertObject:bubbles[200] atIndex:10];
+    [positionIndex insertCellData:bubbles[200] atIndex:10];
+    [cellDatas insertObject:bubbles[201] atIndex:11];
+    [positionIndex insertCellData:bubbles[201] atIndex:11];
+    [self assertPositionIndex:positionIndex describesCellDatas:cellDatas];
+
+    // A copy must not be impacted by changes on the original
+    MXKRoomBubblePositionIndex *positionIndexCopy = [positionIndex copy];
+    [positionIndex removeCellData:cellDatas.firstObject];
+    [self assertPositionIndex:positionIndexCopy describesCellDatas:cellDatas];
+}
+
+- (void)testRandomUpdates
+{
+    NSMutableArray *cellDatas = [NSMutableArray arrayWithArray:[bubbles subarrayWithRange:NSMakeRange(0, 100)]];
+    MXKRoomBubblePositionIndex *positionIndex = [[MXKRoomBubblePositionIndex alloc] initWithCellDatas:cellDatas];
+    
+    // Insert and remove bubbles at random positions, on both halves of the list
+    srand48(42);
+    for (NSUInteger index = 100; index < 1000; index++)
+    {
+        NSUInteger position = (NSUInteger)(drand48() * (cellDatas.count + 1));
+        [cellDatas insertObject:bubbles[index] atIndex:position];
+        [positionIndex insertCellData:bubbles[index] atIndex:position];
+        
+        if (index % 3 == 0)
+        {
+            id cellData = cellDatas[(NSUInteger)(drand48() * cellDatas.count)];
+            [cellDatas removeObject:cellData];
+            [positionIndex removeCellData:cellData];
+        }
+    }
+    
+    [self assertPositionIndex:positionIndex describesCellDatas:cellDatas];
+}
+
+- (void)processEvents:(NSArray<MXEvent*>*)events direction:(MXTimelineDirection)direction withDataSource:(MXKRoomDataSource*)dataSource
+{
+    for (MXEvent *event in events)
+    {
+        [dataSource queueEventForProcessing:event withRoomState:nil direction:direction];
+    }
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Processing"];
+    [dataSource processQueuedEvents:^(NSUInteger addedHistoryCellNb, NSUInteger addedLiveCellNb) {
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+- (void)assertPositionsOfEvents:(NSArray<MXEvent*>*)events inDataSource:(MXKRoomDataSource*)dataSource
+{
+    // The position index maintained by the data source must describe its bubbles without being rebuilt
+    MXKRoomBubblePositionIndex *positionIndex = [dataSource valueForKey:@"bubblesPositionIndex"];
+    NSArray *cellDatas = [dataSource valueForKey:@"bubbles"];
+    XCTAssertEqual(cellDatas.count, events.count);
+    [self assertPositionIndex:positionIndex describesCellDatas:cellDatas];
+    
+    for (MXEvent *event in events)
+    {
+        NSInteger index = [dataSource indexOfCellDataWithEventId:event.eventId];
+        XCTAssertNotEqual(index, NSNotFound);
+        XCTAssertEqual([dataSource cellDataAtIndex:index], [dataSource cellDataOfEventWithEventId:event.eventId]);
+    }
+}
+
+- (NSArray<MXEvent*>*)messageEventsWithCount:(NSUInteger)count forDataSource:(MXKRoomDataSource*)dataSource
+{
+    NSMutableArray<MXEvent*> *events = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        MXEvent *event = [[MXEvent alloc] init];
+        event.roomId = dataSource.roomId;
+        event.eventId = [NSString stringWithFormat:@"$event%tu", index];
+        event.sender = [NSString stringWithFormat:@"@user%tu:matrix.org", index % 3];
+        event.wireType = kMXEventTypeStringRoomMessage;
+        event.originServerTs = 1600000000000 + index;
+        event.wireContent = @{
+                              @"msgtype": kMXMessageTypeText,
+                              @"body": [NSString stringWithFormat:@"Message %tu", index]
+                              };
+        [events addObject:event];
+    }
+    return events;
+}
+
+- (void)testRoomDataSourceUpdates
+{
+    MXKRecentsTestSession *session = [[MXKRecentsTestSession alloc] initWithRoomsCount:0];
+    MXKRoomBubblePositionIndexTestsDataSource *dataSource = [[MXKRoomBubblePositionIndexTestsDataSource alloc] initWithRoomId:@"!room:matrix.org" andMatrixSession:session];
+    [dataSource becomeReady];
+    
+    // One bubble per event: the default cell data does not concatenate events
+    NSArray<MXEvent*> *events = [self messageEventsWithCount:30 forDataSource:dataSource];
+    
+    // Live events, then a back pagination
+    NSMutableArray<MXEvent*> *displayedEvents = [NSMutableArray arrayWithArray:[events subarrayWithRange:NSMakeRange(10, 20)]];
+    [self processEvents:displayedEvents direction:MXTimelineDirectionForwards withDataSource:dataSource];
+    [self processEvents:[events subarrayWithRange:NSMakeRange(0, 10)].reverseObjectEnumerator.allObjects direction:MXTimelineDirectionBackwards withDataSource:dataSource];
+    [displayedEvents insertObjects:[events subarrayWithRange:NSMakeRange(0, 10)] atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 10)]];
+    [self assertPositionsOfEvents:displayedEvents inDataSource:dataSource];
+    
+    // Remove bubbles in the middle, at the start and at the end of the timeline
+    for (MXEvent *event in @[events[7], events[21], events[0], events[29]])
+    {
+        [dataSource removeEventWithEventId:event.eventId];
+        [displayedEvents removeObject:event];
+        XCTAssertEqual([dataSource indexOfCellDataWithEventId:event.eventId], NSNotFound);
+    }
+    [self assertPositionsOfEvents:displayedEvents inDataSource:dataSource];
+    
+    [dataSource destroy];
+}
+
+- (void)testRoomDataSourceRemovalChangeSets
+{
+    MXKRecentsTestSession *session = [[MXKRecentsTestSession alloc] initWithRoomsCount:0];
+    MXKRoomBubblePositionIndexTestsDataSource *dataSource = [[MXKRoomBubblePositionIndexTestsDataSource alloc] initWithRoomId:@"!room:matrix.org" andMatrixSession:session];
+    [dataSource becomeReady];
+    
+    NSArray<MXEvent*> *events = [self messageEventsWithCount:5 forDataSource:dataSource];
+    [self processEvents:events direction:MXTimelineDirectionForwards withDataSource:dataSource];
+    
+    MXKRecentsTestDataSourceDelegate *delegate = [[MXKRecentsTestDataSourceDelegate alloc] init];
+    dataSource.delegate = delegate;
+    
+    // Removing a bubble must not reload the whole timeline
+    [dataSource removeEventWithEventId:events[2].eventId];
+    XCTAssertEqual(delegate.reloadCount, 0);
+    XCTAssertEqual(delegate.changeSetCount, 1);
+    XCTAssertEqualObjects(delegate.lastChangeSet.deletedIndexPaths, @[[NSIndexPath indexPathForRow:2 inSection:0]]);
+    XCTAssertEqualObjects(delegate.lastChangeSet.updatedIndexPaths, @[[NSIndexPath indexPathForRow:3 inSection:0]]);
+    XCTAssertTrue([delegate.lastChangeSet isValidForNumberOfRows:5 newNumberOfRows:[[dataSource valueForKey:@"bubbles"] count]]);
+    
+    // The new first bubble is updated when the first one is removed
+    [dataSource removeEventWithEventId:events[0].eventId];
+    XCTAssertEqual(delegate.reloadCount, 0);
+    XCTAssertEqual(delegate.changeSetCount, 2);
+    XCTAssertEqualObjects(delegate.lastChangeSet.deletedIndexPaths, @[[NSIndexPath indexPathForRow:0 inSection:0]]);
+    XCTAssertEqualObjects(delegate.lastChangeSet.updatedIndexPaths, @[[NSIndexPath indexPathForRow:1 inSection:0]]);
+    
+    // Collapsing a bubble only updates its series
+    id<MXKRoomBubbleCellDataStoring> cellData = [dataSource cellDataOfEventWithEventId:events[4].eventId];
+    [dataSource collapseRoomBubble:cellData collapsed:YES];
+    XCTAssertEqual(delegate.reloadCount, 0);
+    XCTAssertEqual(delegate.changeSetCount, 3);
+    XCTAssertEqualObjects(delegate.lastChangeSet.updatedIndexPaths, @[[NSIndexPath indexPathForRow:2 inSection:0]]);
+    XCTAssertEqual(delegate.lastChangeSet.deletedIndexPaths.count, 0);
+    
+    [dataSource destroy];
+}
+
+- (void)testLookupPerformance
+{
+    MXKRoomBubblePositionIndex *positionIndex = [[MXKRoomBubblePositionIndex alloc] initWithCellDatas:bubbles];
+
+    [self measureBlock:^{
+        for (id cellData in self->bubbles)
+        {
+            [positionIndex indexOfCellData:cellData];
+        }
+    }];
+}
+
+- (void)testLinearLookupPerformance
+{
+    // Reference: the linear scan that the position index replaces
+    [self measureBlock:^{
+        for (id cellData in self->bubbles)
+        {
+            [self->bubbles indexOfObject:cellData];
+        }
+    }];
+}
+
+@end
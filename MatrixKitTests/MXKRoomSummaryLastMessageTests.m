@@ -0,0 +1,222 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKRecentsTestSession.h"
+
+@interface MXKAccount (MXKRoomSummaryLastMessageTests)
+
+- (void)onDateTimeFormatUpdate;
+
+@end
+
+@interface MXKRoomSummaryLastMessageTests : XCTestCase
+{
+    MXKRecentsTestSession *session;
+    MXKEventFormatter *eventFormatter;
+}
+
+@end
+
+@implementation MXKRoomSummaryLastMessageTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    session = [[MXKRecentsTestSession alloc] initWithRoomsCount:0];
+    
+    eventFormatter = [[MXKEventFormatter alloc] initWithMatrixSession:session];
+    eventFormatter.renderLastMessageOnDemand = YES;
+    session.roomSummaryUpdateDelegate = eventFormatter;
+}
+
+- (void)tearDown
+{
+    session.roomSummaryUpdateDelegate = nil;
+    eventFormatter = nil;
+    session = nil;
+    
+    [super tearDown];
+}
+
+- (MXEvent*)messageEventInRoom:(NSString*)roomId withBody:(NSString*)body
+{
+    MXEvent *event = [[MXEvent alloc] init];
+    event.roomId = roomId;
+    event.eventId = [NSString stringWithFormat:@"$%@", [NSUUID UUID].UUIDString];
+    event.sender = @"@alice:matrix.org";
+    event.wireType = kMXEventTypeStringRoomMessage;
+    event.originServerTs = (uint64_t) ([[NSDate date] timeIntervalSince1970] * 1000);
+    event.wireContent = @{
+                          @"msgtype": kMXMessageTypeText,
+                          @"body": body,
+                          };
+    return event;
+}
+
+// A summary whose preview rendering has been deferred
+- (MXRoomSummary*)deferredRoomSummaryWithId:(NSString*)roomId senderDisplayName:(NSString*)senderDisplayName
+{
+    MXRoomSummary *summary = [[MXRoomSummary alloc] initWithRoomId:roomId andMatrixSession:session];
+    summary.lastMessageEvent = [self messageEventInRoom:roomId withBody:@"Hello"];
+    summary.lastMessageString = @"Hello";
+    summary.lastMessageAttributedString = nil;
+    summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] = @(YES);
+    if (senderDisplayName)
+    {
+        summary.lastMessageOthers[@"mxkLastMessageSenderDisplayName"] = senderDisplayName;
+    }
+    [session addRoomSummary:summary];
+    return summary;
+}
+
+#pragma mark - Summary update
+
+- (void)testUpdateDefersTheRendering
+{
+    NSString *roomId = @"!room:matrix.org";
+    MXRoomSummary *summary = [[MXRoomSummary alloc] initWithRoomId:roomId andMatrixSession:session];
+    [session addRoomSummary:summary];
+    
+    // A preview rendered before
+    summary.lastMessageAttributedString = [[NSAttributedString alloc] initWithString:@"Previous message"];
+    summary.lastMessageOthers[@"lastEventDate"] = @"Yesterday";
+    
+    MXEvent *event = [self messageEventInRoom:roomId withBody:@"Hello"];
+    XCTAssertTrue([eventFormatter session:session updateRoomSummary:summary withLastEvent:event eventState:nil roomState:nil]);
+    
+    // Only the plain string is computed
+    XCTAssertEqualObjects(summary.lastMessageEvent.eventId, event.eventId);
+    XCTAssertTrue(summary.lastMessageString.length);
+    XCTAssertNil(summary.lastMessageAttributedString);
+    XCTAssertNil(summary.lastMessageOthers[@"lastEventDate"]);
+    XCTAssertTrue([summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] boolValue]);
+    
+    XCTAssertEqual(eventFormatter.deferredLastMessagesCount, 1);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 0);
+}
+
+- (void)testUpdateRendersWhenNotDeferred
+{
+    eventFormatter.renderLastMessageOnDemand = NO;
+    
+    NSString *roomId = @"!room:matrix.org";
+    MXRoomSummary *summary = [[MXRoomSummary alloc] initWithRoomId:roomId andMatrixSession:session];
+    [session addRoomSummary:summary];
+    
+    MXEvent *event = [self messageEventInRoom:roomId withBody:@"Hello"];
+    XCTAssertTrue([eventFormatter session:session updateRoomSummary:summary withLastEvent:event eventState:nil roomState:nil]);
+    
+    XCTAssertNotNil(summary.lastMessageAttributedString);
+    XCTAssertNotNil(summary.lastMessageOthers[@"lastEventDate"]);
+    XCTAssertNil(summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"]);
+    
+    XCTAssertEqual(eventFormatter.deferredLastMessagesCount, 0);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+    
+    // There is nothing to render on demand
+    XCTAssertFalse([eventFormatter renderLastMessageIfNeededForRoomSummary:summary]);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+}
+
+#pragma mark - On demand rendering
+
+- (void)testFirstReadRendersThePreview
+{
+    MXRoomSummary *summary = [self deferredRoomSummaryWithId:@"!room:matrix.org" senderDisplayName:@"Alice"];
+    
+    MXKRecentCellData *cellData = [[MXKRecentCellData alloc] initWithRoomSummary:summary andRecentListDataSource:nil];
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 0, @"The cell data creation must not render the preview");
+    
+    NSAttributedString *attributedTextMessage = cellData.lastEventAttributedTextMessage;
+    XCTAssertEqualObjects(attributedTextMessage.string, @"Alice: Hello");
+    XCTAssertEqual(summary.lastMessageAttributedString, attributedTextMessage);
+    XCTAssertNotNil(cellData.lastEventDate);
+    XCTAssertNil(summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"]);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+    
+    // The next reads use the rendered preview
+    XCTAssertEqual(cellData.lastEventAttributedTextMessage, attributedTextMessage);
+    XCTAssertNotNil(cellData.lastEventDate);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+}
+
+- (void)testDateReadRendersThePreview
+{
+    MXRoomSummary *summary = [self deferredRoomSummaryWithId:@"!room:matrix.org" senderDisplayName:@"Alice"];
+    
+    MXKRecentCellData *cellData = [[MXKRecentCellData alloc] initWithRoomSummary:summary andRecentListDataSource:nil];
+    XCTAssertNotNil(cellData.lastEventDate);
+    XCTAssertNotNil(summary.lastMessageAttributedString);
+    XCTAssertNil(summary.lastMessageOthers[@"mxkLastMessageNeedsRendering"]);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+}
+
+- (void)testSenderPrefixFallback
+{
+    // Without display name, the preview is prefixed with the sender id
+    MXRoomSummary *summary = [self deferredRoomSummaryWithId:@"!room:matrix.org" senderDisplayName:nil];
+    
+    XCTAssertTrue([eventFormatter renderLastMessageIfNeededForRoomSummary:summary]);
+    XCTAssertEqualObjects(summary.lastMessageAttributedString.string, @"@alice:matrix.org: Hello");
+}
+
+- (void)testRenderingIsStored
+{
+    MXRoomSummary *summary = [self deferredRoomSummaryWithId:@"!room:matrix.org" senderDisplayName:@"Alice"];
+    
+    XCTAssertTrue([eventFormatter renderLastMessageIfNeededForRoomSummary:summary]);
+    XCTAssertEqualObjects(session.testStore.storedSummaryRoomIds, @[@"!room:matrix.org"]);
+    
+    // Nothing is rendered, nor stored, the second time
+    XCTAssertFalse([eventFormatter renderLastMessageIfNeededForRoomSummary:summary]);
+    XCTAssertEqualObjects(session.testStore.storedSummaryRoomIds, @[@"!room:matrix.org"]);
+    XCTAssertEqual(eventFormatter.renderedLastMessagesCount, 1);
+}
+
+#pragma mark - Date and time format change
+
+- (void)testTimeChangeSkipsDeferredSummaries
+{
+    MXRoomSummary *deferredSummary = [self deferredRoomSummaryWithId:@"!deferred:matrix.org" senderDisplayName:@"Alice"];
+    
+    MXRoomSummary *renderedSummary = [self deferredRoomSummaryWithId:@"!rendered:matrix.org" senderDisplayName:@"Alice"];
+    [eventFormatter renderLastMessageIfNeededForRoomSummary:renderedSummary];
+    NSUInteger storedSummariesCount = session.testStore.storedSummaryRoomIds.count;
+    
+    MXCredentials *credentials = [[MXCredentials alloc] initWithHomeServer:@"http://localhost:8008" userId:@"@test:localhost" accessToken:@"token"];
+    MXKAccount *account = [[MXKAccount alloc] initWithCredentials:credentials];
+    [account setValue:session forKey:@"mxSession"];
+    
+    [account onDateTimeFormatUpdate];
+    
+    // Only the rendered summary is updated
+    XCTAssertNotNil(renderedSummary.lastMessageOthers[@"lastEventDate"]);
+    XCTAssertNil(deferredSummary.lastMessageOthers[@"lastEventDate"]);
+    XCTAssertTrue([deferredSummary.lastMessageOthers[@"mxkLastMessageNeedsRendering"] boolValue]);
+    
+    NSArray<NSString*> *storedSummaryRoomIds = [session.testStore.storedSummaryRoomIds subarrayWithRange:NSMakeRange(storedSummariesCount, session.testStore.storedSummaryRoomIds.count - storedSummariesCount)];
+    XCTAssertEqualObjects(storedSummaryRoomIds, @[@"!rendered:matrix.org"]);
+    
+    // The account must not close the test session
+    [account setValue:nil forKey:@"mxSession"];
+}
+
+@end
@@ -0,0 +1,169 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+#import "MXKTextMeasurementEngine.h"
+
+// The measurements may differ by the rounding of a line height
+#define MXKTEXTMEASUREMENTENGINETESTS_ACCURACY 1.0
+
+@interface MXKTextMeasurementEngineTests : XCTestCase
+{
+    MXKEventFormatter *eventFormatter;
+    MXEvent *anEvent;
+
+    /**
+     The formatted messages to measure.
+     */
+    NSArray<NSAttributedString*> *corpus;
+}
+
+@end
+
+@implementation MXKTextMeasurementEngineTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    eventFormatter = [[MXKEventFormatter alloc] initWithMatrixSession:nil];
+    eventFormatter.treatMatrixUserIdAsLink = YES;
+    eventFormatter.treatMatrixRoomIdAsLink = YES;
+    eventFormatter.treatMatrixRoomAliasAsLink = YES;
+    eventFormatter.treatMatrixEventIdAsLink = YES;
+
+    anEvent = [[MXEvent alloc] init];
+    anEvent.roomId = @"aRoomId";
+    anEvent.eventId = @"anEventId";
+    anEvent.wireType = kMXEventTypeStringRoomMessage;
+    anEvent.originServerTs = (uint64_t) ([[NSDate date] timeIntervalSince1970] * 1000);
+    anEvent.wireContent = @{
+                            @"msgtype": kMXMessageTypeText,
+                            @"body": @"deded",
+                            };
+
+    NSMutableArray *messages = [NSMutableArray array];
+
+    NSArray<NSString*> *strings = @[
+                                    @"Hello",
+                                    @"A message long enough to be displayed on several lines in a narrow bubble, with some punctuation, numbers 1234567890 and a link https://matrix.org",
+                                    @"@bob:matrix.org has joined #matrix:matrix.org",
+                                    @"Line 1\nLine 2\n\nLine 4\n",
+                                    @"😀😃😄😁😆😅😂🤣☺️😊",
+                                    @"مرحبا بالعالم - Hello world - こんにちは世界",
+                                    @"Averyveryveryveryveryveryveryveryveryveryveryveryveryveryverylongwordwithoutanyspace",
+                                    ];
+    for (NSString *string in strings)
+    {
+        [messages addObject:[eventFormatter renderString:string forEvent:anEvent]];
+    }
+
+    NSArray<NSString*> *htmlStrings = @[
+                                        @"<b>Bold</b> <i>italic</i> <code>code</code>",
+                                        @"<mx-reply><blockquote>In reply to a message</blockquote></mx-reply>The reply",
+                                        @"<blockquote><p>A quote</p><p>on two paragraphs</p></blockquote>",
+                                        @"<ul><li>one</li><li>two</li><li>three</li></ul>",
+                                        @"<pre><code>let code = \"block\";\nprint(code)</code></pre>",
+                                        @"<h1>Title</h1><p>Some text with a <a href=\"https://matrix.org\">link</a></p>",
+                                        ];
+    for (NSString *htmlString in htmlStrings)
+    {
+        NSAttributedString *message = [eventFormatter renderHTMLString:htmlString forEvent:anEvent withRoomState:nil];
+        if (message)
+        {
+            [messages addObject:message];
+        }
+    }
+
+    corpus = messages;
+}
+
+- (void)tearDown
+{
+    corpus = nil;
+    eventFormatter = nil;
+    anEvent = nil;
+
+    [super tearDown];
+}
+
+- (void)assertParityForTextContainerInset:(UIEdgeInsets)textContainerInset
+{
+    for (NSNumber *maxWidth in @[@(120), @(200), @(320)])
+    {
+        for (NSAttributedString *message in corpus)
+        {
+            CGSize referenceSize = [MXKTextMeasurementEngine textViewSizeOfAttributedText:message withMaximumWidth:maxWidth.floatValue textContainerInset:textContainerInset];
+            CGSize size = [MXKTextMeasurementEngine sizeOfAttributedText:message withMaximumWidth:maxWidth.floatValue textContainerInset:textContainerInset];
+
+            XCTAssertEqualWithAccuracy(size.width, referenceSize.width, MXKTEXTMEASUREMENTENGINETESTS_ACCURACY, @"Width mismatch for \"%@\" at %@", message.string, maxWidth);
+            XCTAssertEqualWithAccuracy(size.height, referenceSize.height, MXKTEXTMEASUREMENTENGINETESTS_ACCURACY, @"Height mismatch for \"%@\" at %@", message.string, maxWidth);
+        }
+    }
+}
+
+- (void)testParityWithTextView
+{
+    [self assertParityForTextContainerInset:kMXKTextMeasurementEngineTextViewTextContainerInset];
+}
+
+- (void)testParityWithTextViewWithoutInset
+{
+    [self assertParityForTextContainerInset:UIEdgeInsetsZero];
+}
+
+- (void)testEmptyText
+{
+    CGSize size = [MXKTextMeasurementEngine sizeOfAttributedText:[[NSAttributedString alloc] init] withMaximumWidth:200 textContainerInset:kMXKTextMeasurementEngineTextViewTextContainerInset];
+    XCTAssertTrue(CGSizeEqualToSize(size, CGSizeZero));
+}
+
+- (void)testMeasurementOffMainThread
+{
+    // Compute the references on the main thread
+    NSMutableArray<NSValue*> *referenceSizes = [NSMutableArray array];
+    for (NSAttributedString *message in corpus)
+    {
+        CGSize size = [MXKTextMeasurementEngine sizeOfAttributedText:message withMaximumWidth:200 textContainerInset:kMXKTextMeasurementEngineTextViewTextContainerInset];
+        [referenceSizes addObject:[NSValue valueWithCGSize:size]];
+    }
+
+    // Measure the corpus concurrently on background threads
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Background measurement"];
+    expectation.expectedFulfillmentCount = 4;
+
+    NSArray<NSAttributedString*> *messages = corpus;
+    for (NSUInteger index = 0; index < expectation.expectedFulfillmentCount; index++)
+    {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+
+            XCTAssertFalse([NSThread isMainThread]);
+
+            [messages enumerateObjectsUsingBlock:^(NSAttributedString *message, NSUInteger messageIndex, BOOL *stop) {
+                CGSize size = [MXKTextMeasurementEngine sizeOfAttributedText:message withMaximumWidth:200 textContainerInset:kMXKTextMeasurementEngineTextViewTextContainerInset];
+                XCTAssertTrue(CGSizeEqualToSize(size, referenceSizes[messageIndex].CGSizeValue));
+            }];
+
+            [expectation fulfill];
+        });
+    }
+
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+@end
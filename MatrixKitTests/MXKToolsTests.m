@@ -0,0 +1,217 @@
+/*
+ Copyright 2021 The Matrix.org Foundation C.I.C
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#import <XCTest/XCTest.h>
+
+#import "MatrixKit.h"
+
+#define MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK (MXKTOOLS_USER_IDENTIFIER_BITWISE | MXKTOOLS_ROOM_IDENTIFIER_BITWISE | MXKTOOLS_ROOM_ALIAS_BITWISE | MXKTOOLS_EVENT_IDENTIFIER_BITWISE | MXKTOOLS_GROUP_IDENTIFIER_BITWISE)
+
+@interface MXKToolsTests : XCTestCase
+
+@end
+
+@implementation MXKToolsTests
+
+#pragma mark - Multi pass linkifier
+
+/**
+ The linkifier used before the single pass one: one regex pass per type of matrix identifier.
+ */
+- (NSAttributedString*)multiPassCreateLinksInAttributedString:(NSAttributedString*)attributedString
+{
+    NSArray<NSString*> *patterns = @[kMXToolsRegexStringForMatrixUserIdentifier, kMXToolsRegexStringForMatrixRoomIdentifier, kMXToolsRegexStringForMatrixRoomAlias, kMXToolsRegexStringForMatrixEventIdentifier, kMXToolsRegexStringForMatrixGroupIdentifier];
+    NSRegularExpression *httpLinksRegex = [NSRegularExpression regularExpressionWithPattern:@"(?i)\\b(https?://.*)\\b" options:NSRegularExpressionCaseInsensitive error:nil];
+
+    NSMutableAttributedString *mutableAttributedString = [[NSMutableAttributedString alloc] initWithAttributedString:attributedString];
+
+    for (NSString *pattern in patterns)
+    {
+        NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:pattern options:NSRegularExpressionCaseInsensitive error:nil];
+        __block NSArray *linkMatches;
+
+        [regex enumerateMatchesInString:attributedString.string options:0 range:NSMakeRange(0, attributedString.length) usingBlock:^(NSTextCheckingResult *match, NSMatchingFlags flags, BOOL *stop) {
+
+            __block BOOL hasAlreadyLink = NO;
+            [attributedString enumerateAttributesInRange:match.range options:0 usingBlock:^(NSDictionary<NSString *,id> *attrs, NSRange range, BOOL *stop) {
+                if (attrs[NSLinkAttributeName])
+                {
+                    hasAlreadyLink = YES;
+                    *stop = YES;
+                }
+            }];
+
+            if (!hasAlreadyLink)
+            {
+                if (!linkMatches)
+                {
+                    linkMatches = [httpLinksRegex matchesInString:attributedString.string options:0 range:NSMakeRange(0, attributedString.length)];
+                }
+
+                for (NSTextCheckingResult *linkMatch in linkMatches)
+                {
+                    if (NSIntersectionRange(match.range, linkMatch.range).length == match.range.length)
+                    {
+                        hasAlreadyLink = YES;
+                        break;
+                    }
+                }
+            }
+
+            if (!hasAlreadyLink)
+            {
+                NSString *link = [attributedString.string substringWithRange:match.range];
+                link = [link stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+                [mutableAttributedString addAttribute:NSLinkAttributeName value:link range:match.range];
+            }
+        }];
+    }
+
+    return mutableAttributedString;
+}
+
+/**
+ A long message made of code blocks full of identifiers.
+ */
+- (NSAttributedString*)codeBlockHeavyMessage
+{
+    NSMutableString *message = [NSMutableString string];
+    for (NSUInteger index = 0; index < 200; index++)
+    {
+        [message appendFormat:@"let user%tu = client.user(\"@bob%tu:matrix.org\") // in !room%tu:matrix.org\n", index, index, index];
+        [message appendFormat:@"room.send(to: \"#alias%tu:matrix.org\", replyTo: \"$event%tu:matrix.org\", group: \"+group%tu:matrix.org\")\n", index, index, index];
+        [message appendString:@"for (i = 0; i < count; i++) { total += values[i] * weights[i]; }\n"];
+    }
+
+    return [[NSAttributedString alloc] initWithString:message attributes:@{NSFontAttributeName: [UIFont fontWithName:@"Menlo-Regular" size:13]}];
+}
+
+#pragma mark - Single pass linkifier
+
+- (void)testLinkifierConformance
+{
+    NSArray<NSString*> *strings = @[
+                                    @"Hello @bob:matrix.org, welcome to #matrix:matrix.org",
+                                    @"!room:matrix.org $event:matrix.org +group:matrix.org",
+                                    @"No identifier here",
+                                    @"@alice:example.com and @bob:example.com\nhttps://matrix.to/#/#matrix:matrix.org",
+                                    @"A link to https://matrix.to/#/@bob:matrix.org",
+                                    ];
+
+    NSMutableArray<NSAttributedString*> *corpus = [NSMutableArray array];
+    for (NSString *string in strings)
+    {
+        [corpus addObject:[[NSAttributedString alloc] initWithString:string]];
+    }
+
+    // An existing link must be kept
+    NSMutableAttributedString *linkedString = [[NSMutableAttributedString alloc] initWithString:@"See @bob:matrix.org or @alice:matrix.org"];
+    [linkedString addAttribute:NSLinkAttributeName value:[NSURL URLWithString:@"https://matrix.org"] range:NSMakeRange(4, 15)];
+    [corpus addObject:linkedString];
+
+    [corpus addObject:self.codeBlockHeavyMessage];
+
+    for (NSAttributedString *attributedString in corpus)
+    {
+        NSAttributedString *reference = [self multiPassCreateLinksInAttributedString:attributedString];
+        NSAttributedString *result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK];
+
+        XCTAssertEqualObjects(result.string, reference.string);
+        for (NSUInteger index = 0; index < reference.length; index++)
+        {
+            XCTAssertEqualObjects([result attribute:NSLinkAttributeName atIndex:index effectiveRange:nil],
+                                  [reference attribute:NSLinkAttributeName atIndex:index effectiveRange:nil],
+                                  @"Link mismatch at %tu in \"%@\"", index, reference.string);
+        }
+    }
+}
+
+- (void)testLinkifierEnabledMatrixIds
+{
+    NSAttributedString *attributedString = [[NSAttributedString alloc] initWithString:@"@bob:matrix.org #matrix:matrix.org"];
+    NSAttributedString *result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLS_ROOM_ALIAS_BITWISE];
+
+    XCTAssertNil([result attribute:NSLinkAttributeName atIndex:0 effectiveRange:nil]);
+    XCTAssertEqualObjects([result attribute:NSLinkAttributeName atIndex:16 effectiveRange:nil], @"%23matrix:matrix.org");
+}
+
+- (void)testLinkifierHttpLinksWithCustomSchemes
+{
+    NSAttributedString *attributedString = [[NSAttributedString alloc] initWithString:@"Go to https://matrix.org/#/@bob:matrix.org. Or http://example.com"];
+    NSAttributedString *result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK httpLinkScheme:@"myhttp" httpsLinkScheme:@"myhttps"];
+
+    NSRange range;
+    NSURL *link = [result attribute:NSLinkAttributeName atIndex:6 effectiveRange:&range];
+    XCTAssertEqualObjects(link.absoluteString, @"myhttps://matrix.org/#/@bob:matrix.org");
+    XCTAssertEqual(range.length, @"https://matrix.org/#/@bob:matrix.org".length, @"The link must not contain the trailing punctuation");
+
+    link = [result attribute:NSLinkAttributeName atIndex:(result.length - 1) effectiveRange:nil];
+    XCTAssertEqualObjects(link.absoluteString, @"myhttp://example.com");
+
+    // Without custom schemes, the http links are left to the UI
+    result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK];
+    XCTAssertEqual(result, attributedString);
+}
+
+- (void)testLinkifierHttpLinksTrailingPunctuation
+{
+    NSDictionary<NSString*, NSString*> *expectedLinks = @{
+                                                          @"(https://x.org).": @"https://x.org",
+                                                          @"www.x.org,": @"www.x.org",
+                                                          @"Write to alice@x.org.": @"alice@x.org",
+                                                          @"See x.org/path.": @"x.org/path",
+                                                          };
+    
+    for (NSString *string in expectedLinks)
+    {
+        NSAttributedString *attributedString = [[NSAttributedString alloc] initWithString:string];
+        NSAttributedString *result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK httpLinkScheme:@"myhttp" httpsLinkScheme:@"myhttps"];
+        
+        NSRange expectedRange = [string rangeOfString:expectedLinks[string]];
+        NSRange range;
+        NSURL *link = [result attribute:NSLinkAttributeName atIndex:expectedRange.location effectiveRange:&range];
+        XCTAssertNotNil(link, @"No link in \"%@\"", string);
+        XCTAssertTrue(NSEqualRanges(range, expectedRange), @"The link must not contain the trailing punctuation in \"%@\"", string);
+    }
+    
+    NSAttributedString *attributedString = [[NSAttributedString alloc] initWithString:@"www.x.org, alice@x.org"];
+    NSAttributedString *result = [MXKTools createLinksInAttributedString:attributedString forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK httpLinkScheme:@"myhttp" httpsLinkScheme:@"myhttps"];
+    XCTAssertEqualObjects([[result attribute:NSLinkAttributeName atIndex:0 effectiveRange:nil] absoluteString], @"myhttp://www.x.org");
+    XCTAssertEqualObjects([[result attribute:NSLinkAttributeName atIndex:(result.length - 1) effectiveRange:nil] absoluteString], @"mailto:alice@x.org");
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceMultiPassLinkifier
+{
+    NSAttributedString *message = self.codeBlockHeavyMessage;
+
+    [self measureBlock:^{
+        [self multiPassCreateLinksInAttributedString:message];
+    }];
+}
+
+- (void)testPerformanceSinglePassLinkifier
+{
+    NSAttributedString *message = self.codeBlockHeavyMessage;
+
+    [self measureBlock:^{
+        [MXKTools createLinksInAttributedString:message forEnabledMatrixIds:MXKTOOLSTESTS_ALL_MATRIX_IDS_BITMASK];
+    }];
+}
+
+@end